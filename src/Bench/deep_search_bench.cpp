@@ -0,0 +1,121 @@
+// Deep search throughput benchmark.
+//
+// Seeds a database with text entries of a given size and runs
+// DataManager::DeepSearch for a needle none of them contains, so every
+// payload is read in full through the read connections and the search pool.
+// Reports bytes scanned per second (GB/s) for each run and the median, then
+// the time to the first hits for a needle in the newest entries.
+//
+// Runs on a fresh in-memory database by default; with a path, on a new
+// database file there (which must not exist yet).
+//
+// Usage: clipx_deep_search_bench [entries] [entry_kb] [runs] [db_file]
+
+#include "data_manager.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace clipx;
+
+namespace {
+
+const char* const WORDS[] = {"request", "timeout", "connection", "service", "worker", "cache", "invalid",
+                             "token", "session", "expired", "database", "query", "index", "snapshot",
+                             "retry", "handler", "payload", "shard", "replica", "leader"};
+
+// Log-like text of about `size` bytes, no digits or rare words in it
+std::string MakeText(std::mt19937& rng, size_t size) {
+    std::uniform_int_distribution<size_t> word(0, std::size(WORDS) - 1);
+    std::uniform_int_distribution<int> lineLength(6, 16);
+    std::string text;
+    text.reserve(size + 32);
+    while (text.size() < size) {
+        int words = lineLength(rng);
+        for (int w = 0; w < words; w++) {
+            if (w) text += ' ';
+            text += WORDS[word(rng)];
+        }
+        text += '\n';
+    }
+    text.resize(size);
+    return text;
+}
+
+bool Seed(int count, size_t entrySize) {
+    std::mt19937 rng(11);
+    int64_t timestamp = 1718000000000;
+    bool ok = true;
+    DataManager::Instance().Transaction([&]() {
+        for (int i = 0; i < count && ok; i++) {
+            ClipboardEntry entry;
+            entry.timestamp = timestamp - i * 61000LL;
+            entry.type = ClipboardDataType::Text;
+            std::string text = MakeText(rng, entrySize);
+            if (i < 3) text.replace(text.size() / 2, 6, "NEEDLE");  // Near the top of the history
+            entry.data.assign(text.begin(), text.end());
+            entry.preview = text.substr(0, 200);
+            entry.sourceApp = "bench.exe";
+            entry.isTagged = true;  // Stored in the database, not kept in memory
+            ok = DataManager::Instance().Insert(entry) > 0;
+        }
+        return ok;
+    });
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const int entries = argc > 1 ? std::max(1, std::atoi(argv[1])) : 2000;
+    const size_t entryKb = argc > 2 ? static_cast<size_t>(std::max(1, std::atoi(argv[2]))) : 64;
+    const int runs = argc > 3 ? std::max(1, std::atoi(argv[3])) : 5;
+    const std::string dbPath = argc > 4 ? argv[4] : ":memory:";
+
+    if (dbPath != ":memory:" && std::ifstream(dbPath).good()) {
+        std::fprintf(stderr, "%s exists; give a path for a new database\n", dbPath.c_str());
+        return 2;
+    }
+    if (!DataManager::Instance().Initialize(dbPath)) {
+        std::fprintf(stderr, "failed to open %s\n", dbPath.c_str());
+        return 1;
+    }
+    if (!Seed(entries, entryKb * 1024)) {
+        std::fprintf(stderr, "failed to seed the database\n");
+        return 1;
+    }
+
+    std::printf("%d entries of %zu KB (%.1f MB), %s, %u hardware threads\n\n", entries, entryKb,
+                entries * entryKb / 1024.0, dbPath.c_str(), std::thread::hardware_concurrency());
+    std::printf("%-6s %12s %10s %10s %12s\n", "run", "scanned MB", "entries", "ms", "GB/s");
+
+    std::vector<double> throughput;
+    for (int run = 0; run < runs; run++) {
+        DeepSearchStats stats;
+        auto hits = DataManager::Instance().DeepSearch("absent-needle-qzx", 50, nullptr, &stats);
+        if (!hits.empty()) {
+            std::fprintf(stderr, "unexpected hits\n");
+            return 1;
+        }
+        throughput.push_back(stats.ThroughputGBps());
+        std::printf("%-6d %12.1f %10zu %10.2f %12.2f\n", run + 1, stats.bytesScanned / 1e6, stats.entriesScanned,
+                    stats.elapsedMs, stats.ThroughputGBps());
+    }
+    std::sort(throughput.begin(), throughput.end());
+    std::printf("\nmedian: %.2f GB/s, best: %.2f GB/s\n", throughput[throughput.size() / 2], throughput.back());
+
+    DeepSearchStats stats;
+    auto hits = DataManager::Instance().DeepSearch("needle", 3, nullptr, &stats);
+    std::printf("first %zu hits: %.2f ms, %zu entries scanned\n", hits.size(), stats.elapsedMs,
+                stats.entriesScanned);
+
+    DataManager::Instance().Shutdown();
+    return 0;
+}
@@ -0,0 +1,141 @@
+// IPC allocation benchmark.
+//
+// Counts heap allocations on the daemon's side of a GET_HISTORY exchange:
+// decoding the request into a reused IPCRequest, then encoding a page of
+// entries into a reused frame buffer, the way IPCSession does. The old
+// path (parse into a json tree, FromJson, ToJson().dump()) is measured for
+// comparison. Running the query itself is not included.
+//
+// Usage: clipx_ipc_alloc_bench [entries] [iterations]
+
+#include "common/ipc_codec.h"
+#include "common/ipc_transport.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::atomic<uint64_t> g_allocations{0};
+std::atomic<uint64_t> g_allocatedBytes{0};
+
+void* Allocate(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+} // namespace
+
+void* operator new(size_t size) { return Allocate(size); }
+void* operator new[](size_t size) { return Allocate(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+using namespace clipx;
+
+namespace {
+
+std::vector<ClipboardEntry> MakeEntries(int count) {
+    std::vector<ClipboardEntry> entries;
+    for (int i = 0; i < count; i++) {
+        ClipboardEntry entry;
+        entry.id = i + 1;
+        entry.timestamp = 1718000000000 - i * 61000LL;
+        entry.preview = "connection timeout while refreshing the session token \"" + std::to_string(i) + "\"";
+        entry.sourceApp = "Code.exe";
+        entry.copyCount = 1 + i % 3;
+        if (i % 4 == 0) {
+            entry.isTagged = true;
+            entry.tags = {"work", "snippets"};
+        }
+        entries.push_back(std::move(entry));
+    }
+    return entries;
+}
+
+struct Counts {
+    double allocations = 0.0;  // Per request
+    double bytes = 0.0;
+};
+
+template<typename Fn>
+Counts Measure(int iterations, Fn&& serve) {
+    for (int i = 0; i < 16; i++) serve(i);  // Warm-up: buffers reach their working size
+
+    uint64_t allocations = g_allocations.load();
+    uint64_t bytes = g_allocatedBytes.load();
+    for (int i = 0; i < iterations; i++) serve(i);
+
+    Counts counts;
+    counts.allocations = static_cast<double>(g_allocations.load() - allocations) / iterations;
+    counts.bytes = static_cast<double>(g_allocatedBytes.load() - bytes) / iterations;
+    return counts;
+}
+
+void Fail(const char* what) {
+    std::fprintf(stderr, "%s\n", what);
+    std::exit(1);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const int entryCount = argc > 1 ? std::max(1, std::atoi(argv[1])) : 100;
+    const int iterations = argc > 2 ? std::max(1, std::atoi(argv[2])) : 2000;
+
+    // Built once, as the dispatcher's result would be
+    IPCResponse page = IPCResponse::Success(1, {{"total", entryCount}, {"seq", 42}});
+    page.entries = MakeEntries(entryCount);
+
+    std::printf("GET_HISTORY server path, %d entries, %d iterations\n\n", entryCount, iterations);
+    std::printf("%-8s %-8s %14s %14s\n", "codec", "path", "allocs/req", "bytes/req");
+
+    for (IPCCodec codec : {IPCCodec::Json, IPCCodec::MsgPack}) {
+        IPCRequest request;
+        request.action = IPCAction::GET_HISTORY;
+        request.requestId = 1;
+        request.params = {{"limit", entryCount}, {"offset", 0}, {"favorites_only", false}};
+        std::vector<uint8_t> requestWire;
+        EncodeRequest(request, codec, requestWire);
+
+        // Per-session buffers
+        IPCRequest received;
+        std::vector<uint8_t> frame;
+
+        Counts streaming = Measure(iterations, [&](int) {
+            if (!DecodeRequest(requestWire.data(), requestWire.size(), codec, received) ||
+                received.GetHistoryParams().limit != entryCount) {
+                Fail("request decode failed");
+            }
+            frame.resize(IPC_FRAME_HEADER_SIZE);
+            EncodeResponse(page, codec, frame);
+        });
+        std::printf("%-8s %-8s %14.2f %14.0f\n", CodecName(codec), "stream", streaming.allocations, streaming.bytes);
+
+        if (codec != IPCCodec::Json) {
+            continue;
+        }
+
+        Counts tree = Measure(iterations, [&](int) {
+            auto json = nlohmann::json::parse(requestWire.begin(), requestWire.end());
+            IPCRequest parsed = IPCRequest::FromJson(json);
+            if (HistoryParams::FromJson(parsed.params).limit != entryCount) {
+                Fail("request decode failed");
+            }
+            std::string text = page.ToJson().dump();
+            frame.assign(text.begin(), text.end());
+        });
+        std::printf("%-8s %-8s %14.2f %14.0f\n", CodecName(codec), "tree", tree.allocations, tree.bytes);
+    }
+    return 0;
+}
@@ -0,0 +1,404 @@
+// IPC load generator and latency benchmark.
+//
+// Connects N clients and replays a weighted mix of GET_HISTORY, SEARCH,
+// GET_ENTRY and ADD_TAG at a target total rate. Reports per-action
+// throughput and latency percentiles as text, and as JSON with --json.
+//
+// By default the server runs in-process: the real ClipD request path
+// (RequestDispatcher over IPCServer) on an in-memory DataManager seeded with
+// generated entries, reached through the platform transport. --address
+// benchmarks a running ClipD instead.
+//
+// Latency is measured from the time a request was scheduled to be sent, so
+// a server that falls behind the target rate shows up as queueing delay
+// instead of silently lowering the offered load. --rate=0 sends back to back.
+// The server's own per-action handler time (get_action_stats) is printed
+// after the client-side table.
+//
+// Usage: clipx_ipc_bench [--clients=8] [--rate=2000] [--duration=10]
+//                        [--mix=get_history=40,search=30,get_entry=20,add_tag=10]
+//                        [--entries=5000] [--codec=msgpack] [--workers=4]
+//                        [--address=ADDR] [--json=FILE|-]
+
+#include "common/ipc_client.h"
+#include "common/ipc_transport.h"
+#include "data_manager.h"
+#include "ipc_server.h"
+#include "request_dispatcher.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace clipx;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char* const APPS[] = {"chrome.exe", "Code.exe", "WindowsTerminal.exe", "OUTLOOK.EXE", "slack.exe"};
+const char* const WORDS[] = {"request", "timeout", "connection", "service", "worker", "cache", "invalid",
+                             "token", "session", "expired", "database", "query", "index", "snapshot"};
+
+enum Action { GetHistory, Search, GetEntry, AddTag, ACTION_COUNT };
+const char* const ACTION_NAMES[ACTION_COUNT] = {"get_history", "search", "get_entry", "add_tag"};
+
+struct Options {
+    int clients = 8;
+    double rate = 2000.0;  // Requests per second over all clients; 0 = unthrottled
+    double duration = 10.0;
+    double mix[ACTION_COUNT] = {40, 30, 20, 10};
+    int entries = 5000;
+    IPCCodec codec = IPCCodec::MsgPack;
+    size_t workers = 4;
+    std::string address;  // Empty: in-process server
+    std::string jsonPath;
+};
+
+struct ClientResult {
+    std::vector<double> latencyMs[ACTION_COUNT];
+    size_t errors[ACTION_COUNT] = {};
+};
+
+[[noreturn]] void Usage(const char* error) {
+    std::fprintf(stderr, "%s\nUsage: clipx_ipc_bench [--clients=N] [--rate=R] [--duration=S] "
+                         "[--mix=action=weight,...] [--entries=N] [--codec=json|msgpack] [--workers=N] "
+                         "[--address=ADDR] [--json=FILE|-]\n", error);
+    std::exit(2);
+}
+
+bool ParseMix(const std::string& text, double (&mix)[ACTION_COUNT]) {
+    std::fill(std::begin(mix), std::end(mix), 0.0);
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = text.find(',', pos);
+        if (end == std::string::npos) end = text.size();
+        std::string item = text.substr(pos, end - pos);
+        size_t eq = item.find('=');
+        if (eq == std::string::npos) return false;
+
+        std::string name = item.substr(0, eq);
+        auto it = std::find_if(std::begin(ACTION_NAMES), std::end(ACTION_NAMES),
+                               [&](const char* n) { return name == n; });
+        if (it == std::end(ACTION_NAMES)) return false;
+        mix[it - std::begin(ACTION_NAMES)] = std::atof(item.c_str() + eq + 1);
+        pos = end + 1;
+    }
+    return std::any_of(std::begin(mix), std::end(mix), [](double w) { return w > 0; });
+}
+
+Options ParseOptions(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        if (arg.rfind("--", 0) != 0 || eq == std::string::npos) Usage(("Bad argument: " + arg).c_str());
+        std::string key = arg.substr(2, eq - 2);
+        std::string value = arg.substr(eq + 1);
+
+        if (key == "clients") options.clients = std::max(1, std::atoi(value.c_str()));
+        else if (key == "rate") options.rate = std::max(0.0, std::atof(value.c_str()));
+        else if (key == "duration") options.duration = std::max(0.1, std::atof(value.c_str()));
+        else if (key == "entries") options.entries = std::max(1, std::atoi(value.c_str()));
+        else if (key == "workers") options.workers = std::max(1, std::atoi(value.c_str()));
+        else if (key == "address") options.address = value;
+        else if (key == "json") options.jsonPath = value;
+        else if (key == "codec") {
+            if (!CodecFromName(value, options.codec)) Usage(("Unknown codec: " + value).c_str());
+        } else if (key == "mix") {
+            if (!ParseMix(value, options.mix)) Usage(("Bad mix: " + value).c_str());
+        } else {
+            Usage(("Unknown option: " + key).c_str());
+        }
+    }
+    return options;
+}
+
+std::string RandomText(std::mt19937& rng, int minWords, int maxWords) {
+    int words = std::uniform_int_distribution<int>(minWords, maxWords)(rng);
+    std::string text;
+    for (int w = 0; w < words; w++) {
+        if (w) text += ' ';
+        text += WORDS[std::uniform_int_distribution<size_t>(0, std::size(WORDS) - 1)(rng)];
+    }
+    return text;
+}
+
+std::vector<int64_t> SeedDatabase(int count) {
+    std::mt19937 rng(7);
+    std::vector<int64_t> ids;
+    int64_t timestamp = 1718000000000;
+
+    DataManager::Instance().Transaction([&]() {
+        for (int i = 0; i < count; i++) {
+            ClipboardEntry entry;
+            entry.timestamp = timestamp - i * 61000LL;
+            entry.type = ClipboardDataType::Text;
+            std::string text = RandomText(rng, 4, 60);
+            entry.data.assign(text.begin(), text.end());
+            entry.preview = text.substr(0, 200);
+            entry.sourceApp = APPS[std::uniform_int_distribution<size_t>(0, std::size(APPS) - 1)(rng)];
+            entry.isTagged = true;
+            int64_t id = DataManager::Instance().Insert(entry);
+            if (id > 0) ids.push_back(id);
+        }
+        return true;
+    });
+    return ids;
+}
+
+// Ids to aim GET_ENTRY and ADD_TAG at on an external server
+std::vector<int64_t> FetchIds(IPCClient& client) {
+    IPCRequest request;
+    request.action = IPCAction::GET_HISTORY;
+    request.params = {{"limit", 1000}, {"offset", 0}};
+    std::vector<int64_t> ids;
+    for (const auto& entry : client.SendRequest(request).GetEntries()) {
+        ids.push_back(entry.id);
+    }
+    return ids;
+}
+
+IPCRequest MakeRequest(Action action, std::mt19937& rng, const std::vector<int64_t>& ids) {
+    auto randomId = [&]() {
+        return ids.empty() ? int64_t{1} : ids[std::uniform_int_distribution<size_t>(0, ids.size() - 1)(rng)];
+    };
+
+    IPCRequest request;
+    request.action = ACTION_NAMES[action];
+    switch (action) {
+        case GetHistory:
+            request.params = {{"limit", 50}, {"offset", std::uniform_int_distribution<int>(0, 4)(rng) * 50}};
+            break;
+        case Search:
+            request.params = {{"keyword", RandomText(rng, 1, 2)}, {"limit", 50}};
+            break;
+        case GetEntry:
+            request.params = {{"id", randomId()}};
+            break;
+        case AddTag:
+            request.params = {{"id", randomId()}, {"tag", "bench" + std::to_string(rng() % 10)}};
+            break;
+        default:
+            break;
+    }
+    return request;
+}
+
+void RunClient(const Options& options, int index, const std::vector<int64_t>& ids, Clock::time_point start,
+               std::atomic<bool>& failed, ClientResult& result) {
+    IPCClient client;
+    client.SetPreferredCodec(options.codec);
+    if (!client.Connect(options.address, 5000)) {
+        std::fprintf(stderr, "client %d: connect failed\n", index);
+        failed = true;
+        return;
+    }
+
+    std::mt19937 rng(1000 + index);
+    std::discrete_distribution<int> pick(std::begin(options.mix), std::end(options.mix));
+
+    // Clients share the rate evenly, phase-shifted so sends don't bunch up
+    auto interval = options.rate > 0
+        ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.clients / options.rate))
+        : Clock::duration::zero();
+    auto next = start + interval * index / options.clients;
+    auto end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.duration));
+
+    while (true) {
+        auto scheduled = interval.count() > 0 ? next : Clock::now();
+        if (scheduled >= end) break;
+        std::this_thread::sleep_until(scheduled);
+
+        Action action = static_cast<Action>(pick(rng));
+        IPCResponse response = client.SendRequest(MakeRequest(action, rng, ids));
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - scheduled).count();
+
+        if (response.success) {
+            result.latencyMs[action].push_back(ms);
+        } else {
+            result.errors[action]++;
+            if (response.errorCode == IPCError::IPC_CONNECTION_FAILED) {
+                std::fprintf(stderr, "client %d: connection lost\n", index);
+                failed = true;
+                break;
+            }
+        }
+        next += interval;
+    }
+    client.Disconnect();
+}
+
+// Nearest-rank percentile of sorted samples
+double Percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+    return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+nlohmann::json Summarize(std::vector<double>& samples, size_t errors, double elapsed) {
+    std::sort(samples.begin(), samples.end());
+    return {
+        {"count", samples.size()},
+        {"errors", errors},
+        {"throughput", samples.size() / elapsed},
+        {"p50_ms", Percentile(samples, 0.50)},
+        {"p95_ms", Percentile(samples, 0.95)},
+        {"p99_ms", Percentile(samples, 0.99)},
+        {"p999_ms", Percentile(samples, 0.999)},
+        {"max_ms", samples.empty() ? 0.0 : samples.back()}
+    };
+}
+
+void PrintRow(const std::string& name, const nlohmann::json& row) {
+    std::printf("%-12s %8zu %7zu %9.1f %9.3f %9.3f %9.3f %9.3f %9.3f\n", name.c_str(),
+                row["count"].get<size_t>(), row["errors"].get<size_t>(), row["throughput"].get<double>(),
+                row["p50_ms"].get<double>(), row["p95_ms"].get<double>(), row["p99_ms"].get<double>(),
+                row["p999_ms"].get<double>(), row["max_ms"].get<double>());
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options = ParseOptions(argc, argv);
+
+    // In-process server over the real transport, on a private address
+    IPCServer server;
+    std::unique_ptr<RequestDispatcher> dispatcher;
+    std::vector<int64_t> ids;
+    bool inProcess = options.address.empty();
+    if (inProcess) {
+        if (!DataManager::Instance().Initialize(":memory:")) {
+            std::fprintf(stderr, "failed to open in-memory database\n");
+            return 1;
+        }
+        ids = SeedDatabase(options.entries);
+        dispatcher = std::make_unique<RequestDispatcher>();
+
+        server.SetRequestHandler([&](const IPCRequest& request, const std::shared_ptr<IPCSession>& session) {
+            return dispatcher->Handle(request, session);
+        });
+        server.SetSessionClosedHandler([&](const std::shared_ptr<IPCSession>& session) {
+            dispatcher->SessionClosed(session->GetId());
+        });
+
+        IPCServerOptions serverOptions;
+        serverOptions.workerCount = options.workers;
+        serverOptions.maxConnections = std::max<size_t>(serverOptions.maxConnections, options.clients + 1);
+        options.address = DefaultIPCAddress() + "-bench-" + std::to_string(std::random_device{}());
+        if (!server.Start(options.address, serverOptions)) {
+            std::fprintf(stderr, "failed to start server on %s\n", options.address.c_str());
+            return 1;
+        }
+    } else {
+        IPCClient probe;
+        if (!probe.Connect(options.address, 5000)) {
+            std::fprintf(stderr, "cannot connect to %s\n", options.address.c_str());
+            return 1;
+        }
+        ids = FetchIds(probe);
+    }
+
+    std::printf("%d clients, %s, %.1f s, codec %s, %s\n\n", options.clients,
+                options.rate > 0 ? (std::to_string(static_cast<int>(options.rate)) + " req/s target").c_str()
+                                 : "unthrottled",
+                options.duration, CodecName(options.codec),
+                inProcess ? ("in-process server, " + std::to_string(ids.size()) + " entries").c_str()
+                          : options.address.c_str());
+
+    std::vector<ClientResult> results(options.clients);
+    std::vector<std::thread> threads;
+    std::atomic<bool> failed{false};
+    auto start = Clock::now() + std::chrono::milliseconds(100);  // Let every client connect first
+    for (int i = 0; i < options.clients; i++) {
+        threads.emplace_back(RunClient, std::cref(options), i, std::cref(ids), start, std::ref(failed),
+                             std::ref(results[i]));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Time spent in the handlers, as measured by the server (older
+    // daemons don't report it)
+    nlohmann::json serverActions;
+    {
+        IPCClient probe;
+        IPCRequest request;
+        request.action = IPCAction::GET_ACTION_STATS;
+        if (probe.Connect(options.address, 5000)) {
+            IPCResponse response = probe.SendRequest(request);
+            if (response.success && response.data.contains("actions")) {
+                serverActions = response.data["actions"];
+            }
+        }
+    }
+
+    if (inProcess) {
+        server.Stop();
+        dispatcher.reset();
+        DataManager::Instance().Shutdown();
+    }
+
+    // Merge per-client samples
+    nlohmann::json report = {
+        {"clients", options.clients},
+        {"target_rate", options.rate},
+        {"duration_s", options.duration},
+        {"elapsed_s", elapsed},
+        {"codec", CodecName(options.codec)},
+        {"server", inProcess ? "in-process" : options.address},
+        {"actions", nlohmann::json::object()}
+    };
+    std::vector<double> all;
+    size_t allErrors = 0;
+    std::printf("%-12s %8s %7s %9s %9s %9s %9s %9s %9s\n", "action", "count", "errors", "req/s",
+                "p50 ms", "p95 ms", "p99 ms", "p999 ms", "max ms");
+    for (int a = 0; a < ACTION_COUNT; a++) {
+        std::vector<double> samples;
+        size_t errors = 0;
+        for (auto& result : results) {
+            samples.insert(samples.end(), result.latencyMs[a].begin(), result.latencyMs[a].end());
+            errors += result.errors[a];
+        }
+        if (samples.empty() && errors == 0) continue;
+
+        all.insert(all.end(), samples.begin(), samples.end());
+        allErrors += errors;
+        nlohmann::json row = Summarize(samples, errors, elapsed);
+        PrintRow(ACTION_NAMES[a], row);
+        report["actions"][ACTION_NAMES[a]] = row;
+    }
+    report["total"] = Summarize(all, allErrors, elapsed);
+    PrintRow("total", report["total"]);
+
+    if (serverActions.is_array()) {
+        std::printf("\nserver handler time\n");
+        std::printf("%-18s %8s %7s %9s %9s %9s %9s\n", "action", "count", "errors", "mean us", "p50 us", "p99 us", "max us");
+        for (const auto& row : serverActions) {
+            std::printf("%-18s %8zu %7zu %9zu %9zu %9zu %9zu\n", row["action"].get<std::string>().c_str(),
+                        row["count"].get<size_t>(), row["errors"].get<size_t>(), row["mean_us"].get<size_t>(),
+                        row["p50_us"].get<size_t>(), row["p99_us"].get<size_t>(), row["max_us"].get<size_t>());
+        }
+        report["server_actions"] = serverActions;
+    }
+
+    if (!options.jsonPath.empty()) {
+        std::string text = report.dump(2);
+        if (options.jsonPath == "-") {
+            std::printf("\n%s\n", text.c_str());
+        } else {
+            std::ofstream(options.jsonPath) << text << "\n";
+        }
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,171 @@
+// IPC codec benchmark.
+//
+// Measures one GET_HISTORY exchange per codec without the pipe: the client
+// encodes the request, the server decodes it and encodes a page of entries,
+// the client decodes the reply into ClipboardEntry structs. Reports the
+// round-trip CPU time and bytes on the wire (header included).
+//
+// Usage: clipx_ipc_codec_bench [entries] [iterations]
+
+#include "common/ipc_codec.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace clipx;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char* const APPS[] = {"chrome.exe", "Code.exe", "WindowsTerminal.exe", "OUTLOOK.EXE", "slack.exe"};
+const char* const WORDS[] = {"request", "timeout", "connection", "service", "worker", "cache", "invalid",
+                             "token", "session", "expired", "database", "query", "index", "snapshot"};
+
+std::vector<ClipboardEntry> MakeEntries(int count) {
+    std::mt19937 rng(7);
+    auto pick = [&](int n) { return std::uniform_int_distribution<int>(0, n - 1)(rng); };
+
+    std::vector<ClipboardEntry> entries;
+    int64_t timestamp = 1718000000000;
+    for (int i = 0; i < count; i++) {
+        ClipboardEntry entry;
+        entry.id = -(i + 1);
+        entry.timestamp = timestamp - i * 61000LL;
+        entry.type = pick(10) == 0 ? ClipboardDataType::Image : ClipboardDataType::Text;
+        // Previews are capped at a few hundred characters by the daemon
+        int words = 4 + pick(40);
+        for (int w = 0; w < words; w++) {
+            if (w) entry.preview += ' ';
+            entry.preview += WORDS[pick(static_cast<int>(std::size(WORDS)))];
+        }
+        entry.sourceApp = APPS[pick(static_cast<int>(std::size(APPS)))];
+        entry.copyCount = 1 + pick(3);
+        entry.isFavorited = pick(8) == 0;
+        if (pick(4) == 0) {
+            entry.isTagged = true;
+            entry.tags = {"work", "snippets"};
+        }
+        entries.push_back(std::move(entry));
+    }
+    return entries;
+}
+
+struct Result {
+    size_t requestBytes = 0;
+    size_t responseBytes = 0;
+    std::vector<double> samplesUs;
+};
+
+Result Run(IPCCodec codec, const std::vector<ClipboardEntry>& page, int iterations) {
+    Result result;
+    result.samplesUs.reserve(iterations);
+
+    std::vector<uint8_t> requestWire;
+    std::vector<uint8_t> responseWire;
+    size_t checksum = 0;
+
+    for (int i = 0; i < iterations; i++) {
+        auto start = Clock::now();
+
+        // Client -> server
+        IPCRequest request;
+        request.action = IPCAction::GET_HISTORY;
+        request.requestId = i;
+        request.params = {{"limit", static_cast<int>(page.size())}, {"offset", 0}};
+        requestWire.clear();
+        EncodeRequest(request, codec, requestWire);
+
+        IPCRequest received;
+        if (!DecodeRequest(requestWire.data(), requestWire.size(), codec, received)) {
+            std::fprintf(stderr, "request decode failed\n");
+            std::exit(1);
+        }
+
+        // Server -> client
+        IPCResponse response = IPCResponse::Success(received.requestId, {{"total", page.size()}});
+        response.entries = page;
+        responseWire.clear();
+        EncodeResponse(response, codec, responseWire);
+
+        IPCServerMessage message;
+        if (!DecodeServerMessage(responseWire.data(), responseWire.size(), codec, message)) {
+            std::fprintf(stderr, "response decode failed\n");
+            std::exit(1);
+        }
+        std::vector<ClipboardEntry> entries = message.response.GetEntries();
+
+        result.samplesUs.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+        checksum += entries.size() + entries.back().preview.size();
+    }
+
+    if (checksum == 0) std::printf("\n");
+    result.requestBytes = requestWire.size() + sizeof(IPCHeader);
+    result.responseBytes = responseWire.size() + sizeof(IPCHeader);
+    return result;
+}
+
+double Percentile(std::vector<double> samples, double p) {
+    std::sort(samples.begin(), samples.end());
+    size_t index = static_cast<size_t>(p * (samples.size() - 1));
+    return samples[index];
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const int entryCount = argc > 1 ? std::max(1, std::atoi(argv[1])) : 100;
+    const int iterations = argc > 2 ? std::max(1, std::atoi(argv[2])) : 2000;
+
+    std::vector<ClipboardEntry> page = MakeEntries(entryCount);
+
+    // Both codecs must produce the same entries
+    for (IPCCodec codec : {IPCCodec::Json, IPCCodec::MsgPack}) {
+        IPCResponse response = IPCResponse::Success(1, {{"total", page.size()}});
+        response.entries = page;
+        std::vector<uint8_t> wire;
+        EncodeResponse(response, codec, wire);
+        IPCServerMessage message;
+        DecodeServerMessage(wire.data(), wire.size(), codec, message);
+        auto decoded = message.response.GetEntries();
+        for (size_t i = 0; i < page.size(); i++) {
+            if (decoded.size() != page.size() || decoded[i].id != page[i].id ||
+                decoded[i].preview != page[i].preview || decoded[i].tags != page[i].tags) {
+                std::fprintf(stderr, "%s round trip mismatch\n", CodecName(codec));
+                return 1;
+            }
+        }
+    }
+
+    std::printf("GET_HISTORY, %d entries, %d iterations\n\n", entryCount, iterations);
+    std::printf("%-8s %10s %10s %10s %10s %10s\n", "codec", "req bytes", "resp bytes", "p50 us", "p99 us", "mean us");
+
+    double jsonMean = 0.0;
+    size_t jsonBytes = 0;
+    for (IPCCodec codec : {IPCCodec::Json, IPCCodec::MsgPack}) {
+        Run(codec, page, std::max(1, iterations / 10));  // Warm-up
+        Result result = Run(codec, page, iterations);
+
+        double mean = 0.0;
+        for (double s : result.samplesUs) mean += s;
+        mean /= result.samplesUs.size();
+
+        std::printf("%-8s %10zu %10zu %10.1f %10.1f %10.1f\n", CodecName(codec),
+                    result.requestBytes, result.responseBytes,
+                    Percentile(result.samplesUs, 0.50), Percentile(result.samplesUs, 0.99), mean);
+
+        if (codec == IPCCodec::Json) {
+            jsonMean = mean;
+            jsonBytes = result.responseBytes;
+        } else {
+            std::printf("\nmsgpack vs json: %.2fx faster, %.1f%% fewer response bytes\n",
+                        jsonMean / mean, 100.0 * (1.0 - static_cast<double>(result.responseBytes) / jsonBytes));
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,313 @@
+// Near-duplicate detection benchmark.
+//
+// Builds a synthetic clipboard history that mixes log lines, stack traces,
+// code, prose and URLs, where a share of the clips are re-copies that differ
+// only in a timestamp, whitespace, a trailing newline or an added word.
+// Reports fingerprint throughput, then for each distance the capture cost,
+// how much storage collapsing saves over exact-hash dedup, how many re-copies
+// of each kind collapse, and how many unrelated clips are folded together.
+//
+// Usage: clipx_simhash_bench [clips] [near_copy_percent]
+
+#include "common/simhash.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <optional>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using namespace clipx;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// How a re-copy differs from the clip it copies
+enum CopyKind { ORIGINAL = -1, NUMBERS, TRAILING_NEWLINE, INDENTED, SPACING, EXTRA_WORD, COPY_KINDS };
+
+const char* const COPY_KIND_NAMES[COPY_KINDS] = {"numbers", "newline", "indent", "spacing", "word"};
+
+struct Clip {
+    std::string text;
+    int family;  // Clips of the same family are copies of one original
+    CopyKind kind;
+};
+
+const char* const SYLLABLES[] = {
+    "re", "quest", "time", "out", "con", "nect", "ion", "serv", "ice", "work", "er", "cache",
+    "in", "val", "id", "tok", "en", "ses", "sion", "ex", "pire", "han", "dle", "da", "ta",
+    "base", "que", "ry", "dex", "shard", "rep", "li", "lead", "lec", "snap", "shot", "com",
+    "pac", "lat", "cy", "the", "of", "to", "and", "for", "with", "on", "while", "af", "ter"
+};
+const char* const LEVELS[] = {"INFO", "WARN", "ERROR", "DEBUG"};
+const char* const FUNCS[] = {"main", "run", "dispatch", "handle_request", "load_config", "parse", "flush"};
+
+class Generator {
+public:
+    explicit Generator(uint32_t seed) : m_rng(seed) {
+        // A vocabulary of pseudo-words; Word() favors the front of it the way
+        // natural text favors common words
+        for (int i = 0; i < 4000; i++) {
+            std::string word;
+            int syllables = Int(1, 4);
+            for (int j = 0; j < syllables; j++) {
+                word += SYLLABLES[Int(0, static_cast<int>(std::size(SYLLABLES)) - 1)];
+            }
+            m_vocabulary.push_back(word);
+        }
+    }
+
+    int Int(int lo, int hi) { return std::uniform_int_distribution<int>(lo, hi)(m_rng); }
+
+    const std::string& Word() {
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(m_rng);
+        return m_vocabulary[static_cast<size_t>(u * u * u * (m_vocabulary.size() - 1))];
+    }
+
+    std::string Sentence(int words) {
+        std::string s;
+        for (int i = 0; i < words; i++) {
+            if (i) s += ' ';
+            s += Word();
+        }
+        return s;
+    }
+
+    std::string Timestamp() {
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "2024-%02d-%02d %02d:%02d:%02d.%03d",
+                      Int(1, 12), Int(1, 28), Int(0, 23), Int(0, 59), Int(0, 59), Int(0, 999));
+        return buf;
+    }
+
+    std::string LogLine() {
+        return Timestamp() + " " + LEVELS[Int(0, 3)] + " [worker-" + std::to_string(Int(1, 16)) + "] " +
+               Sentence(Int(6, 14)) + " id=" + std::to_string(Int(1000, 999999));
+    }
+
+    std::string StackTrace() {
+        std::string s = "Traceback (most recent call last):\n";
+        int frames = Int(3, 10);
+        for (int i = 0; i < frames; i++) {
+            s += "  File \"/srv/app/" + Word() + ".py\", line " + std::to_string(Int(1, 900)) +
+                 ", in " + FUNCS[Int(0, 6)] + "\n    " + Word() + "(" + Word() + ")\n";
+        }
+        s += "RuntimeError: " + Sentence(Int(3, 8)) + "\n";
+        return s;
+    }
+
+    std::string Code() {
+        std::string s;
+        int lines = Int(4, 30);
+        for (int i = 0; i < lines; i++) {
+            s += std::string(Int(0, 3) * 4, ' ') + "auto " + Word() + "_" + Word() + " = " + Word() +
+                 "(" + Word() + ", " + std::to_string(Int(0, 100)) + ");\n";
+        }
+        return s;
+    }
+
+    std::string Prose() {
+        std::string s;
+        int sentences = Int(2, 12);
+        for (int i = 0; i < sentences; i++) {
+            s += Sentence(Int(8, 20)) + ". ";
+        }
+        return s;
+    }
+
+    std::string Url() {
+        return "https://" + Word() + ".example.com/" + Word() + "/" + Word() + "?id=" + std::to_string(Int(1, 1 << 30));
+    }
+
+    std::string Original() {
+        switch (Int(0, 9)) {
+            case 0: case 1: case 2: return LogLine();
+            case 3: case 4: return StackTrace();
+            case 5: case 6: return Code();
+            case 7: case 8: return Prose();
+            default: return Url();
+        }
+    }
+
+    // A re-copy of `text`: new numbers, different whitespace, a trailing
+    // newline, or one more word
+    std::string NearCopy(const std::string& text, CopyKind kind) {
+        std::string copy = text;
+        switch (kind) {
+            case NUMBERS:
+                for (char& c : copy) {
+                    if (c >= '0' && c <= '9' && Int(0, 3) == 0) c = static_cast<char>('0' + Int(0, 9));
+                }
+                break;
+            case TRAILING_NEWLINE:
+                copy += "\n";
+                break;
+            case INDENTED:
+                copy = "  " + copy + "\t";
+                break;
+            case EXTRA_WORD: {
+                size_t space = copy.find(' ', static_cast<size_t>(Int(0, static_cast<int>(copy.size()) - 1)));
+                copy.insert(space == std::string::npos ? copy.size() : space, " " + Word());
+                break;
+            }
+            case SPACING:
+                for (size_t i = 0; i < copy.size(); i++) {
+                    if (copy[i] == ' ' && Int(0, 5) == 0) copy.insert(i++, " ");
+                }
+                break;
+            default:
+                break;
+        }
+        return copy;
+    }
+
+private:
+    std::mt19937 m_rng;
+    std::vector<std::string> m_vocabulary;
+};
+
+uint64_t ExactKey(const std::string& text) {
+    return std::hash<std::string>{}(text);
+}
+
+struct Capture {
+    double seconds = 0;
+    size_t entries = 0;
+    uint64_t bytes = 0;
+    size_t wrongFamily = 0;
+    size_t copies[COPY_KINDS] = {};
+    size_t collapsed[COPY_KINDS] = {};
+};
+
+// Capture as ClipD does it: exact dedup first, then collapsing into the
+// nearest entry within maxDistance, which takes the newest text
+Capture Simulate(const std::vector<Clip>& clips, const std::vector<uint64_t>& fingerprints, int maxDistance) {
+    Capture capture;
+    SimHashIndex index;
+    std::unordered_map<int64_t, size_t> entryText;  // Entry id -> clip holding its current text
+    std::unordered_map<uint64_t, int64_t> exactIds;
+    int64_t nextId = 1;
+
+    auto start = Clock::now();
+    for (size_t i = 0; i < clips.size(); i++) {
+        const Clip& clip = clips[i];
+        uint64_t key = ExactKey(clip.text);
+        auto exact = exactIds.find(key);
+        if (exact != exactIds.end()) {
+            entryText[exact->second] = i;
+            continue;
+        }
+
+        std::optional<int64_t> nearId;
+        if (fingerprints[i] != 0) {
+            nearId = index.FindNearest(fingerprints[i], maxDistance);
+            if (clip.kind != ORIGINAL) capture.copies[clip.kind]++;
+        }
+        if (nearId) {
+            if (clips[entryText[*nearId]].family != clip.family) {
+                capture.wrongFamily++;
+            } else if (clip.kind != ORIGINAL) {
+                capture.collapsed[clip.kind]++;
+            }
+            entryText[*nearId] = i;
+            index.Add(*nearId, fingerprints[i]);
+            exactIds[key] = *nearId;
+            continue;
+        }
+
+        int64_t id = nextId++;
+        entryText[id] = i;
+        exactIds[key] = id;
+        if (fingerprints[i] != 0) index.Add(id, fingerprints[i]);
+    }
+    capture.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    capture.entries = entryText.size();
+    for (const auto& [id, clipIndex] : entryText) {
+        capture.bytes += clips[clipIndex].text.size();
+    }
+    return capture;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const int clipCount = argc > 1 ? std::atoi(argv[1]) : 50000;
+    const int nearPercent = argc > 2 ? std::atoi(argv[2]) : 30;
+
+    Generator gen(42);
+    std::vector<Clip> clips;
+    clips.reserve(clipCount);
+    for (int i = 0; i < clipCount; i++) {
+        if (!clips.empty() && gen.Int(0, 99) < nearPercent) {
+            // Re-copy a recent clip, as happens when tailing logs
+            const Clip& source = clips[clips.size() - 1 - gen.Int(0, std::min<int>(200, static_cast<int>(clips.size()) - 1))];
+            CopyKind kind = static_cast<CopyKind>(gen.Int(0, COPY_KINDS - 1));
+            clips.push_back({gen.NearCopy(source.text, kind), source.family, kind});
+        } else {
+            clips.push_back({gen.Original(), i, ORIGINAL});
+        }
+    }
+
+    uint64_t totalBytes = 0;
+    for (const auto& clip : clips) totalBytes += clip.text.size();
+
+    // Fingerprint throughput
+    std::vector<uint64_t> fingerprints(clips.size());
+    auto start = Clock::now();
+    for (size_t i = 0; i < clips.size(); i++) {
+        fingerprints[i] = simhash::Compute(clips[i].text.data(), clips[i].text.size());
+    }
+    double fingerprintSec = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Exact dedup alone. Stored bytes count the newest text of each
+    // surviving entry.
+    std::unordered_map<uint64_t, size_t> exactEntries;  // Exact key -> clip index
+    uint64_t exactOnlyBytes = 0;
+    for (size_t i = 0; i < clips.size(); i++) {
+        if (exactEntries.emplace(ExactKey(clips[i].text), i).second) {
+            exactOnlyBytes += clips[i].text.size();
+        }
+    }
+
+    std::vector<Capture> captures;
+    for (int distance = 0; distance <= SimHashIndex::MAX_DISTANCE; distance++) {
+        captures.push_back(Simulate(clips, fingerprints, distance));
+    }
+
+    size_t families = 0;
+    {
+        std::unordered_set<int> seen;
+        for (const auto& clip : clips) seen.insert(clip.family);
+        families = seen.size();
+    }
+
+    std::printf("clips:                  %zu (%.1f MB, %d%% near copies)\n",
+                clips.size(), totalBytes / 1e6, nearPercent);
+    std::printf("fingerprinting:         %.1f MB/s, %.0f clips/s\n",
+                totalBytes / 1e6 / fingerprintSec, clips.size() / fingerprintSec);
+    std::printf("entries exact dedup:    %zu (%.2f MB)\n", exactEntries.size(), exactOnlyBytes / 1e6);
+    std::printf("distinct originals:     %zu\n", families);
+    std::printf("\n%-9s %8s %9s %8s %7s", "distance", "us/clip", "entries", "saved", "false");
+    for (const char* name : COPY_KIND_NAMES) std::printf(" %8s", name);
+    std::printf("\n");
+    for (size_t distance = 0; distance < captures.size(); distance++) {
+        const Capture& capture = captures[distance];
+        std::printf("%-9zu %8.2f %9zu %7.1f%% %7zu", distance, capture.seconds * 1e6 / clips.size(),
+                    capture.entries, exactOnlyBytes ? 100.0 * (exactOnlyBytes - capture.bytes) / exactOnlyBytes : 0.0,
+                    capture.wrongFamily);
+        for (int kind = 0; kind < COPY_KINDS; kind++) {
+            std::printf(" %7.1f%%", capture.copies[kind] ? 100.0 * capture.collapsed[kind] / capture.copies[kind] : 0.0);
+        }
+        std::printf("\n");
+    }
+    std::printf("\nsaved: storage over exact dedup; false: unrelated clips folded together;\n"
+                "per kind: share of fingerprinted re-copies collapsed into their original\n");
+    return 0;
+}
@@ -0,0 +1,111 @@
+// Thumbnail generation benchmark.
+//
+// Builds packed DIBs of common screenshot sizes in the layouts the
+// clipboard hands out (24 bpp bottom-up, 32 bpp with and without an alpha
+// mask) and times MakeThumbnail on each. Reports time per image, source
+// throughput and the size of the thumbnail against the original, i.e. what
+// a history page carries instead of the image.
+//
+// Usage: clipx_thumbnail_bench [iterations]
+
+#include "common/thumbnail.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace clipx;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Layout {
+    const char* name;
+    int bitCount;
+    bool topDown;
+    bool alphaMask;
+};
+
+void Put16(std::vector<uint8_t>& out, size_t offset, uint16_t value) {
+    std::memcpy(out.data() + offset, &value, sizeof(value));
+}
+
+void Put32(std::vector<uint8_t>& out, size_t offset, uint32_t value) {
+    std::memcpy(out.data() + offset, &value, sizeof(value));
+}
+
+// A gradient with noise, so neither the scaler nor the cache sees a
+// constant image
+std::vector<uint8_t> MakeDib(int width, int height, const Layout& layout, std::mt19937& rng) {
+    const size_t headerSize = 40;
+    const size_t masksSize = layout.alphaMask ? 16 : 0;
+    const size_t stride = ((static_cast<size_t>(width) * layout.bitCount + 31) / 32) * 4;
+    std::vector<uint8_t> dib(headerSize + masksSize + stride * height);
+
+    Put32(dib, 0, static_cast<uint32_t>(headerSize));
+    Put32(dib, 4, static_cast<uint32_t>(width));
+    Put32(dib, 8, static_cast<uint32_t>(layout.topDown ? -height : height));
+    Put16(dib, 12, 1);
+    Put16(dib, 14, static_cast<uint16_t>(layout.bitCount));
+    Put32(dib, 16, layout.alphaMask ? 6 : 0);  // BI_ALPHABITFIELDS or BI_RGB
+    if (layout.alphaMask) {
+        Put32(dib, headerSize, 0x00FF0000);
+        Put32(dib, headerSize + 4, 0x0000FF00);
+        Put32(dib, headerSize + 8, 0x000000FF);
+        Put32(dib, headerSize + 12, 0xFF000000);
+    }
+
+    std::uniform_int_distribution<int> noise(0, 31);
+    uint8_t* bits = dib.data() + headerSize + masksSize;
+    const int bytesPerPixel = layout.bitCount / 8;
+    for (int y = 0; y < height; y++) {
+        uint8_t* row = bits + y * stride;
+        for (int x = 0; x < width; x++) {
+            uint8_t* pixel = row + x * bytesPerPixel;
+            pixel[0] = static_cast<uint8_t>(x * 255 / width ^ noise(rng));
+            pixel[1] = static_cast<uint8_t>(y * 255 / height ^ noise(rng));
+            pixel[2] = static_cast<uint8_t>((x + y) & 0xFF);
+            if (bytesPerPixel == 4) pixel[3] = 255;
+        }
+    }
+    return dib;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const int iterations = argc > 1 ? std::max(1, std::atoi(argv[1])) : 20;
+
+    const struct { int width; int height; } sizes[] = {{800, 600}, {1920, 1080}, {2560, 1440}, {3840, 2160}};
+    const Layout layouts[] = {
+        {"24bpp bottom-up", 24, false, false},
+        {"32bpp bottom-up", 32, false, false},
+        {"32bpp top-down a", 32, true, true},
+    };
+
+    std::mt19937 rng(42);
+    std::printf("%-11s %-17s %10s %10s %12s %10s\n", "size", "layout", "ms/image", "MB/s", "source", "thumbnail");
+    for (const auto& size : sizes) {
+        for (const auto& layout : layouts) {
+            std::vector<uint8_t> dib = MakeDib(size.width, size.height, layout, rng);
+
+            size_t thumbnailSize = 0;
+            auto start = Clock::now();
+            for (int i = 0; i < iterations; i++) {
+                thumbnailSize += image::MakeThumbnail(dib.data(), dib.size()).size();
+            }
+            double sec = std::chrono::duration<double>(Clock::now() - start).count();
+            thumbnailSize /= iterations;
+
+            char dims[32];
+            std::snprintf(dims, sizeof(dims), "%dx%d", size.width, size.height);
+            std::printf("%-11s %-17s %10.2f %10.0f %10.1fMB %9zuB\n", dims, layout.name, sec * 1e3 / iterations,
+                        dib.size() * static_cast<double>(iterations) / 1e6 / sec, dib.size() / 1e6, thumbnailSize);
+        }
+    }
+    return 0;
+}
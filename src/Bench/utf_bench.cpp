@@ -0,0 +1,272 @@
+// UTF-8 transcoding benchmark.
+//
+// Converts an ASCII-heavy corpus (code and log text with the odd accented
+// word), a CJK-heavy corpus (Chinese prose with ASCII punctuation, numbers
+// and an occasional emoji) and a batch of short path and UI strings, in
+// both directions, with utils::WideToUtf8 / Utf8ToWide and with the
+// conversion they replaced: WideCharToMultiByte / MultiByteToWideChar
+// (sized by a first call) on Windows, the scalar fallback elsewhere.
+// Reports MB/s of UTF-8 and checks that both produce the same text.
+//
+// Usage: clipx_utf_bench [corpus_kb] [iterations]
+
+#ifdef _WIN32
+#include "common/windows.h"
+#endif
+#include "common/utils.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace clipx;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+namespace legacy {
+
+#ifdef _WIN32
+std::string WideToUtf8(const std::wstring& wstr) {
+    if (wstr.empty()) return "";
+
+    int size = WideCharToMultiByte(CP_UTF8, 0, wstr.c_str(), static_cast<int>(wstr.length()),
+                                    nullptr, 0, nullptr, nullptr);
+    if (size == 0) return "";
+
+    std::string result(size, 0);
+    WideCharToMultiByte(CP_UTF8, 0, wstr.c_str(), static_cast<int>(wstr.length()),
+                        &result[0], size, nullptr, nullptr);
+    return result;
+}
+
+std::wstring Utf8ToWide(const std::string& str) {
+    if (str.empty()) return L"";
+
+    int size = MultiByteToWideChar(CP_UTF8, 0, str.c_str(), static_cast<int>(str.length()),
+                                    nullptr, 0);
+    if (size == 0) return L"";
+
+    std::wstring result(size, 0);
+    MultiByteToWideChar(CP_UTF8, 0, str.c_str(), static_cast<int>(str.length()),
+                        &result[0], size);
+    return result;
+}
+#else
+// The fallback used outside Windows (wchar_t holds UTF-32)
+std::string WideToUtf8(const std::wstring& wstr) {
+    std::string result;
+    result.reserve(wstr.size());
+    for (wchar_t wc : wstr) {
+        uint32_t c = static_cast<uint32_t>(wc);
+        if (c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF)) c = 0xFFFD;
+        if (c < 0x80) {
+            result += static_cast<char>(c);
+        } else if (c < 0x800) {
+            result += static_cast<char>(0xC0 | (c >> 6));
+            result += static_cast<char>(0x80 | (c & 0x3F));
+        } else if (c < 0x10000) {
+            result += static_cast<char>(0xE0 | (c >> 12));
+            result += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            result += static_cast<char>(0x80 | (c & 0x3F));
+        } else {
+            result += static_cast<char>(0xF0 | (c >> 18));
+            result += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+            result += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            result += static_cast<char>(0x80 | (c & 0x3F));
+        }
+    }
+    return result;
+}
+
+std::wstring Utf8ToWide(const std::string& str) {
+    std::wstring result;
+    result.reserve(str.size());
+    size_t i = 0;
+    while (i < str.size()) {
+        unsigned char b = static_cast<unsigned char>(str[i]);
+        uint32_t c;
+        size_t extra;
+        if (b < 0x80) {
+            c = b;
+            extra = 0;
+        } else if ((b & 0xE0) == 0xC0) {
+            c = b & 0x1F;
+            extra = 1;
+        } else if ((b & 0xF0) == 0xE0) {
+            c = b & 0x0F;
+            extra = 2;
+        } else if ((b & 0xF8) == 0xF0) {
+            c = b & 0x07;
+            extra = 3;
+        } else {
+            result += L'\uFFFD';
+            i++;
+            continue;
+        }
+
+        if (extra > 0 && i + extra >= str.size()) {
+            result += L'\uFFFD';  // Truncated sequence
+            break;
+        }
+        bool valid = true;
+        for (size_t k = 1; k <= extra; k++) {
+            unsigned char cb = static_cast<unsigned char>(str[i + k]);
+            if ((cb & 0xC0) != 0x80) {
+                valid = false;
+                break;
+            }
+            c = (c << 6) | (cb & 0x3F);
+        }
+        if (!valid) {
+            result += L'\uFFFD';
+            i++;
+            continue;
+        }
+        result += static_cast<wchar_t>(c);
+        i += extra + 1;
+    }
+    return result;
+}
+#endif
+
+} // namespace legacy
+
+void Append(std::wstring& out, uint32_t c) {
+    if (sizeof(wchar_t) == 2 && c >= 0x10000) {
+        c -= 0x10000;
+        out += static_cast<wchar_t>(0xD800 + (c >> 10));
+        out += static_cast<wchar_t>(0xDC00 + (c & 0x3FF));
+    } else {
+        out += static_cast<wchar_t>(c);
+    }
+}
+
+const char* const WORDS[] = {
+    "request", "timeout", "connection", "service", "worker", "cache", "invalid", "token", "session",
+    "handle", "database", "query", "index", "shard", "snapshot", "latency", "return", "const",
+    "std::string", "if", "for", "while", "nullptr", "auto", "size_t", "0x7fff", "404", "->", "{", "}",
+};
+const char* const ACCENTED[] = {"café", "naïve", "résumé", "Zürich", "São", "niño"};
+
+std::wstring AsciiHeavy(size_t bytes, std::mt19937& rng) {
+    std::uniform_int_distribution<size_t> word(0, std::size(WORDS) - 1);
+    std::uniform_int_distribution<size_t> accented(0, std::size(ACCENTED) - 1);
+    std::uniform_int_distribution<int> percent(0, 99);
+    std::string text;
+    while (text.size() < bytes) {
+        text += percent(rng) == 0 ? ACCENTED[accented(rng)] : WORDS[word(rng)];
+        text += percent(rng) < 8 ? '\n' : ' ';
+    }
+    return utils::Utf8ToWide(text);
+}
+
+std::wstring CjkHeavy(size_t bytes, std::mt19937& rng) {
+    std::uniform_int_distribution<uint32_t> han(0x4E00, 0x9FFF);
+    std::uniform_int_distribution<int> percent(0, 999);
+    std::wstring text;
+    size_t utf8 = 0;
+    while (utf8 < bytes) {
+        int roll = percent(rng);
+        if (roll < 40) {
+            Append(text, 0xFF0C);  // Fullwidth comma
+        } else if (roll < 55) {
+            Append(text, 0x3002);  // Ideographic full stop
+        } else if (roll < 100) {
+            text += static_cast<wchar_t>(L'0' + roll % 10);
+            utf8 -= 2;
+        } else if (roll < 130) {
+            text += L' ';
+            utf8 -= 2;
+        } else if (roll < 132) {
+            Append(text, 0x1F600 + roll % 16);
+            utf8++;
+        } else {
+            Append(text, han(rng));
+        }
+        utf8 += 3;
+    }
+    return text;
+}
+
+std::vector<std::wstring> ShortStrings(size_t count, std::mt19937& rng) {
+    const char* const samples[] = {
+        "C:\\Users\\dev\\AppData\\Roaming\\ClipX\\clipx.db", "Search...", "Just now",
+        "\\\\.\\pipe\\ClipX_IPC", "notepad.exe", "D:\\项目\\文档\\报告.docx", "3 minutes ago",
+        "Visual Studio Code", "收藏夹", "- 工作 (12)",
+    };
+    std::uniform_int_distribution<size_t> pick(0, std::size(samples) - 1);
+    std::vector<std::wstring> strings;
+    for (size_t i = 0; i < count; i++) {
+        strings.push_back(utils::Utf8ToWide(samples[pick(rng)]));
+    }
+    return strings;
+}
+
+template<typename Fn>
+double Seconds(int iterations, Fn fn) {
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+        fn();
+    }
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void Report(const char* corpus, const char* direction, size_t utf8Bytes, int iterations, double legacySec,
+            double newSec) {
+    double volume = static_cast<double>(utf8Bytes) * iterations / 1e6;
+    std::printf("%-8s %-12s %12.0f %12.0f %8.2fx\n", corpus, direction, volume / legacySec, volume / newSec,
+                legacySec / newSec);
+}
+
+// Both directions over a list of strings; false if the outputs differ
+bool Run(const char* corpus, const std::vector<std::wstring>& wide, int iterations) {
+    std::vector<std::string> utf8;
+    size_t utf8Bytes = 0;
+    for (const auto& text : wide) {
+        utf8.push_back(utils::WideToUtf8(text));
+        utf8Bytes += utf8.back().size();
+        if (utf8.back() != legacy::WideToUtf8(text) || utils::Utf8ToWide(utf8.back()) != legacy::Utf8ToWide(utf8.back())) {
+            std::printf("%-8s output differs from the legacy conversion\n", corpus);
+            return false;
+        }
+    }
+
+    size_t sink = 0;
+    double legacySec = Seconds(iterations, [&]() {
+        for (const auto& text : wide) sink += legacy::WideToUtf8(text).size();
+    });
+    double newSec = Seconds(iterations, [&]() {
+        for (const auto& text : wide) sink += utils::WideToUtf8(text).size();
+    });
+    Report(corpus, "wide->utf8", utf8Bytes, iterations, legacySec, newSec);
+
+    legacySec = Seconds(iterations, [&]() {
+        for (const auto& text : utf8) sink += legacy::Utf8ToWide(text).size();
+    });
+    newSec = Seconds(iterations, [&]() {
+        for (const auto& text : utf8) sink += utils::Utf8ToWide(text).size();
+    });
+    Report(corpus, "utf8->wide", utf8Bytes, iterations, legacySec, newSec);
+
+    return sink != 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const size_t corpusKb = argc > 1 ? std::max(1, std::atoi(argv[1])) : 1024;
+    const int iterations = argc > 2 ? std::max(1, std::atoi(argv[2])) : 20;
+
+    std::mt19937 rng(42);
+    std::printf("%-8s %-12s %12s %12s %9s\n", "corpus", "direction", "legacy MB/s", "new MB/s", "speedup");
+    bool ok = Run("ascii", {AsciiHeavy(corpusKb * 1024, rng)}, iterations);
+    ok = Run("cjk", {CjkHeavy(corpusKb * 1024, rng)}, iterations) && ok;
+    ok = Run("short", ShortStrings(corpusKb * 1024 / 32, rng), iterations) && ok;
+    return ok ? 0 : 1;
+}
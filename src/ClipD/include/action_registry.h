@@ -0,0 +1,164 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "json/json.hpp"
+
+namespace clipx {
+
+// Collision-free hash from a fixed set of names to their index, built at
+// compile time. Find() hashes the name once and confirms it with a single
+// comparison, so dispatch cost does not grow with the number of actions.
+//
+//   constexpr PerfectHashIndex<std::size(DEFS)> INDEX(DEFS);  // DEFS[i].name
+//   static_assert(INDEX.Valid());
+template<size_t N, size_t Slots = 64>
+class PerfectHashIndex {
+public:
+    static_assert(N < Slots, "PerfectHashIndex needs more slots than names");
+
+    template<typename Def>
+    constexpr explicit PerfectHashIndex(const Def (&defs)[N]) {
+        for (size_t i = 0; i < N; i++) {
+            m_names[i] = defs[i].name;
+        }
+        for (uint32_t seed = 0; seed < MAX_SEED; seed++) {
+            if (TrySeed(seed)) {
+                m_seed = seed;
+                return;
+            }
+        }
+    }
+
+    constexpr bool Valid() const { return m_seed != MAX_SEED; }
+
+    // Index of `name`, or -1
+    constexpr int Find(std::string_view name) const {
+        int index = m_slots[Hash(name, m_seed) % Slots];
+        return index >= 0 && m_names[index] == name ? index : -1;
+    }
+
+private:
+    static constexpr uint32_t MAX_SEED = 1u << 16;
+
+    // FNV-1a, then mixed so the low bits depend on every bit of the seed
+    static constexpr uint32_t Hash(std::string_view name, uint32_t seed) {
+        uint32_t hash = 2166136261u ^ seed;
+        for (char c : name) {
+            hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+        }
+        hash ^= hash >> 16;
+        hash *= 0x85ebca6bu;
+        hash ^= hash >> 13;
+        return hash;
+    }
+
+    constexpr bool TrySeed(uint32_t seed) {
+        for (auto& slot : m_slots) {
+            slot = -1;
+        }
+        for (size_t i = 0; i < N; i++) {
+            int16_t& slot = m_slots[Hash(m_names[i], seed) % Slots];
+            if (slot >= 0) {
+                return false;
+            }
+            slot = static_cast<int16_t>(i);
+        }
+        return true;
+    }
+
+    std::array<std::string_view, N> m_names{};
+    std::array<int16_t, Slots> m_slots{};
+    uint32_t m_seed = MAX_SEED;
+};
+
+// Call count, error count and latency histogram of one action. Recording
+// is lock-free, so every worker updates the counters directly.
+class ActionMetrics {
+public:
+    // Bucket i holds latencies below 2^i microseconds (the last one is open)
+    static constexpr int BUCKETS = 28;
+
+    struct Snapshot {
+        uint64_t count = 0;
+        uint64_t errors = 0;
+        uint64_t totalUs = 0;
+        uint64_t maxUs = 0;
+        std::array<uint64_t, BUCKETS> buckets{};
+
+        // Upper bound of the bucket holding the p-th latency (0 < p <= 1)
+        uint64_t PercentileUs(double p) const;
+    };
+
+    void Record(uint64_t micros, bool failed);
+    Snapshot Read() const;
+
+private:
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<uint64_t> m_errors{0};
+    std::atomic<uint64_t> m_totalUs{0};
+    std::atomic<uint64_t> m_maxUs{0};
+    std::array<std::atomic<uint64_t>, BUCKETS> m_buckets{};
+};
+
+// Reads request parameters into typed fields without throwing. Absent and
+// null fields keep their defaults; the first field of the wrong type (or a
+// missing required one) is reported through Error().
+class ParamReader {
+public:
+    explicit ParamReader(const nlohmann::json& params);
+
+    template<typename T>
+    ParamReader& Optional(const char* key, T& value) {
+        if (const nlohmann::json* field = Field(key); field && !Convert(*field, value)) {
+            Fail(std::string("Invalid parameter: ") + key);
+        }
+        return *this;
+    }
+
+    template<typename T>
+    ParamReader& Optional(const char* key, std::optional<T>& value) {
+        if (const nlohmann::json* field = Field(key)) {
+            T converted{};
+            if (Convert(*field, converted)) {
+                value = std::move(converted);
+            } else {
+                Fail(std::string("Invalid parameter: ") + key);
+            }
+        }
+        return *this;
+    }
+
+    template<typename T>
+    ParamReader& Required(const char* key, T& value) {
+        if (!Field(key)) {
+            Fail(std::string("Missing ") + key);
+        }
+        return Optional(key, value);
+    }
+
+    bool Ok() const { return m_error.empty(); }
+    const std::string& Error() const { return m_error; }
+
+private:
+    const nlohmann::json* Field(const char* key) const;
+    void Fail(std::string error);
+
+    static bool Convert(const nlohmann::json& field, bool& value);
+    static bool Convert(const nlohmann::json& field, int32_t& value);
+    static bool Convert(const nlohmann::json& field, int64_t& value);
+    static bool Convert(const nlohmann::json& field, uint64_t& value);
+    static bool Convert(const nlohmann::json& field, std::string& value);
+    static bool Convert(const nlohmann::json& field, std::vector<std::string>& value);
+    static bool Convert(const nlohmann::json& field, const nlohmann::json*& value);  // Any value, borrowed
+
+    const nlohmann::json& m_params;
+    std::string m_error;
+};
+
+} // namespace clipx
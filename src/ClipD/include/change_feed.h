@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <map>
+#include "common/types.h"
+#include "ipc_server.h"
+
+namespace clipx {
+
+// Pushes history changes to subscribed sessions as compact delta events
+// (entry_inserted, entry_updated, entry_deleted, tags_changed), so clients
+// patch their lists instead of reloading them.
+//
+// Publish() only queues: DataManager calls it with its lock held. A sender
+// thread turns the changes into notifications in order and hands them to
+// each subscriber's own queue and writer thread, so a client that stops
+// reading holds up only itself. If a queue overflows, its backlog is
+// replaced with one resync event.
+class ChangeFeed {
+public:
+    static constexpr size_t MAX_QUEUED_CHANGES = 4096;
+
+    ChangeFeed();
+    ~ChangeFeed();
+
+    // Empty `events` subscribes to every change event
+    void Subscribe(const std::shared_ptr<IPCSession>& session, std::vector<std::string> events);
+    bool Unsubscribe(uint64_t sessionId);
+
+    void Publish(EntryChange&& change);
+
+private:
+    struct Subscriber {
+        std::weak_ptr<IPCSession> session;
+        std::vector<std::string> events;
+
+        // Guarded by m_mutex, drained by `writer`
+        std::deque<std::shared_ptr<const IPCNotification>> pending;
+        bool overflowed = false;
+        bool failed = false;  // A write failed; nothing more is sent
+        bool stopping = false;
+        std::condition_variable cv;
+        std::thread writer;
+    };
+
+    void SenderLoop();
+    void WriterLoop(Subscriber& subscriber);
+    void StopWriter(std::unique_ptr<Subscriber> subscriber);  // m_mutex not held
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<EntryChange> m_queue;
+    bool m_overflowed = false;
+    bool m_stopping = false;
+    std::map<uint64_t, std::unique_ptr<Subscriber>> m_subscribers;
+    std::thread m_sender;
+};
+
+} // namespace clipx
@@ -2,10 +2,17 @@
 
 #include <string>
 #include <vector>
+#include <deque>
 #include <mutex>
-#include "common/windows.h"
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <functional>
 #include <sqlite3.h>
 #include "common/types.h"
+#include "common/search_query.h"
+#include "common/thread_pool.h"
+#include "common/simhash.h"
 
 namespace clipx {
 
@@ -32,12 +39,40 @@ public:
     // Clear all memory entries
     void ClearMemoryEntries();
 
-    // Query history with options
-    std::vector<ClipboardEntry> Query(const QueryOptions& options);
+    // Query history with options. Stored rows come without their payload;
+    // image rows carry their thumbnail instead. `total`, if given, receives
+    // the number of entries matching the filters, across all pages.
+    std::vector<ClipboardEntry> Query(const QueryOptions& options, int64_t* total = nullptr);
 
-    // Search by keyword (includes both memory and database)
+    // Search by keyword (includes both memory and database).
+    // The keyword is parsed with the search query syntax (tag:, app:, ...).
     std::vector<ClipboardEntry> Search(const std::string& keyword, int limit = 50);
 
+    // Search with a parsed query. All predicates are evaluated in SQL,
+    // driven by the most selective index available for the query.
+    // `timedOut` is set when query.timeBudgetMs ran out before the end.
+    std::vector<ClipboardEntry> Search(const SearchQuery& query, int limit = 50, bool* timedOut = nullptr);
+
+    // Streaming variant of Search. Rows are handed to `onBatch` as they are
+    // read: the first `firstBatch` rows as soon as they are available, then
+    // `batchSize` at a time. Runs on a pooled read connection without holding
+    // the write lock. Setting `cancel` aborts the running statement within a
+    // few thousand VM steps; returning false from `onBatch` stops the search.
+    // A query that exceeds its time budget delivers the rows found so far and
+    // sets `timedOut`.
+    // Returns false if the search was cancelled, stopped, timed out or failed.
+    using SearchBatchCallback = std::function<bool(std::vector<ClipboardEntry>&& batch)>;
+    bool SearchStreaming(const SearchQuery& query, int limit, int firstBatch, int batchSize,
+                         const std::atomic<bool>* cancel, const SearchBatchCallback& onBatch,
+                         bool* timedOut = nullptr);
+
+    // Search the full stored payload of text/HTML/RTF entries, newest first.
+    // Scans on the read connection across the search pool and stops after
+    // `limit` hits or when `cancel` becomes true.
+    std::vector<ClipboardEntry> DeepSearch(const std::string& keyword, int limit = 50,
+                                           const std::atomic<bool>* cancel = nullptr,
+                                           DeepSearchStats* stats = nullptr);
+
     // Get full data for an entry
     std::vector<uint8_t> GetEntryData(int64_t id);
 
@@ -52,6 +87,7 @@ public:
 
     // Toggle favorite
     bool ToggleFavorite(int64_t id);
+    bool SetFavorite(int64_t id, bool favorited);
 
     // Check if hash exists (for deduplication)
     std::optional<int64_t> FindByHash(const std::vector<uint8_t>& hash);
@@ -59,10 +95,18 @@ public:
     // Update existing entry (increment copy count)
     bool UpdateCopyCount(int64_t id, int64_t newTimestamp);
 
+    // Near-duplicate collapsing: the memory or database entry whose
+    // fingerprint is nearest entry.simhash, within maxDistance bits, takes
+    // over the new text and timestamp and its copy count is bumped. If that
+    // entry is favorited or tagged, nothing is collapsed: kept entries are
+    // never overwritten. Returns the id of the entry the new one was
+    // collapsed into.
+    std::optional<int64_t> CollapseNearDuplicate(const ClipboardEntry& entry, int maxDistance);
+
     // Get statistics
     DatabaseStats GetStats();
 
-    // Set clipboard content from entry
+    // Set clipboard content from entry (Windows only)
     bool SetClipboard(int64_t id);
 
     // Tag operations
@@ -78,6 +122,38 @@ public:
     // Check if initialized
     bool IsInitialized() const { return m_initialized; }
 
+    // Runs `body` as one SQLite transaction, holding the data lock
+    // throughout, so all its writes share a single commit. DataManager calls
+    // made from `body` join the transaction. Returning false from `body`
+    // (or a failed commit) rolls everything back, including memory entries
+    // it removed. Change events are held until the commit and dropped on
+    // rollback. Nested calls become savepoints. DeleteAll can't run inside.
+    bool Transaction(const std::function<bool()>& body);
+
+    // Inside Transaction: runs `step` as a savepoint, undoing just its
+    // writes if it returns false. Outside, the same as Transaction.
+    bool Savepoint(const std::function<bool()>& step);
+
+    // Called for every change to the stored history, in order and with the
+    // data lock held: the listener must only queue the change (ChangeFeed)
+    using ChangeListener = std::function<void(EntryChange&& change)>;
+    void SetChangeListener(ChangeListener listener);
+
+    // Every published change gets the next number of a sequence that never
+    // goes backwards, not even across restarts: the counter is persisted.
+    // The latest changes are kept so a client holding the list as of `seq`
+    // can catch up. Returns false when the changes after `seq` are no
+    // longer all known (dropped from the log, made by an earlier run whose
+    // memory entries are gone, or from another database); the client must
+    // reload instead. At most `limit` changes are returned, oldest first.
+    int64_t GetChangeSeq();
+    bool GetChangesSince(int64_t seq, size_t limit, std::vector<EntryChange>& changes);
+
+    // Advances after every published change, and when the database is
+    // opened or closed. Readable without the data lock: a result read
+    // while the epoch stayed the same is still current.
+    uint64_t GetWriteEpoch() const { return m_writeEpoch.load(std::memory_order_acquire); }
+
 private:
     DataManager() = default;
     ~DataManager();
@@ -85,19 +161,76 @@ private:
     DataManager(const DataManager&) = delete;
     DataManager& operator=(const DataManager&) = delete;
 
+    std::optional<int64_t> PersistMemoryEntryLocked(int64_t memoryId);
+    bool UpdateFavorite(int64_t id, std::optional<bool> favorited);  // nullopt toggles
+    void NotifyChange(EntryChange&& change);  // m_mutex held
+    void NotifyTagsChanged(int64_t entryId);  // m_mutex held
+    void LogChange(EntryChange& change);      // m_mutex held, assigns change.seq
+    void LoadChangeSeq();
+    void ReserveChangeSeq(int64_t upTo);
+
+    // Transaction support, m_mutex held
+    bool ExecSql(const std::string& sql);
+    void RecordUndo(std::function<void()> undo);
+    void RollbackTo(size_t undoMark, size_t changeMark);
+    void RestoreMemoryEntry(size_t index, ClipboardEntry entry);
+
     bool CreateTables();
     bool UpgradeSchema();
+    bool CreateSearchIndex();
+    void LoadNearDuplicateIndex();
+    void BackfillThumbnails();
+    sqlite3_stmt* PrepareSearch(sqlite3* db, const SearchQuery& query, int limit);
+
+    // Read-only connections for concurrent queries, one per running query
+    // or deep search worker. Acquire returns nullptr once Shutdown has
+    // begun; Shutdown waits until every acquired connection is released.
+    sqlite3* AcquireReadConnection();
+    void ReleaseReadConnection(sqlite3* db);
     ClipboardEntry RowToEntry(sqlite3_stmt* stmt);
-    void LoadTagsForEntry(ClipboardEntry& entry);
+    void LoadTagsForEntry(ClipboardEntry& entry, sqlite3* db = nullptr);
+    void LoadThumbnailForEntry(ClipboardEntry& entry, sqlite3* db = nullptr);  // Image entries only
+    bool StoreThumbnail(int64_t id, const std::vector<uint8_t>& thumbnail);
+    bool ScanEntryData(sqlite3* db, int64_t id, const std::string& needleLower,
+                       const std::atomic<bool>& stop, uint64_t& bytesScanned);
 
     sqlite3* m_db = nullptr;
-    std::mutex m_mutex;
+    std::unique_ptr<ThreadPool> m_searchPool;  // Kept alive by an acquired read connection
+    std::vector<sqlite3*> m_idleReadConnections;
+    size_t m_maxIdleReadConnections = 4;
+    size_t m_activeReadConnections = 0;
+    bool m_readsClosed = true;  // Until Initialize, and from the start of Shutdown
+    std::condition_variable m_readConnectionReleased;
+    std::mutex m_readPoolMutex;
+    std::recursive_mutex m_mutex;  // Recursive so DataManager calls can join a Transaction
     bool m_initialized = false;
+    bool m_hasFts = false;  // FTS5 trigram index over preview and tags is available
     std::string m_dbPath;
 
     // Memory storage for non-tagged entries
     std::vector<ClipboardEntry> m_memoryEntries;
     int64_t m_nextMemoryId = -1;  // Negative IDs for memory entries
+
+    // Fingerprints of memory and database text entries. Database ids of rows
+    // removed by bulk deletes are dropped lazily when a lookup hits them.
+    SimHashIndex m_nearDuplicates;
+
+    ChangeListener m_changeListener;
+
+    // Change sequence: the latest number handed out, the number up to which
+    // the database has been advanced, and the log of changes after
+    // m_changeFloor (oldest first, contiguous)
+    int64_t m_changeSeq = 0;
+    int64_t m_reservedSeq = 0;
+    int64_t m_changeFloor = 0;
+    std::deque<EntryChange> m_changeLog;
+    std::atomic<uint64_t> m_writeEpoch{0};
+
+    // Open transaction state: nesting depth (savepoints beyond 1), undo
+    // actions for in-memory state, and change events awaiting the commit
+    int m_transactionDepth = 0;
+    std::vector<std::function<void()>> m_undoLog;
+    std::vector<EntryChange> m_pendingChanges;
 };
 
 } // namespace clipx
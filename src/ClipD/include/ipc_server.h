@@ -4,36 +4,111 @@
 #include <functional>
 #include <thread>
 #include <atomic>
-#include <windows.h>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #include "common/ipc_protocol.h"
+#include "common/ipc_codec.h"
+#include "common/ipc_transport.h"
+#include "common/thread_pool.h"
 
 namespace clipx {
 
+// A connected client. Handlers may keep the session to push notifications
+// later from another thread; writes are serialized per session and fail
+// once the client has disconnected. Messages go out in the codec of the
+// client's most recent request. Messages are read and encoded into
+// per-session buffers that are reused, so serving a request does not
+// allocate for I/O.
+class IPCSession {
+public:
+    IPCSession(std::shared_ptr<IPCConnection> connection, uint64_t id)
+        : m_connection(std::move(connection)), m_id(id) {}
+
+    uint64_t GetId() const { return m_id; }
+    bool IsOpen() const { return m_open; }
+    IPCCodec GetCodec() const { return m_codec; }
+
+    bool SendResponse(const IPCResponse& response);
+    bool SendNotification(const IPCNotification& notification);
+
+private:
+    friend class IPCServer;
+
+    bool Flush(IPCCodec codec);  // m_writeMutex held
+    void Close();
+
+    std::shared_ptr<IPCConnection> m_connection;
+    uint64_t m_id;
+    std::atomic<bool> m_open{true};
+    std::atomic<IPCCodec> m_codec{IPCCodec::Json};
+    std::mutex m_writeMutex;
+    std::vector<uint8_t> m_writeBuffer;  // Frame being sent, m_writeMutex held
+
+    // Frame being read, m_readFilled bytes of it so far. Only the worker
+    // reading the connection touches them, and only until the request is
+    // decoded or the connection rearmed for the rest of the frame.
+    std::vector<uint8_t> m_readBuffer;
+    size_t m_readFilled = 0;
+
+    // Requests being handled, and whether reading stopped at the limit
+    std::mutex m_dispatchMutex;
+    size_t m_inFlight = 0;
+    bool m_readPaused = false;
+};
+
+struct IPCServerOptions {
+    size_t workerCount = 4;
+    size_t maxConnections = 64;
+    // Requests of one client handled at once; further ones stay unread in
+    // the connection until one finishes, so a single pipelining client
+    // can't occupy every worker
+    size_t maxRequestsPerConnection = 2;
+};
+
+// Serves clients from a fixed set of threads: one event loop waits on the
+// listener, and each request is read, handled and answered on a worker.
+// Workers never wait for input: a frame that is not complete yet stays in
+// the session and the connection is watched again for the rest.
+// A client may pipeline requests: once a frame is read the connection is
+// watched again, so its next request can run on another worker and the
+// responses go out in completion order, matched by requestId. A client that
+// needs one request to see the effect of another waits for its response.
 class IPCServer {
 public:
-    using RequestHandler = std::function<IPCResponse(const IPCRequest&)>;
+    using RequestHandler = std::function<IPCResponse(const IPCRequest&, const std::shared_ptr<IPCSession>&)>;
+    using SessionClosedHandler = std::function<void(const std::shared_ptr<IPCSession>&)>;
 
     IPCServer();
     ~IPCServer();
 
-    bool Start(const std::string& pipeName);
+    // Address as understood by the transport (see DefaultIPCAddress)
+    bool Start(const std::string& address, const IPCServerOptions& options = {});
     void Stop();
 
+    // Set before Start
     void SetRequestHandler(RequestHandler handler);
+    void SetSessionClosedHandler(SessionClosedHandler handler);
 
     bool IsRunning() const { return m_running; }
 
 private:
-    void ListenLoop();
-    void HandleClient(HANDLE pipe);
-    bool ReadMessage(HANDLE pipe, std::vector<uint8_t>& buffer);
-    bool WriteMessage(HANDLE pipe, const std::vector<uint8_t>& data);
+    void EventLoop();
+    void ServeRequest(const std::shared_ptr<IPCSession>& session);
+    void HandleRequest(const IPCRequest& request, const std::shared_ptr<IPCSession>& session);
+    void CloseSession(const std::shared_ptr<IPCSession>& session);
 
-    std::string m_pipeName;
-    std::thread m_listenerThread;
+    std::thread m_loopThread;
     std::atomic<bool> m_running{false};
+    std::atomic<uint64_t> m_nextSessionId{1};
+    IPCServerOptions m_options;
     RequestHandler m_handler;
-    HANDLE m_stopEvent = nullptr;
+    SessionClosedHandler m_sessionClosedHandler;
+
+    std::unique_ptr<IPCListener> m_listener;
+    std::unique_ptr<ThreadPool> m_workers;
+    std::mutex m_sessionsMutex;
+    std::unordered_map<IPCConnection*, std::shared_ptr<IPCSession>> m_sessions;
 };
 
 } // namespace clipx
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "common/ipc_protocol.h"
+#include "action_registry.h"
+#include "ipc_server.h"
+#include "search_jobs.h"
+#include "change_feed.h"
+#include "shared_blob_pool.h"
+#include "response_cache.h"
+#include "snapshot_publisher.h"
+
+namespace clipx {
+
+// Serves ClipD's IPC actions on top of DataManager, along with the
+// per-client services they need: streamed search jobs, the change feed and
+// shared-memory payloads. Holds no window or clipboard state, so the IPC
+// stack runs the same in the tray app and in the Linux benchmarks; the app
+// supplies what needs its window through Hooks.
+//
+// Actions are looked up in a compile-time registry (request_dispatcher.cpp)
+// that maps each name to a handler taking a typed parameter struct, and
+// records call counts, errors and latency per action. Results of the
+// read-only actions the overlay sends on every open (get_history,
+// get_all_tags, get_tags) are kept encoded in a ResponseCache until the
+// next write. Optionally a SnapshotPublisher keeps the first page in shared
+// memory for clients that paint before connecting.
+//
+// DataManager must be initialized first and outlive the dispatcher.
+class RequestDispatcher {
+public:
+    struct Hooks {
+        std::function<void()> beforeSetClipboard;  // Runs before set_clipboard writes
+        std::function<void()> shutdown;            // shutdown action
+    };
+
+    struct Options {
+        std::string snapshotName;  // Region for the HistorySnapshot; empty for none
+    };
+
+    explicit RequestDispatcher(Hooks hooks = {}, Options options = {});
+    ~RequestDispatcher();  // Stops running searches and the change feed
+
+    RequestDispatcher(const RequestDispatcher&) = delete;
+    RequestDispatcher& operator=(const RequestDispatcher&) = delete;
+
+    IPCResponse Handle(const IPCRequest& request, const std::shared_ptr<IPCSession>& session);
+
+    // Drops the session's searches, subscription and payload leases
+    void SessionClosed(uint64_t sessionId);
+
+    struct ActionStats {
+        std::string action;
+        ActionMetrics::Snapshot metrics;
+    };
+
+    // Every registered action, in registry order. Batch items are counted
+    // under their own action as well as under batch.
+    std::vector<ActionStats> GetActionStats() const;
+    uint64_t GetUnknownActionCount() const { return m_unknownActions.load(std::memory_order_relaxed); }
+    ResponseCache::Stats GetCacheStats() const { return m_responseCache->GetStats(); }
+
+private:
+    Hooks m_hooks;
+    std::unique_ptr<ActionMetrics[]> m_metrics;  // Indexed like the registry
+    std::atomic<uint64_t> m_unknownActions{0};
+    std::unique_ptr<SearchJobManager> m_searchJobs;
+    std::unique_ptr<ChangeFeed> m_changeFeed;
+    std::unique_ptr<SharedBlobPool> m_blobPool;
+    std::unique_ptr<ResponseCache> m_responseCache;
+    std::unique_ptr<SnapshotPublisher> m_snapshot;
+};
+
+} // namespace clipx
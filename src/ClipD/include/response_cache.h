@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "common/ipc_codec.h"
+
+namespace clipx {
+
+// Encoded results of read-only actions, keyed by codec, action and
+// canonical parameters. Results are valid for one DataManager write epoch:
+// the first lookup or store at a newer epoch empties the cache, and a store
+// computed at an older one is ignored. Least recently used results are
+// evicted beyond the memory budget.
+class ResponseCache {
+public:
+    static constexpr size_t DEFAULT_MAX_BYTES = 8 * 1024 * 1024;
+
+    explicit ResponseCache(size_t maxBytes = DEFAULT_MAX_BYTES);
+
+    std::shared_ptr<const EncodedResponseData> Find(const std::string& key, uint64_t epoch);
+    void Store(const std::string& key, uint64_t epoch, std::shared_ptr<const EncodedResponseData> data);
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        size_t entries = 0;
+        size_t bytes = 0;
+    };
+    Stats GetStats() const;
+
+private:
+    struct Entry {
+        std::string key;
+        std::shared_ptr<const EncodedResponseData> data;
+        size_t size;  // Accounted against m_maxBytes
+    };
+
+    bool Advance(uint64_t epoch);  // m_mutex held; false if `epoch` is stale
+    void Evict(std::list<Entry>::iterator it);
+
+    mutable std::mutex m_mutex;
+    std::list<Entry> m_lru;  // Most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> m_index;
+    uint64_t m_epoch = 0;
+    size_t m_bytes = 0;
+    size_t m_maxBytes;
+    uint64_t m_hits = 0;
+    uint64_t m_misses = 0;
+};
+
+} // namespace clipx
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <map>
+#include <utility>
+#include "common/thread_pool.h"
+#include "ipc_server.h"
+
+namespace clipx {
+
+// Runs searches in the background and streams their results to the session
+// that started them as search_results notifications. A job is identified by
+// the request id of the search request, so the client knows the id before
+// the first batch can arrive.
+class SearchJobManager {
+public:
+    struct Options {
+        std::string keyword;
+        int limit = 50;
+        int firstBatch = 20;    // Rows in the first notification (one screenful)
+        int batchSize = 50;     // Rows in each following notification
+        bool deep = false;      // Scan full payloads instead of the index
+        bool regex = false;     // keyword is a regular expression
+        bool ignoreCase = false;
+        int timeBudgetMs = 0;   // 0 = no limit
+        bool supersede = true;  // Cancel the session's older jobs
+    };
+
+    explicit SearchJobManager(size_t workerCount = 2);
+    ~SearchJobManager();
+
+    void Start(const std::shared_ptr<IPCSession>& session, int32_t jobId, const Options& options);
+
+    // Returns false if the job already finished or never existed
+    bool Cancel(uint64_t sessionId, int32_t jobId);
+
+    // Cancel every job of a session (e.g. on disconnect)
+    void CancelSession(uint64_t sessionId);
+
+private:
+    using JobKey = std::pair<uint64_t, int32_t>;  // Session id, job id
+
+    struct Job {
+        std::atomic<bool> cancelled{false};
+    };
+
+    void Run(const std::shared_ptr<IPCSession>& session, int32_t jobId,
+             const std::shared_ptr<Job>& job, const Options& options);
+
+    std::mutex m_mutex;
+    std::map<JobKey, std::shared_ptr<Job>> m_jobs;
+    ThreadPool m_pool;
+};
+
+} // namespace clipx
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include "common/shared_memory.h"
+
+namespace clipx {
+
+// Server side of the shared-memory payload channel (see SharedBlobRef).
+//
+// Payloads are bump-allocated in pooled segments. Each one is held by a
+// lease until the client sends release_blob, its session closes, or
+// LEASE_TIMEOUT_MS passes. A segment whose leases are all gone is reused
+// from the start; payloads too big for a segment get a region of their own,
+// dropped as soon as it is released.
+class SharedBlobPool {
+public:
+    static constexpr size_t SEGMENT_SIZE = 8 * 1024 * 1024;
+    static constexpr size_t MAX_POOL_BYTES = 256 * 1024 * 1024;  // Mapped by all segments together
+    static constexpr int LEASE_TIMEOUT_MS = 30000;
+
+    SharedBlobPool();
+
+    // Copy `size` bytes into the pool under a new lease. Fails when the
+    // pool is full of live leases or the region can't be created.
+    std::optional<SharedBlobRef> Store(uint64_t sessionId, const uint8_t* data, size_t size);
+
+    bool Release(uint64_t sessionId, uint64_t lease);
+    void ReleaseSession(uint64_t sessionId);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Segment {
+        std::unique_ptr<SharedMemory> memory;
+        size_t used = 0;
+        size_t leases = 0;
+        std::vector<size_t> headers;  // Offsets stamped since the last reuse
+    };
+
+    struct Lease {
+        uint64_t sessionId;
+        Segment* segment;
+        Clock::time_point expiry;
+    };
+
+    Segment* FindSpace(size_t need);
+    void ReclaimExpired();
+    void Drop(std::unordered_map<uint64_t, Lease>::iterator it);
+    void TrimIdle();  // Unmap segments without leases
+    size_t MappedBytes() const;
+
+    std::mutex m_mutex;
+    std::vector<std::unique_ptr<Segment>> m_segments;
+    std::unordered_map<uint64_t, Lease> m_leases;
+    uint64_t m_nextLease = 0;
+    uint64_t m_leaseKey;  // Lease ids are never guessable or reused
+};
+
+} // namespace clipx
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "common/history_snapshot.h"
+
+namespace clipx {
+
+// Keeps the shared HistorySnapshot in step with the database. Changes only
+// mark it dirty (DataManager reports them with its lock held); a worker
+// thread rebuilds it from the first history page and the tag list
+// DEBOUNCE_MS after the first one, so a burst of changes costs one rewrite.
+//
+// DataManager must be initialized first and outlive the publisher.
+class SnapshotPublisher {
+public:
+    static constexpr int DEBOUNCE_MS = 50;
+
+    // Publishes the current state right away; does nothing further if the
+    // region can't be created
+    explicit SnapshotPublisher(const std::string& name);
+    ~SnapshotPublisher();
+
+    SnapshotPublisher(const SnapshotPublisher&) = delete;
+    SnapshotPublisher& operator=(const SnapshotPublisher&) = delete;
+
+    void MarkDirty();
+
+private:
+    void Publish();
+    void WorkerLoop();
+
+    HistorySnapshotWriter m_writer;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_dirty = false;
+    bool m_stopping = false;
+    std::thread m_worker;
+};
+
+} // namespace clipx
@@ -0,0 +1,136 @@
+#include "action_registry.h"
+#include <algorithm>
+#include <limits>
+
+namespace clipx {
+
+uint64_t ActionMetrics::Snapshot::PercentileUs(double p) const {
+    uint64_t total = 0;
+    for (uint64_t n : buckets) total += n;
+    if (total == 0) {
+        return 0;
+    }
+
+    uint64_t rank = static_cast<uint64_t>(p * total + 0.5);
+    rank = std::max<uint64_t>(rank, 1);
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS - 1; i++) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return std::min(maxUs, (uint64_t(1) << i) - 1);
+        }
+    }
+    return maxUs;
+}
+
+void ActionMetrics::Record(uint64_t micros, bool failed) {
+    int bucket = 0;
+    while (bucket < BUCKETS - 1 && micros >= (uint64_t(1) << bucket)) {
+        bucket++;
+    }
+    m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_totalUs.fetch_add(micros, std::memory_order_relaxed);
+    if (failed) {
+        m_errors.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t max = m_maxUs.load(std::memory_order_relaxed);
+    while (micros > max && !m_maxUs.compare_exchange_weak(max, micros, std::memory_order_relaxed)) {
+    }
+}
+
+// Counters are read one by one, so a snapshot taken under load may be off
+// by the requests finishing meanwhile
+ActionMetrics::Snapshot ActionMetrics::Read() const {
+    Snapshot snapshot;
+    snapshot.count = m_count.load(std::memory_order_relaxed);
+    snapshot.errors = m_errors.load(std::memory_order_relaxed);
+    snapshot.totalUs = m_totalUs.load(std::memory_order_relaxed);
+    snapshot.maxUs = m_maxUs.load(std::memory_order_relaxed);
+    for (int i = 0; i < BUCKETS; i++) {
+        snapshot.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+ParamReader::ParamReader(const nlohmann::json& params) : m_params(params) {
+    if (!params.is_object() && !params.is_null()) {
+        Fail("Invalid params");
+    }
+}
+
+const nlohmann::json* ParamReader::Field(const char* key) const {
+    if (!m_params.is_object()) {
+        return nullptr;
+    }
+    auto it = m_params.find(key);
+    return it == m_params.end() || it->is_null() ? nullptr : &*it;
+}
+
+void ParamReader::Fail(std::string error) {
+    if (m_error.empty()) {
+        m_error = std::move(error);
+    }
+}
+
+bool ParamReader::Convert(const nlohmann::json& field, bool& value) {
+    if (!field.is_boolean()) return false;
+    value = field.get<bool>();
+    return true;
+}
+
+bool ParamReader::Convert(const nlohmann::json& field, int32_t& value) {
+    int64_t wide;
+    if (!Convert(field, wide) || wide < std::numeric_limits<int32_t>::min() ||
+        wide > std::numeric_limits<int32_t>::max()) {
+        return false;
+    }
+    value = static_cast<int32_t>(wide);
+    return true;
+}
+
+bool ParamReader::Convert(const nlohmann::json& field, int64_t& value) {
+    if (field.is_number_unsigned()) {
+        uint64_t number = field.get<uint64_t>();
+        if (number > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) return false;
+        value = static_cast<int64_t>(number);
+        return true;
+    }
+    if (!field.is_number_integer()) return false;
+    value = field.get<int64_t>();
+    return true;
+}
+
+bool ParamReader::Convert(const nlohmann::json& field, uint64_t& value) {
+    if (field.is_number_unsigned()) {
+        value = field.get<uint64_t>();
+        return true;
+    }
+    if (!field.is_number_integer() || field.get<int64_t>() < 0) return false;
+    value = static_cast<uint64_t>(field.get<int64_t>());
+    return true;
+}
+
+bool ParamReader::Convert(const nlohmann::json& field, std::string& value) {
+    if (!field.is_string()) return false;
+    value = field.get<std::string>();
+    return true;
+}
+
+bool ParamReader::Convert(const nlohmann::json& field, std::vector<std::string>& value) {
+    if (!field.is_array()) return false;
+    value.clear();
+    for (const auto& item : field) {
+        if (!item.is_string()) return false;
+        value.push_back(item.get<std::string>());
+    }
+    return true;
+}
+
+bool ParamReader::Convert(const nlohmann::json& field, const nlohmann::json*& value) {
+    value = &field;
+    return true;
+}
+
+} // namespace clipx
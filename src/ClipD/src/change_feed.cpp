@@ -0,0 +1,180 @@
+#include "change_feed.h"
+#include "common/logger.h"
+#include <algorithm>
+
+namespace clipx {
+
+namespace {
+
+// Sent in place of a backlog that was dropped
+std::shared_ptr<const IPCNotification> Resync() {
+    static const auto resync = [] {
+        auto notification = std::make_shared<IPCNotification>();
+        notification->event = IPCEvent::RESYNC;
+        notification->data = nlohmann::json::object();
+        return notification;
+    }();
+    return resync;
+}
+
+} // namespace
+
+ChangeFeed::ChangeFeed() {
+    m_sender = std::thread(&ChangeFeed::SenderLoop, this);
+}
+
+ChangeFeed::~ChangeFeed() {
+    std::map<uint64_t, std::unique_ptr<Subscriber>> subscribers;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+        subscribers.swap(m_subscribers);
+    }
+    m_cv.notify_one();
+    m_sender.join();
+
+    for (auto& [id, subscriber] : subscribers) {
+        StopWriter(std::move(subscriber));
+    }
+}
+
+void ChangeFeed::Subscribe(const std::shared_ptr<IPCSession>& session, std::vector<std::string> events) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto& subscriber = m_subscribers[session->GetId()];
+    if (subscriber) {
+        subscriber->events = std::move(events);
+        return;
+    }
+
+    subscriber = std::make_unique<Subscriber>();
+    subscriber->session = session;
+    subscriber->events = std::move(events);
+    subscriber->writer = std::thread(&ChangeFeed::WriterLoop, this, std::ref(*subscriber));
+    LOG_DEBUG("Session " + std::to_string(session->GetId()) + " subscribed to changes");
+}
+
+bool ChangeFeed::Unsubscribe(uint64_t sessionId) {
+    std::unique_ptr<Subscriber> subscriber;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_subscribers.find(sessionId);
+        if (it == m_subscribers.end()) {
+            return false;
+        }
+        subscriber = std::move(it->second);
+        m_subscribers.erase(it);
+    }
+    StopWriter(std::move(subscriber));
+    return true;
+}
+
+void ChangeFeed::StopWriter(std::unique_ptr<Subscriber> subscriber) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        subscriber->stopping = true;
+    }
+    subscriber->cv.notify_one();
+    subscriber->writer.join();
+}
+
+void ChangeFeed::Publish(EntryChange&& change) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_subscribers.empty() || m_overflowed) {
+            return;
+        }
+        if (m_queue.size() == MAX_QUEUED_CHANGES) {
+            LOG_WARN("Change feed backlog full, asking subscribers to resync");
+            m_queue.clear();
+            m_overflowed = true;
+        } else {
+            m_queue.push_back(std::move(change));
+        }
+    }
+    m_cv.notify_one();
+}
+
+void ChangeFeed::SenderLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_cv.wait(lock, [this] { return m_stopping || m_overflowed || !m_queue.empty(); });
+        if (m_stopping) {
+            return;
+        }
+
+        // Encoded here rather than in Publish, which runs under
+        // DataManager's lock
+        std::shared_ptr<const IPCNotification> notification;
+        if (m_overflowed) {
+            notification = Resync();
+            m_overflowed = false;
+        } else {
+            EntryChange change = std::move(m_queue.front());
+            m_queue.pop_front();
+            lock.unlock();
+            notification = std::make_shared<IPCNotification>(EntryChangeToNotification(change));
+            lock.lock();
+        }
+
+        // Only queued here; each subscriber's writer sends at its own pace
+        for (auto& [id, subscriber] : m_subscribers) {
+            const auto& events = subscriber->events;
+            if (subscriber->failed || !(events.empty() || notification->event == IPCEvent::RESYNC ||
+                                        std::find(events.begin(), events.end(), notification->event) != events.end())) {
+                continue;
+            }
+            if (subscriber->overflowed) {
+                continue;  // The resync covers this change too
+            }
+            if (subscriber->pending.size() == MAX_QUEUED_CHANGES) {
+                LOG_WARN("Session " + std::to_string(id) + " is not reading changes, asking it to resync");
+                subscriber->pending.clear();
+                subscriber->overflowed = true;
+            } else {
+                subscriber->pending.push_back(notification);
+            }
+            subscriber->cv.notify_one();
+        }
+    }
+}
+
+void ChangeFeed::WriterLoop(Subscriber& subscriber) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        subscriber.cv.wait(lock, [&] {
+            return subscriber.stopping || subscriber.overflowed || !subscriber.pending.empty();
+        });
+        if (subscriber.stopping) {
+            return;
+        }
+
+        std::shared_ptr<const IPCNotification> notification;
+        if (subscriber.overflowed) {
+            notification = Resync();
+            subscriber.overflowed = false;
+        } else {
+            notification = std::move(subscriber.pending.front());
+            subscriber.pending.pop_front();
+        }
+        auto session = subscriber.session.lock();
+
+        // Written without the lock so neither Publish nor the other
+        // subscribers wait on this client
+        lock.unlock();
+        bool sent = session && session->IsOpen() && session->SendNotification(*notification);
+        lock.lock();
+
+        if (!sent) {
+            // A frame may have been cut off mid-way; stop until the session
+            // closes and unsubscribes
+            if (session && session->IsOpen()) {
+                LOG_WARN("Failed to push change to session " + std::to_string(session->GetId()));
+            }
+            subscriber.failed = true;
+            subscriber.pending.clear();
+            subscriber.overflowed = false;
+        }
+    }
+}
+
+} // namespace clipx
@@ -2,8 +2,11 @@
 #include "clipboard_listener.h"
 #include "common/logger.h"
 #include "common/utils.h"
+#include "common/simhash.h"
+#include "common/utf.h"
 #include <vector>
 #include <algorithm>
+#include <cwchar>
 
 // Define DROPFILES locally if not available
 #ifndef DROPFILES
@@ -71,6 +74,9 @@ void ClipboardListener::ProcessClipboardChange() {
     LOG_DEBUG("Clipboard changed, sequence: " + std::to_string(currentSequence));
 
     ClipboardEntry entry = ReadClipboard();
+    if (entry.type == ClipboardDataType::Text) {
+        entry.simhash = simhash::Compute(entry.data);
+    }
     if (!entry.data.empty() || !entry.preview.empty()) {
         if (m_onClipboardChange) {
             m_onClipboardChange(entry);
@@ -220,11 +226,16 @@ std::vector<uint8_t> ClipboardListener::ReadTextFromClipboard() {
         return result;
     }
 
-    std::wstring wtext(ptr);
+    // Straight from the clipboard's memory into the result, without the
+    // intermediate wide and narrow copies
+    size_t length = wcsnlen(ptr, GlobalSize(hData) / sizeof(wchar_t));
+    result.resize(utf::MaxUtf8ForWide(length));
+    result.resize(utf::WideToUtf8(ptr, length, reinterpret_cast<char*>(result.data())));
     GlobalUnlock(hData);
-
-    std::string utf8 = utils::WideToUtf8(wtext);
-    result.assign(utf8.begin(), utf8.end());
+    // The entry keeps this; give back the worst-case slack of large text
+    if (result.capacity() > 64 * 1024 && result.size() < result.capacity() / 2) {
+        result.shrink_to_fit();
+    }
 
     return result;
 }
@@ -1,13 +1,20 @@
+#ifdef _WIN32
 #include "common/windows.h"
+#endif
 #include "data_manager.h"
 #include "common/logger.h"
 #include "common/utils.h"
+#include "common/text_search.h"
+#include "common/regex.h"
+#include "common/thumbnail.h"
+#include "common/trace.h"
 #include <sstream>
 #include <algorithm>
+#include <chrono>
 #include <cstring>
 
 // Define DROPFILES locally if not available
-#ifndef DROPFILES
+#if defined(_WIN32) && !defined(DROPFILES)
 typedef struct _DROPFILES {
     DWORD pFiles;
     POINT pt;
@@ -18,6 +25,110 @@ typedef struct _DROPFILES {
 
 namespace clipx {
 
+namespace {
+
+// Without WAL (in-memory databases) readers and the writer lock each other
+// out briefly; wait instead of failing
+constexpr int BUSY_TIMEOUT_MS = 2000;
+
+// Latest changes kept for clients catching up with GetChangesSince
+constexpr size_t CHANGE_LOG_SIZE = 8192;
+
+// The persisted change sequence is advanced this far ahead at a time, so
+// only one change in CHANGE_SEQ_BLOCK writes it
+constexpr int64_t CHANGE_SEQ_BLOCK = 1024;
+
+// Deadline of the search statement currently stepping on this thread
+thread_local Regex::Clock::time_point t_searchDeadline = Regex::Clock::time_point::max();
+
+// regexp(pattern, text), which SQLite calls for "text REGEXP pattern".
+// The compiled pattern is kept as auxdata so it's looked up once per statement.
+void RegexpFunction(sqlite3_context* context, int, sqlite3_value** argv) {
+    const char* pattern = reinterpret_cast<const char*>(sqlite3_value_text(argv[0]));
+    const char* text = reinterpret_cast<const char*>(sqlite3_value_text(argv[1]));
+    if (!pattern || !text) {
+        sqlite3_result_null(context);
+        return;
+    }
+
+    std::shared_ptr<const Regex> regex;
+    if (auto* cached = static_cast<std::shared_ptr<const Regex>*>(sqlite3_get_auxdata(context, 0))) {
+        regex = *cached;
+    } else {
+        std::string error;
+        regex = RegexCache::Instance().Get(pattern, false, &error);
+        if (!regex) {
+            sqlite3_result_error(context, ("Invalid regex: " + error).c_str(), -1);
+            return;
+        }
+        sqlite3_set_auxdata(context, 0, new std::shared_ptr<const Regex>(regex), [](void* p) {
+            delete static_cast<std::shared_ptr<const Regex>*>(p);
+        });
+    }
+
+    switch (regex->Search(text, static_cast<size_t>(sqlite3_value_bytes(argv[1])), t_searchDeadline)) {
+        case Regex::Result::Match:
+            sqlite3_result_int(context, 1);
+            break;
+        case Regex::Result::NoMatch:
+            sqlite3_result_int(context, 0);
+            break;
+        case Regex::Result::Timeout:
+            sqlite3_result_error(context, "Search time budget exceeded", -1);
+            break;
+    }
+}
+
+// Fingerprints are stored as signed 64-bit integers, "none" as NULL
+void BindSimhash(sqlite3_stmt* stmt, int index, uint64_t simhash) {
+    if (simhash == 0) {
+        sqlite3_bind_null(stmt, index);
+    } else {
+        sqlite3_bind_int64(stmt, index, static_cast<int64_t>(simhash));
+    }
+}
+
+// Integer column of one row, e.g. a counter read back after an UPDATE
+std::optional<int64_t> QueryInt64(sqlite3* db, const char* sql, int64_t id) {
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        return std::nullopt;
+    }
+    sqlite3_bind_int64(stmt, 1, id);
+    std::optional<int64_t> value;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        value = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return value;
+}
+
+// Change event of a new entry; the payload stays on the server
+EntryChange MakeInsertedChange(const ClipboardEntry& entry) {
+    EntryChange change;
+    change.kind = EntryChange::Kind::Inserted;
+    change.id = entry.id;
+    change.entry = entry;
+    change.entry.data.clear();
+    return change;
+}
+
+// Thumbnail to store with an entry: the one it came with, or one made from
+// an image payload. Runs before taking m_mutex, scaling takes milliseconds.
+std::vector<uint8_t> ThumbnailFor(const ClipboardEntry& entry) {
+    if (!entry.thumbnail.empty() || entry.type != ClipboardDataType::Image) {
+        return entry.thumbnail;
+    }
+    return image::MakeThumbnail(entry.data.data(), entry.data.size());
+}
+
+void RegisterSqlFunctions(sqlite3* db) {
+    sqlite3_create_function(db, "regexp", 2, SQLITE_UTF8 | SQLITE_DETERMINISTIC, nullptr,
+                            RegexpFunction, nullptr, nullptr);
+}
+
+} // namespace
+
 DataManager& DataManager::Instance() {
     static DataManager instance;
     return instance;
@@ -28,16 +139,19 @@ DataManager::~DataManager() {
 }
 
 bool DataManager::Initialize(const std::string& dbPath) {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
 
     if (m_initialized) {
         return true;
     }
 
-    m_dbPath = dbPath;
+    // Every connection to ":memory:" gets its own empty database; a named
+    // in-memory database (memdb VFS) is shared by the read connections
+    m_dbPath = dbPath == ":memory:" ? "file:/clipx-memory?vfs=memdb" : dbPath;
 
     // Open database
-    int result = sqlite3_open(dbPath.c_str(), &m_db);
+    int result = sqlite3_open_v2(m_dbPath.c_str(), &m_db,
+                                 SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_URI, nullptr);
     if (result != SQLITE_OK) {
         LOG_ERROR("Failed to open database: " + std::string(sqlite3_errmsg(m_db)));
         return false;
@@ -47,6 +161,8 @@ bool DataManager::Initialize(const std::string& dbPath) {
     sqlite3_exec(m_db, "PRAGMA journal_mode=WAL;", nullptr, nullptr, nullptr);
     sqlite3_exec(m_db, "PRAGMA synchronous=NORMAL;", nullptr, nullptr, nullptr);
     sqlite3_exec(m_db, "PRAGMA foreign_keys=ON;", nullptr, nullptr, nullptr);
+    sqlite3_busy_timeout(m_db, BUSY_TIMEOUT_MS);
+    RegisterSqlFunctions(m_db);
 
     // Create tables
     if (!CreateTables()) {
@@ -56,18 +172,53 @@ bool DataManager::Initialize(const std::string& dbPath) {
         return false;
     }
 
+    LoadNearDuplicateIndex();
+    BackfillThumbnails();
+    LoadChangeSeq();
+
+    // Leave one core for the UI and clipboard threads
+    unsigned cores = std::thread::hardware_concurrency();
+    m_searchPool = std::make_unique<ThreadPool>(cores > 2 ? cores - 1 : 1);
+
+    // Long scans read through pooled read-only connections so they don't
+    // hold m_mutex; in WAL mode readers never block the writer connection.
+    // A deep search holds one per worker (the pool and the calling thread)
+    // plus one of its own.
+    {
+        std::lock_guard<std::mutex> poolLock(m_readPoolMutex);
+        m_maxIdleReadConnections = std::max<size_t>(4, m_searchPool->Size() + 2);
+        m_readsClosed = false;
+    }
+
     m_initialized = true;
     LOG_INFO("DataManager initialized: " + dbPath);
     return true;
 }
 
 void DataManager::Shutdown() {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    // Searches read without m_mutex: let the running ones return their
+    // connections first, and refuse new ones. Not under m_mutex, which a
+    // reader may still need to finish.
+    {
+        std::unique_lock<std::mutex> poolLock(m_readPoolMutex);
+        m_readsClosed = true;
+        m_readConnectionReleased.wait(poolLock, [this] { return m_activeReadConnections == 0; });
+        for (sqlite3* db : m_idleReadConnections) {
+            sqlite3_close(db);
+        }
+        m_idleReadConnections.clear();
+    }
+
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
 
+    m_searchPool.reset();
     if (m_db) {
         sqlite3_close(m_db);
         m_db = nullptr;
     }
+    m_changeLog.clear();
+    m_changeSeq = m_reservedSeq = m_changeFloor = 0;
+    m_writeEpoch.fetch_add(1, std::memory_order_release);
     m_initialized = false;
     LOG_INFO("DataManager shutdown");
 }
@@ -98,11 +249,23 @@ bool DataManager::CreateTables() {
             UNIQUE(entry_id, tag_name)
         );
 
+        CREATE TABLE IF NOT EXISTS entry_thumbnails (
+            entry_id        INTEGER PRIMARY KEY,
+            data            BLOB NOT NULL,
+            FOREIGN KEY (entry_id) REFERENCES clipboard_entries(id) ON DELETE CASCADE
+        );
+
+        CREATE TABLE IF NOT EXISTS sync_state (
+            name            TEXT PRIMARY KEY,
+            value           INTEGER NOT NULL
+        );
+
         CREATE INDEX IF NOT EXISTS idx_timestamp ON clipboard_entries(timestamp DESC);
         CREATE INDEX IF NOT EXISTS idx_type ON clipboard_entries(type);
         CREATE INDEX IF NOT EXISTS idx_hash ON clipboard_entries(hash);
         CREATE INDEX IF NOT EXISTS idx_favorited ON clipboard_entries(is_favorited);
         CREATE INDEX IF NOT EXISTS idx_entry_tags_entry ON entry_tags(entry_id);
+        CREATE INDEX IF NOT EXISTS idx_entry_tags_name ON entry_tags(tag_name COLLATE NOCASE, entry_id);
     )";
 
     char* errorMsg = nullptr;
@@ -127,21 +290,91 @@ bool DataManager::CreateTables() {
         // Non-fatal, continue
     }
 
+    // Full-text index is optional, search falls back to LIKE without it
+    m_hasFts = CreateSearchIndex();
+
+    return true;
+}
+
+bool DataManager::CreateSearchIndex() {
+    // The trigram tokenizer matches arbitrary substrings (like LIKE '%x%')
+    // for terms of 3+ characters. It needs FTS5 and SQLite 3.34 or newer.
+    bool exists = false;
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(m_db, "SELECT 1 FROM sqlite_master WHERE name = 'clipboard_fts'", -1, &stmt, nullptr) == SQLITE_OK) {
+        exists = sqlite3_step(stmt) == SQLITE_ROW;
+        sqlite3_finalize(stmt);
+    }
+
+    char* errorMsg = nullptr;
+    if (!exists) {
+        const char* createSQL = "CREATE VIRTUAL TABLE clipboard_fts USING fts5(preview, tags, tokenize = 'trigram')";
+        if (sqlite3_exec(m_db, createSQL, nullptr, nullptr, &errorMsg) != SQLITE_OK) {
+            LOG_WARN("Full-text search unavailable: " + std::string(errorMsg ? errorMsg : "unknown"));
+            if (errorMsg) sqlite3_free(errorMsg);
+            return false;
+        }
+    }
+
+    // Keep the index in sync with entries and their tags (rowid = entry id)
+    const char* triggerSQL = R"(
+        CREATE TRIGGER IF NOT EXISTS clipboard_fts_insert AFTER INSERT ON clipboard_entries BEGIN
+            INSERT INTO clipboard_fts(rowid, preview, tags) VALUES (new.id, new.preview, '');
+        END;
+        CREATE TRIGGER IF NOT EXISTS clipboard_fts_delete AFTER DELETE ON clipboard_entries BEGIN
+            DELETE FROM clipboard_fts WHERE rowid = old.id;
+        END;
+        CREATE TRIGGER IF NOT EXISTS clipboard_fts_update AFTER UPDATE OF preview ON clipboard_entries BEGIN
+            UPDATE clipboard_fts SET preview = new.preview WHERE rowid = new.id;
+        END;
+        CREATE TRIGGER IF NOT EXISTS clipboard_fts_tag_insert AFTER INSERT ON entry_tags BEGIN
+            UPDATE clipboard_fts SET tags = (SELECT group_concat(tag_name, ' ') FROM entry_tags WHERE entry_id = new.entry_id)
+            WHERE rowid = new.entry_id;
+        END;
+        CREATE TRIGGER IF NOT EXISTS clipboard_fts_tag_delete AFTER DELETE ON entry_tags BEGIN
+            UPDATE clipboard_fts SET tags = coalesce((SELECT group_concat(tag_name, ' ') FROM entry_tags WHERE entry_id = old.entry_id), '')
+            WHERE rowid = old.entry_id;
+        END;
+    )";
+    if (sqlite3_exec(m_db, triggerSQL, nullptr, nullptr, &errorMsg) != SQLITE_OK) {
+        LOG_ERROR("Failed to create search triggers: " + std::string(errorMsg ? errorMsg : "unknown"));
+        if (errorMsg) sqlite3_free(errorMsg);
+        return false;
+    }
+
+    if (!exists) {
+        // Index entries that were stored before the table existed
+        const char* populateSQL = R"(
+            INSERT INTO clipboard_fts(rowid, preview, tags)
+            SELECT id, coalesce(preview, ''),
+                   coalesce((SELECT group_concat(tag_name, ' ') FROM entry_tags WHERE entry_id = clipboard_entries.id), '')
+            FROM clipboard_entries
+        )";
+        if (sqlite3_exec(m_db, populateSQL, nullptr, nullptr, &errorMsg) != SQLITE_OK) {
+            LOG_ERROR("Failed to build search index: " + std::string(errorMsg ? errorMsg : "unknown"));
+            if (errorMsg) sqlite3_free(errorMsg);
+            return false;
+        }
+        LOG_INFO("Built full-text search index");
+    }
+
     return true;
 }
 
 bool DataManager::UpgradeSchema() {
-    // Check if is_tagged column exists
+    // Check which optional columns exist
     const char* checkColSQL = "PRAGMA table_info(clipboard_entries)";
     sqlite3_stmt* stmt = nullptr;
     bool hasIsTagged = false;
+    bool hasSimhash = false;
 
     if (sqlite3_prepare_v2(m_db, checkColSQL, -1, &stmt, nullptr) == SQLITE_OK) {
         while (sqlite3_step(stmt) == SQLITE_ROW) {
             const char* colName = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
             if (colName && strcmp(colName, "is_tagged") == 0) {
                 hasIsTagged = true;
-                break;
+            } else if (colName && strcmp(colName, "simhash") == 0) {
+                hasSimhash = true;
             }
         }
         sqlite3_finalize(stmt);
@@ -161,17 +394,32 @@ bool DataManager::UpgradeSchema() {
         }
     }
 
+    // Near-duplicate fingerprint, NULL for non-text and very short entries.
+    // Existing rows are filled in by LoadNearDuplicateIndex.
+    if (!hasSimhash) {
+        const char* alterSQL = "ALTER TABLE clipboard_entries ADD COLUMN simhash INTEGER";
+        char* errorMsg = nullptr;
+        int result = sqlite3_exec(m_db, alterSQL, nullptr, nullptr, &errorMsg);
+        if (result != SQLITE_OK) {
+            LOG_ERROR("Failed to add simhash column: " + std::string(errorMsg ? errorMsg : "unknown"));
+            if (errorMsg) sqlite3_free(errorMsg);
+        } else {
+            LOG_INFO("Added simhash column to clipboard_entries");
+        }
+    }
+
     return true;
 }
 
 int64_t DataManager::Insert(const ClipboardEntry& entry) {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<uint8_t> thumbnail = ThumbnailFor(entry);
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
 
     if (!m_initialized) return -1;
 
     const char* sql = R"(
-        INSERT INTO clipboard_entries (timestamp, type, data, preview, source_app, hash, copy_count, is_favorited, is_tagged, created_at, updated_at)
-        VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
+        INSERT INTO clipboard_entries (timestamp, type, data, preview, source_app, hash, copy_count, is_favorited, is_tagged, created_at, updated_at, simhash)
+        VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
     )";
 
     sqlite3_stmt* stmt = nullptr;
@@ -194,6 +442,7 @@ int64_t DataManager::Insert(const ClipboardEntry& entry) {
     sqlite3_bind_int(stmt, 9, entry.isTagged ? 1 : 0);
     sqlite3_bind_int64(stmt, 10, now);
     sqlite3_bind_int64(stmt, 11, now);
+    BindSimhash(stmt, 12, entry.simhash);
 
     int result = sqlite3_step(stmt);
     sqlite3_finalize(stmt);
@@ -204,23 +453,47 @@ int64_t DataManager::Insert(const ClipboardEntry& entry) {
     }
 
     int64_t id = sqlite3_last_insert_rowid(m_db);
+    if (entry.simhash != 0) {
+        m_nearDuplicates.Add(id, entry.simhash);
+        RecordUndo([this, id]() { m_nearDuplicates.Remove(id); });
+    }
+    if (!thumbnail.empty() && !StoreThumbnail(id, thumbnail)) {
+        thumbnail.clear();
+    }
+
+    EntryChange change = MakeInsertedChange(entry);
+    change.id = change.entry.id = id;
+    change.entry.thumbnail = std::move(thumbnail);
+    NotifyChange(std::move(change));
     LOG_DEBUG("Inserted entry with id: " + std::to_string(id));
     return id;
 }
 
 int64_t DataManager::InsertMemoryOnly(const ClipboardEntry& entry) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-
     ClipboardEntry memoryEntry = entry;
+    memoryEntry.thumbnail = ThumbnailFor(entry);
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
     memoryEntry.id = m_nextMemoryId--;
     memoryEntry.isTagged = false;
 
     m_memoryEntries.insert(m_memoryEntries.begin(), memoryEntry);
+    if (memoryEntry.simhash != 0) {
+        m_nearDuplicates.Add(memoryEntry.id, memoryEntry.simhash);
+    }
+    NotifyChange(MakeInsertedChange(memoryEntry));
 
     // Limit memory entries to prevent excessive memory usage
     const size_t maxMemoryEntries = 100;
     if (m_memoryEntries.size() > maxMemoryEntries) {
+        EntryChange evicted;
+        evicted.kind = EntryChange::Kind::Deleted;
+        for (size_t i = maxMemoryEntries; i < m_memoryEntries.size(); i++) {
+            m_nearDuplicates.Remove(m_memoryEntries[i].id);
+            evicted.ids.push_back(m_memoryEntries[i].id);
+        }
         m_memoryEntries.resize(maxMemoryEntries);
+        NotifyChange(std::move(evicted));
     }
 
     LOG_DEBUG("Inserted memory entry with id: " + std::to_string(memoryEntry.id));
@@ -228,13 +501,27 @@ int64_t DataManager::InsertMemoryOnly(const ClipboardEntry& entry) {
 }
 
 void DataManager::ClearMemoryEntries() {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
+    EntryChange change;
+    change.kind = EntryChange::Kind::Deleted;
+    for (const auto& memEntry : m_memoryEntries) {
+        m_nearDuplicates.Remove(memEntry.id);
+        change.ids.push_back(memEntry.id);
+    }
     m_memoryEntries.clear();
+    if (!change.ids.empty()) {
+        NotifyChange(std::move(change));
+    }
     m_nextMemoryId = -1;
     LOG_INFO("Cleared all memory entries");
 }
 
 std::optional<int64_t> DataManager::PersistMemoryEntry(int64_t memoryId) {
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
+    return PersistMemoryEntryLocked(memoryId);
+}
+
+std::optional<int64_t> DataManager::PersistMemoryEntryLocked(int64_t memoryId) {
     // Find the memory entry
     auto it = std::find_if(m_memoryEntries.begin(), m_memoryEntries.end(),
         [memoryId](const ClipboardEntry& e) { return e.id == memoryId; });
@@ -248,8 +535,8 @@ std::optional<int64_t> DataManager::PersistMemoryEntry(int64_t memoryId) {
     entry.isTagged = true;
 
     const char* sql = R"(
-        INSERT INTO clipboard_entries (timestamp, type, data, preview, source_app, hash, copy_count, is_favorited, is_tagged, created_at, updated_at)
-        VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
+        INSERT INTO clipboard_entries (timestamp, type, data, preview, source_app, hash, copy_count, is_favorited, is_tagged, created_at, updated_at, simhash)
+        VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
     )";
 
     sqlite3_stmt* stmt = nullptr;
@@ -272,6 +559,7 @@ std::optional<int64_t> DataManager::PersistMemoryEntry(int64_t memoryId) {
     sqlite3_bind_int(stmt, 9, 1);  // is_tagged = 1
     sqlite3_bind_int64(stmt, 10, now);
     sqlite3_bind_int64(stmt, 11, now);
+    BindSimhash(stmt, 12, entry.simhash);
 
     int result = sqlite3_step(stmt);
     sqlite3_finalize(stmt);
@@ -282,9 +570,26 @@ std::optional<int64_t> DataManager::PersistMemoryEntry(int64_t memoryId) {
     }
 
     int64_t newId = sqlite3_last_insert_rowid(m_db);
+    if (!entry.thumbnail.empty()) {
+        StoreThumbnail(newId, entry.thumbnail);
+    }
 
     // Remove from memory (entry is now persisted)
+    size_t index = static_cast<size_t>(it - m_memoryEntries.begin());
+    RecordUndo([this, index, newId, memoryEntry = std::move(*it)]() {
+        m_nearDuplicates.Remove(newId);
+        RestoreMemoryEntry(index, memoryEntry);
+    });
     m_memoryEntries.erase(it);
+    m_nearDuplicates.Remove(memoryId);
+    if (entry.simhash != 0) {
+        m_nearDuplicates.Add(newId, entry.simhash);
+    }
+
+    EntryChange change;
+    change.id = memoryId;
+    change.newId = newId;
+    NotifyChange(std::move(change));
 
     LOG_INFO("Persisted memory entry to database with id: " + std::to_string(newId));
     return newId;
@@ -318,13 +623,14 @@ ClipboardEntry DataManager::RowToEntry(sqlite3_stmt* stmt) {
     return entry;
 }
 
-void DataManager::LoadTagsForEntry(ClipboardEntry& entry) {
-    if (!m_db || entry.id < 0) return;
+void DataManager::LoadTagsForEntry(ClipboardEntry& entry, sqlite3* db) {
+    if (!db) db = m_db;
+    if (!db || entry.id < 0) return;
 
     const char* sql = "SELECT tag_name FROM entry_tags WHERE entry_id = ? ORDER BY created_at";
 
     sqlite3_stmt* stmt = nullptr;
-    if (sqlite3_prepare_v2(m_db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
         return;
     }
 
@@ -340,9 +646,48 @@ void DataManager::LoadTagsForEntry(ClipboardEntry& entry) {
     sqlite3_finalize(stmt);
 }
 
-std::vector<ClipboardEntry> DataManager::Query(const QueryOptions& options) {
+void DataManager::LoadThumbnailForEntry(ClipboardEntry& entry, sqlite3* db) {
+    if (!db) db = m_db;
+    if (!db || entry.id < 0 || entry.type != ClipboardDataType::Image) return;
+
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, "SELECT data FROM entry_thumbnails WHERE entry_id = ?", -1, &stmt, nullptr) != SQLITE_OK) {
+        return;
+    }
+
+    sqlite3_bind_int64(stmt, 1, entry.id);
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        const auto* data = static_cast<const uint8_t*>(sqlite3_column_blob(stmt, 0));
+        entry.thumbnail.assign(data, data + sqlite3_column_bytes(stmt, 0));
+    }
+
+    sqlite3_finalize(stmt);
+}
+
+bool DataManager::StoreThumbnail(int64_t id, const std::vector<uint8_t>& thumbnail) {
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(m_db, "INSERT OR REPLACE INTO entry_thumbnails (entry_id, data) VALUES (?, ?)", -1, &stmt,
+                           nullptr) != SQLITE_OK) {
+        LOG_ERROR("Failed to prepare thumbnail insert: " + std::string(sqlite3_errmsg(m_db)));
+        return false;
+    }
+
+    sqlite3_bind_int64(stmt, 1, id);
+    sqlite3_bind_blob(stmt, 2, thumbnail.data(), static_cast<int>(thumbnail.size()), SQLITE_TRANSIENT);
+    int result = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+
+    if (result != SQLITE_DONE) {
+        LOG_ERROR("Failed to store thumbnail: " + std::string(sqlite3_errmsg(m_db)));
+        return false;
+    }
+    return true;
+}
+
+std::vector<ClipboardEntry> DataManager::Query(const QueryOptions& options, int64_t* total) {
+    CLIPX_TRACE_SPAN("db.query");
     std::vector<ClipboardEntry> entries;
-    std::lock_guard<std::mutex> lock(m_mutex);
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
 
     // Add memory entries
     for (const auto& memEntry : m_memoryEntries) {
@@ -354,23 +699,36 @@ std::vector<ClipboardEntry> DataManager::Query(const QueryOptions& options) {
         }
         entries.push_back(memEntry);
     }
+    if (total) {
+        *total = static_cast<int64_t>(entries.size());
+    }
 
     if (!m_initialized) return entries;
 
-    // Query database entries
-    std::ostringstream sql;
-    sql << "SELECT id, timestamp, type, data, preview, source_app, copy_count, is_favorited, is_tagged FROM clipboard_entries";
-
-    bool hasWhere = false;
+    // Query database entries; pages never carry the payload, image rows
+    // bring their thumbnail instead
+    std::ostringstream where;
     if (options.filterType.has_value()) {
-        sql << " WHERE type = " << static_cast<int>(*options.filterType);
-        hasWhere = true;
+        where << " WHERE type = " << static_cast<int>(*options.filterType);
     }
     if (options.favoritesOnly) {
-        sql << (hasWhere ? " AND" : " WHERE") << " is_favorited = 1";
-        hasWhere = true;
+        where << (options.filterType.has_value() ? " AND" : " WHERE") << " is_favorited = 1";
     }
 
+    if (total) {
+        std::string countSql = "SELECT COUNT(*) FROM clipboard_entries" + where.str();
+        sqlite3_stmt* count = nullptr;
+        if (sqlite3_prepare_v2(m_db, countSql.c_str(), -1, &count, nullptr) == SQLITE_OK &&
+            sqlite3_step(count) == SQLITE_ROW) {
+            *total += sqlite3_column_int64(count, 0);
+        }
+        sqlite3_finalize(count);
+    }
+
+    std::ostringstream sql;
+    sql << "SELECT id, timestamp, type, NULL, preview, source_app, copy_count, is_favorited, is_tagged FROM clipboard_entries"
+        << where.str();
+
     // Order by
     switch (options.sortOrder) {
         case QueryOptions::SortOrder::LatestFirst:
@@ -387,7 +745,10 @@ std::vector<ClipboardEntry> DataManager::Query(const QueryOptions& options) {
             break;
     }
 
-    sql << " LIMIT " << options.limit << " OFFSET " << options.offset;
+    // Memory entries may sort anywhere among the stored rows, so the page is
+    // cut after merging: every stored row that can land before its end is
+    // read, and the offset is applied once, below
+    sql << " LIMIT " << static_cast<int64_t>(options.limit) + options.offset;
 
     sqlite3_stmt* stmt = nullptr;
     if (sqlite3_prepare_v2(m_db, sql.str().c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
@@ -396,9 +757,7 @@ std::vector<ClipboardEntry> DataManager::Query(const QueryOptions& options) {
     }
 
     while (sqlite3_step(stmt) == SQLITE_ROW) {
-        ClipboardEntry entry = RowToEntry(stmt);
-        LoadTagsForEntry(entry);
-        entries.push_back(entry);
+        entries.push_back(RowToEntry(stmt));
     }
 
     sqlite3_finalize(stmt);
@@ -435,95 +794,608 @@ std::vector<ClipboardEntry> DataManager::Query(const QueryOptions& options) {
     }
 
     // Apply offset and limit after sorting
-    size_t startIdx = std::min(static_cast<size_t>(options.offset), entries.size());
-    size_t endIdx = std::min(startIdx + static_cast<size_t>(options.limit), entries.size());
+    size_t startIdx = std::min(static_cast<size_t>(std::max(options.offset, 0)), entries.size());
+    size_t endIdx = std::min(startIdx + static_cast<size_t>(std::max(options.limit, 0)), entries.size());
 
     if (startIdx > 0 || endIdx < entries.size()) {
-        entries = std::vector<ClipboardEntry>(entries.begin() + startIdx, entries.begin() + endIdx);
+        entries = std::vector<ClipboardEntry>(std::make_move_iterator(entries.begin() + startIdx),
+                                              std::make_move_iterator(entries.begin() + endIdx));
+    }
+
+    // Only rows of the page are completed; memory entries have theirs
+    for (auto& entry : entries) {
+        LoadTagsForEntry(entry);
+        LoadThumbnailForEntry(entry);
     }
 
     return entries;
 }
 
 std::vector<ClipboardEntry> DataManager::Search(const std::string& keyword, int limit) {
+    if (keyword.empty()) return {};
+    return Search(ParseSearchQuery(keyword), limit);
+}
+
+std::vector<ClipboardEntry> DataManager::Search(const SearchQuery& query, int limit, bool* timedOut) {
     std::vector<ClipboardEntry> entries;
-    std::lock_guard<std::mutex> lock(m_mutex);
+    SearchStreaming(query, limit, limit, limit, nullptr, [&entries](std::vector<ClipboardEntry>&& batch) {
+        entries.insert(entries.end(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+        return true;
+    }, timedOut);
+    return entries;
+}
 
-    if (keyword.empty()) return entries;
+bool DataManager::SearchStreaming(const SearchQuery& query, int limit, int firstBatch, int batchSize,
+                                  const std::atomic<bool>* cancel, const SearchBatchCallback& onBatch,
+                                  bool* timedOut) {
+    if (query.IsEmpty() || limit <= 0) return true;
+    CLIPX_TRACE_SPAN("db.search");
+    firstBatch = std::max(1, firstBatch);
+    batchSize = std::max(1, batchSize);
+
+    std::vector<ClipboardEntry> batch;
+    int delivered = 0;
+    bool firstSent = false;
+
+    auto flush = [&]() {
+        if (batch.empty()) return true;
+        delivered += static_cast<int>(batch.size());
+        firstSent = true;
+        std::vector<ClipboardEntry> out;
+        out.swap(batch);
+        return onBatch(std::move(out));
+    };
+    auto batchFull = [&]() {
+        return static_cast<int>(batch.size()) >= (firstSent ? batchSize : firstBatch);
+    };
+
+    // Only memory entries, which are not flushed to the database, take the
+    // C++ path: MatchesSearchQuery evaluates the predicates PrepareSearch
+    // puts in SQL for every stored row (DataManager tests keep the two in
+    // agreement). They are the newest entries, so they lead the first batch.
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_mutex);
+        for (const auto& memEntry : m_memoryEntries) {
+            if (MatchesSearchQuery(query, memEntry)) {
+                batch.push_back(memEntry);
+                if (static_cast<int>(batch.size()) >= limit) break;
+            }
+        }
+        if (!m_initialized) return flush();
+    }
 
-    // Search in memory entries (both preview and tags)
-    std::string searchLower = keyword;
-    std::transform(searchLower.begin(), searchLower.end(), searchLower.begin(), ::tolower);
+    if (static_cast<int>(batch.size()) >= limit) return flush();
+    if (batchFull() && !flush()) return false;
 
-    for (const auto& memEntry : m_memoryEntries) {
-        bool found = false;
+    sqlite3* db = AcquireReadConnection();
+    if (!db) {
+        flush();
+        return false;
+    }
 
-        // Search in preview text
-        std::string previewLower = memEntry.preview;
-        std::transform(previewLower.begin(), previewLower.end(), previewLower.begin(), ::tolower);
+    // The handler runs every 1000 VM instructions, so a cancelled or overdue
+    // query stops mid-statement (including a sort) instead of running to the end
+    struct StopCheck {
+        const std::atomic<bool>* cancel;
+        Regex::Clock::time_point deadline;
+    } stopCheck{cancel, Regex::Clock::time_point::max()};
+    if (query.timeBudgetMs > 0) {
+        stopCheck.deadline = Regex::Clock::now() + std::chrono::milliseconds(query.timeBudgetMs);
+    }
+    const bool budgeted = stopCheck.deadline != Regex::Clock::time_point::max();
+
+    if (cancel || budgeted) {
+        sqlite3_progress_handler(db, 1000, [](void* data) -> int {
+            const auto* check = static_cast<const StopCheck*>(data);
+            if (check->cancel && check->cancel->load(std::memory_order_relaxed)) return 1;
+            return Regex::Clock::now() > check->deadline ? 1 : 0;
+        }, &stopCheck);
+    }
+    t_searchDeadline = stopCheck.deadline;
+
+    bool completed = false;
+    sqlite3_stmt* stmt = PrepareSearch(db, query, limit - static_cast<int>(batch.size()) - delivered);
+    if (stmt) {
+        int rc;
+        bool stopped = false;
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            ClipboardEntry entry = RowToEntry(stmt);
+            LoadTagsForEntry(entry, db);
+            LoadThumbnailForEntry(entry, db);
+            batch.push_back(std::move(entry));
+
+            if (batchFull() && !flush()) {
+                stopped = true;
+                break;
+            }
+        }
+        sqlite3_finalize(stmt);
 
-        if (previewLower.find(searchLower) != std::string::npos) {
-            found = true;
+        if (!stopped && rc != SQLITE_DONE && budgeted && Regex::Clock::now() > stopCheck.deadline) {
+            // Out of time: deliver what was found so far
+            LOG_DEBUG("Search exceeded its " + std::to_string(query.timeBudgetMs) + " ms budget");
+            if (timedOut) *timedOut = true;
+            flush();
+        } else if (rc == SQLITE_INTERRUPT) {
+            LOG_DEBUG("Search cancelled");
+        } else if (!stopped && rc != SQLITE_DONE) {
+            LOG_ERROR("Search failed: " + std::string(sqlite3_errmsg(db)));
+        } else if (!stopped) {
+            completed = flush();
         }
+    }
 
-        // Search in tags
-        if (!found) {
-            for (const auto& tag : memEntry.tags) {
-                std::string tagLower = tag;
-                std::transform(tagLower.begin(), tagLower.end(), tagLower.begin(), ::tolower);
-                if (tagLower.find(searchLower) != std::string::npos) {
-                    found = true;
-                    break;
-                }
+    t_searchDeadline = Regex::Clock::time_point::max();
+    if (cancel || budgeted) {
+        sqlite3_progress_handler(db, 0, nullptr, nullptr);
+    }
+    ReleaseReadConnection(db);
+    return completed;
+}
+
+sqlite3* DataManager::AcquireReadConnection() {
+    {
+        std::lock_guard<std::mutex> lock(m_readPoolMutex);
+        if (m_readsClosed) {
+            return nullptr;
+        }
+        m_activeReadConnections++;
+        if (!m_idleReadConnections.empty()) {
+            sqlite3* db = m_idleReadConnections.back();
+            m_idleReadConnections.pop_back();
+            return db;
+        }
+    }
+
+    // Each connection is used by one thread at a time, no internal mutex needed
+    sqlite3* db = nullptr;
+    if (sqlite3_open_v2(m_dbPath.c_str(), &db, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX | SQLITE_OPEN_URI,
+                        nullptr) != SQLITE_OK) {
+        LOG_ERROR("Failed to open read connection: " + std::string(sqlite3_errmsg(db)));
+        sqlite3_close(db);
+        ReleaseReadConnection(nullptr);
+        return nullptr;
+    }
+    sqlite3_busy_timeout(db, BUSY_TIMEOUT_MS);
+    RegisterSqlFunctions(db);
+    return db;
+}
+
+void DataManager::ReleaseReadConnection(sqlite3* db) {
+    // Keep enough warm connections for the next queries, close the rest
+    {
+        std::lock_guard<std::mutex> lock(m_readPoolMutex);
+        if (db && !m_readsClosed && m_idleReadConnections.size() < m_maxIdleReadConnections) {
+            m_idleReadConnections.push_back(db);
+        } else if (db) {
+            sqlite3_close(db);
+        }
+        m_activeReadConnections--;
+    }
+    m_readConnectionReleased.notify_all();
+}
+
+namespace {
+
+// A bound value for a planned search statement
+struct SearchParam {
+    bool isText = false;
+    int64_t number = 0;
+    std::string text;
+
+    static SearchParam Int(int64_t v) { SearchParam p; p.number = v; return p; }
+    static SearchParam Text(std::string v) { SearchParam p; p.isText = true; p.text = std::move(v); return p; }
+};
+
+// Tag filters with at most this many rows always drive the query, above it
+// an FTS term (if any) is assumed to be the narrower index
+constexpr int64_t TAG_DRIVER_MAX_ROWS = 2000;
+
+// Wrap a term for LIKE ... ESCAPE '\' so % and _ match literally
+std::string LikePattern(const std::string& term) {
+    std::string pattern = "%";
+    for (char c : term) {
+        if (c == '%' || c == '_' || c == '\\') pattern += '\\';
+        pattern += c;
+    }
+    pattern += '%';
+    return pattern;
+}
+
+// Quote a term as an FTS5 string so operators in user input stay literal
+std::string FtsString(const std::string& term) {
+    std::string quoted = "\"";
+    for (char c : term) {
+        if (c == '"') quoted += '"';
+        quoted += c;
+    }
+    quoted += '"';
+    return quoted;
+}
+
+// Trigrams are built over characters, not bytes
+size_t Utf8Length(const std::string& str) {
+    size_t length = 0;
+    for (unsigned char c : str) {
+        if ((c & 0xC0) != 0x80) length++;
+    }
+    return length;
+}
+
+int64_t CountTagRows(sqlite3* db, const std::string& tag) {
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM entry_tags WHERE tag_name = ? COLLATE NOCASE", -1, &stmt, nullptr) != SQLITE_OK) {
+        return 0;
+    }
+    sqlite3_bind_text(stmt, 1, tag.c_str(), -1, SQLITE_TRANSIENT);
+    int64_t count = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int64(stmt, 0) : 0;
+    sqlite3_finalize(stmt);
+    return count;
+}
+
+} // namespace
+
+// Must select exactly the rows MatchesSearchQuery accepts, which filters
+// memory entries
+sqlite3_stmt* DataManager::PrepareSearch(sqlite3* db, const SearchQuery& query, int limit) {
+    enum class Driver { Timestamp, Tag, Fts, Type };
+
+    // Free-text terms the trigram index can answer; the rest use LIKE
+    std::vector<std::string> ftsTerms;
+    std::vector<std::string> likeTerms;
+    for (const auto& term : query.terms) {
+        if (m_hasFts && Utf8Length(term) >= 3) {
+            ftsTerms.push_back(term);
+        } else {
+            likeTerms.push_back(term);
+        }
+    }
+
+    // Literals every regex match contains narrow the candidates (through the
+    // trigram index when long enough) before REGEXP runs on the survivors
+    std::string regexPattern;
+    std::vector<std::string> ftsLiterals;
+    std::vector<std::string> likeLiterals;
+    if (!query.regex.empty()) {
+        regexPattern = (query.regexIgnoreCase ? "(?i)" : "") + query.regex;
+        std::string error;
+        auto regex = RegexCache::Instance().Get(regexPattern, false, &error);
+        if (!regex) {
+            LOG_WARN("Invalid search regex: " + error);
+            return nullptr;
+        }
+        for (const auto& literal : regex->RequiredLiterals()) {
+            if (m_hasFts && Utf8Length(literal) >= 3) {
+                ftsLiterals.push_back(literal);
+            } else {
+                likeLiterals.push_back(literal);
             }
         }
+    }
 
-        if (found) {
-            entries.push_back(memEntry);
-            if (static_cast<int>(entries.size()) >= limit) {
-                return entries;
+    // Pick the index that drives the scan. Tag lookups are exact and cheap to
+    // count, so the rarest tag competes with FTS on its row count. Otherwise a
+    // non-text type narrows well through idx_type, and everything else walks
+    // idx_timestamp newest-first, which stops as soon as LIMIT rows match.
+    Driver driver = Driver::Timestamp;
+    size_t driverTag = 0;
+    if (!query.tags.empty()) {
+        int64_t fewest = -1;
+        for (size_t i = 0; i < query.tags.size(); i++) {
+            int64_t count = CountTagRows(db, query.tags[i]);
+            if (fewest < 0 || count < fewest) {
+                fewest = count;
+                driverTag = i;
             }
         }
+        driver = ((ftsTerms.empty() && ftsLiterals.empty()) || fewest <= TAG_DRIVER_MAX_ROWS) ? Driver::Tag : Driver::Fts;
+    } else if (!ftsTerms.empty() || !ftsLiterals.empty()) {
+        driver = Driver::Fts;
+    } else if (query.type.has_value() && *query.type != ClipboardDataType::Text && !query.after.has_value()) {
+        driver = Driver::Type;
     }
 
-    if (!m_initialized) return entries;
+    std::string sql = driver == Driver::Tag ? "SELECT DISTINCT" : "SELECT";
+    // The payload is never part of a search result, skip reading it
+    sql += " e.id, e.timestamp, e.type, NULL, e.preview, e.source_app, e.copy_count, e.is_favorited, e.is_tagged";
 
-    // Search in database - search both preview text and tags
-    // Use DISTINCT to avoid duplicates when an entry matches both preview and tag
-    std::string sql = R"(
-        SELECT DISTINCT e.id, e.timestamp, e.type, e.data, e.preview, e.source_app, e.copy_count, e.is_favorited, e.is_tagged
-        FROM clipboard_entries e
-        LEFT JOIN entry_tags t ON e.id = t.entry_id
-        WHERE e.preview LIKE ? OR t.tag_name LIKE ?
-        ORDER BY e.timestamp DESC
-        LIMIT ?
-    )";
+    std::vector<std::string> where;
+    std::vector<SearchParam> params;
+
+    // CROSS JOIN and INDEXED BY pin SQLite to the chosen access path
+    switch (driver) {
+        case Driver::Tag:
+            sql += " FROM entry_tags d CROSS JOIN clipboard_entries e ON e.id = d.entry_id";
+            where.push_back("d.tag_name = ? COLLATE NOCASE");
+            params.push_back(SearchParam::Text(query.tags[driverTag]));
+            break;
+        case Driver::Fts: {
+            sql += " FROM clipboard_fts CROSS JOIN clipboard_entries e ON e.id = clipboard_fts.rowid";
+            std::string match;
+            for (const auto& term : ftsTerms) {
+                if (!match.empty()) match += " AND ";
+                match += FtsString(term);
+            }
+            for (const auto& literal : ftsLiterals) {
+                if (!match.empty()) match += " AND ";
+                match += FtsString(literal);
+            }
+            where.push_back("clipboard_fts MATCH ?");
+            params.push_back(SearchParam::Text(match));
+            ftsTerms.clear();
+            ftsLiterals.clear();
+            break;
+        }
+        case Driver::Type:
+            sql += " FROM clipboard_entries e INDEXED BY idx_type";
+            break;
+        case Driver::Timestamp:
+            sql += " FROM clipboard_entries e INDEXED BY idx_timestamp";
+            break;
+    }
+
+    if (query.type.has_value()) {
+        where.push_back("e.type = ?");
+        params.push_back(SearchParam::Int(static_cast<int>(*query.type)));
+    }
+    if (query.favoritesOnly) {
+        where.push_back("e.is_favorited = 1");
+    }
+    if (query.before.has_value()) {
+        where.push_back("e.timestamp < ?");
+        params.push_back(SearchParam::Int(*query.before));
+    }
+    if (query.after.has_value()) {
+        where.push_back("e.timestamp >= ?");
+        params.push_back(SearchParam::Int(*query.after));
+    }
+    for (size_t i = 0; i < query.tags.size(); i++) {
+        if (driver == Driver::Tag && i == driverTag) continue;
+        where.push_back("EXISTS (SELECT 1 FROM entry_tags t WHERE t.entry_id = e.id AND t.tag_name = ? COLLATE NOCASE)");
+        params.push_back(SearchParam::Text(query.tags[i]));
+    }
+    for (const auto& app : query.apps) {
+        where.push_back("e.source_app LIKE ? ESCAPE '\\'");
+        params.push_back(SearchParam::Text(LikePattern(app)));
+    }
+
+    // Terms not answered by the driving index match preview or any tag
+    likeTerms.insert(likeTerms.end(), ftsTerms.begin(), ftsTerms.end());
+    for (const auto& term : likeTerms) {
+        where.push_back("(e.preview LIKE ? ESCAPE '\\' OR EXISTS (SELECT 1 FROM entry_tags t WHERE t.entry_id = e.id AND t.tag_name LIKE ? ESCAPE '\\'))");
+        params.push_back(SearchParam::Text(LikePattern(term)));
+        params.push_back(SearchParam::Text(LikePattern(term)));
+    }
+
+    if (!regexPattern.empty()) {
+        // Literals the index didn't take are checked on the preview, which is all the regex sees
+        likeLiterals.insert(likeLiterals.end(), ftsLiterals.begin(), ftsLiterals.end());
+        for (const auto& literal : likeLiterals) {
+            where.push_back("e.preview LIKE ? ESCAPE '\\'");
+            params.push_back(SearchParam::Text(LikePattern(literal)));
+        }
+        where.push_back("e.preview REGEXP ?");
+        params.push_back(SearchParam::Text(regexPattern));
+    }
+
+    for (size_t i = 0; i < where.size(); i++) {
+        sql += (i == 0 ? " WHERE " : " AND ");
+        sql += where[i];
+    }
+    sql += " ORDER BY e.timestamp DESC LIMIT ?";
+    params.push_back(SearchParam::Int(limit));
 
     sqlite3_stmt* stmt = nullptr;
-    if (sqlite3_prepare_v2(m_db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
-        LOG_ERROR("Failed to prepare search: " + std::string(sqlite3_errmsg(m_db)));
-        return entries;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        LOG_ERROR("Failed to prepare search: " + std::string(sqlite3_errmsg(db)));
+        return nullptr;
     }
 
-    // Use %keyword% for substring matching
-    std::string searchPattern = "%" + keyword + "%";
+    for (size_t i = 0; i < params.size(); i++) {
+        int index = static_cast<int>(i) + 1;
+        if (params[i].isText) {
+            sqlite3_bind_text(stmt, index, params[i].text.c_str(), -1, SQLITE_TRANSIENT);
+        } else {
+            sqlite3_bind_int64(stmt, index, params[i].number);
+        }
+    }
 
-    sqlite3_bind_text(stmt, 1, searchPattern.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, searchPattern.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_int(stmt, 3, limit - static_cast<int>(entries.size()));
+    return stmt;
+}
 
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        ClipboardEntry entry = RowToEntry(stmt);
-        LoadTagsForEntry(entry);
-        entries.push_back(entry);
+std::vector<ClipboardEntry> DataManager::DeepSearch(const std::string& keyword, int limit,
+                                                    const std::atomic<bool>* cancel,
+                                                    DeepSearchStats* stats) {
+    std::vector<ClipboardEntry> entries;
+    if (keyword.empty() || limit <= 0) return entries;
+
+    auto startTime = std::chrono::steady_clock::now();
+    std::string needle = utils::ToLower(keyword);
+    DeepSearchStats localStats;
+
+    auto isTextType = [](ClipboardDataType type) {
+        return type == ClipboardDataType::Text || type == ClipboardDataType::Html || type == ClipboardDataType::Rtf;
+    };
+
+    auto finish = [&]() {
+        localStats.elapsedMs = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - startTime).count();
+        if (stats) *stats = localStats;
+        LOG_DEBUG("Deep search scanned " + std::to_string(localStats.bytesScanned) + " bytes in " +
+                  std::to_string(localStats.elapsedMs) + " ms (" +
+                  std::to_string(localStats.ThroughputGBps()) + " GB/s), hits: " + std::to_string(entries.size()));
+    };
+
+    // Memory entries are newest and small in number, scan them under the lock
+    std::vector<int64_t> candidates;
+    sqlite3* db = nullptr;
+    ThreadPool* pool = nullptr;
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
+        for (const auto& memEntry : m_memoryEntries) {
+            if (!isTextType(memEntry.type)) continue;
+            localStats.entriesScanned++;
+            localStats.bytesScanned += memEntry.data.size();
+            if (text::FindCaseInsensitive(memEntry.data.data(), memEntry.data.size(), needle) != text::NOT_FOUND) {
+                entries.push_back(memEntry);
+                if (static_cast<int>(entries.size()) >= limit) {
+                    finish();
+                    return entries;
+                }
+            }
+        }
+
+        if (!m_initialized || !m_searchPool) {
+            finish();
+            return entries;
+        }
+        // Held for the whole scan, so Shutdown waits for it before closing
+        // the pool and the connections
+        db = AcquireReadConnection();
+        if (!db) {
+            finish();
+            return entries;
+        }
+        pool = m_searchPool.get();
+    }
+
+    // Every worker reads through its own connection; a shared one would
+    // serialize them. ParallelFor runs on the pool and the calling thread.
+    std::vector<sqlite3*> workerDbs = {db};
+    while (workerDbs.size() < pool->Size() + 1) {
+        sqlite3* workerDb = AcquireReadConnection();
+        if (!workerDb) break;
+        workerDbs.push_back(workerDb);
     }
+    auto releaseConnections = [&]() {
+        for (sqlite3* workerDb : workerDbs) {
+            ReleaseReadConnection(workerDb);
+        }
+    };
 
+    // Candidate ids in timestamp order; the payloads themselves are streamed later
+    const char* candidateSql = "SELECT id FROM clipboard_entries WHERE type IN (?, ?, ?) ORDER BY timestamp DESC";
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, candidateSql, -1, &stmt, nullptr) != SQLITE_OK) {
+        LOG_ERROR("Failed to prepare deep search: " + std::string(sqlite3_errmsg(db)));
+        releaseConnections();
+        finish();
+        return entries;
+    }
+    sqlite3_bind_int(stmt, 1, static_cast<int>(ClipboardDataType::Text));
+    sqlite3_bind_int(stmt, 2, static_cast<int>(ClipboardDataType::Html));
+    sqlite3_bind_int(stmt, 3, static_cast<int>(ClipboardDataType::Rtf));
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        candidates.push_back(sqlite3_column_int64(stmt, 0));
+    }
     sqlite3_finalize(stmt);
+
+    // Scan in batches so we can stop as soon as the newest `limit` hits are known
+    // without keeping the whole pool busy on entries that will never be returned
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> bytesScanned{0};
+    const size_t batchSize = workerDbs.size() * 4;
+    std::vector<int64_t> hits;
+
+    for (size_t base = 0; base < candidates.size(); base += batchSize) {
+        if (cancel && cancel->load()) {
+            localStats.cancelled = true;
+            break;
+        }
+
+        size_t count = std::min(batchSize, candidates.size() - base);
+        std::vector<uint8_t> matched(count, 0);
+        std::atomic<size_t> next{0};
+
+        // One task per connection, each taking entries until the batch is done
+        pool->ParallelFor(workerDbs.size(), [&](size_t worker) {
+            uint64_t bytes = 0;
+            for (size_t i = next++; i < count; i = next++) {
+                if (stop.load(std::memory_order_relaxed)) break;
+                if (cancel && cancel->load(std::memory_order_relaxed)) {
+                    stop = true;
+                    break;
+                }
+                matched[i] = ScanEntryData(workerDbs[worker], candidates[base + i], needle, stop, bytes) ? 1 : 0;
+            }
+            bytesScanned += bytes;
+        });
+
+        localStats.entriesScanned += count;
+        for (size_t i = 0; i < count && static_cast<int>(entries.size() + hits.size()) < limit; i++) {
+            if (matched[i]) hits.push_back(candidates[base + i]);
+        }
+        if (static_cast<int>(entries.size() + hits.size()) >= limit) break;
+    }
+    localStats.bytesScanned += bytesScanned.load();
+    if (cancel && cancel->load()) localStats.cancelled = true;
+
+    // Materialize hits without their payloads
+    const char* entrySql = "SELECT id, timestamp, type, NULL, preview, source_app, copy_count, is_favorited, is_tagged FROM clipboard_entries WHERE id = ?";
+    if (!hits.empty() && sqlite3_prepare_v2(db, entrySql, -1, &stmt, nullptr) == SQLITE_OK) {
+        for (int64_t id : hits) {
+            sqlite3_bind_int64(stmt, 1, id);
+            if (sqlite3_step(stmt) == SQLITE_ROW) {
+                ClipboardEntry entry = RowToEntry(stmt);
+                LoadTagsForEntry(entry, db);
+                LoadThumbnailForEntry(entry, db);
+                entries.push_back(std::move(entry));
+            }
+            sqlite3_reset(stmt);
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    releaseConnections();
+    finish();
     return entries;
 }
 
+bool DataManager::ScanEntryData(sqlite3* db, int64_t id, const std::string& needleLower,
+                                const std::atomic<bool>& stop, uint64_t& bytesScanned) {
+    sqlite3_blob* blob = nullptr;
+    if (sqlite3_blob_open(db, "main", "clipboard_entries", "data", id, 0, &blob) != SQLITE_OK) {
+        if (blob) sqlite3_blob_close(blob);
+        return false;
+    }
+
+    // Read the payload in fixed chunks; keep the last needle-1 bytes of each
+    // chunk in front of the next one so matches spanning a boundary are found
+    const int chunkSize = 256 * 1024;
+    const size_t overlap = needleLower.size() - 1;
+    thread_local std::vector<uint8_t> buffer;
+    buffer.resize(chunkSize + overlap);
+
+    const int total = sqlite3_blob_bytes(blob);
+    int offset = 0;
+    size_t carry = 0;
+    bool found = false;
+
+    while (offset < total && !stop.load(std::memory_order_relaxed)) {
+        int n = std::min(chunkSize, total - offset);
+        if (sqlite3_blob_read(blob, buffer.data() + carry, n, offset) != SQLITE_OK) {
+            break;
+        }
+
+        size_t available = carry + static_cast<size_t>(n);
+        bytesScanned += static_cast<uint64_t>(n);
+        if (text::FindCaseInsensitive(buffer.data(), available, needleLower) != text::NOT_FOUND) {
+            found = true;
+            break;
+        }
+
+        carry = std::min(overlap, available);
+        std::memmove(buffer.data(), buffer.data() + available - carry, carry);
+        offset += n;
+    }
+
+    sqlite3_blob_close(blob);
+    return found;
+}
+
 std::optional<ClipboardEntry> DataManager::GetEntry(int64_t id) {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
 
     // Check memory first for negative IDs
     if (id < 0) {
@@ -552,6 +1424,7 @@ std::optional<ClipboardEntry> DataManager::GetEntry(int64_t id) {
         entry = RowToEntry(stmt);
         if (entry) {
             LoadTagsForEntry(*entry);
+            LoadThumbnailForEntry(*entry);
         }
     }
 
@@ -560,7 +1433,7 @@ std::optional<ClipboardEntry> DataManager::GetEntry(int64_t id) {
 }
 
 std::vector<uint8_t> DataManager::GetEntryData(int64_t id) {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
 
     if (!m_initialized) return {};
 
@@ -587,7 +1460,7 @@ std::vector<uint8_t> DataManager::GetEntryData(int64_t id) {
 }
 
 bool DataManager::Delete(int64_t id) {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
 
     // Check if it's a memory entry (negative ID)
     if (id < 0) {
@@ -595,7 +1468,15 @@ bool DataManager::Delete(int64_t id) {
             [id](const ClipboardEntry& e) { return e.id == id; });
 
         if (it != m_memoryEntries.end()) {
+            size_t index = static_cast<size_t>(it - m_memoryEntries.begin());
+            RecordUndo([this, index, entry = std::move(*it)]() { RestoreMemoryEntry(index, entry); });
             m_memoryEntries.erase(it);
+            m_nearDuplicates.Remove(id);
+
+            EntryChange change;
+            change.kind = EntryChange::Kind::Deleted;
+            change.ids.push_back(id);
+            NotifyChange(std::move(change));
             LOG_DEBUG("Deleted memory entry: " + std::to_string(id));
             return true;
         }
@@ -605,6 +1486,15 @@ bool DataManager::Delete(int64_t id) {
     // Database entry
     if (!m_initialized) return false;
 
+    if (m_transactionDepth > 0) {
+        // The fingerprint goes back into the index if the delete is undone
+        uint64_t simhash = static_cast<uint64_t>(
+            QueryInt64(m_db, "SELECT simhash FROM clipboard_entries WHERE id = ?", id).value_or(0));
+        if (simhash != 0) {
+            RecordUndo([this, id, simhash]() { m_nearDuplicates.Add(id, simhash); });
+        }
+    }
+
     const char* sql = "DELETE FROM clipboard_entries WHERE id = ?";
 
     sqlite3_stmt* stmt = nullptr;
@@ -623,12 +1513,19 @@ bool DataManager::Delete(int64_t id) {
         return false;
     }
 
+    m_nearDuplicates.Remove(id);
+    if (sqlite3_changes(m_db) > 0) {
+        EntryChange change;
+        change.kind = EntryChange::Kind::Deleted;
+        change.ids.push_back(id);
+        NotifyChange(std::move(change));
+    }
     LOG_DEBUG("Deleted database entry: " + std::to_string(id));
     return true;
 }
 
 int DataManager::DeleteOlderThan(int64_t timestamp) {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
 
     if (!m_initialized) return 0;
 
@@ -651,12 +1548,19 @@ int DataManager::DeleteOlderThan(int64_t timestamp) {
         return 0;
     }
 
+    if (deleted > 0) {
+        EntryChange change;
+        change.kind = EntryChange::Kind::Deleted;
+        change.olderThan = timestamp;
+        NotifyChange(std::move(change));
+    }
+
     LOG_INFO("Deleted " + std::to_string(deleted) + " old entries");
     return deleted;
 }
 
 bool DataManager::DeleteAll() {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
 
     if (!m_initialized) return false;
 
@@ -666,6 +1570,17 @@ bool DataManager::DeleteAll() {
         return false;
     }
 
+    // Only memory entries are left to index
+    m_nearDuplicates.Clear();
+    for (const auto& memEntry : m_memoryEntries) {
+        if (memEntry.simhash != 0) m_nearDuplicates.Add(memEntry.id, memEntry.simhash);
+    }
+
+    EntryChange change;
+    change.kind = EntryChange::Kind::Deleted;
+    change.allPersisted = true;
+    NotifyChange(std::move(change));
+
     // Vacuum to reclaim space
     sqlite3_exec(m_db, "VACUUM", nullptr, nullptr, nullptr);
 
@@ -674,35 +1589,56 @@ bool DataManager::DeleteAll() {
 }
 
 bool DataManager::ToggleFavorite(int64_t id) {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    return UpdateFavorite(id, std::nullopt);
+}
+
+bool DataManager::SetFavorite(int64_t id, bool favorited) {
+    return UpdateFavorite(id, favorited);
+}
+
+bool DataManager::UpdateFavorite(int64_t id, std::optional<bool> favorited) {
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
 
     if (!m_initialized) return false;
 
-    const char* sql = "UPDATE clipboard_entries SET is_favorited = NOT is_favorited, updated_at = ? WHERE id = ?";
+    const char* sql = favorited.has_value()
+        ? "UPDATE clipboard_entries SET is_favorited = ?, updated_at = ? WHERE id = ?"
+        : "UPDATE clipboard_entries SET is_favorited = NOT is_favorited, updated_at = ? WHERE id = ?";
 
     sqlite3_stmt* stmt = nullptr;
     if (sqlite3_prepare_v2(m_db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-        LOG_ERROR("Failed to prepare toggle favorite: " + std::string(sqlite3_errmsg(m_db)));
+        LOG_ERROR("Failed to prepare update favorite: " + std::string(sqlite3_errmsg(m_db)));
         return false;
     }
 
-    sqlite3_bind_int64(stmt, 1, utils::GetCurrentTimestamp());
-    sqlite3_bind_int64(stmt, 2, id);
+    int param = 1;
+    if (favorited.has_value()) {
+        sqlite3_bind_int(stmt, param++, *favorited ? 1 : 0);
+    }
+    sqlite3_bind_int64(stmt, param++, utils::GetCurrentTimestamp());
+    sqlite3_bind_int64(stmt, param, id);
 
     int result = sqlite3_step(stmt);
     sqlite3_finalize(stmt);
 
     if (result != SQLITE_DONE) {
-        LOG_ERROR("Failed to toggle favorite: " + std::string(sqlite3_errmsg(m_db)));
+        LOG_ERROR("Failed to update favorite: " + std::string(sqlite3_errmsg(m_db)));
         return false;
     }
 
-    LOG_DEBUG("Toggled favorite for entry: " + std::to_string(id));
+    if (auto current = QueryInt64(m_db, "SELECT is_favorited FROM clipboard_entries WHERE id = ?", id)) {
+        EntryChange change;
+        change.id = id;
+        change.isFavorited = *current != 0;
+        NotifyChange(std::move(change));
+    }
+
+    LOG_DEBUG("Updated favorite for entry: " + std::to_string(id));
     return true;
 }
 
 std::optional<int64_t> DataManager::FindByHash(const std::vector<uint8_t>& hash) {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
 
     if (!m_initialized) return std::nullopt;
 
@@ -726,7 +1662,7 @@ std::optional<int64_t> DataManager::FindByHash(const std::vector<uint8_t>& hash)
 }
 
 bool DataManager::UpdateCopyCount(int64_t id, int64_t newTimestamp) {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
 
     if (!m_initialized) return false;
 
@@ -751,11 +1687,228 @@ bool DataManager::UpdateCopyCount(int64_t id, int64_t newTimestamp) {
         return false;
     }
 
+    if (auto copyCount = QueryInt64(m_db, "SELECT copy_count FROM clipboard_entries WHERE id = ?", id)) {
+        EntryChange change;
+        change.id = id;
+        change.timestamp = newTimestamp;
+        change.copyCount = static_cast<int32_t>(*copyCount);
+        NotifyChange(std::move(change));
+    }
+
     return true;
 }
 
+std::optional<int64_t> DataManager::CollapseNearDuplicate(const ClipboardEntry& entry, int maxDistance) {
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
+    if (entry.simhash == 0) return std::nullopt;
+
+    // A hit on a row removed by a bulk delete is dropped and the lookup retried
+    while (auto nearId = m_nearDuplicates.FindNearest(entry.simhash, maxDistance)) {
+        int64_t id = *nearId;
+
+        if (id < 0) {
+            auto it = std::find_if(m_memoryEntries.begin(), m_memoryEntries.end(),
+                [id](const ClipboardEntry& e) { return e.id == id; });
+            if (it == m_memoryEntries.end()) {
+                m_nearDuplicates.Remove(id);
+                continue;
+            }
+            if (it->isFavorited || it->isTagged || !it->tags.empty()) {
+                return std::nullopt;
+            }
+
+            // Keep the id; take the newest content
+            ClipboardEntry merged = std::move(*it);
+            merged.timestamp = entry.timestamp;
+            merged.data = entry.data;
+            merged.preview = entry.preview;
+            merged.sourceApp = entry.sourceApp;
+            merged.simhash = entry.simhash;
+            merged.copyCount++;
+
+            EntryChange change;
+            change.id = id;
+            change.timestamp = merged.timestamp;
+            change.preview = merged.preview;
+            change.sourceApp = merged.sourceApp;
+            change.copyCount = merged.copyCount;
+
+            m_memoryEntries.erase(it);
+            m_memoryEntries.insert(m_memoryEntries.begin(), std::move(merged));
+            m_nearDuplicates.Add(id, entry.simhash);
+            NotifyChange(std::move(change));
+            return id;
+        }
+
+        if (!m_initialized) return std::nullopt;
+
+        // Favorited and tagged rows keep their text
+        sqlite3_stmt* stmt = nullptr;
+        const char* checkSql = R"(
+            SELECT is_favorited, is_tagged,
+                   EXISTS (SELECT 1 FROM entry_tags WHERE entry_id = clipboard_entries.id)
+            FROM clipboard_entries WHERE id = ?
+        )";
+        if (sqlite3_prepare_v2(m_db, checkSql, -1, &stmt, nullptr) != SQLITE_OK) {
+            LOG_ERROR("Failed to prepare collapse check: " + std::string(sqlite3_errmsg(m_db)));
+            return std::nullopt;
+        }
+        sqlite3_bind_int64(stmt, 1, id);
+        int found = sqlite3_step(stmt);
+        bool eligible = false;
+        if (found == SQLITE_ROW) {
+            eligible = sqlite3_column_int(stmt, 0) == 0 && sqlite3_column_int(stmt, 1) == 0 &&
+                       sqlite3_column_int(stmt, 2) == 0;
+        }
+        sqlite3_finalize(stmt);
+        if (found == SQLITE_DONE) {
+            m_nearDuplicates.Remove(id);
+            continue;
+        }
+        if (!eligible) {
+            return std::nullopt;
+        }
+
+        const char* sql = R"(
+            UPDATE clipboard_entries
+            SET data = ?, preview = ?, source_app = ?, hash = ?, simhash = ?, timestamp = ?,
+                copy_count = copy_count + 1, updated_at = ?
+            WHERE id = ?
+        )";
+
+        if (sqlite3_prepare_v2(m_db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+            LOG_ERROR("Failed to prepare collapse: " + std::string(sqlite3_errmsg(m_db)));
+            return std::nullopt;
+        }
+
+        std::vector<uint8_t> hash = utils::ComputeHash(entry.data);
+        sqlite3_bind_blob(stmt, 1, entry.data.data(), static_cast<int>(entry.data.size()), SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 2, entry.preview.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 3, entry.sourceApp.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_blob(stmt, 4, hash.data(), static_cast<int>(hash.size()), SQLITE_TRANSIENT);
+        BindSimhash(stmt, 5, entry.simhash);
+        sqlite3_bind_int64(stmt, 6, entry.timestamp);
+        sqlite3_bind_int64(stmt, 7, utils::GetCurrentTimestamp());
+        sqlite3_bind_int64(stmt, 8, id);
+
+        int result = sqlite3_step(stmt);
+        int changes = sqlite3_changes(m_db);
+        sqlite3_finalize(stmt);
+
+        if (result != SQLITE_DONE) {
+            LOG_ERROR("Failed to collapse near-duplicate: " + std::string(sqlite3_errmsg(m_db)));
+            return std::nullopt;
+        }
+        if (changes == 0) {
+            m_nearDuplicates.Remove(id);
+            continue;
+        }
+
+        m_nearDuplicates.Add(id, entry.simhash);
+
+        EntryChange change;
+        change.id = id;
+        change.timestamp = entry.timestamp;
+        change.preview = entry.preview;
+        change.sourceApp = entry.sourceApp;
+        if (auto copyCount = QueryInt64(m_db, "SELECT copy_count FROM clipboard_entries WHERE id = ?", id)) {
+            change.copyCount = static_cast<int32_t>(*copyCount);
+        }
+        NotifyChange(std::move(change));
+        return id;
+    }
+
+    return std::nullopt;
+}
+
+void DataManager::LoadNearDuplicateIndex() {
+    m_nearDuplicates.Clear();
+
+    // Payloads are only read for rows that predate the simhash column
+    const char* sql = R"(
+        SELECT id, simhash, CASE WHEN simhash IS NULL THEN data END
+        FROM clipboard_entries WHERE type = ?
+    )";
+
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(m_db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        LOG_ERROR("Failed to prepare near-duplicate index load: " + std::string(sqlite3_errmsg(m_db)));
+        return;
+    }
+    sqlite3_bind_int(stmt, 1, static_cast<int>(ClipboardDataType::Text));
+
+    std::vector<std::pair<int64_t, uint64_t>> backfill;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        int64_t id = sqlite3_column_int64(stmt, 0);
+        uint64_t fingerprint;
+        if (sqlite3_column_type(stmt, 1) != SQLITE_NULL) {
+            fingerprint = static_cast<uint64_t>(sqlite3_column_int64(stmt, 1));
+        } else {
+            const char* data = static_cast<const char*>(sqlite3_column_blob(stmt, 2));
+            fingerprint = simhash::Compute(data, static_cast<size_t>(sqlite3_column_bytes(stmt, 2)));
+            if (fingerprint != 0) backfill.emplace_back(id, fingerprint);
+        }
+        if (fingerprint != 0) {
+            m_nearDuplicates.Add(id, fingerprint);
+        }
+    }
+    sqlite3_finalize(stmt);
+
+    if (!backfill.empty() &&
+        sqlite3_prepare_v2(m_db, "UPDATE clipboard_entries SET simhash = ? WHERE id = ?", -1, &stmt, nullptr) == SQLITE_OK) {
+        sqlite3_exec(m_db, "BEGIN", nullptr, nullptr, nullptr);
+        for (const auto& [id, fingerprint] : backfill) {
+            BindSimhash(stmt, 1, fingerprint);
+            sqlite3_bind_int64(stmt, 2, id);
+            sqlite3_step(stmt);
+            sqlite3_reset(stmt);
+        }
+        sqlite3_exec(m_db, "COMMIT", nullptr, nullptr, nullptr);
+        sqlite3_finalize(stmt);
+        LOG_INFO("Computed fingerprints for " + std::to_string(backfill.size()) + " entries");
+    }
+
+    LOG_DEBUG("Near-duplicate index holds " + std::to_string(m_nearDuplicates.Size()) + " entries");
+}
+
+void DataManager::BackfillThumbnails() {
+    // Image entries stored before thumbnails were made, one payload at a time
+    const char* sql = R"(
+        SELECT id, data FROM clipboard_entries
+        WHERE type = ? AND id NOT IN (SELECT entry_id FROM entry_thumbnails)
+    )";
+
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(m_db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        LOG_ERROR("Failed to prepare thumbnail backfill: " + std::string(sqlite3_errmsg(m_db)));
+        return;
+    }
+    sqlite3_bind_int(stmt, 1, static_cast<int>(ClipboardDataType::Image));
+
+    std::vector<std::pair<int64_t, std::vector<uint8_t>>> backfill;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const auto* data = static_cast<const uint8_t*>(sqlite3_column_blob(stmt, 1));
+        auto thumbnail = image::MakeThumbnail(data, static_cast<size_t>(sqlite3_column_bytes(stmt, 1)));
+        if (!thumbnail.empty()) {
+            backfill.emplace_back(sqlite3_column_int64(stmt, 0), std::move(thumbnail));
+        }
+    }
+    sqlite3_finalize(stmt);
+
+    if (backfill.empty()) {
+        return;
+    }
+    sqlite3_exec(m_db, "BEGIN", nullptr, nullptr, nullptr);
+    for (const auto& [id, thumbnail] : backfill) {
+        StoreThumbnail(id, thumbnail);
+    }
+    sqlite3_exec(m_db, "COMMIT", nullptr, nullptr, nullptr);
+    LOG_INFO("Made thumbnails for " + std::to_string(backfill.size()) + " entries");
+}
+
 DatabaseStats DataManager::GetStats() {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
 
     DatabaseStats stats;
     if (!m_initialized) return stats;
@@ -796,6 +1949,10 @@ bool DataManager::SetClipboard(int64_t id) {
         return false;
     }
 
+#ifndef _WIN32
+    LOG_WARN("No system clipboard on this platform");
+    return false;
+#else
     if (!OpenClipboard(nullptr)) {
         LOG_ERROR("Failed to open clipboard");
         return false;
@@ -878,12 +2035,17 @@ bool DataManager::SetClipboard(int64_t id) {
     CloseClipboard();
     LOG_DEBUG("Set clipboard from entry: " + std::to_string(id));
     return success;
+#endif
 }
 
 bool DataManager::AddTag(int64_t entryId, const std::string& tagName) {
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
+    if (!m_initialized) return false;
+
     // If this is a memory entry, persist it first
     if (entryId < 0) {
-        auto newId = PersistMemoryEntry(entryId);
+        auto newId = PersistMemoryEntryLocked(entryId);
         if (!newId.has_value()) {
             LOG_ERROR("Failed to persist memory entry for tagging: " + std::to_string(entryId));
             return false;
@@ -892,10 +2054,6 @@ bool DataManager::AddTag(int64_t entryId, const std::string& tagName) {
         LOG_INFO("Memory entry persisted with new ID: " + std::to_string(entryId));
     }
 
-    std::lock_guard<std::mutex> lock(m_mutex);
-
-    if (!m_initialized) return false;
-
     // First, set is_tagged = 1 for the entry
     const char* updateSql = "UPDATE clipboard_entries SET is_tagged = 1, updated_at = ? WHERE id = ?";
     sqlite3_stmt* stmt = nullptr;
@@ -925,12 +2083,14 @@ bool DataManager::AddTag(int64_t entryId, const std::string& tagName) {
         return false;
     }
 
+    NotifyTagsChanged(entryId);
+
     LOG_INFO("Added tag '" + tagName + "' to entry: " + std::to_string(entryId));
     return true;
 }
 
 bool DataManager::RemoveTag(int64_t entryId, const std::string& tagName) {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
 
     if (!m_initialized || entryId < 0) return false;
 
@@ -977,13 +2137,14 @@ bool DataManager::RemoveTag(int64_t entryId, const std::string& tagName) {
         }
     }
 
+    NotifyTagsChanged(entryId);
     LOG_INFO("Removed tag '" + tagName + "' from entry: " + std::to_string(entryId));
     return true;
 }
 
 std::vector<std::string> DataManager::GetTags(int64_t entryId) {
     std::vector<std::string> tags;
-    std::lock_guard<std::mutex> lock(m_mutex);
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
 
     if (!m_initialized || entryId < 0) return tags;
 
@@ -1010,7 +2171,7 @@ std::vector<std::string> DataManager::GetTags(int64_t entryId) {
 
 std::vector<std::pair<std::string, int>> DataManager::GetAllTags() {
     std::vector<std::pair<std::string, int>> tags;
-    std::lock_guard<std::mutex> lock(m_mutex);
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
 
     if (!m_initialized) return tags;
 
@@ -1043,8 +2204,230 @@ std::vector<std::pair<std::string, int>> DataManager::GetAllTags() {
     return tags;
 }
 
+void DataManager::SetChangeListener(ChangeListener listener) {
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
+    m_changeListener = std::move(listener);
+}
+
+int64_t DataManager::GetChangeSeq() {
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
+    return m_changeSeq;
+}
+
+bool DataManager::GetChangesSince(int64_t seq, size_t limit, std::vector<EntryChange>& changes) {
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
+    changes.clear();
+    if (!m_initialized || seq < m_changeFloor || seq > m_changeSeq) {
+        return false;
+    }
+
+    // The log holds m_changeFloor + 1 .. m_changeSeq without gaps
+    size_t first = static_cast<size_t>(seq - m_changeFloor);
+    size_t count = std::min(limit, m_changeLog.size() - first);
+    changes.assign(m_changeLog.begin() + first, m_changeLog.begin() + first + count);
+    return true;
+}
+
+void DataManager::LoadChangeSeq() {
+    int64_t reserved = 0;
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(m_db, "SELECT value FROM sync_state WHERE name = 'change_seq'", -1, &stmt,
+                           nullptr) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            reserved = sqlite3_column_int64(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    // Lists from an earlier run can't be patched, its memory entries are
+    // gone: skipping a number puts every seq it handed out below the floor
+    m_changeSeq = m_changeFloor = reserved + 1;
+    m_changeLog.clear();
+    m_writeEpoch.fetch_add(1, std::memory_order_release);
+    ReserveChangeSeq(m_changeSeq + CHANGE_SEQ_BLOCK);
+}
+
+void DataManager::ReserveChangeSeq(int64_t upTo) {
+    const char* sql = "INSERT OR REPLACE INTO sync_state (name, value) VALUES ('change_seq', ?)";
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(m_db, sql, -1, &stmt, nullptr) == SQLITE_OK) {
+        sqlite3_bind_int64(stmt, 1, upTo);
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            LOG_ERROR("Failed to persist change sequence: " + std::string(sqlite3_errmsg(m_db)));
+        }
+        sqlite3_finalize(stmt);
+    }
+    // Not retried on failure: the sequence still only grows within this run
+    m_reservedSeq = upTo;
+}
+
+void DataManager::LogChange(EntryChange& change) {
+    m_writeEpoch.fetch_add(1, std::memory_order_release);
+    change.seq = ++m_changeSeq;
+    if (m_changeSeq > m_reservedSeq) {
+        ReserveChangeSeq(m_changeSeq + CHANGE_SEQ_BLOCK);
+    }
+
+    m_changeLog.push_back(change);
+    if (m_changeLog.size() > CHANGE_LOG_SIZE) {
+        m_changeFloor = m_changeLog.front().seq;
+        m_changeLog.pop_front();
+    }
+}
+
+void DataManager::NotifyChange(EntryChange&& change) {
+    if (m_transactionDepth > 0) {
+        m_pendingChanges.push_back(std::move(change));  // Published on commit
+        return;
+    }
+    LogChange(change);
+    if (m_changeListener) {
+        m_changeListener(std::move(change));
+    }
+}
+
+void DataManager::NotifyTagsChanged(int64_t entryId) {
+    EntryChange change;
+    change.kind = EntryChange::Kind::TagsChanged;
+    change.id = entryId;
+
+    const char* sql = "SELECT tag_name FROM entry_tags WHERE entry_id = ? ORDER BY created_at";
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(m_db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        return;
+    }
+    sqlite3_bind_int64(stmt, 1, entryId);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char* tagName = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+        if (tagName) {
+            change.tags.push_back(tagName);
+        }
+    }
+    sqlite3_finalize(stmt);
+
+    NotifyChange(std::move(change));
+}
+
+bool DataManager::Transaction(const std::function<bool()>& body) {
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
+    if (!m_initialized) return false;
+    if (m_transactionDepth > 0) {
+        return Savepoint(body);
+    }
+
+    // IMMEDIATE takes the write lock up front, so the commit can't fail
+    // on a reader upgrading halfway through
+    if (!ExecSql("BEGIN IMMEDIATE")) {
+        return false;
+    }
+    m_transactionDepth = 1;
+
+    bool ok = false;
+    try {
+        ok = body();
+    } catch (...) {
+        ExecSql("ROLLBACK");
+        RollbackTo(0, 0);
+        m_transactionDepth = 0;
+        throw;
+    }
+
+    if (ok && !ExecSql("COMMIT")) {
+        ok = false;
+    }
+    if (!ok) {
+        ExecSql("ROLLBACK");
+        RollbackTo(0, 0);
+        m_transactionDepth = 0;
+        return false;
+    }
+
+    m_transactionDepth = 0;
+    m_undoLog.clear();
+    std::vector<EntryChange> changes;
+    changes.swap(m_pendingChanges);
+    for (auto& change : changes) {
+        NotifyChange(std::move(change));
+    }
+    return true;
+}
+
+bool DataManager::Savepoint(const std::function<bool()>& step) {
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
+    if (m_transactionDepth == 0) {
+        return Transaction(step);
+    }
+
+    std::string name = "sp" + std::to_string(m_transactionDepth);
+    if (!ExecSql("SAVEPOINT " + name)) {
+        return false;
+    }
+    size_t undoMark = m_undoLog.size();
+    size_t changeMark = m_pendingChanges.size();
+    m_transactionDepth++;
+
+    bool ok = false;
+    try {
+        ok = step();
+    } catch (...) {
+        m_transactionDepth--;
+        ExecSql("ROLLBACK TO " + name);
+        ExecSql("RELEASE " + name);
+        RollbackTo(undoMark, changeMark);
+        throw;
+    }
+    m_transactionDepth--;
+
+    if (ok) {
+        ExecSql("RELEASE " + name);
+        return true;
+    }
+
+    // ROLLBACK TO leaves the savepoint open; RELEASE closes it
+    ExecSql("ROLLBACK TO " + name);
+    ExecSql("RELEASE " + name);
+    RollbackTo(undoMark, changeMark);
+    return false;
+}
+
+bool DataManager::ExecSql(const std::string& sql) {
+    char* errorMsg = nullptr;
+    if (sqlite3_exec(m_db, sql.c_str(), nullptr, nullptr, &errorMsg) != SQLITE_OK) {
+        LOG_ERROR("Failed to execute '" + sql + "': " + std::string(errorMsg ? errorMsg : "unknown"));
+        sqlite3_free(errorMsg);
+        return false;
+    }
+    return true;
+}
+
+void DataManager::RecordUndo(std::function<void()> undo) {
+    if (m_transactionDepth > 0) {
+        m_undoLog.push_back(std::move(undo));
+    }
+}
+
+void DataManager::RollbackTo(size_t undoMark, size_t changeMark) {
+    while (m_undoLog.size() > undoMark) {
+        auto undo = std::move(m_undoLog.back());
+        m_undoLog.pop_back();
+        undo();
+    }
+    m_pendingChanges.resize(std::min(changeMark, m_pendingChanges.size()));
+}
+
+void DataManager::RestoreMemoryEntry(size_t index, ClipboardEntry entry) {
+    index = std::min(index, m_memoryEntries.size());
+    if (entry.simhash != 0) {
+        m_nearDuplicates.Add(entry.id, entry.simhash);
+    }
+    m_memoryEntries.insert(m_memoryEntries.begin() + index, std::move(entry));
+}
+
 int DataManager::CleanupOrphanedTags() {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
 
     if (!m_initialized) return 0;
 
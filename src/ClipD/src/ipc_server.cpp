@@ -1,34 +1,88 @@
-#include "common/windows.h"
 #include "ipc_server.h"
 #include "common/logger.h"
-#include "common/utils.h"
+#include "common/trace.h"
+#include <algorithm>
 #include <vector>
 
 namespace clipx {
 
-IPCServer::IPCServer() {
-    m_stopEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+namespace {
+
+// How often the event loop checks m_running when nothing happens
+constexpr int EVENT_LOOP_TIMEOUT_MS = 500;
+
+// Session buffers grown beyond this by one large message are released
+// afterwards instead of being kept for the connection's lifetime
+constexpr size_t MAX_IDLE_BUFFER_SIZE = IPC_BUFFER_SIZE * 16;
+
+void TrimBuffer(std::vector<uint8_t>& buffer) {
+    if (buffer.capacity() > MAX_IDLE_BUFFER_SIZE) {
+        std::vector<uint8_t>().swap(buffer);
+    }
 }
 
+} // namespace
+
+bool IPCSession::SendResponse(const IPCResponse& response) {
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    if (!m_open) {
+        return false;
+    }
+    // Pre-encoded data is sent in its own codec; clients read either
+    IPCCodec codec = response.encoded ? response.encoded->codec : m_codec.load();
+    m_writeBuffer.resize(IPC_FRAME_HEADER_SIZE);
+    EncodeResponse(response, codec, m_writeBuffer);
+    return Flush(codec);
+}
+
+bool IPCSession::SendNotification(const IPCNotification& notification) {
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    if (!m_open) {
+        return false;
+    }
+    IPCCodec codec = m_codec;
+    m_writeBuffer.resize(IPC_FRAME_HEADER_SIZE);
+    EncodeNotification(notification, codec, m_writeBuffer);
+    return Flush(codec);
+}
+
+bool IPCSession::Flush(IPCCodec codec) {
+    bool written = m_connection->WriteFrame(m_writeBuffer, codec);
+    TrimBuffer(m_writeBuffer);
+    return written;
+}
+
+void IPCSession::Close() {
+    // Taking the write lock guarantees no writer is still using the connection
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    m_open = false;
+}
+
+IPCServer::IPCServer() = default;
+
 IPCServer::~IPCServer() {
     Stop();
-    if (m_stopEvent) {
-        CloseHandle(m_stopEvent);
-    }
 }
 
-bool IPCServer::Start(const std::string& pipeName) {
+bool IPCServer::Start(const std::string& address, const IPCServerOptions& options) {
     if (m_running) {
         return true;
     }
 
-    m_pipeName = pipeName;
-    m_running = true;
-    ResetEvent(m_stopEvent);
+    m_options = options;
+    m_options.maxRequestsPerConnection = std::max<size_t>(1, options.maxRequestsPerConnection);
+
+    m_listener = CreateIPCListener();
+    if (!m_listener->Listen(address, m_options.maxConnections)) {
+        m_listener.reset();
+        return false;
+    }
 
-    m_listenerThread = std::thread(&IPCServer::ListenLoop, this);
+    m_workers = std::make_unique<ThreadPool>(m_options.workerCount);
+    m_running = true;
+    m_loopThread = std::thread(&IPCServer::EventLoop, this);
 
-    LOG_INFO("IPC Server started: " + pipeName);
+    LOG_INFO("IPC Server started: " + address + " (" + std::to_string(m_workers->Size()) + " workers)");
     return true;
 }
 
@@ -38,11 +92,28 @@ void IPCServer::Stop() {
     }
 
     m_running = false;
-    SetEvent(m_stopEvent);
+    m_listener->Wake();
+    if (m_loopThread.joinable()) {
+        m_loopThread.join();
+    }
 
-    if (m_listenerThread.joinable()) {
-        m_listenerThread.join();
+    // Closing the connections makes workers blocked on a write give up;
+    // destroying the pool waits for them
+    std::unordered_map<IPCConnection*, std::shared_ptr<IPCSession>> sessions;
+    {
+        std::lock_guard<std::mutex> lock(m_sessionsMutex);
+        sessions = m_sessions;
+    }
+    for (auto& [connection, session] : sessions) {
+        session->m_connection->Close();
     }
+    m_workers.reset();
+
+    for (auto& [connection, session] : sessions) {
+        CloseSession(session);
+    }
+    m_listener->Close();
+    m_listener.reset();
 
     LOG_INFO("IPC Server stopped");
 }
@@ -51,202 +122,154 @@ void IPCServer::SetRequestHandler(RequestHandler handler) {
     m_handler = std::move(handler);
 }
 
-void IPCServer::ListenLoop() {
-    while (m_running) {
-        // Create named pipe
-        HANDLE pipe = CreateNamedPipeW(
-            utils::Utf8ToWide(m_pipeName).c_str(),
-            PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED,
-            PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE | PIPE_WAIT,
-            PIPE_UNLIMITED_INSTANCES,
-            IPC_BUFFER_SIZE,
-            IPC_BUFFER_SIZE,
-            0,
-            nullptr
-        );
-
-        if (pipe == INVALID_HANDLE_VALUE) {
-            LOG_ERROR("Failed to create named pipe: " + std::to_string(GetLastError()));
-            if (!m_running) break;
-            Sleep(1000);
-            continue;
-        }
-
-        // Set up overlapped for async connect
-        OVERLAPPED overlapped = {0};
-        overlapped.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
-
-        // Wait for client connection
-        BOOL connected = ConnectNamedPipe(pipe, &overlapped);
-        if (!connected && GetLastError() == ERROR_IO_PENDING) {
-            // Wait for connection or stop event
-            HANDLE handles[] = { overlapped.hEvent, m_stopEvent };
-            DWORD waitResult = WaitForMultipleObjects(2, handles, FALSE, INFINITE);
-
-            if (waitResult == WAIT_OBJECT_0 + 1) {
-                // Stop event signaled
-                CloseHandle(overlapped.hEvent);
-                CloseHandle(pipe);
-                break;
-            }
-
-            DWORD bytesTransferred;
-            connected = GetOverlappedResult(pipe, &overlapped, &bytesTransferred, FALSE);
-        }
-
-        CloseHandle(overlapped.hEvent);
-
-        if (connected || GetLastError() == ERROR_PIPE_CONNECTED) {
-            // Handle client in a separate thread
-            std::thread clientThread(&IPCServer::HandleClient, this, pipe);
-            clientThread.detach();
-        } else {
-            CloseHandle(pipe);
-        }
-    }
+void IPCServer::SetSessionClosedHandler(SessionClosedHandler handler) {
+    m_sessionClosedHandler = std::move(handler);
 }
 
-void IPCServer::HandleClient(HANDLE pipe) {
-    std::vector<uint8_t> buffer;
+void IPCServer::EventLoop() {
+    std::vector<std::shared_ptr<IPCConnection>> accepted;
+    std::vector<std::shared_ptr<IPCConnection>> readable;
 
     while (m_running) {
-        // Read message
-        if (!ReadMessage(pipe, buffer)) {
+        accepted.clear();
+        readable.clear();
+        if (!m_listener->Wait(EVENT_LOOP_TIMEOUT_MS, accepted, readable)) {
+            LOG_ERROR("IPC event loop failed");
             break;
         }
 
-        // Parse request
-        std::string jsonStr(buffer.begin(), buffer.end());
-        IPCRequest request;
-        IPCResponse response;
-
-        try {
-            nlohmann::json json = nlohmann::json::parse(jsonStr);
-            request = IPCRequest::FromJson(json);
-
-            // Handle request
-            if (m_handler) {
-                response = m_handler(request);
-            } else {
-                response = IPCResponse::Error(request.requestId, "No handler set", IPCError::IPC_INVALID_REQUEST);
-            }
-
-            // Send response
-            std::string responseJson = response.ToJson().dump();
-            std::vector<uint8_t> responseData(responseJson.begin(), responseJson.end());
+        for (auto& connection : accepted) {
+            auto session = std::make_shared<IPCSession>(connection, m_nextSessionId++);
+            std::lock_guard<std::mutex> lock(m_sessionsMutex);
+            m_sessions[connection.get()] = std::move(session);
+        }
 
-            if (!WriteMessage(pipe, responseData)) {
-                LOG_ERROR("Failed to send response");
-                break;
+        for (auto& connection : readable) {
+            std::shared_ptr<IPCSession> session;
+            {
+                std::lock_guard<std::mutex> lock(m_sessionsMutex);
+                auto it = m_sessions.find(connection.get());
+                if (it == m_sessions.end()) continue;
+                session = it->second;
             }
-
-            LOG_DEBUG("Sent response for request: " + request.action);
-        } catch (const std::exception& e) {
-            LOG_ERROR("Failed to parse request: " + std::string(e.what()));
-            IPCResponse errorResp = IPCResponse::Error(0, "Invalid request format", IPCError::IPC_INVALID_REQUEST);
-            std::string responseJson = errorResp.ToJson().dump();
-            std::vector<uint8_t> responseData(responseJson.begin(), responseJson.end());
-            WriteMessage(pipe, responseData);
-            break;
+            m_workers->Submit([this, session]() {
+                ServeRequest(session);
+            });
         }
     }
-
-    FlushFileBuffers(pipe);
-    DisconnectNamedPipe(pipe);
-    CloseHandle(pipe);
 }
 
-bool IPCServer::ReadMessage(HANDLE pipe, std::vector<uint8_t>& buffer) {
-    // Read header first
-    IPCHeader header;
-    DWORD bytesRead = 0;
-
-    OVERLAPPED overlapped = {0};
-    overlapped.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
-
-    if (!ReadFile(pipe, &header, sizeof(header), &bytesRead, &overlapped)) {
-        if (GetLastError() == ERROR_IO_PENDING) {
-            WaitForSingleObject(overlapped.hEvent, IPC_DEFAULT_TIMEOUT_MS);
-            GetOverlappedResult(pipe, &overlapped, &bytesRead, TRUE);
-        }
+void IPCServer::ServeRequest(const std::shared_ptr<IPCSession>& session) {
+    // Continues the client's trace once the request says which
+    trace::Span span("ipc.serve");
+
+    // Read what has arrived; a partial frame waits in the session for the
+    // rest, so a slow client doesn't hold the worker
+    std::vector<uint8_t>& buffer = session->m_readBuffer;
+    IPCCodec codec;
+    IPCReadResult read;
+    {
+        CLIPX_TRACE_SPAN("ipc.read");
+        read = m_running ? session->m_connection->ReadAvailable(buffer, session->m_readFilled, codec)
+                         : IPCReadResult::Failed;
     }
-
-    CloseHandle(overlapped.hEvent);
-
-    if (bytesRead != sizeof(header) || header.magic != IPC_MAGIC) {
-        LOG_ERROR("Invalid IPC header");
-        return false;
+    if (read == IPCReadResult::Pending) {
+        m_listener->Rearm(session->m_connection);
+        return;
+    }
+    if (read == IPCReadResult::Failed) {
+        CloseSession(session);
+        return;
+    }
+    session->m_readFilled = 0;
+
+    // Replies follow the encoding the client just used
+    session->m_codec = codec;
+
+    // Parse request
+    IPCRequest request;
+    bool decoded;
+    {
+        CLIPX_TRACE_SPAN("ipc.decode");
+        decoded = DecodeRequest(buffer.data() + IPC_FRAME_HEADER_SIZE, buffer.size() - IPC_FRAME_HEADER_SIZE, codec,
+                                request);
+    }
+    TrimBuffer(buffer);
+    span.Adopt(request.trace);
+    if (!decoded) {
+        LOG_ERROR(std::string("Failed to parse ") + CodecName(codec) + " request");
+        session->SendResponse(IPCResponse::Error(0, "Invalid request format", IPCError::IPC_INVALID_REQUEST));
+        CloseSession(session);
+        return;
     }
 
-    // Read payload
-    buffer.resize(header.payloadSize);
-    if (header.payloadSize > 0) {
-        bytesRead = 0;
-        overlapped = {0};
-        overlapped.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
-
-        if (!ReadFile(pipe, buffer.data(), header.payloadSize, &bytesRead, &overlapped)) {
-            if (GetLastError() == ERROR_IO_PENDING) {
-                WaitForSingleObject(overlapped.hEvent, IPC_DEFAULT_TIMEOUT_MS);
-                GetOverlappedResult(pipe, &overlapped, &bytesRead, TRUE);
-            }
-        }
+    // Keep reading the client's pipeline unless it is at its limit
+    bool watch;
+    {
+        std::lock_guard<std::mutex> lock(session->m_dispatchMutex);
+        watch = ++session->m_inFlight < m_options.maxRequestsPerConnection;
+        session->m_readPaused = !watch;
+    }
+    if (watch) {
+        m_listener->Rearm(session->m_connection);
+    }
 
-        CloseHandle(overlapped.hEvent);
+    HandleRequest(request, session);
 
-        if (bytesRead != header.payloadSize) {
-            LOG_ERROR("Failed to read full payload");
-            return false;
-        }
+    bool resume;
+    {
+        std::lock_guard<std::mutex> lock(session->m_dispatchMutex);
+        session->m_inFlight--;
+        resume = session->m_readPaused;
+        session->m_readPaused = false;
+    }
+    if (resume && session->IsOpen()) {
+        m_listener->Rearm(session->m_connection);
     }
-
-    return true;
 }
 
-bool IPCServer::WriteMessage(HANDLE pipe, const std::vector<uint8_t>& data) {
-    IPCHeader header;
-    header.magic = IPC_MAGIC;
-    header.payloadSize = static_cast<uint32_t>(data.size());
-
-    DWORD bytesWritten = 0;
-
-    OVERLAPPED overlapped = {0};
-    overlapped.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
-
-    // Write header
-    if (!WriteFile(pipe, &header, sizeof(header), &bytesWritten, &overlapped)) {
-        if (GetLastError() == ERROR_IO_PENDING) {
-            WaitForSingleObject(overlapped.hEvent, IPC_DEFAULT_TIMEOUT_MS);
-            GetOverlappedResult(pipe, &overlapped, &bytesWritten, TRUE);
+void IPCServer::HandleRequest(const IPCRequest& request, const std::shared_ptr<IPCSession>& session) {
+    IPCResponse response;
+    try {
+        // Handle request
+        if (m_handler) {
+            response = m_handler(request, session);
+        } else {
+            response = IPCResponse::Error(request.requestId, "No handler set", IPCError::IPC_INVALID_REQUEST);
         }
+    } catch (const std::exception& e) {
+        LOG_ERROR("Request handler failed: " + std::string(e.what()));
+        response = IPCResponse::Error(request.requestId, "Invalid request format", IPCError::IPC_INVALID_REQUEST);
     }
 
-    CloseHandle(overlapped.hEvent);
-
-    if (bytesWritten != sizeof(header)) {
-        return false;
+    // Send response
+    bool sent;
+    {
+        CLIPX_TRACE_SPAN("ipc.respond");
+        sent = session->SendResponse(response);
+    }
+    if (!sent) {
+        LOG_ERROR("Failed to send response");
+        CloseSession(session);
+        return;
     }
 
-    // Write payload
-    if (!data.empty()) {
-        overlapped = {0};
-        overlapped.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
-
-        if (!WriteFile(pipe, data.data(), static_cast<DWORD>(data.size()), &bytesWritten, &overlapped)) {
-            if (GetLastError() == ERROR_IO_PENDING) {
-                WaitForSingleObject(overlapped.hEvent, IPC_DEFAULT_TIMEOUT_MS);
-                GetOverlappedResult(pipe, &overlapped, &bytesWritten, TRUE);
-            }
-        }
-
-        CloseHandle(overlapped.hEvent);
+    LOG_DEBUG("Sent response for request: " + request.action);
+}
 
-        if (bytesWritten != data.size()) {
-            return false;
+void IPCServer::CloseSession(const std::shared_ptr<IPCSession>& session) {
+    {
+        std::lock_guard<std::mutex> lock(m_sessionsMutex);
+        if (m_sessions.erase(session->m_connection.get()) == 0) {
+            return;  // Already closed
         }
     }
 
-    return true;
+    session->Close();
+    m_listener->Remove(session->m_connection);
+    if (m_sessionClosedHandler) {
+        m_sessionClosedHandler(session);
+    }
 }
 
 } // namespace clipx
@@ -1,15 +1,20 @@
 #include "common/windows.h"
 #include <string>
 #include <filesystem>
+#include <memory>
 
 #include "common/types.h"
 #include "common/logger.h"
 #include "common/config.h"
 #include "common/ipc_protocol.h"
+#include "common/ipc_transport.h"
+#include "common/history_snapshot.h"
+#include "common/trace.h"
 #include "common/utils.h"
 #include "clipboard_listener.h"
 #include "data_manager.h"
 #include "ipc_server.h"
+#include "request_dispatcher.h"
 #include "hotkey_manager.h"
 #include "tray_icon.h"
 #include "auto_start.h"
@@ -50,6 +55,13 @@ public:
         // Load config
         Config::Instance().Load(m_appDir + "\\config.json");
 
+        // Latency tracing; the Overlay appends to the same file
+        if (Config::Instance().GetNested<bool>("advanced.trace", false)) {
+            if (trace::Start(m_appDir + "\\logs\\trace.json", "ClipD", false)) {
+                LOG_INFO("Tracing to logs\\trace.json");
+            }
+        }
+
         // Create hidden window
         if (!CreateHiddenWindow()) {
             LOG_ERROR("Failed to create hidden window");
@@ -82,16 +94,29 @@ public:
             OnClipboardChange(entry);
         });
 
+        RequestDispatcher::Hooks hooks;
+        hooks.beforeSetClipboard = [this]() { m_clipboardListener.IgnoreNextChange(); };
+        hooks.shutdown = [this]() { PostMessage(m_hwnd, WM_CLOSE, 0, 0); };
+        RequestDispatcher::Options options;
+        options.snapshotName = DefaultHistorySnapshotName();
+        m_dispatcher = std::make_unique<RequestDispatcher>(std::move(hooks), std::move(options));
+
         // Initialize IPC server
-        if (!m_ipcServer.Start(IPC_PIPE_NAME)) {
+        m_ipcServer.SetRequestHandler([this](const IPCRequest& request, const std::shared_ptr<IPCSession>& session) {
+            return m_dispatcher->Handle(request, session);
+        });
+
+        m_ipcServer.SetSessionClosedHandler([this](const std::shared_ptr<IPCSession>& session) {
+            if (m_dispatcher) {
+                m_dispatcher->SessionClosed(session->GetId());
+            }
+        });
+
+        if (!m_ipcServer.Start(DefaultIPCAddress())) {
             LOG_ERROR("Failed to start IPC server");
             return false;
         }
 
-        m_ipcServer.SetRequestHandler([this](const IPCRequest& request) {
-            return HandleIPCRequest(request);
-        });
-
         // Initialize hotkey manager
         if (!m_hotkeyManager.Initialize(m_hwnd)) {
             LOG_ERROR("Failed to initialize hotkey manager");
@@ -136,8 +161,10 @@ public:
 
     void Shutdown() {
         m_ipcServer.Stop();
+        m_dispatcher.reset();  // Joins running searches before the database closes
         DataManager::Instance().Shutdown();
         m_trayIcon.Shutdown();
+        trace::Stop();
         Logger::Instance().Shutdown();
     }
 
@@ -233,6 +260,17 @@ private:
             }
         }
 
+        // Near-copies (other whitespace or numbers, a word or two changed)
+        // fold into the existing entry, which keeps the newest text
+        if (entry.simhash != 0 && Config::Instance().GetNested<bool>("behavior.collapse_near_duplicates", false)) {
+            int maxDistance = Config::Instance().GetNested<int>("behavior.near_duplicate_distance", 3);
+            auto nearId = DataManager::Instance().CollapseNearDuplicate(entry, maxDistance);
+            if (nearId.has_value()) {
+                LOG_DEBUG("Collapsed near-duplicate into entry: " + std::to_string(*nearId));
+                return;
+            }
+        }
+
         // Insert new entry to memory only (not persisted until tagged)
         int64_t id = DataManager::Instance().InsertMemoryOnly(entry);
         if (id < 0) {
@@ -247,193 +285,8 @@ private:
         }
     }
 
-    IPCResponse HandleIPCRequest(const IPCRequest& request) {
-        LOG_DEBUG("Handling IPC request: " + request.action);
-
-        if (request.action == IPCAction::PING) {
-            return IPCResponse::Success(request.requestId, {{"pong", true}});
-        }
-
-        if (request.action == IPCAction::GET_HISTORY) {
-            QueryOptions options;
-            options.limit = request.params.value("limit", 100);
-            options.offset = request.params.value("offset", 0);
-            options.favoritesOnly = request.params.value("favorites_only", false);
-
-            int typeFilter = request.params.value("type", 0);
-            if (typeFilter > 0) {
-                options.filterType = static_cast<ClipboardDataType>(typeFilter);
-            }
-
-            auto entries = DataManager::Instance().Query(options);
-
-            nlohmann::json entriesJson = nlohmann::json::array();
-            for (const auto& entry : entries) {
-                entriesJson.push_back(ClipboardEntryToJson(entry));
-            }
-
-            return IPCResponse::Success(request.requestId, {
-                {"entries", entriesJson},
-                {"total", entries.size()}
-            });
-        }
-
-        if (request.action == IPCAction::SEARCH) {
-            std::string keyword = request.params.value("keyword", "");
-            int limit = request.params.value("limit", 50);
-
-            if (keyword.empty()) {
-                return IPCResponse::Error(request.requestId, "Missing keyword", IPCError::IPC_INVALID_REQUEST);
-            }
-
-            auto entries = DataManager::Instance().Search(keyword, limit);
-
-            nlohmann::json entriesJson = nlohmann::json::array();
-            for (const auto& entry : entries) {
-                entriesJson.push_back(ClipboardEntryToJson(entry));
-            }
-
-            return IPCResponse::Success(request.requestId, {{"entries", entriesJson}});
-        }
-
-        if (request.action == IPCAction::GET_ENTRY) {
-            int64_t id = request.params.value("id", static_cast<int64_t>(0));
-            auto entry = DataManager::Instance().GetEntry(id);
-
-            if (!entry.has_value()) {
-                return IPCResponse::Error(request.requestId, "Entry not found", IPCError::DB_NOT_FOUND);
-            }
-
-            return IPCResponse::Success(request.requestId, ClipboardEntryToJson(*entry));
-        }
-
-        if (request.action == IPCAction::SET_CLIPBOARD) {
-            int64_t id = request.params.value("id", static_cast<int64_t>(0));
-
-            // Tell the listener to ignore the next clipboard change
-            // (since we're about to set the clipboard ourselves)
-            m_clipboardListener.IgnoreNextChange();
-
-            if (!DataManager::Instance().SetClipboard(id)) {
-                return IPCResponse::Error(request.requestId, "Failed to set clipboard", IPCError::CLIPBOARD_WRITE_FAILED);
-            }
-
-            return IPCResponse::Success(request.requestId, {{"success", true}});
-        }
-
-        if (request.action == IPCAction::DELETE_ENTRY) {
-            int64_t id = request.params.value("id", static_cast<int64_t>(0));
-
-            if (!DataManager::Instance().Delete(id)) {
-                return IPCResponse::Error(request.requestId, "Failed to delete entry", IPCError::DB_WRITE_FAILED);
-            }
-
-            return IPCResponse::Success(request.requestId, {{"success", true}});
-        }
-
-        if (request.action == IPCAction::TOGGLE_FAVORITE) {
-            int64_t id = request.params.value("id", static_cast<int64_t>(0));
-
-            if (!DataManager::Instance().ToggleFavorite(id)) {
-                return IPCResponse::Error(request.requestId, "Failed to toggle favorite", IPCError::DB_WRITE_FAILED);
-            }
-
-            return IPCResponse::Success(request.requestId, {{"success", true}});
-        }
-
-        if (request.action == IPCAction::GET_STATS) {
-            auto stats = DataManager::Instance().GetStats();
-            return IPCResponse::Success(request.requestId, {
-                {"count", stats.totalCount},
-                {"text_size", stats.textSize},
-                {"image_size", stats.imageSize},
-                {"total_size", stats.totalSize}
-            });
-        }
-
-        if (request.action == IPCAction::CLEAR_ALL) {
-            if (!DataManager::Instance().DeleteAll()) {
-                return IPCResponse::Error(request.requestId, "Failed to clear all", IPCError::DB_WRITE_FAILED);
-            }
-            return IPCResponse::Success(request.requestId, {{"success", true}});
-        }
-
-        if (request.action == IPCAction::GET_CONFIG) {
-            return IPCResponse::Success(request.requestId, Config::Instance().GetRaw());
-        }
-
-        if (request.action == IPCAction::SET_CONFIG) {
-            // Merge new config
-            // TODO: Implement config update
-            return IPCResponse::Success(request.requestId, {{"success", true}});
-        }
-
-        if (request.action == IPCAction::SHUTDOWN) {
-            PostMessage(m_hwnd, WM_CLOSE, 0, 0);
-            return IPCResponse::Success(request.requestId, {{"success", true}});
-        }
-
-        if (request.action == IPCAction::ADD_TAG) {
-            int64_t id = request.params.value("id", static_cast<int64_t>(0));
-            std::string tag = request.params.value("tag", "");
-
-            if (tag.empty()) {
-                return IPCResponse::Error(request.requestId, "Missing tag name", IPCError::IPC_INVALID_REQUEST);
-            }
-
-            if (!DataManager::Instance().AddTag(id, tag)) {
-                return IPCResponse::Error(request.requestId, "Failed to add tag", IPCError::DB_WRITE_FAILED);
-            }
-
-            return IPCResponse::Success(request.requestId, {{"success", true}});
-        }
-
-        if (request.action == IPCAction::REMOVE_TAG) {
-            int64_t id = request.params.value("id", static_cast<int64_t>(0));
-            std::string tag = request.params.value("tag", "");
-
-            if (tag.empty()) {
-                return IPCResponse::Error(request.requestId, "Missing tag name", IPCError::IPC_INVALID_REQUEST);
-            }
-
-            if (!DataManager::Instance().RemoveTag(id, tag)) {
-                return IPCResponse::Error(request.requestId, "Failed to remove tag", IPCError::DB_WRITE_FAILED);
-            }
-
-            return IPCResponse::Success(request.requestId, {{"success", true}});
-        }
-
-        if (request.action == IPCAction::GET_TAGS) {
-            int64_t id = request.params.value("id", static_cast<int64_t>(0));
-
-            auto tags = DataManager::Instance().GetTags(id);
-
-            nlohmann::json tagsJson = nlohmann::json::array();
-            for (const auto& tag : tags) {
-                tagsJson.push_back(tag);
-            }
-
-            return IPCResponse::Success(request.requestId, {{"tags", tagsJson}});
-        }
-
-        if (request.action == IPCAction::GET_ALL_TAGS) {
-            auto tags = DataManager::Instance().GetAllTags();
-
-            nlohmann::json tagsJson = nlohmann::json::array();
-            for (const auto& [tagName, count] : tags) {
-                tagsJson.push_back({
-                    {"name", tagName},
-                    {"count", count}
-                });
-            }
-
-            return IPCResponse::Success(request.requestId, {{"tags", tagsJson}});
-        }
-
-        return IPCResponse::Error(request.requestId, "Unknown action: " + request.action, IPCError::IPC_INVALID_REQUEST);
-    }
-
     void ShowOverlay() {
+        CLIPX_TRACE_SPAN("overlay.show");
         LOG_DEBUG("Showing overlay");
 
         // Get path to Overlay.exe
@@ -443,6 +296,13 @@ private:
 
         std::wstring cmdLine = L"\"" + overlayPath.wstring() + L"\"";
 
+        // The Overlay continues this trace from its first instruction
+        trace::Span spawn("overlay.spawn");
+        trace::Context context = trace::Inject();
+        if (context.Valid()) {
+            cmdLine += L" --trace=" + utils::Utf8ToWide(trace::FormatContext(context));
+        }
+
         STARTUPINFOW si = {sizeof(STARTUPINFOW)};
         si.dwFlags = STARTF_USESHOWWINDOW;
         si.wShowWindow = SW_SHOWNORMAL;
@@ -510,6 +370,7 @@ private:
 
     ClipboardListener m_clipboardListener;
     IPCServer m_ipcServer;
+    std::unique_ptr<RequestDispatcher> m_dispatcher;
     HotkeyManager m_hotkeyManager;
     TrayIcon m_trayIcon;
 };
@@ -0,0 +1,714 @@
+#include "request_dispatcher.h"
+#include "data_manager.h"
+#include "common/config.h"
+#include "common/ipc_codec.h"
+#include "common/logger.h"
+#include "common/regex.h"
+#include "common/search_query.h"
+#include "common/trace.h"
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+
+namespace clipx {
+
+namespace {
+
+// What a handler gets besides its parameters
+struct ActionContext {
+    const IPCRequest& request;
+    const std::shared_ptr<IPCSession>& session;
+    RequestDispatcher& dispatcher;  // Batch items and stats
+    const RequestDispatcher::Hooks& hooks;
+    SearchJobManager& searchJobs;
+    ChangeFeed& changeFeed;
+    SharedBlobPool& blobPool;
+    ResponseCache& responseCache;
+};
+
+// Default time budget of a regex search; a full scan with an expensive
+// pattern returns what it found by then
+constexpr int REGEX_SEARCH_BUDGET_MS = 250;
+
+IPCResponse InvalidRequest(const ActionContext& context, const std::string& error) {
+    return IPCResponse::Error(context.request.requestId, error, IPCError::IPC_INVALID_REQUEST);
+}
+
+IPCResponse Done(const ActionContext& context) {
+    return IPCResponse::Success(context.request.requestId, {{"success", true}});
+}
+
+// Parameters of a handler: a struct with defaults and a Read() naming its
+// fields. Malformed parameters are answered before the handler runs.
+template<typename Params>
+bool ReadParams(const IPCRequest& request, Params& params, std::string& error) {
+    ParamReader reader(request.params);
+    params.Read(reader);
+    error = reader.Error();
+    return reader.Ok();
+}
+
+// Decoded by the codecs when well-formed; from the params tree otherwise
+bool ReadParams(const IPCRequest& request, HistoryParams& params, std::string& error) {
+    if (request.history) {
+        params = *request.history;
+        return true;
+    }
+    ParamReader reader(request.params);
+    reader.Optional("limit", params.limit)
+          .Optional("offset", params.offset)
+          .Optional("favorites_only", params.favoritesOnly)
+          .Optional("type", params.type);
+    error = reader.Error();
+    return reader.Ok();
+}
+
+struct NoParams {
+    void Read(ParamReader&) {}
+};
+
+struct EntryParams {
+    int64_t id = 0;
+
+    void Read(ParamReader& reader) { reader.Optional("id", id); }
+};
+
+// Canonical form of the parameters of cached actions: equal keys must
+// produce equal results
+void AppendCacheKey(std::string&, const NoParams&) {}
+
+void AppendCacheKey(std::string& key, const EntryParams& params) {
+    key += std::to_string(params.id);
+}
+
+void AppendCacheKey(std::string& key, const HistoryParams& params) {
+    key += std::to_string(params.limit);
+    key += ',';
+    key += std::to_string(params.offset);
+    key += params.favoritesOnly ? ",f," : ",a,";
+    key += std::to_string(params.type);
+}
+
+// ---- Handlers ----
+
+IPCResponse Ping(ActionContext& context, const NoParams&) {
+    // Clients switch to a binary codec once they see it listed here
+    return IPCResponse::Success(context.request.requestId, {
+        {"pong", true},
+        {"codecs", {CodecName(IPCCodec::Json), CodecName(IPCCodec::MsgPack)}}
+    });
+}
+
+IPCResponse GetHistory(ActionContext& context, const HistoryParams& params) {
+    QueryOptions options;
+    options.limit = params.limit;
+    options.offset = params.offset;
+    options.favoritesOnly = params.favoritesOnly;
+    if (params.type > 0) {
+        options.filterType = static_cast<ClipboardDataType>(params.type);
+    }
+
+    // Read first: changes racing with the query are replayed on top of
+    // it, which is harmless since clients apply them as upserts
+    int64_t seq = DataManager::Instance().GetChangeSeq();
+    int64_t total = 0;
+    auto entries = DataManager::Instance().Query(options, &total);
+
+    // `total` counts the whole filtered history, so clients can size a
+    // scroll range before loading the rest
+    IPCResponse response = IPCResponse::Success(context.request.requestId, {{"total", total}, {"seq", seq}});
+    response.entries = std::move(entries);
+    return response;
+}
+
+struct SearchParams {
+    std::string keyword;
+    int limit = 50;
+    bool regex = false;        // keyword is a pattern matched against the preview
+    bool ignoreCase = false;
+    bool deep = false;         // Scan full payloads instead of the stored preview
+    std::optional<int> timeBudgetMs;
+    bool stream = false;       // Results arrive as search_results notifications
+    SearchJobManager::Options job;  // Batching of streamed results
+
+    void Read(ParamReader& reader) {
+        reader.Optional("keyword", keyword)
+              .Optional("limit", limit)
+              .Optional("regex", regex)
+              .Optional("ignore_case", ignoreCase)
+              .Optional("deep", deep)
+              .Optional("time_budget_ms", timeBudgetMs)
+              .Optional("stream", stream)
+              .Optional("first_batch", job.firstBatch)
+              .Optional("batch_size", job.batchSize)
+              .Optional("supersede", job.supersede);
+    }
+};
+
+IPCResponse Search(ActionContext& context, const SearchParams& params) {
+    const IPCRequest& request = context.request;
+    if (params.keyword.empty()) {
+        return InvalidRequest(context, "Missing keyword");
+    }
+
+    int timeBudgetMs = params.timeBudgetMs.value_or(params.regex ? REGEX_SEARCH_BUDGET_MS : 0);
+    if (params.regex) {
+        if (params.deep) {
+            return InvalidRequest(context, "Regex search does not support deep mode");
+        }
+        std::string error;
+        if (!RegexCache::Instance().Get(params.keyword, params.ignoreCase, &error)) {
+            return InvalidRequest(context, "Invalid regex: " + error);
+        }
+    }
+
+    // Streaming mode: results are tagged with job_id (= this request's id)
+    if (params.stream) {
+        SearchJobManager::Options options = params.job;
+        options.keyword = params.keyword;
+        options.limit = params.limit;
+        options.deep = params.deep;
+        options.regex = params.regex;
+        options.ignoreCase = params.ignoreCase;
+        options.timeBudgetMs = timeBudgetMs;
+
+        context.searchJobs.Start(context.session, request.requestId, options);
+        return IPCResponse::Success(request.requestId, {{"job_id", request.requestId}});
+    }
+
+    if (params.deep) {
+        DeepSearchStats stats;
+        auto entries = DataManager::Instance().DeepSearch(params.keyword, params.limit, nullptr, &stats);
+
+        IPCResponse response = IPCResponse::Success(request.requestId, {
+            {"scanned_bytes", stats.bytesScanned},
+            {"scanned_entries", stats.entriesScanned},
+            {"elapsed_ms", stats.elapsedMs}
+        });
+        response.entries = std::move(entries);
+        return response;
+    }
+
+    SearchQuery query = params.regex ? MakeRegexQuery(params.keyword, params.ignoreCase)
+                                     : ParseSearchQuery(params.keyword);
+    query.timeBudgetMs = timeBudgetMs;
+    bool timedOut = false;
+    auto entries = DataManager::Instance().Search(query, params.limit, &timedOut);
+
+    nlohmann::json data = nlohmann::json::object();
+    if (timedOut) data["timed_out"] = true;
+    IPCResponse response = IPCResponse::Success(request.requestId, data);
+    response.entries = std::move(entries);
+    return response;
+}
+
+struct CancelSearchParams {
+    int32_t jobId = 0;
+
+    void Read(ParamReader& reader) { reader.Optional("job_id", jobId); }
+};
+
+IPCResponse CancelSearch(ActionContext& context, const CancelSearchParams& params) {
+    bool cancelled = context.searchJobs.Cancel(context.session->GetId(), params.jobId);
+    return IPCResponse::Success(context.request.requestId, {{"cancelled", cancelled}});
+}
+
+struct SubscribeParams {
+    std::vector<std::string> events;  // Empty for every change event
+
+    void Read(ParamReader& reader) { reader.Optional("events", events); }
+};
+
+IPCResponse Subscribe(ActionContext& context, const SubscribeParams& params) {
+    context.changeFeed.Subscribe(context.session, params.events);
+    return Done(context);
+}
+
+IPCResponse Unsubscribe(ActionContext& context, const NoParams&) {
+    bool unsubscribed = context.changeFeed.Unsubscribe(context.session->GetId());
+    return IPCResponse::Success(context.request.requestId, {{"unsubscribed", unsubscribed}});
+}
+
+struct ChangesSinceParams {
+    int64_t seq = 0;
+    int limit = static_cast<int>(IPC_MAX_CHANGES);
+
+    void Read(ParamReader& reader) {
+        reader.Required("seq", seq)
+              .Optional("limit", limit);
+    }
+};
+
+IPCResponse GetChangesSince(ActionContext& context, const ChangesSinceParams& params) {
+    int limit = std::clamp(params.limit, 1, static_cast<int>(IPC_MAX_CHANGES));
+
+    // "seq" is where the client stands after applying the changes; a
+    // resync answer means it has to reload the list instead
+    std::vector<EntryChange> changes;
+    if (!DataManager::Instance().GetChangesSince(params.seq, limit, changes)) {
+        return IPCResponse::Success(context.request.requestId, {
+            {"resync", true},
+            {"seq", DataManager::Instance().GetChangeSeq()}
+        });
+    }
+
+    nlohmann::json changesJson = nlohmann::json::array();
+    for (const auto& change : changes) {
+        changesJson.push_back(EntryChangeToNotification(change).ToJson());
+    }
+    int64_t seq = changes.empty() ? params.seq : changes.back().seq;
+    return IPCResponse::Success(context.request.requestId, {
+        {"resync", false},
+        {"seq", seq},
+        {"has_more", seq < DataManager::Instance().GetChangeSeq()},
+        {"changes", changesJson}
+    });
+}
+
+struct GetEntryParams {
+    int64_t id = 0;
+    bool withData = false;
+
+    void Read(ParamReader& reader) {
+        reader.Optional("id", id)
+              .Optional("with_data", withData);
+    }
+};
+
+IPCResponse GetEntry(ActionContext& context, const GetEntryParams& params) {
+    auto entry = DataManager::Instance().GetEntry(params.id);
+    if (!entry.has_value()) {
+        return IPCResponse::Error(context.request.requestId, "Entry not found", IPCError::DB_NOT_FOUND);
+    }
+
+    nlohmann::json data = ClipboardEntryToJson(*entry);
+
+    // The payload never goes through the pipe: it is handed over in
+    // shared memory, and the client sends release_blob when done
+    if (params.withData) {
+        data["data_size"] = entry->data.size();
+        if (!entry->data.empty()) {
+            auto blob = context.blobPool.Store(context.session->GetId(),
+                                               entry->data.data(), entry->data.size());
+            if (!blob) {
+                return IPCResponse::Error(context.request.requestId, "Shared memory unavailable",
+                                          IPCError::IPC_BLOB_UNAVAILABLE);
+            }
+            data["blob"] = SharedBlobRefToJson(*blob);
+        }
+    }
+
+    return IPCResponse::Success(context.request.requestId, data);
+}
+
+struct ReleaseBlobParams {
+    uint64_t lease = 0;
+
+    void Read(ParamReader& reader) { reader.Optional("lease", lease); }
+};
+
+IPCResponse ReleaseBlob(ActionContext& context, const ReleaseBlobParams& params) {
+    bool released = context.blobPool.Release(context.session->GetId(), params.lease);
+    return IPCResponse::Success(context.request.requestId, {{"released", released}});
+}
+
+IPCResponse SetClipboard(ActionContext& context, const EntryParams& params) {
+    // Tell the listener to ignore the next clipboard change
+    // (since we're about to set the clipboard ourselves)
+    if (context.hooks.beforeSetClipboard) {
+        context.hooks.beforeSetClipboard();
+    }
+
+    if (!DataManager::Instance().SetClipboard(params.id)) {
+        return IPCResponse::Error(context.request.requestId, "Failed to set clipboard", IPCError::CLIPBOARD_WRITE_FAILED);
+    }
+    return Done(context);
+}
+
+IPCResponse DeleteEntry(ActionContext& context, const EntryParams& params) {
+    if (!DataManager::Instance().Delete(params.id)) {
+        return IPCResponse::Error(context.request.requestId, "Failed to delete entry", IPCError::DB_WRITE_FAILED);
+    }
+    return Done(context);
+}
+
+struct ToggleFavoriteParams {
+    int64_t id = 0;
+    std::optional<bool> favorited;  // Sets the flag instead, for bulk favoriting
+
+    void Read(ParamReader& reader) {
+        reader.Optional("id", id)
+              .Optional("favorited", favorited);
+    }
+};
+
+IPCResponse ToggleFavorite(ActionContext& context, const ToggleFavoriteParams& params) {
+    bool ok = params.favorited
+        ? DataManager::Instance().SetFavorite(params.id, *params.favorited)
+        : DataManager::Instance().ToggleFavorite(params.id);
+    if (!ok) {
+        return IPCResponse::Error(context.request.requestId, "Failed to toggle favorite", IPCError::DB_WRITE_FAILED);
+    }
+    return Done(context);
+}
+
+struct BatchParams {
+    const nlohmann::json* requests = nullptr;
+    bool atomic = false;  // First failure rolls back the whole batch
+
+    void Read(ParamReader& reader) {
+        reader.Optional("requests", requests)
+              .Optional("atomic", atomic);
+    }
+};
+
+IPCResponse Batch(ActionContext& context, const BatchParams& params);
+
+IPCResponse GetStats(ActionContext& context, const NoParams&) {
+    auto stats = DataManager::Instance().GetStats();
+    return IPCResponse::Success(context.request.requestId, {
+        {"count", stats.totalCount},
+        {"text_size", stats.textSize},
+        {"image_size", stats.imageSize},
+        {"total_size", stats.totalSize}
+    });
+}
+
+IPCResponse ClearAll(ActionContext& context, const NoParams&) {
+    if (!DataManager::Instance().DeleteAll()) {
+        return IPCResponse::Error(context.request.requestId, "Failed to clear all", IPCError::DB_WRITE_FAILED);
+    }
+    return Done(context);
+}
+
+IPCResponse GetConfig(ActionContext& context, const NoParams&) {
+    return IPCResponse::Success(context.request.requestId, Config::Instance().GetRaw());
+}
+
+IPCResponse SetConfig(ActionContext& context, const NoParams&) {
+    // Merge new config
+    // TODO: Implement config update
+    return Done(context);
+}
+
+IPCResponse Shutdown(ActionContext& context, const NoParams&) {
+    if (context.hooks.shutdown) {
+        context.hooks.shutdown();
+    }
+    return Done(context);
+}
+
+struct TagParams {
+    int64_t id = 0;
+    std::string tag;
+
+    void Read(ParamReader& reader) {
+        reader.Optional("id", id)
+              .Optional("tag", tag);
+    }
+};
+
+IPCResponse AddTag(ActionContext& context, const TagParams& params) {
+    if (params.tag.empty()) {
+        return InvalidRequest(context, "Missing tag name");
+    }
+    if (!DataManager::Instance().AddTag(params.id, params.tag)) {
+        return IPCResponse::Error(context.request.requestId, "Failed to add tag", IPCError::DB_WRITE_FAILED);
+    }
+    return Done(context);
+}
+
+IPCResponse RemoveTag(ActionContext& context, const TagParams& params) {
+    if (params.tag.empty()) {
+        return InvalidRequest(context, "Missing tag name");
+    }
+    if (!DataManager::Instance().RemoveTag(params.id, params.tag)) {
+        return IPCResponse::Error(context.request.requestId, "Failed to remove tag", IPCError::DB_WRITE_FAILED);
+    }
+    return Done(context);
+}
+
+IPCResponse GetTags(ActionContext& context, const EntryParams& params) {
+    nlohmann::json tagsJson = nlohmann::json::array();
+    for (const auto& tag : DataManager::Instance().GetTags(params.id)) {
+        tagsJson.push_back(tag);
+    }
+    return IPCResponse::Success(context.request.requestId, {{"tags", tagsJson}});
+}
+
+IPCResponse GetAllTags(ActionContext& context, const NoParams&) {
+    nlohmann::json tagsJson = nlohmann::json::array();
+    for (const auto& [tagName, count] : DataManager::Instance().GetAllTags()) {
+        tagsJson.push_back({
+            {"name", tagName},
+            {"count", count}
+        });
+    }
+    return IPCResponse::Success(context.request.requestId, {{"tags", tagsJson}});
+}
+
+IPCResponse GetActionStats(ActionContext& context, const NoParams&) {
+    nlohmann::json actions = nlohmann::json::array();
+    for (const auto& stats : context.dispatcher.GetActionStats()) {
+        const auto& metrics = stats.metrics;
+        if (metrics.count == 0) continue;
+        actions.push_back({
+            {"action", stats.action},
+            {"count", metrics.count},
+            {"errors", metrics.errors},
+            {"mean_us", metrics.totalUs / metrics.count},
+            {"p50_us", metrics.PercentileUs(0.50)},
+            {"p99_us", metrics.PercentileUs(0.99)},
+            {"max_us", metrics.maxUs}
+        });
+    }
+    auto cache = context.dispatcher.GetCacheStats();
+    return IPCResponse::Success(context.request.requestId, {
+        {"actions", actions},
+        {"unknown", context.dispatcher.GetUnknownActionCount()},
+        {"cache", {
+            {"hits", cache.hits},
+            {"misses", cache.misses},
+            {"entries", cache.entries},
+            {"bytes", cache.bytes}
+        }}
+    });
+}
+
+// ---- Registry ----
+
+using ActionHandler = IPCResponse (*)(ActionContext&);
+
+template<typename Params, IPCResponse (*Handler)(ActionContext&, const Params&)>
+IPCResponse Invoke(ActionContext& context) {
+    Params params;
+    std::string error;
+    if (!ReadParams(context.request, params, error)) {
+        return InvalidRequest(context, error);
+    }
+    return Handler(context, params);
+}
+
+// Read-only actions whose result depends only on their parameters and the
+// stored history. A hit is answered with the encoded bytes of the earlier
+// response; a miss is encoded once, for the cache and the reply alike.
+template<typename Params, IPCResponse (*Handler)(ActionContext&, const Params&)>
+IPCResponse InvokeCached(ActionContext& context) {
+    Params params;
+    std::string error;
+    if (!ReadParams(context.request, params, error)) {
+        return InvalidRequest(context, error);
+    }
+
+    IPCCodec codec = context.session->GetCodec();
+    std::string key;
+    key += CodecName(codec);
+    key += ' ';
+    key += context.request.action;
+    key += ' ';
+    AppendCacheKey(key, params);
+
+    // Read before the handler: a write racing with it moves the epoch on,
+    // and the result is then stored under the old one, already stale
+    uint64_t epoch = DataManager::Instance().GetWriteEpoch();
+    if (auto encoded = context.responseCache.Find(key, epoch)) {
+        IPCResponse response = IPCResponse::Success(context.request.requestId);
+        response.encoded = std::move(encoded);
+        return response;
+    }
+
+    IPCResponse response = Handler(context, params);
+    if (response.success) {
+        response.encoded = EncodeResponseData(response, codec);
+        context.responseCache.Store(key, epoch, response.encoded);
+    }
+    return response;
+}
+
+struct ActionDef {
+    std::string_view name;
+    ActionHandler handler;
+    bool batchable;  // Writes that only touch the database
+};
+
+constexpr ActionDef ACTIONS[] = {
+    {IPCAction::PING,              Invoke<NoParams, Ping>,                         false},
+    {IPCAction::GET_HISTORY,       InvokeCached<HistoryParams, GetHistory>,        false},
+    {IPCAction::SEARCH,            Invoke<SearchParams, Search>,                   false},
+    {IPCAction::CANCEL_SEARCH,     Invoke<CancelSearchParams, CancelSearch>,       false},
+    {IPCAction::SUBSCRIBE,         Invoke<SubscribeParams, Subscribe>,             false},
+    {IPCAction::UNSUBSCRIBE,       Invoke<NoParams, Unsubscribe>,                  false},
+    {IPCAction::GET_CHANGES_SINCE, Invoke<ChangesSinceParams, GetChangesSince>,    false},
+    {IPCAction::GET_ENTRY,         Invoke<GetEntryParams, GetEntry>,               false},
+    {IPCAction::RELEASE_BLOB,      Invoke<ReleaseBlobParams, ReleaseBlob>,         false},
+    {IPCAction::SET_CLIPBOARD,     Invoke<EntryParams, SetClipboard>,              false},
+    {IPCAction::DELETE_ENTRY,      Invoke<EntryParams, DeleteEntry>,               true},
+    {IPCAction::TOGGLE_FAVORITE,   Invoke<ToggleFavoriteParams, ToggleFavorite>,   true},
+    {IPCAction::BATCH,             Invoke<BatchParams, Batch>,                     false},
+    {IPCAction::GET_STATS,         Invoke<NoParams, GetStats>,                     false},
+    {IPCAction::CLEAR_ALL,         Invoke<NoParams, ClearAll>,                     false},
+    {IPCAction::GET_CONFIG,        Invoke<NoParams, GetConfig>,                    false},
+    {IPCAction::SET_CONFIG,        Invoke<NoParams, SetConfig>,                    false},
+    {IPCAction::SHUTDOWN,          Invoke<NoParams, Shutdown>,                     false},
+    {IPCAction::ADD_TAG,           Invoke<TagParams, AddTag>,                      true},
+    {IPCAction::REMOVE_TAG,        Invoke<TagParams, RemoveTag>,                   true},
+    {IPCAction::GET_TAGS,          InvokeCached<EntryParams, GetTags>,             false},
+    {IPCAction::GET_ALL_TAGS,      InvokeCached<NoParams, GetAllTags>,             false},
+    {IPCAction::GET_ACTION_STATS,  Invoke<NoParams, GetActionStats>,               false},
+};
+
+constexpr size_t ACTION_COUNT = std::size(ACTIONS);
+constexpr PerfectHashIndex<ACTION_COUNT> ACTION_INDEX(ACTIONS);
+static_assert(ACTION_INDEX.Valid(), "No collision-free seed for the action names");
+
+// Runs the sub-requests in one DataManager transaction, so N writes cost
+// one round trip and one commit. Each sub-request is a savepoint: a
+// failed one leaves no partial writes. With "atomic" the first failure
+// rolls back the whole batch; otherwise the others still commit.
+IPCResponse BatchItem(ActionContext& context, const nlohmann::json& item) {
+    if (!item.is_object()) {
+        return IPCResponse::Error(0, "Invalid batch item", IPCError::IPC_INVALID_REQUEST);
+    }
+
+    try {
+        IPCRequest subRequest = IPCRequest::FromJson(item);
+        int index = ACTION_INDEX.Find(subRequest.action);
+        if (index < 0 || !ACTIONS[index].batchable || !subRequest.params.is_object()) {
+            return IPCResponse::Error(0, "Action not allowed in batch: " + subRequest.action,
+                                      IPCError::IPC_INVALID_REQUEST);
+        }
+        return context.dispatcher.Handle(subRequest, context.session);
+    } catch (const std::exception& e) {
+        return IPCResponse::Error(0, std::string("Invalid batch item: ") + e.what(), IPCError::IPC_INVALID_REQUEST);
+    }
+}
+
+IPCResponse Batch(ActionContext& context, const BatchParams& params) {
+    if (!params.requests || !params.requests->is_array()) {
+        return InvalidRequest(context, "Missing requests");
+    }
+    const nlohmann::json& items = *params.requests;
+    if (items.size() > IPC_MAX_BATCH_SIZE) {
+        return InvalidRequest(context, "Too many requests in batch");
+    }
+
+    nlohmann::json results = nlohmann::json::array();
+    size_t failed = 0;
+    bool committed = DataManager::Instance().Transaction([&]() {
+        for (const auto& item : items) {
+            IPCResponse result;
+            DataManager::Instance().Savepoint([&]() {
+                result = BatchItem(context, item);
+                return result.success;
+            });
+
+            nlohmann::json itemJson = {{"success", result.success}};
+            if (result.success) {
+                itemJson["data"] = result.data;
+            } else {
+                itemJson["error"] = result.error;
+                itemJson["error_code"] = result.errorCode;
+                failed++;
+            }
+            results.push_back(std::move(itemJson));
+
+            if (!result.success && params.atomic) {
+                return false;
+            }
+        }
+        return true;
+    });
+
+    nlohmann::json data = {
+        {"committed", committed},
+        {"failed", failed},
+        {"results", std::move(results)}
+    };
+    if (!committed) {
+        IPCResponse response = IPCResponse::Error(context.request.requestId,
+            failed > 0 ? "Batch rolled back" : "Failed to commit batch", IPCError::DB_WRITE_FAILED);
+        response.data = std::move(data);
+        return response;
+    }
+    return IPCResponse::Success(context.request.requestId, data);
+}
+
+uint64_t ElapsedUs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+RequestDispatcher::RequestDispatcher(Hooks hooks, Options options) : m_hooks(std::move(hooks)) {
+    m_metrics = std::make_unique<ActionMetrics[]>(ACTION_COUNT);
+    m_searchJobs = std::make_unique<SearchJobManager>();
+
+    if (!options.snapshotName.empty()) {
+        m_snapshot = std::make_unique<SnapshotPublisher>(options.snapshotName);
+    }
+
+    // Subscribed clients get every history change as a delta event
+    m_changeFeed = std::make_unique<ChangeFeed>();
+    DataManager::Instance().SetChangeListener([this](EntryChange&& change) {
+        if (m_snapshot) {
+            m_snapshot->MarkDirty();
+        }
+        m_changeFeed->Publish(std::move(change));
+    });
+
+    // Large payloads go to clients through shared memory
+    m_blobPool = std::make_unique<SharedBlobPool>();
+
+    m_responseCache = std::make_unique<ResponseCache>();
+}
+
+RequestDispatcher::~RequestDispatcher() {
+    m_searchJobs.reset();  // Cancels and joins running searches before the database closes
+    DataManager::Instance().SetChangeListener(nullptr);
+    m_changeFeed.reset();
+    m_snapshot.reset();
+    m_blobPool.reset();
+}
+
+void RequestDispatcher::SessionClosed(uint64_t sessionId) {
+    m_searchJobs->CancelSession(sessionId);
+    m_changeFeed->Unsubscribe(sessionId);
+    m_blobPool->ReleaseSession(sessionId);
+}
+
+IPCResponse RequestDispatcher::Handle(const IPCRequest& request, const std::shared_ptr<IPCSession>& session) {
+    LOG_DEBUG("Handling IPC request: " + request.action);
+
+    int index = ACTION_INDEX.Find(request.action);
+    if (index < 0) {
+        m_unknownActions.fetch_add(1, std::memory_order_relaxed);
+        return IPCResponse::Error(request.requestId, "Unknown action: " + request.action, IPCError::IPC_INVALID_REQUEST);
+    }
+
+    trace::Span span(ACTIONS[index].name.data());  // Names are literals
+
+    // A handler that throws counts as an error; IPCServer answers for it
+    ActionContext context{request, session, *this, m_hooks, *m_searchJobs, *m_changeFeed, *m_blobPool,
+                          *m_responseCache};
+    auto start = std::chrono::steady_clock::now();
+    IPCResponse response;
+    try {
+        response = ACTIONS[index].handler(context);
+    } catch (...) {
+        m_metrics[index].Record(ElapsedUs(start), true);
+        throw;
+    }
+    m_metrics[index].Record(ElapsedUs(start), !response.success);
+    return response;
+}
+
+std::vector<RequestDispatcher::ActionStats> RequestDispatcher::GetActionStats() const {
+    std::vector<ActionStats> stats;
+    stats.reserve(ACTION_COUNT);
+    for (size_t i = 0; i < ACTION_COUNT; i++) {
+        stats.push_back({std::string(ACTIONS[i].name), m_metrics[i].Read()});
+    }
+    return stats;
+}
+
+} // namespace clipx
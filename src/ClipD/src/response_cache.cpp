@@ -0,0 +1,77 @@
+#include "response_cache.h"
+#include <iterator>
+
+namespace clipx {
+
+namespace {
+
+// Bookkeeping per entry besides the key and the encoded bytes
+constexpr size_t ENTRY_OVERHEAD = 128;
+
+} // namespace
+
+ResponseCache::ResponseCache(size_t maxBytes) : m_maxBytes(maxBytes) {}
+
+std::shared_ptr<const EncodedResponseData> ResponseCache::Find(const std::string& key, uint64_t epoch) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = Advance(epoch) ? m_index.find(key) : m_index.end();
+    if (it == m_index.end()) {
+        m_misses++;
+        return nullptr;
+    }
+    m_hits++;
+    m_lru.splice(m_lru.begin(), m_lru, it->second);
+    return it->second->data;
+}
+
+void ResponseCache::Store(const std::string& key, uint64_t epoch, std::shared_ptr<const EncodedResponseData> data) {
+    size_t size = key.size() + data->bytes.size() + ENTRY_OVERHEAD;
+    if (size > m_maxBytes / 4) {
+        return;  // Would push out most of the others
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!Advance(epoch)) {
+        return;
+    }
+    if (auto it = m_index.find(key); it != m_index.end()) {
+        Evict(it->second);
+    }
+    m_lru.push_front({key, std::move(data), size});
+    m_index[key] = m_lru.begin();
+    m_bytes += size;
+    while (m_bytes > m_maxBytes) {
+        Evict(std::prev(m_lru.end()));
+    }
+}
+
+ResponseCache::Stats ResponseCache::GetStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Stats stats;
+    stats.hits = m_hits;
+    stats.misses = m_misses;
+    stats.entries = m_lru.size();
+    stats.bytes = m_bytes;
+    return stats;
+}
+
+bool ResponseCache::Advance(uint64_t epoch) {
+    if (epoch < m_epoch) {
+        return false;
+    }
+    if (epoch > m_epoch) {
+        m_index.clear();
+        m_lru.clear();
+        m_bytes = 0;
+        m_epoch = epoch;
+    }
+    return true;
+}
+
+void ResponseCache::Evict(std::list<Entry>::iterator it) {
+    m_bytes -= it->size;
+    m_index.erase(it->key);
+    m_lru.erase(it);
+}
+
+} // namespace clipx
@@ -0,0 +1,127 @@
+#include "search_jobs.h"
+#include "data_manager.h"
+#include "common/logger.h"
+#include "common/search_query.h"
+#include <chrono>
+
+namespace clipx {
+
+SearchJobManager::SearchJobManager(size_t workerCount)
+    : m_pool(workerCount) {
+}
+
+SearchJobManager::~SearchJobManager() {
+    // Queued jobs still run when the pool drains, make them return at once
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& [key, job] : m_jobs) {
+        job->cancelled = true;
+    }
+}
+
+void SearchJobManager::Start(const std::shared_ptr<IPCSession>& session, int32_t jobId, const Options& options) {
+    auto job = std::make_shared<Job>();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // New input makes older queries of the same client pointless
+        if (options.supersede) {
+            for (auto& [key, other] : m_jobs) {
+                if (key.first == session->GetId()) {
+                    other->cancelled = true;
+                }
+            }
+        }
+
+        auto& slot = m_jobs[{session->GetId(), jobId}];
+        if (slot) {
+            slot->cancelled = true;
+        }
+        slot = job;
+    }
+
+    m_pool.Submit([this, session, jobId, job, options]() {
+        Run(session, jobId, job, options);
+    });
+}
+
+bool SearchJobManager::Cancel(uint64_t sessionId, int32_t jobId) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_jobs.find({sessionId, jobId});
+    if (it == m_jobs.end()) {
+        return false;
+    }
+    it->second->cancelled = true;
+    return true;
+}
+
+void SearchJobManager::CancelSession(uint64_t sessionId) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (auto& [key, job] : m_jobs) {
+        if (key.first == sessionId) {
+            job->cancelled = true;
+        }
+    }
+}
+
+void SearchJobManager::Run(const std::shared_ptr<IPCSession>& session, int32_t jobId,
+                           const std::shared_ptr<Job>& job, const Options& options) {
+    auto startTime = std::chrono::steady_clock::now();
+    size_t sent = 0;
+    bool timedOut = false;
+
+    auto notify = [&](std::vector<ClipboardEntry> entries, bool done) {
+        IPCNotification notification;
+        notification.event = IPCEvent::SEARCH_RESULTS;
+        notification.data = {
+            {"job_id", jobId},
+            {"done", done}
+        };
+        notification.entries = std::move(entries);
+        if (done) {
+            notification.data["cancelled"] = job->cancelled.load();
+            notification.data["timed_out"] = timedOut;
+            notification.data["elapsed_ms"] = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - startTime).count();
+        }
+        return session->SendNotification(notification);
+    };
+
+    if (!job->cancelled && session->IsOpen()) {
+        if (options.deep) {
+            DeepSearchStats stats;
+            auto entries = DataManager::Instance().DeepSearch(options.keyword, options.limit, &job->cancelled, &stats);
+            if (!job->cancelled) {
+                sent = entries.size();
+                notify(std::move(entries), false);
+            }
+        } else {
+            SearchQuery query = options.regex ? MakeRegexQuery(options.keyword, options.ignoreCase)
+                                              : ParseSearchQuery(options.keyword);
+            query.timeBudgetMs = options.timeBudgetMs;
+            DataManager::Instance().SearchStreaming(
+                query, options.limit, options.firstBatch, options.batchSize,
+                &job->cancelled, [&](std::vector<ClipboardEntry>&& batch) {
+                    if (job->cancelled) return false;
+                    sent += batch.size();
+                    return notify(std::move(batch), false);
+                }, &timedOut);
+        }
+    }
+
+    // The final message tells the client no more batches will follow
+    notify({}, true);
+
+    LOG_DEBUG("Search job " + std::to_string(jobId) + (job->cancelled ? " cancelled" : " finished") +
+              " after " + std::to_string(sent) + " entries");
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_jobs.find({session->GetId(), jobId});
+    if (it != m_jobs.end() && it->second == job) {
+        m_jobs.erase(it);
+    }
+}
+
+} // namespace clipx
@@ -0,0 +1,153 @@
+#include "shared_blob_pool.h"
+#include "common/logger.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <random>
+
+namespace clipx {
+
+namespace {
+
+void StoreStamp(uint8_t* header, uint64_t lease) {
+    std::atomic_thread_fence(std::memory_order_release);
+    *reinterpret_cast<volatile uint64_t*>(header) = lease;
+}
+
+} // namespace
+
+SharedBlobPool::SharedBlobPool() {
+    std::random_device random;
+    m_leaseKey = (static_cast<uint64_t>(random()) << 32) ^ random();
+}
+
+std::optional<SharedBlobRef> SharedBlobPool::Store(uint64_t sessionId, const uint8_t* data, size_t size) {
+    size_t need = SHARED_BLOB_HEADER_SIZE + (size + SHARED_BLOB_HEADER_SIZE - 1) / SHARED_BLOB_HEADER_SIZE * SHARED_BLOB_HEADER_SIZE;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ReclaimExpired();
+
+    Segment* segment = FindSpace(need);
+    if (!segment) {
+        size_t capacity = std::max(SEGMENT_SIZE, need);
+        if (MappedBytes() + capacity > MAX_POOL_BYTES) {
+            TrimIdle();
+        }
+        if (MappedBytes() + capacity > MAX_POOL_BYTES) {
+            LOG_WARN("Shared blob pool full, refusing " + std::to_string(size) + " bytes");
+            return std::nullopt;
+        }
+        auto memory = CreateSharedMemory(capacity);
+        if (!memory) {
+            return std::nullopt;
+        }
+        m_segments.push_back(std::make_unique<Segment>());
+        segment = m_segments.back().get();
+        segment->memory = std::move(memory);
+    }
+
+    uint64_t lease;
+    do {
+        lease = ++m_nextLease ^ m_leaseKey;
+    } while (lease == 0);
+
+    size_t offset = segment->used;
+    segment->used += need;
+    segment->leases++;
+    segment->headers.push_back(offset);
+
+    // The stamp is written last: a reader that sees it sees the payload
+    uint8_t* header = segment->memory->Data() + offset;
+    StoreStamp(header, 0);
+    std::memcpy(header + SHARED_BLOB_HEADER_SIZE, data, size);
+    uint64_t length = size;
+    std::memcpy(header + sizeof(uint64_t), &length, sizeof(length));
+    StoreStamp(header, lease);
+
+    m_leases[lease] = {sessionId, segment, Clock::now() + std::chrono::milliseconds(LEASE_TIMEOUT_MS)};
+
+    SharedBlobRef ref;
+    ref.name = segment->memory->Name();
+    ref.capacity = segment->memory->Size();
+    ref.offset = offset + SHARED_BLOB_HEADER_SIZE;
+    ref.length = size;
+    ref.lease = lease;
+    return ref;
+}
+
+bool SharedBlobPool::Release(uint64_t sessionId, uint64_t lease) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_leases.find(lease);
+    if (it == m_leases.end() || it->second.sessionId != sessionId) {
+        return false;
+    }
+    Drop(it);
+    return true;
+}
+
+void SharedBlobPool::ReleaseSession(uint64_t sessionId) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto it = m_leases.begin(); it != m_leases.end();) {
+        auto next = std::next(it);
+        if (it->second.sessionId == sessionId) {
+            Drop(it);
+        }
+        it = next;
+    }
+}
+
+SharedBlobPool::Segment* SharedBlobPool::FindSpace(size_t need) {
+    for (auto& segment : m_segments) {
+        if (segment->leases == 0 && segment->used != 0) {
+            // Every lease is gone: clear the stamps so readers still holding
+            // a stale reference notice, then start over
+            for (size_t offset : segment->headers) {
+                StoreStamp(segment->memory->Data() + offset, 0);
+            }
+            segment->headers.clear();
+            segment->used = 0;
+        }
+        if (segment->memory->Size() - segment->used >= need) {
+            return segment.get();
+        }
+    }
+    return nullptr;
+}
+
+void SharedBlobPool::ReclaimExpired() {
+    auto now = Clock::now();
+    for (auto it = m_leases.begin(); it != m_leases.end();) {
+        auto next = std::next(it);
+        if (it->second.expiry <= now) {
+            LOG_DEBUG("Shared blob lease expired for session " + std::to_string(it->second.sessionId));
+            Drop(it);
+        }
+        it = next;
+    }
+}
+
+void SharedBlobPool::Drop(std::unordered_map<uint64_t, Lease>::iterator it) {
+    Segment* segment = it->second.segment;
+    m_leases.erase(it);
+    if (--segment->leases == 0 && segment->memory->Size() > SEGMENT_SIZE) {
+        // Oversized regions hold a single payload; don't keep them around
+        m_segments.erase(std::find_if(m_segments.begin(), m_segments.end(),
+                                      [segment](const auto& s) { return s.get() == segment; }));
+    }
+}
+
+void SharedBlobPool::TrimIdle() {
+    m_segments.erase(std::remove_if(m_segments.begin(), m_segments.end(),
+                                    [](const auto& s) { return s->leases == 0; }),
+                     m_segments.end());
+}
+
+size_t SharedBlobPool::MappedBytes() const {
+    size_t total = 0;
+    for (const auto& segment : m_segments) {
+        total += segment->memory->Size();
+    }
+    return total;
+}
+
+} // namespace clipx
@@ -0,0 +1,68 @@
+#include "snapshot_publisher.h"
+#include "data_manager.h"
+#include "common/logger.h"
+#include <chrono>
+
+namespace clipx {
+
+SnapshotPublisher::SnapshotPublisher(const std::string& name) {
+    if (!m_writer.Create(name)) {
+        LOG_WARN("History snapshot unavailable: " + name);
+        return;
+    }
+    Publish();
+    m_worker = std::thread(&SnapshotPublisher::WorkerLoop, this);
+}
+
+SnapshotPublisher::~SnapshotPublisher() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_one();
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+}
+
+void SnapshotPublisher::MarkDirty() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_dirty = true;
+    }
+    m_cv.notify_one();
+}
+
+void SnapshotPublisher::Publish() {
+    // Read first, like get_history: clients replay changes from changeSeq,
+    // and replaying one the rows already include is harmless
+    HistorySnapshot snapshot;
+    snapshot.changeSeq = DataManager::Instance().GetChangeSeq();
+
+    QueryOptions options;
+    options.limit = static_cast<int>(HISTORY_SNAPSHOT_ROWS);
+    snapshot.entries = DataManager::Instance().Query(options);
+    for (auto& entry : snapshot.entries) {
+        entry.data.clear();  // Never part of the snapshot
+    }
+    snapshot.tags = DataManager::Instance().GetAllTags();
+
+    m_writer.Publish(snapshot);
+}
+
+void SnapshotPublisher::WorkerLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_cv.wait(lock, [this] { return m_stopping || m_dirty; });
+        if (m_cv.wait_for(lock, std::chrono::milliseconds(DEBOUNCE_MS), [this] { return m_stopping; })) {
+            return;
+        }
+        m_dirty = false;
+
+        lock.unlock();
+        Publish();
+        lock.lock();
+    }
+}
+
+} // namespace clipx
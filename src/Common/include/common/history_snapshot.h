@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "common/types.h"
+#include "common/shared_memory.h"
+
+namespace clipx {
+
+// The first page of history and the tag list, as the overlay shows them on
+// open. ClipD keeps the latest one in a shared-memory region under a
+// well-known name, so the overlay can paint before its IPC connection is up
+// and then reconcile from changeSeq with get_changes_since.
+struct HistorySnapshot {
+    int64_t changeSeq = 0;                          // History state it reflects
+    std::vector<ClipboardEntry> entries;            // Newest first, without payload data (thumbnails included)
+    std::vector<std::pair<std::string, int>> tags;  // Tag name and count
+};
+
+constexpr size_t HISTORY_SNAPSHOT_ROWS = 100;  // Same as the overlay's first get_history page
+
+// Bumped whenever the layout changes; readers ignore other versions
+constexpr uint32_t HISTORY_SNAPSHOT_VERSION = 2;
+
+std::string DefaultHistorySnapshotName();
+
+// Flat binary layout of one snapshot: a header, fixed-size entry and tag
+// records, then one string pool the records point into. Native byte order,
+// since it is only read on the machine that wrote it.
+//
+// Entries that don't fit in `capacity` bytes are left out (tags never are,
+// as long as they fit themselves), then thumbnails that don't fit in what
+// is left. Returns the number of entries written, or -1 if not even the
+// tags fit.
+int EncodeHistorySnapshot(const HistorySnapshot& snapshot, size_t capacity, std::vector<uint8_t>& out);
+
+// Every offset and length is checked, so torn or corrupt input fails
+// instead of reading out of bounds
+bool DecodeHistorySnapshot(const uint8_t* data, size_t size, HistorySnapshot& snapshot);
+
+// Owns the snapshot region and rewrites it. The region holds two slots: a
+// new snapshot is written to the one readers aren't using, then published
+// by switching the active slot under a generation counter, so readers never
+// wait on the writer. Single writer; not thread-safe.
+class HistorySnapshotWriter {
+public:
+    bool Create(const std::string& name);
+    bool Publish(const HistorySnapshot& snapshot);
+
+private:
+    std::unique_ptr<SharedMemory> m_memory;
+    std::vector<uint8_t> m_buffer;
+};
+
+// Map the region read-only and copy out the active snapshot. Retries while
+// the writer switches slots underneath; false if there is no region, it has
+// another layout version or nothing consistent could be read.
+bool ReadHistorySnapshot(const std::string& name, HistorySnapshot& snapshot);
+
+} // namespace clipx
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include "common/ipc_protocol.h"
+#include "common/ipc_codec.h"
+#include "common/ipc_transport.h"
+
+namespace clipx {
+
+// Client end of the IPC connection. Requests are pipelined: any number may
+// be in flight, and a reader thread matches responses to them by requestId,
+// so a slow SEARCH no longer holds up a GET_TAGS sent after it.
+//
+// Responses are delivered either through a future (resolved on the reader
+// thread) or a callback, which runs on the thread calling PollNotifications
+// so UI code can keep owning its state. A request that gets no answer
+// within its timeout completes with IPC_TIMEOUT; a late answer is dropped.
+class IPCClient {
+public:
+    using ResponseCallback = std::function<void(const IPCResponse&)>;
+    using NotificationHandler = std::function<void(const IPCNotification&)>;
+    using WakeCallback = std::function<void()>;
+    using DataVisitor = std::function<void(const uint8_t* data, size_t size)>;
+
+    // When nobody polls and this many notifications pile up, they are
+    // replaced with a single resync event
+    static constexpr size_t MAX_QUEUED_NOTIFICATIONS = 1024;
+
+    IPCClient();
+    ~IPCClient();
+
+    // Connects and negotiates the payload codec: the client starts in JSON
+    // and switches to the preferred codec if the server's PING lists it.
+    // Neither Connect nor Disconnect may race with requests being sent.
+    bool Connect(const std::string& address, int timeoutMs = 5000);
+    void Disconnect();
+
+    bool IsConnected() const { return m_connected; }
+
+    // Set before Connect
+    void SetPreferredCodec(IPCCodec codec) { m_preferredCodec = codec; }
+
+    // Called on the reader thread when PollNotifications has new work, at
+    // most once until the next poll (e.g. to post a message to the UI
+    // thread). Set before Connect.
+    void SetWakeCallback(WakeCallback callback) { m_wake = std::move(callback); }
+    IPCCodec GetCodec() const { return m_codec; }
+
+    // A request id of 0 is replaced with NextRequestId(); an explicit id must
+    // not collide with another request in flight. Safe from any thread.
+    std::future<IPCResponse> SendAsync(IPCRequest request, int timeoutMs = IPC_DEFAULT_TIMEOUT_MS);
+    int32_t SendAsync(IPCRequest request, ResponseCallback callback, int timeoutMs = IPC_DEFAULT_TIMEOUT_MS);
+
+    // Send a request and wait for its response
+    IPCResponse SendRequest(IPCRequest request, int timeoutMs = IPC_DEFAULT_TIMEOUT_MS);
+
+    // Fetch an entry's full payload. It arrives through shared memory, not
+    // the pipe: `visitor` reads it in place, then the lease is released.
+    // Returns false if the request failed or the server reclaimed the space
+    // before the visitor was done (what it saw may be torn).
+    bool FetchEntryData(int64_t id, const DataVisitor& visitor, int timeoutMs = IPC_DEFAULT_TIMEOUT_MS);
+
+    // Run completed callbacks and dispatch notifications, in arrival order.
+    // Never blocks.
+    void PollNotifications(const NotificationHandler& handler);
+
+    // Request ids for jobs that outlive their request (e.g. streamed search)
+    int32_t NextRequestId() { return m_nextRequestId++; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct PendingRequest {
+        std::promise<IPCResponse> promise;
+        ResponseCallback callback;  // Set: deliver through PollNotifications
+        Clock::time_point deadline;
+    };
+
+    // A completed callback or a notification, waiting for PollNotifications
+    struct Delivery {
+        ResponseCallback callback;
+        IPCResponse response;
+        IPCNotification notification;
+    };
+
+    int32_t Submit(IPCRequest& request, PendingRequest pending);
+    void ReaderLoop();
+    void QueueNotification(IPCNotification notification);
+    void Complete(int32_t requestId, IPCResponse response);
+    void Deliver(PendingRequest& pending, IPCResponse response);
+    void ExpireRequests();
+    void FailAll(const std::string& error);
+    void Wake();
+    void NegotiateCodec();
+
+    std::unique_ptr<IPCConnection> m_connection;
+    std::thread m_readerThread;
+    std::atomic<bool> m_connected{false};
+    std::atomic<IPCCodec> m_codec{IPCCodec::Json};
+    IPCCodec m_preferredCodec = IPCCodec::MsgPack;
+    std::atomic<int32_t> m_nextRequestId{1};
+
+    std::mutex m_writeMutex;
+    std::mutex m_pendingMutex;
+    std::unordered_map<int32_t, PendingRequest> m_pending;
+
+    std::mutex m_deliveryMutex;
+    std::deque<Delivery> m_deliveries;
+    size_t m_queuedNotifications = 0;
+    WakeCallback m_wake;
+    std::atomic<bool> m_wakePending{false};
+};
+
+} // namespace clipx
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "common/ipc_protocol.h"
+
+namespace clipx {
+
+// Payload encodings. The header magic names the encoding of each message,
+// so both sides can tell them apart without extra framing. JSON is always
+// understood; a client switches to MessagePack only after PING lists it,
+// and the server answers in whatever encoding the client last used.
+//
+// MessagePack messages mirror the JSON layout (same keys, same nesting).
+// Entry lists are encoded straight from and decoded straight into
+// ClipboardEntry, skipping the intermediate JSON tree.
+enum class IPCCodec : uint8_t {
+    Json,
+    MsgPack
+};
+
+uint32_t MagicForCodec(IPCCodec codec);
+bool CodecForMagic(uint32_t magic, IPCCodec& codec);
+const char* CodecName(IPCCodec codec);
+bool CodecFromName(const std::string& name, IPCCodec& codec);
+
+// Encoders append to `out`, so the caller can reserve room for a frame
+// header in front of the payload and reuse the buffer between messages
+void EncodeRequest(const IPCRequest& request, IPCCodec codec, std::vector<uint8_t>& out);
+void EncodeResponse(const IPCResponse& response, IPCCodec codec, std::vector<uint8_t>& out);
+void EncodeNotification(const IPCNotification& notification, IPCCodec codec, std::vector<uint8_t>& out);
+
+// A response's data value (entries included) encoded on its own. Set as
+// IPCResponse::encoded, it is copied into responses in the same codec, so a
+// cached result is sent again under another request id without re-encoding.
+struct EncodedResponseData {
+    IPCCodec codec = IPCCodec::Json;
+    std::vector<uint8_t> bytes;
+};
+
+std::shared_ptr<const EncodedResponseData> EncodeResponseData(const IPCResponse& response, IPCCodec codec);
+
+// Decoders return false on malformed input
+bool DecodeRequest(const uint8_t* data, size_t size, IPCCodec codec, IPCRequest& request);
+
+// Anything the server sends: a response or a notification
+struct IPCServerMessage {
+    bool isNotification = false;
+    IPCResponse response;
+    IPCNotification notification;
+};
+
+bool DecodeServerMessage(const uint8_t* data, size_t size, IPCCodec codec, IPCServerMessage& message);
+
+} // namespace clipx
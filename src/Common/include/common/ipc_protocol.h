@@ -2,21 +2,143 @@
 
 #include <string>
 #include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
 #include "json/json.hpp"
 #include "common/types.h"
+#include "common/shared_memory.h"
+#include "common/trace.h"
+#include "common/utils.h"
 
 namespace clipx {
 
-// IPC message header (binary, sent before JSON payload)
+// IPC message header (binary, sent before the payload)
 struct IPCHeader {
-    uint32_t magic;         // Magic number: 0x434C4958 ("CLIX")
-    uint32_t payloadSize;   // Size of JSON payload in bytes
+    uint32_t magic;         // Payload encoding: IPC_MAGIC (JSON) or IPC_MAGIC_MSGPACK
+    uint32_t payloadSize;   // Size of payload in bytes
 };
 
-constexpr uint32_t IPC_MAGIC = 0x434C4958;
+constexpr uint32_t IPC_MAGIC = 0x434C4958;          // "CLIX", JSON payload
+constexpr uint32_t IPC_MAGIC_MSGPACK = 0x434C4942;  // "CLIB", MessagePack payload
 constexpr const char* IPC_PIPE_NAME = "\\\\.\\pipe\\ClipX_IPC";
 constexpr int IPC_DEFAULT_TIMEOUT_MS = 5000;
 constexpr int IPC_BUFFER_SIZE = 65536;
+constexpr size_t IPC_MAX_BATCH_SIZE = 10000;  // Sub-requests per batch action
+constexpr size_t IPC_MAX_CHANGES = 1000;      // Changes per get_changes_since reply
+
+// Helper to convert ClipboardEntry to JSON
+inline nlohmann::json ClipboardEntryToJson(const ClipboardEntry& entry) {
+    nlohmann::json json = {
+        {"id", entry.id},
+        {"timestamp", entry.timestamp},
+        {"type", static_cast<int32_t>(entry.type)},
+        {"preview", entry.preview},
+        {"source_app", entry.sourceApp},
+        {"copy_count", entry.copyCount},
+        {"is_favorited", entry.isFavorited},
+        {"is_tagged", entry.isTagged}
+    };
+    if (!entry.tags.empty()) {
+        json["tags"] = entry.tags;
+    }
+    if (!entry.thumbnail.empty()) {
+        json["thumbnail"] = utils::Base64Encode(entry.thumbnail);
+    }
+    return json;
+}
+
+// Helper to convert JSON to ClipboardEntry
+inline ClipboardEntry JsonToClipboardEntry(const nlohmann::json& json) {
+    ClipboardEntry entry;
+    entry.id = json.value("id", static_cast<int64_t>(0));
+    entry.timestamp = json.value("timestamp", static_cast<int64_t>(0));
+    entry.type = static_cast<ClipboardDataType>(json.value("type", 1));
+    entry.preview = json.value("preview", "");
+    entry.sourceApp = json.value("source_app", "");
+    entry.copyCount = json.value("copy_count", 1);
+    entry.isFavorited = json.value("is_favorited", false);
+    entry.isTagged = json.value("is_tagged", false);
+    if (json.contains("tags") && json["tags"].is_array()) {
+        for (const auto& tag : json["tags"]) {
+            if (tag.is_string()) {
+                entry.tags.push_back(tag.get<std::string>());
+            }
+        }
+    }
+    if (json.contains("thumbnail") && json["thumbnail"].is_string()) {
+        entry.thumbnail = utils::Base64Decode(json["thumbnail"].get<std::string>());
+    }
+    return entry;
+}
+
+inline nlohmann::json EntriesToJson(const std::vector<ClipboardEntry>& entries) {
+    nlohmann::json json = nlohmann::json::array();
+    for (const auto& entry : entries) {
+        json.push_back(ClipboardEntryToJson(entry));
+    }
+    return json;
+}
+
+// Entries of a message's "entries" array; empty when absent
+inline std::vector<ClipboardEntry> JsonToEntries(const nlohmann::json& data) {
+    std::vector<ClipboardEntry> entries;
+    if (data.is_object() && data.contains("entries") && data["entries"].is_array()) {
+        for (const auto& item : data["entries"]) {
+            entries.push_back(JsonToClipboardEntry(item));
+        }
+    }
+    return entries;
+}
+
+// get_entry's "blob": where to find a payload sent through shared memory
+inline nlohmann::json SharedBlobRefToJson(const SharedBlobRef& ref) {
+    return {
+        {"name", ref.name},
+        {"capacity", ref.capacity},
+        {"offset", ref.offset},
+        {"length", ref.length},
+        {"lease", ref.lease}
+    };
+}
+
+inline std::optional<SharedBlobRef> JsonToSharedBlobRef(const nlohmann::json& json) {
+    if (!json.is_object() || !json.contains("name") || !json["name"].is_string()) {
+        return std::nullopt;
+    }
+    SharedBlobRef ref;
+    ref.name = json["name"].get<std::string>();
+    std::pair<const char*, uint64_t*> fields[] = {
+        {"capacity", &ref.capacity}, {"offset", &ref.offset}, {"length", &ref.length}, {"lease", &ref.lease}
+    };
+    for (auto& [key, value] : fields) {
+        auto it = json.find(key);
+        if (it == json.end() || !it->is_number_unsigned()) {
+            return std::nullopt;
+        }
+        *value = it->get<uint64_t>();
+    }
+    return ref;
+}
+
+// get_history parameters. The overlay asks for history every time it opens,
+// so the codecs decode these straight into the struct (IPCRequest::history)
+// instead of building a params tree.
+struct HistoryParams {
+    int limit = 100;
+    int offset = 0;
+    bool favoritesOnly = false;
+    int type = 0;  // ClipboardDataType to filter on, 0 for all
+
+    static HistoryParams FromJson(const nlohmann::json& params) {
+        HistoryParams history;
+        history.limit = params.value("limit", history.limit);
+        history.offset = params.value("offset", history.offset);
+        history.favoritesOnly = params.value("favorites_only", history.favoritesOnly);
+        history.type = params.value("type", history.type);
+        return history;
+    }
+};
 
 // IPC Request
 struct IPCRequest {
@@ -24,12 +146,26 @@ struct IPCRequest {
     int32_t requestId = 0;
     nlohmann::json params;
 
+    // Set by the codecs for get_history, with `params` left empty
+    std::optional<HistoryParams> history;
+
+    // The sender's span, sent as "trace" only while it traces
+    trace::Context trace;
+
+    HistoryParams GetHistoryParams() const {
+        return history ? *history : HistoryParams::FromJson(params);
+    }
+
     nlohmann::json ToJson() const {
-        return {
+        nlohmann::json json = {
             {"action", action},
             {"request_id", requestId},
             {"params", params}
         };
+        if (trace.Valid()) {
+            json["trace"] = trace::FormatContext(trace);
+        }
+        return json;
     }
 
     static IPCRequest FromJson(const nlohmann::json& json) {
@@ -37,10 +173,13 @@ struct IPCRequest {
         req.action = json.value("action", "");
         req.requestId = json.value("request_id", 0);
         req.params = json.value("params", nlohmann::json::object());
+        trace::ParseContext(json.value("trace", ""), req.trace);
         return req;
     }
 };
 
+struct EncodedResponseData;  // ipc_codec.h
+
 // IPC Response
 struct IPCResponse {
     int32_t requestId = 0;
@@ -49,12 +188,23 @@ struct IPCResponse {
     std::string error;
     int32_t errorCode = 0;
 
+    // Entry list sent as data.entries. Kept typed so binary codecs can
+    // encode it without building a JSON tree first.
+    std::optional<std::vector<ClipboardEntry>> entries;
+
+    // Data and entries already encoded, e.g. by ClipD's response cache:
+    // the codecs copy these bytes instead. Not part of ToJson.
+    std::shared_ptr<const EncodedResponseData> encoded;
+
     nlohmann::json ToJson() const {
         nlohmann::json json = {
             {"request_id", requestId},
             {"success", success},
             {"data", data}
         };
+        if (entries) {
+            json["data"]["entries"] = EntriesToJson(*entries);
+        }
         if (!error.empty()) {
             json["error"] = error;
             json["error_code"] = errorCode;
@@ -72,6 +222,11 @@ struct IPCResponse {
         return resp;
     }
 
+    // Typed entries, or data.entries parsed from JSON
+    std::vector<ClipboardEntry> GetEntries() const {
+        return entries ? *entries : JsonToEntries(data);
+    }
+
     static IPCResponse Success(int32_t requestId, const nlohmann::json& data = {}) {
         IPCResponse resp;
         resp.requestId = requestId;
@@ -94,12 +249,17 @@ struct IPCResponse {
 struct IPCNotification {
     std::string event;
     nlohmann::json data;
+    std::optional<std::vector<ClipboardEntry>> entries;  // See IPCResponse::entries
 
     nlohmann::json ToJson() const {
-        return {
+        nlohmann::json json = {
             {"event", event},
             {"data", data}
         };
+        if (entries) {
+            json["data"]["entries"] = EntriesToJson(*entries);
+        }
+        return json;
     }
 
     static IPCNotification FromJson(const nlohmann::json& json) {
@@ -108,6 +268,15 @@ struct IPCNotification {
         notif.data = json.value("data", nlohmann::json::object());
         return notif;
     }
+
+    std::vector<ClipboardEntry> GetEntries() const {
+        return entries ? *entries : JsonToEntries(data);
+    }
+
+    // Notifications share the pipe with responses and are told apart by "event"
+    static bool IsNotification(const nlohmann::json& json) {
+        return json.contains("event");
+    }
 };
 
 // Action types
@@ -128,13 +297,108 @@ namespace IPCAction {
     constexpr const char* REMOVE_TAG = "remove_tag";
     constexpr const char* GET_TAGS = "get_tags";
     constexpr const char* GET_ALL_TAGS = "get_all_tags";
+    constexpr const char* CANCEL_SEARCH = "cancel_search";
+    constexpr const char* SUBSCRIBE = "subscribe";
+    constexpr const char* UNSUBSCRIBE = "unsubscribe";
+    constexpr const char* BATCH = "batch";  // Write actions in one transaction
+    constexpr const char* RELEASE_BLOB = "release_blob";  // Done with a get_entry payload
+    constexpr const char* GET_CHANGES_SINCE = "get_changes_since";  // Catch up from a change seq
+    constexpr const char* GET_ACTION_STATS = "get_action_stats";  // Per-action counts and latency
 }
 
 // Event types
 namespace IPCEvent {
-    constexpr const char* CLIPBOARD_CHANGED = "clipboard_changed";
+    constexpr const char* ENTRY_INSERTED = "entry_inserted";
+    constexpr const char* ENTRY_UPDATED = "entry_updated";
     constexpr const char* ENTRY_DELETED = "entry_deleted";
+    constexpr const char* TAGS_CHANGED = "tags_changed";
+    constexpr const char* RESYNC = "resync";  // Changes were dropped; reload
     constexpr const char* CONFIG_CHANGED = "config_changed";
+    constexpr const char* SEARCH_RESULTS = "search_results";
+}
+
+// Change events (see EntryChange) carry only the fields that changed
+inline IPCNotification EntryChangeToNotification(const EntryChange& change) {
+    IPCNotification notification;
+    nlohmann::json& data = notification.data;
+    data = nlohmann::json::object();
+
+    switch (change.kind) {
+        case EntryChange::Kind::Inserted:
+            notification.event = IPCEvent::ENTRY_INSERTED;
+            notification.entries = std::vector<ClipboardEntry>{change.entry};
+            break;
+        case EntryChange::Kind::Updated:
+            notification.event = IPCEvent::ENTRY_UPDATED;
+            data["id"] = change.id;
+            if (change.newId) data["new_id"] = *change.newId;
+            if (change.timestamp) data["timestamp"] = *change.timestamp;
+            if (change.preview) data["preview"] = *change.preview;
+            if (change.sourceApp) data["source_app"] = *change.sourceApp;
+            if (change.copyCount) data["copy_count"] = *change.copyCount;
+            if (change.isFavorited) data["is_favorited"] = *change.isFavorited;
+            break;
+        case EntryChange::Kind::Deleted:
+            notification.event = IPCEvent::ENTRY_DELETED;
+            if (!change.ids.empty()) data["ids"] = change.ids;
+            if (change.olderThan) data["older_than"] = *change.olderThan;
+            if (change.allPersisted) data["all_persisted"] = true;
+            break;
+        case EntryChange::Kind::TagsChanged:
+            notification.event = IPCEvent::TAGS_CHANGED;
+            data["id"] = change.id;
+            data["tags"] = change.tags;
+            break;
+    }
+    if (change.seq != 0) {
+        data["seq"] = change.seq;
+    }
+    return notification;
+}
+
+// False for notifications that are not change events
+inline bool NotificationToEntryChange(const IPCNotification& notification, EntryChange& change) {
+    const nlohmann::json& data = notification.data;
+    if (!data.is_object()) {
+        return false;
+    }
+
+    try {
+        change = EntryChange();
+        change.seq = data.value("seq", static_cast<int64_t>(0));
+        if (notification.event == IPCEvent::ENTRY_INSERTED) {
+            auto entries = notification.GetEntries();
+            if (entries.empty()) {
+                return false;
+            }
+            change.kind = EntryChange::Kind::Inserted;
+            change.entry = std::move(entries.front());
+            change.id = change.entry.id;
+        } else if (notification.event == IPCEvent::ENTRY_UPDATED) {
+            change.kind = EntryChange::Kind::Updated;
+            change.id = data.value("id", static_cast<int64_t>(0));
+            if (data.contains("new_id")) change.newId = data["new_id"].get<int64_t>();
+            if (data.contains("timestamp")) change.timestamp = data["timestamp"].get<int64_t>();
+            if (data.contains("preview")) change.preview = data["preview"].get<std::string>();
+            if (data.contains("source_app")) change.sourceApp = data["source_app"].get<std::string>();
+            if (data.contains("copy_count")) change.copyCount = data["copy_count"].get<int32_t>();
+            if (data.contains("is_favorited")) change.isFavorited = data["is_favorited"].get<bool>();
+        } else if (notification.event == IPCEvent::ENTRY_DELETED) {
+            change.kind = EntryChange::Kind::Deleted;
+            if (data.contains("ids")) change.ids = data["ids"].get<std::vector<int64_t>>();
+            if (data.contains("older_than")) change.olderThan = data["older_than"].get<int64_t>();
+            change.allPersisted = data.value("all_persisted", false);
+        } else if (notification.event == IPCEvent::TAGS_CHANGED) {
+            change.kind = EntryChange::Kind::TagsChanged;
+            change.id = data.value("id", static_cast<int64_t>(0));
+            if (data.contains("tags")) change.tags = data["tags"].get<std::vector<std::string>>();
+        } else {
+            return false;
+        }
+    } catch (const nlohmann::json::exception&) {
+        return false;  // Field of the wrong type
+    }
+    return true;
 }
 
 // Error codes
@@ -143,6 +407,7 @@ namespace IPCError {
     constexpr int32_t IPC_CONNECTION_FAILED = 1001;
     constexpr int32_t IPC_TIMEOUT = 1002;
     constexpr int32_t IPC_INVALID_REQUEST = 1003;
+    constexpr int32_t IPC_BLOB_UNAVAILABLE = 1004;  // Shared-memory payload channel full or failed
     constexpr int32_t DB_OPEN_FAILED = 2001;
     constexpr int32_t DB_WRITE_FAILED = 2002;
     constexpr int32_t DB_QUERY_FAILED = 2003;
@@ -153,43 +418,4 @@ namespace IPCError {
     constexpr int32_t UNKNOWN_ERROR = 9999;
 }
 
-// Helper to convert ClipboardEntry to JSON
-inline nlohmann::json ClipboardEntryToJson(const ClipboardEntry& entry) {
-    nlohmann::json json = {
-        {"id", entry.id},
-        {"timestamp", entry.timestamp},
-        {"type", static_cast<int32_t>(entry.type)},
-        {"preview", entry.preview},
-        {"source_app", entry.sourceApp},
-        {"copy_count", entry.copyCount},
-        {"is_favorited", entry.isFavorited},
-        {"is_tagged", entry.isTagged}
-    };
-    if (!entry.tags.empty()) {
-        json["tags"] = entry.tags;
-    }
-    return json;
-}
-
-// Helper to convert JSON to ClipboardEntry
-inline ClipboardEntry JsonToClipboardEntry(const nlohmann::json& json) {
-    ClipboardEntry entry;
-    entry.id = json.value("id", static_cast<int64_t>(0));
-    entry.timestamp = json.value("timestamp", static_cast<int64_t>(0));
-    entry.type = static_cast<ClipboardDataType>(json.value("type", 1));
-    entry.preview = json.value("preview", "");
-    entry.sourceApp = json.value("source_app", "");
-    entry.copyCount = json.value("copy_count", 1);
-    entry.isFavorited = json.value("is_favorited", false);
-    entry.isTagged = json.value("is_tagged", false);
-    if (json.contains("tags") && json["tags"].is_array()) {
-        for (const auto& tag : json["tags"]) {
-            if (tag.is_string()) {
-                entry.tags.push_back(tag.get<std::string>());
-            }
-        }
-    }
-    return entry;
-}
-
 } // namespace clipx
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include "common/ipc_codec.h"
+
+namespace clipx {
+
+// Largest payload accepted from a peer; a corrupt or hostile header must not
+// make the reader allocate gigabytes
+constexpr uint32_t IPC_MAX_PAYLOAD_SIZE = 64 * 1024 * 1024;
+
+// Room a frame assembled in place (WriteFrame) keeps in front of the payload
+constexpr size_t IPC_FRAME_HEADER_SIZE = sizeof(IPCHeader);
+
+// Outcome of IPCConnection::ReadAvailable
+enum class IPCReadResult {
+    Message,  // The frame is complete
+    Pending,  // Nothing more has arrived yet
+    Failed,   // Hang-up, I/O error or invalid header
+};
+
+// One end of a byte stream carrying IPCHeader-framed messages. Backends:
+// Win32 named pipes (Windows) and AF_UNIX stream sockets (everywhere else).
+//
+// One thread may read while others write; concurrent writers must be
+// serialized by the caller (IPCSession does this per client).
+class IPCConnection {
+public:
+    virtual ~IPCConnection() = default;
+
+    IPCConnection(const IPCConnection&) = delete;
+    IPCConnection& operator=(const IPCConnection&) = delete;
+
+    // Read one message, waiting up to timeoutMs for the whole frame. The
+    // payload reuses the vector's capacity.
+    bool ReadMessage(std::vector<uint8_t>& payload, IPCCodec& codec, int timeoutMs = IPC_DEFAULT_TIMEOUT_MS);
+
+    // Read what has arrived without waiting, continuing a frame begun by
+    // earlier calls: `filled` bytes of `frame` (header included) are in, and
+    // starts at 0 for a new frame. On Message the payload follows the first
+    // IPC_FRAME_HEADER_SIZE bytes of `frame`. Lets a server serve a client
+    // that sends a frame slowly without tying a thread to it.
+    IPCReadResult ReadAvailable(std::vector<uint8_t>& frame, size_t& filled, IPCCodec& codec);
+
+    // Write header and payload as one frame
+    bool WriteMessage(const std::vector<uint8_t>& payload, IPCCodec codec);
+
+    // Write a frame assembled in place: IPC_FRAME_HEADER_SIZE bytes of room
+    // followed by the payload. The header is filled in, so a sender that
+    // encodes straight into a reused buffer saves WriteMessage's copy.
+    bool WriteFrame(std::vector<uint8_t>& frame, IPCCodec codec);
+
+    // Wait up to timeoutMs (negative: forever) until a read would not block:
+    // data is waiting, the peer hung up or the connection was closed
+    virtual bool WaitReadable(int timeoutMs) = 0;
+    bool HasPendingData() { return WaitReadable(0); }
+
+    // Unblocks pending reads and writes; further I/O fails. Idempotent and
+    // safe to call from any thread. Handles are released by the destructor.
+    virtual void Close() = 0;
+
+    bool IsOpen() const { return m_open; }
+
+protected:
+    IPCConnection() = default;
+
+    // Block until exactly `size` bytes arrived or were written
+    virtual bool ReadExact(uint8_t* buffer, size_t size, int timeoutMs) = 0;
+    virtual bool WriteAll(const uint8_t* data, size_t size, int timeoutMs) = 0;
+
+    // Read up to `size` bytes that have already arrived: the count, 0 if
+    // none has, -1 on hang-up or error
+    virtual ptrdiff_t ReadSome(uint8_t* buffer, size_t size) = 0;
+
+    std::atomic<bool> m_open{true};
+};
+
+// Server side of the transport. Instead of a thread per client, a single
+// event loop calls Wait() and hands ready connections to worker threads:
+//
+//   - Accepted connections are watched for input right away.
+//   - A connection reported readable is not reported again until Rearm(),
+//     so exactly one worker serves it at a time.
+//   - Remove() stops watching and closes the connection.
+//
+// Wait() runs on one thread; Rearm, Remove and Wake may be called from any.
+class IPCListener {
+public:
+    virtual ~IPCListener() = default;
+
+    // Connections beyond maxConnections are refused (closed on accept)
+    virtual bool Listen(const std::string& address, size_t maxConnections) = 0;
+
+    // Blocks until something happens, timeoutMs passes or Wake() is called.
+    // Returns false once the listener is unusable.
+    virtual bool Wait(int timeoutMs,
+                      std::vector<std::shared_ptr<IPCConnection>>& accepted,
+                      std::vector<std::shared_ptr<IPCConnection>>& readable) = 0;
+
+    virtual void Rearm(const std::shared_ptr<IPCConnection>& connection) = 0;
+    virtual void Remove(const std::shared_ptr<IPCConnection>& connection) = 0;
+    virtual void Wake() = 0;
+
+    // Stops listening and closes every connection
+    virtual void Close() = 0;
+};
+
+// Platform backend: named pipe on Windows, Unix domain socket elsewhere
+std::unique_ptr<IPCListener> CreateIPCListener();
+
+// Connect to a listening server, retrying while it is busy or not up yet
+std::unique_ptr<IPCConnection> ConnectIPC(const std::string& address, int timeoutMs);
+
+// IPC_PIPE_NAME on Windows, a per-user socket path elsewhere
+std::string DefaultIPCAddress();
+
+#ifndef _WIN32
+// Wrap a connected AF_UNIX stream socket, such as one end of a
+// socketpair(). The connection owns the descriptor.
+std::unique_ptr<IPCConnection> AdoptIPCSocket(int fd);
+#endif
+
+} // namespace clipx
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace clipx {
+
+// Streaming JSON encoder, the counterpart of MsgPackWriter for the JSON
+// codec. Appends compact JSON to a caller-owned buffer without building a
+// tree first; commas are inserted automatically. Strings are escaped, and
+// invalid UTF-8 is replaced with U+FFFD so the output always parses.
+class JsonWriter {
+public:
+    static constexpr int MAX_DEPTH = 64;
+
+    explicit JsonWriter(std::vector<uint8_t>& out) : m_out(out) {}
+
+    void BeginObject();
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+    void Key(const char* data, size_t size);
+    void Key(const std::string& key) { Key(key.data(), key.size()); }
+
+    void Null();
+    void Bool(bool value);
+    void Int(int64_t value);
+    void UInt(uint64_t value);
+    void Double(double value);  // NaN and infinities become null
+    void String(const char* data, size_t size);
+    void String(const std::string& value) { String(value.data(), value.size()); }
+    void RawValue(const uint8_t* data, size_t size);  // One value, already encoded
+
+private:
+    void BeforeValue();
+    void Open(uint8_t bracket);
+    void Close(uint8_t bracket);
+    void Raw(const char* data, size_t size) { m_out.insert(m_out.end(), data, data + size); }
+    void Escaped(const char* data, size_t size);
+
+    std::vector<uint8_t>& m_out;
+    int m_depth = 0;
+    uint64_t m_hasItems = 0;  // Bit per depth: the open container needs a comma
+    bool m_afterKey = false;
+};
+
+// Pull parser over a borrowed buffer, the counterpart of MsgPackReader.
+// Values are read in document order straight into the caller's variables;
+// nothing is allocated except when a string is unescaped into a
+// std::string (which reuses its capacity). Every Read* returns false on a
+// type mismatch or malformed input.
+//
+// Containers are walked with NextKey/NextItem, which set `end` once the
+// closing bracket has been consumed:
+//
+//   if (!reader.BeginObject()) ...
+//   std::string_view key;
+//   bool end;
+//   while (reader.NextKey(key, end) && !end) { ... read or Skip() the value ... }
+class JsonReader {
+public:
+    enum class Type {
+        Null,
+        Bool,
+        Number,
+        String,
+        Array,
+        Object,
+        Invalid   // Malformed input or end of input
+    };
+
+    // Nesting limit for Skip and generic readers
+    static constexpr int MAX_DEPTH = 64;
+
+    JsonReader(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+
+    Type PeekType();
+    bool AtEnd();  // Only whitespace left
+    size_t Position() const { return m_pos; }
+
+    bool ReadNull();
+    bool ReadBool(bool& value);
+    bool ReadInt(int64_t& value);    // Integer literal that fits int64
+    bool ReadUInt(uint64_t& value);  // Non-negative integer literal
+    bool ReadDouble(double& value);  // Any number
+    bool ReadString(std::string& value);
+
+    bool BeginObject();
+    bool NextKey(std::string_view& key, bool& end);  // Points into the buffer unless escaped
+    bool BeginArray();
+    bool NextItem(bool& end);
+
+    // Skip one complete value, including nested containers
+    bool Skip(int depth = 0);
+
+private:
+    void SkipWhitespace();
+    bool Literal(const char* text, size_t size);
+    bool NumberToken(const char*& begin, size_t& size, bool& integral);
+    bool NextInContainer(uint8_t close, bool& end);
+
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_pos = 0;
+    int m_depth = 0;
+    uint64_t m_hasItems = 0;  // Bit per depth: an item was read, a comma must come next
+    std::string m_keyScratch;  // Unescaped keys
+};
+
+} // namespace clipx
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <atomic>
 #include <fstream>
 #include <mutex>
 #include <memory>
@@ -30,6 +31,9 @@ public:
     void SetLevel(LogLevel level);
     LogLevel GetLevel() const;
 
+    // Lock-free check the LOG_* macros make before building the message
+    bool IsEnabled(LogLevel level) const { return m_initialized && level >= m_level; }
+
 private:
     Logger() = default;
     ~Logger();
@@ -41,15 +45,20 @@ private:
     std::string GetCurrentTimeString();
 
     std::ofstream m_file;
-    LogLevel m_level = LogLevel::Info;
+    std::atomic<LogLevel> m_level{LogLevel::Info};
     std::mutex m_mutex;
-    bool m_initialized = false;
+    std::atomic<bool> m_initialized{false};
 };
 
-// Convenience macros
-#define LOG_DEBUG(msg) clipx::Logger::Instance().Debug(msg)
-#define LOG_INFO(msg) clipx::Logger::Instance().Info(msg)
-#define LOG_WARN(msg) clipx::Logger::Instance().Warning(msg)
-#define LOG_ERROR(msg) clipx::Logger::Instance().Error(msg)
+// Convenience macros. The message expression is only evaluated when the
+// level is enabled, so disabled debug logging costs no string building.
+#define CLIPX_LOG(level, msg) \
+    do { \
+        if (clipx::Logger::Instance().IsEnabled(level)) clipx::Logger::Instance().Log(level, msg); \
+    } while (0)
+#define LOG_DEBUG(msg) CLIPX_LOG(clipx::LogLevel::Debug, msg)
+#define LOG_INFO(msg) CLIPX_LOG(clipx::LogLevel::Info, msg)
+#define LOG_WARN(msg) CLIPX_LOG(clipx::LogLevel::Warning, msg)
+#define LOG_ERROR(msg) CLIPX_LOG(clipx::LogLevel::Error, msg)
 
 } // namespace clipx
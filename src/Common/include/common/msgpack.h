@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace clipx {
+
+// Minimal MessagePack encoder. Appends to a caller-owned buffer so the
+// buffer can be reused between messages.
+class MsgPackWriter {
+public:
+    explicit MsgPackWriter(std::vector<uint8_t>& out) : m_out(out) {}
+
+    void Nil();
+    void Bool(bool value);
+    void Int(int64_t value);      // Smallest encoding that holds the value
+    void UInt(uint64_t value);
+    void Double(double value);
+    void String(const char* data, size_t size);
+    void String(const std::string& value) { String(value.data(), value.size()); }
+    void Binary(const uint8_t* data, size_t size);
+    void ArrayHeader(uint32_t count);
+    void MapHeader(uint32_t count);
+    void RawValue(const uint8_t* data, size_t size) { m_out.insert(m_out.end(), data, data + size); }
+
+private:
+    void Byte(uint8_t b) { m_out.push_back(b); }
+    void BigEndian(uint64_t value, int bytes);
+
+    std::vector<uint8_t>& m_out;
+};
+
+// MessagePack decoder over a borrowed buffer. Every Read* returns false and
+// leaves the position unchanged on a type mismatch or truncated input.
+class MsgPackReader {
+public:
+    enum class Type {
+        Nil,
+        Bool,
+        Int,      // Negative integer
+        UInt,     // Non-negative integer
+        Float,
+        String,
+        Binary,
+        Array,
+        Map,
+        Invalid   // Extension types, reserved bytes or end of input
+    };
+
+    // Nesting limit for Skip and generic readers
+    static constexpr int MAX_DEPTH = 64;
+
+    MsgPackReader(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+
+    Type PeekType() const;
+    bool AtEnd() const { return m_pos >= m_size; }
+    size_t Position() const { return m_pos; }
+
+    bool ReadNil();
+    bool ReadBool(bool& value);
+    bool ReadInt(int64_t& value);     // Any integer that fits int64
+    bool ReadUInt(uint64_t& value);   // Any non-negative integer
+    bool ReadDouble(double& value);   // Floats and integers
+    bool ReadString(std::string& value);
+    bool ReadString(const char*& data, size_t& size);  // Points into the buffer
+    bool ReadBinary(const uint8_t*& data, size_t& size);
+    bool ReadArrayHeader(uint32_t& count);
+    bool ReadMapHeader(uint32_t& count);
+
+    // Skip one complete value, including nested containers
+    bool Skip(int depth = 0);
+
+private:
+    bool Has(size_t bytes) const { return m_size - m_pos >= bytes; }
+    uint64_t BigEndian(size_t offset, int bytes) const;
+
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_pos = 0;
+};
+
+} // namespace clipx
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <list>
+#include <unordered_map>
+#include <chrono>
+#include <cstdint>
+
+namespace clipx {
+
+// Regular expressions evaluated by a Pike VM (Thompson NFA simulation).
+// Matching time is linear in the input for every pattern, so user input
+// can't trigger catastrophic backtracking.
+//
+// Supported syntax: literals, . (not newline), [...] / [^...] classes,
+// \d \w \s \D \W \S, \b \B, ^ $ (line boundaries), ( ) (?: ) groups,
+// |, * + ? {n} {n,} {n,m} and their lazy forms (laziness does not change
+// whether a text matches). A leading (?i) enables case-insensitive matching.
+// Text is decoded as UTF-8; case folding and \w \d \s are ASCII only.
+class Regex {
+public:
+    enum class Result {
+        Match,
+        NoMatch,
+        Timeout
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    // Returns nullptr and fills `error` when the pattern is invalid or too large
+    static std::shared_ptr<const Regex> Compile(const std::string& pattern, bool ignoreCase = false,
+                                                std::string* error = nullptr);
+
+    // Search for a match anywhere in text. Gives up with Timeout once the
+    // deadline has passed.
+    Result Search(const char* text, size_t size, Clock::time_point deadline = Clock::time_point::max()) const;
+    bool Search(const std::string& text) const {
+        return Search(text.data(), text.size()) == Result::Match;
+    }
+
+    // Lowercased literal strings that occur in every match, longest first.
+    // A text missing any of them can't match, which makes them usable as an
+    // index or substring prefilter.
+    const std::vector<std::string>& RequiredLiterals() const { return m_literals; }
+
+    const std::string& Pattern() const { return m_pattern; }
+    bool IgnoreCase() const { return m_ignoreCase; }
+
+    struct Range {
+        uint32_t lo;
+        uint32_t hi;
+    };
+
+    struct Inst {
+        enum Op : uint8_t {
+            Char,       // Match code point `value`
+            Class,      // Match class `value` in m_classes
+            Any,        // Match anything except '\n'
+            Split,      // Continue at x and y
+            Jmp,        // Continue at x
+            LineStart,
+            LineEnd,
+            WordBoundary,
+            NotWordBoundary,
+            Match
+        };
+        Op op;
+        uint32_t value = 0;
+        int x = 0;
+        int y = 0;
+    };
+
+    struct CharClass {
+        std::vector<Range> ranges;
+        bool negated = false;
+    };
+
+private:
+    Regex() = default;
+
+    friend class RegexCompiler;
+
+    std::string m_pattern;
+    bool m_ignoreCase = false;
+    std::vector<Inst> m_program;
+    std::vector<CharClass> m_classes;
+    std::vector<std::string> m_literals;
+};
+
+// Process-wide LRU cache of compiled patterns
+class RegexCache {
+public:
+    static RegexCache& Instance();
+
+    std::shared_ptr<const Regex> Get(const std::string& pattern, bool ignoreCase = false,
+                                     std::string* error = nullptr);
+
+private:
+    RegexCache() = default;
+
+    using Key = std::string;  // Flag byte + pattern
+
+    static constexpr size_t MAX_ENTRIES = 64;
+
+    std::mutex m_mutex;
+    std::list<std::pair<Key, std::shared_ptr<const Regex>>> m_lru;  // Most recent first
+    std::unordered_map<Key, decltype(m_lru)::iterator> m_index;
+};
+
+} // namespace clipx
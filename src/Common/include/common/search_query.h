@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <optional>
+#include "common/types.h"
+
+namespace clipx {
+
+// Parsed form of the search box syntax:
+//
+//   tag:<name>            entry carries this tag (exact, case-insensitive)
+//   app:<name>            source application contains <name>
+//   type:<kind>           text | html | rtf | image | files
+//   fav                   favorited entries only (also "is:fav")
+//   before:<when>         older than <when>
+//   after:<when>          newer than or equal to <when>
+//   anything else         free text, matched against preview and tags
+//
+// <when> is either a date (YYYY-MM-DD, local time) or a relative age such
+// as 30m, 12h, 7d or 2w. Values may be double-quoted to include spaces,
+// e.g. tag:"work notes"; inside quotes \" is a quote and \\ a backslash,
+// other backslashes are literal. Tokens that don't parse as a filter are
+// kept as free text so a stray colon never makes a query fail.
+//
+// Regex mode bypasses this syntax: the whole input is the pattern (see
+// common/regex.h) and is matched against the preview.
+struct SearchQuery {
+    std::vector<std::string> terms;     // Free-text terms, all must match
+    std::vector<std::string> tags;      // All must be present
+    std::vector<std::string> apps;      // All must match source_app
+    std::optional<ClipboardDataType> type;
+    bool favoritesOnly = false;
+    std::optional<int64_t> before;      // Exclusive upper bound (ms)
+    std::optional<int64_t> after;       // Inclusive lower bound (ms)
+    std::string regex;                  // Pattern the preview must match
+    bool regexIgnoreCase = false;
+    int timeBudgetMs = 0;               // Stop evaluating after this long, 0 = no limit
+
+    bool IsEmpty() const;
+    bool HasFilters() const;            // Anything besides free text
+};
+
+// Parse search box input. `now` is used to resolve relative ages and
+// defaults to the current time.
+SearchQuery ParseSearchQuery(const std::string& input, int64_t now = 0);
+
+// Query for regex mode
+SearchQuery MakeRegexQuery(const std::string& pattern, bool ignoreCase = false);
+
+// Evaluate a parsed query against an in-memory entry (entries that are
+// not in the database cannot be filtered by SQL)
+bool MatchesSearchQuery(const SearchQuery& query, const ClipboardEntry& entry);
+
+// Build a "key:value" token, quoting and escaping the value when necessary
+std::string FormatQueryFilter(const std::string& key, const std::string& value);
+
+} // namespace clipx
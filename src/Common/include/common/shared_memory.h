@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace clipx {
+
+// A named shared-memory region. Backends: file mappings backed by the paging
+// file (Windows) and POSIX shm objects (everywhere else).
+//
+// The creator maps it read-write and owns the name: it is removed when the
+// creator's object goes away. Other processes open it by name, read-only.
+// An existing mapping stays valid after the name is gone.
+class SharedMemory {
+public:
+    virtual ~SharedMemory() = default;
+
+    SharedMemory(const SharedMemory&) = delete;
+    SharedMemory& operator=(const SharedMemory&) = delete;
+
+    uint8_t* Data() { return m_data; }
+    const uint8_t* Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+    const std::string& Name() const { return m_name; }
+
+protected:
+    SharedMemory() = default;
+
+    uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+    std::string m_name;
+};
+
+// New region with a unique, hard-to-guess name, readable by the current user
+std::unique_ptr<SharedMemory> CreateSharedMemory(size_t size);
+
+// New region under a well-known name, for readers that can't be told a
+// unique one. Fails while another process owns the name; a name left behind
+// by a creator that crashed (POSIX only) is taken over.
+std::unique_ptr<SharedMemory> CreateNamedSharedMemory(const std::string& name, size_t size);
+
+// Map `size` bytes of an existing region read-only
+std::unique_ptr<SharedMemory> OpenSharedMemory(const std::string& name, size_t size);
+
+// Large payloads (GET_ENTRY with_data) travel through shared memory instead
+// of the pipe. The server copies the payload into a pooled region and sends
+// this reference; the client maps the region, reads the payload and sends
+// release_blob when done.
+//
+// Each payload is preceded by a SHARED_BLOB_HEADER_SIZE-byte header whose
+// first 8 bytes hold the lease id. Space whose lease was released or expired
+// is reused, and reusing it overwrites the stamp first, so a reader that
+// finds the stamp unchanged after reading knows the bytes were intact.
+struct SharedBlobRef {
+    std::string name;    // Region to map
+    uint64_t capacity;   // Region size
+    uint64_t offset;     // Payload start within the region
+    uint64_t length;     // Payload size
+    uint64_t lease;      // Stamp expected in the header; release_blob key
+};
+
+constexpr size_t SHARED_BLOB_HEADER_SIZE = 64;  // Keeps payloads cache-line aligned
+
+// Read-only view of a blob. Data() points straight into the mapping, so the
+// payload is never copied unless the caller does.
+class SharedBlobView {
+public:
+    // Fails if the region is gone or the lease was already reclaimed
+    bool Open(const SharedBlobRef& ref);
+    void Close();
+
+    const uint8_t* Data() const;
+    size_t Size() const { return m_memory ? static_cast<size_t>(m_ref.length) : 0; }
+
+    // False once the server reclaimed the space. Check after reading Data():
+    // if it fails, what was read may be torn and the blob must be fetched again.
+    bool IsValid() const;
+
+    // Copy the payload out; false (and `out` unspecified) if reclaimed meanwhile
+    bool CopyTo(std::vector<uint8_t>& out) const;
+
+private:
+    std::unique_ptr<SharedMemory> m_memory;
+    SharedBlobRef m_ref{};
+};
+
+} // namespace clipx
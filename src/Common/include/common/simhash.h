@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace clipx {
+
+// 64-bit SimHash similarity fingerprints. Whitespace runs are ignored and
+// all digits read alike, so re-copies that differ in indentation, a trailing
+// newline or a timestamp get the same fingerprint, a changed word a nearly
+// equal one, while unrelated texts end up about 32 bits apart.
+namespace simhash {
+
+// Texts shorter than this (after normalization) get no fingerprint; small
+// edits change too large a share of their features to measure similarity
+constexpr size_t MIN_TEXT_LENGTH = 32;
+
+// Only this much of a text is fingerprinted, which bounds the capture cost
+constexpr size_t MAX_TEXT_LENGTH = 256 * 1024;
+
+// Returns 0 ("no fingerprint") for texts below MIN_TEXT_LENGTH.
+// Leading and trailing whitespace is dropped, inner runs collapse to one
+// space and every digit becomes '0' before hashing the text's overlapping
+// 4-byte shingles; case is kept. Each distinct shingle is one feature,
+// however often it repeats.
+uint64_t Compute(const char* text, size_t size);
+
+inline uint64_t Compute(const std::vector<uint8_t>& data) {
+    return Compute(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+inline int Distance(uint64_t a, uint64_t b) {
+    uint64_t x = a ^ b;
+    int count = 0;
+    while (x) {
+        x &= x - 1;
+        count++;
+    }
+    return count;
+}
+
+} // namespace simhash
+
+// LSH index over fingerprints. The 64 bits are split into BANDS bands, and
+// two fingerprints within MAX_DISTANCE bits agree on at least one whole band
+// (pigeonhole), so a lookup only compares against entries sharing a band:
+// O(1) expected instead of a scan. Not thread-safe.
+class SimHashIndex {
+public:
+    static constexpr int BANDS = 4;
+    static constexpr int MAX_DISTANCE = BANDS - 1;
+
+    void Add(int64_t id, uint64_t fingerprint);
+    void Remove(int64_t id);
+    void Clear();
+
+    // Closest indexed id within maxDistance (clamped to MAX_DISTANCE) bits,
+    // excluding `exclude`
+    std::optional<int64_t> FindNearest(uint64_t fingerprint, int maxDistance,
+                                       std::optional<int64_t> exclude = std::nullopt) const;
+
+    size_t Size() const { return m_fingerprints.size(); }
+
+private:
+    static uint32_t BandKey(uint64_t fingerprint, int band) {
+        return (static_cast<uint32_t>(band) << 16) | static_cast<uint32_t>((fingerprint >> (band * 16)) & 0xFFFF);
+    }
+
+    std::unordered_map<int64_t, uint64_t> m_fingerprints;
+    std::unordered_map<uint32_t, std::vector<int64_t>> m_buckets;
+};
+
+} // namespace clipx
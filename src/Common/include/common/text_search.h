@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace clipx {
+namespace text {
+
+constexpr size_t NOT_FOUND = static_cast<size_t>(-1);
+
+// Find needle in haystack, ignoring ASCII case (same rules as SQLite LIKE).
+// The needle must already be lowercased. Non-ASCII bytes compare exactly.
+// Returns the byte offset of the first match or NOT_FOUND.
+size_t FindCaseInsensitive(const uint8_t* haystack, size_t size, const std::string& needleLower);
+
+} // namespace text
+} // namespace clipx
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <thread>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+namespace clipx {
+
+// Fixed-size worker pool. Threads are created once and reused for every task.
+class ThreadPool {
+public:
+    // threadCount == 0 picks hardware_concurrency (at least 1)
+    explicit ThreadPool(size_t threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Queue a task for execution on a worker thread
+    void Submit(std::function<void()> task);
+
+    // Run fn(0..count-1) across the pool and the calling thread, block until done
+    void ParallelFor(size_t count, const std::function<void(size_t)>& fn);
+
+    size_t Size() const { return m_threads.size(); }
+
+private:
+    void WorkerLoop();
+
+    std::vector<std::thread> m_threads;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_stopping = false;
+};
+
+} // namespace clipx
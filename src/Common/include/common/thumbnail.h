@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace clipx {
+namespace image {
+
+// Longest side of the thumbnails stored with image entries. At 32 bpp one
+// is at most 48 * 48 * 4 bytes plus its header, about 9 KB.
+constexpr int THUMBNAIL_MAX_SIDE = 48;
+
+// A packed DIB (CF_DIB: BITMAPINFOHEADER or a V4/V5 header, optional masks
+// and color table, then the pixels) as read by ParseDib. Points into the
+// buffer it was parsed from.
+struct DibInfo {
+    int width = 0;
+    int height = 0;                 // Always positive
+    bool topDown = false;
+    int bitCount = 0;               // 1, 4, 8, 16, 24 or 32
+    uint32_t masks[4] = {};         // Red, green, blue, alpha; 16 and 32 bpp
+    const uint8_t* palette = nullptr;  // RGBQUADs, 1/4/8 bpp
+    uint32_t paletteSize = 0;
+    const uint8_t* bits = nullptr;
+    size_t stride = 0;              // Bytes per row, DWORD aligned
+};
+
+// Validates the header against `size`; false for compressed (RLE, JPEG,
+// PNG) or malformed DIBs. Every row it reports lies inside the buffer.
+bool ParseDib(const uint8_t* data, size_t size, DibInfo& info);
+
+// Box-filtered downscale to `width` x `height` (each at most the source's):
+// every target pixel is the mean of the source pixels it covers. Reads the
+// DIB a row at a time, without decoding it whole. Returns top-down BGRA
+// rows; alpha is 255 unless the DIB has an alpha mask.
+std::vector<uint8_t> ScaleDib(const DibInfo& info, int width, int height);
+
+// 32 bpp top-down DIB (BITMAPINFOHEADER + BGRA rows) fitting the image in
+// maxSide x maxSide with its aspect ratio, or empty if `dib` can't be read.
+// Images already that small are converted, not scaled.
+std::vector<uint8_t> MakeThumbnail(const uint8_t* dib, size_t size, int maxSide = THUMBNAIL_MAX_SIDE);
+
+} // namespace image
+} // namespace clipx
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace clipx {
+namespace trace {
+
+// Where a span sits in a trace that may cross processes: the trace it
+// belongs to and the span (or hop, for a message in flight) it hangs off
+struct Context {
+    uint64_t traceId = 0;
+    uint64_t spanId = 0;
+
+    bool Valid() const { return traceId != 0; }
+};
+
+// "<trace>-<span>" in hex, as sent in IPC requests and on the Overlay
+// command line
+std::string FormatContext(const Context& context);
+bool ParseContext(const std::string& text, Context& context);
+
+extern std::atomic<bool> g_enabled;
+
+// The one check a disabled span costs
+inline bool Enabled() { return g_enabled.load(std::memory_order_relaxed); }
+
+// Starts recording; events are appended to `path` in the Chrome trace
+// event format (JSON array, left open so that several processes and
+// restarts can append to one file; chrome://tracing and Perfetto accept
+// it). `append` keeps what the file holds, else it is truncated.
+bool Start(const std::string& path, const char* processName, bool append);
+
+// Stops recording and writes out what is buffered
+void Stop();
+
+// Writes out what every thread has buffered. A background thread does
+// this about once a second while tracing runs.
+void Flush();
+
+// Shown for the calling thread's events. `name` must outlive the process
+// (a literal); cheap enough to call whether tracing runs or not.
+void SetThreadName(const char* name);
+
+// The innermost open span of the calling thread, if any
+Context Current();
+
+// For a message about to leave the process inside the current span:
+// records the start of the hop and returns the context to send with it.
+// Invalid (send nothing) when tracing is off or no span is open.
+Context Inject();
+
+// A point in time on the calling thread, e.g. the first paint
+void Instant(const char* name);
+
+// Times the scope it lives in. Spans nest per thread; one opened with the
+// context of a message from another process continues that trace and is
+// linked to the sender's span. `name` must outlive the process.
+class Span {
+public:
+    explicit Span(const char* name) {
+        if (Enabled()) Begin(name, nullptr);
+    }
+
+    Span(const char* name, const Context& remote) {
+        if (Enabled()) Begin(name, &remote);
+    }
+
+    ~Span() {
+        if (m_name) End();
+    }
+
+    // Sets the remote parent of a span opened before it was known (the
+    // request is decoded inside the span that reads it)
+    void Adopt(const Context& remote);
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+private:
+    void Begin(const char* name, const Context* remote);
+    void End();
+
+    const char* m_name = nullptr;  // Null: not recording
+    uint64_t m_start = 0;
+    uint64_t m_parentId = 0;
+    Context m_context;
+    Context m_outer;  // Restored as the thread's current span on End
+};
+
+} // namespace trace
+} // namespace clipx
+
+#define CLIPX_TRACE_CONCAT_(a, b) a##b
+#define CLIPX_TRACE_CONCAT(a, b) CLIPX_TRACE_CONCAT_(a, b)
+
+// Times the rest of the enclosing scope as `name`
+#define CLIPX_TRACE_SPAN(name) clipx::trace::Span CLIPX_TRACE_CONCAT(clipxTraceSpan, __LINE__)(name)
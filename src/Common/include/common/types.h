@@ -30,6 +30,8 @@ struct ClipboardEntry {
     bool isFavorited = false;
     bool isTagged = false;
     std::vector<std::string> tags;
+    uint64_t simhash = 0;  // Similarity fingerprint of text entries, 0 = none
+    std::vector<uint8_t> thumbnail;  // Image entries: small DIB (common/thumbnail.h), empty if none
 
     ClipboardEntry() = default;
 
@@ -39,6 +41,35 @@ struct ClipboardEntry {
     ClipboardEntry& operator=(ClipboardEntry&&) = default;
 };
 
+// A change to the stored history, pushed to subscribed clients. Only the
+// members used by `kind` are meaningful; updates carry just the fields that
+// changed.
+struct EntryChange {
+    enum class Kind {
+        Inserted,     // `entry` is new (without its payload)
+        Updated,      // `id` changed in the set optional fields
+        Deleted,      // `ids`, or every match of `olderThan` / `allPersisted`
+        TagsChanged   // `id` now has exactly `tags`
+    } kind = Kind::Updated;
+
+    int64_t seq = 0;  // Position in DataManager's change sequence, set when published
+    int64_t id = 0;
+    ClipboardEntry entry;
+
+    std::optional<int64_t> newId;  // Memory entry persisted under a database id
+    std::optional<int64_t> timestamp;
+    std::optional<std::string> preview;
+    std::optional<std::string> sourceApp;
+    std::optional<int32_t> copyCount;
+    std::optional<bool> isFavorited;
+
+    std::vector<int64_t> ids;
+    std::optional<int64_t> olderThan;  // Unfavorited database entries with an older timestamp
+    bool allPersisted = false;         // Every database entry; memory entries stay
+
+    std::vector<std::string> tags;
+};
+
 // Query options for history retrieval
 struct QueryOptions {
     int limit = 100;
@@ -61,6 +92,18 @@ struct DatabaseStats {
     size_t totalSize = 0;
 };
 
+// Deep search statistics (full payload scan)
+struct DeepSearchStats {
+    uint64_t bytesScanned = 0;
+    size_t entriesScanned = 0;
+    double elapsedMs = 0.0;
+    bool cancelled = false;
+
+    double ThroughputGBps() const {
+        return elapsedMs > 0.0 ? (bytesScanned / 1e9) / (elapsedMs / 1000.0) : 0.0;
+    }
+};
+
 // Utility functions for type conversion
 inline std::string ClipboardDataTypeToString(ClipboardDataType type) {
     switch (type) {
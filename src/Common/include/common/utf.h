@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace clipx {
+namespace utf {
+
+// Transcoding between UTF-8 and UTF-16/UTF-32 in one pass: the caller
+// sizes the output with the Max* bound, converts, then trims to the
+// returned length (the vector paths may write scratch past it, within the
+// bound). wchar_t is UTF-16 on Windows and UTF-32 elsewhere.
+//
+// Input is validated as it is converted. Unpaired surrogates and
+// malformed, overlong, surrogate or out-of-range UTF-8 become U+FFFD, one
+// per maximal invalid subpart (as MultiByteToWideChar and browsers do);
+// `valid`, if given, says whether there were any.
+
+constexpr size_t MaxUtf8ForUtf16(size_t units) { return units * 3; }  // A surrogate pair is 4 bytes
+constexpr size_t MaxUtf8ForUtf32(size_t units) { return units * 4; }
+constexpr size_t MaxUtf16ForUtf8(size_t bytes) { return bytes; }
+constexpr size_t MaxUtf32ForUtf8(size_t bytes) { return bytes; }
+constexpr size_t MaxUtf8ForWide(size_t units) {
+    return sizeof(wchar_t) == 2 ? MaxUtf8ForUtf16(units) : MaxUtf8ForUtf32(units);
+}
+constexpr size_t MaxWideForUtf8(size_t bytes) { return bytes; }
+
+size_t Utf16ToUtf8(const char16_t* in, size_t size, char* out, bool* valid = nullptr);
+size_t Utf32ToUtf8(const char32_t* in, size_t size, char* out, bool* valid = nullptr);
+size_t WideToUtf8(const wchar_t* in, size_t size, char* out, bool* valid = nullptr);
+
+size_t Utf8ToUtf16(const char* in, size_t size, char16_t* out, bool* valid = nullptr);
+size_t Utf8ToUtf32(const char* in, size_t size, char32_t* out, bool* valid = nullptr);
+size_t Utf8ToWide(const char* in, size_t size, wchar_t* out, bool* valid = nullptr);
+
+bool ValidateUtf8(const char* data, size_t size);
+
+} // namespace utf
+} // namespace clipx
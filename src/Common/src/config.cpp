@@ -40,12 +40,15 @@ void Config::SetDefaults() {
             {"close_on_select", true},
             {"paste_after_select", true},
             {"smart_sort", true},
-            {"deduplicate", true}
+            {"deduplicate", true},
+            {"collapse_near_duplicates", false},
+            {"near_duplicate_distance", 3}
         }},
         {"advanced", {
             {"log_level", "info"},
             {"log_file", "logs/clipx.log"},
-            {"db_file", "clipx.db"}
+            {"db_file", "clipx.db"},
+            {"trace", false}
         }}
     };
 }
@@ -0,0 +1,375 @@
+#include "common/history_snapshot.h"
+#include "common/logger.h"
+#include "common/trace.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+namespace clipx {
+
+namespace {
+
+constexpr uint32_t SNAPSHOT_MAGIC = 0x53535843;  // "CXSS"
+constexpr size_t SLOT_SIZE = 1024 * 1024;  // Room for a page of rows with thumbnails
+constexpr size_t REGION_HEADER_SIZE = 64;
+constexpr size_t REGION_SIZE = REGION_HEADER_SIZE + 2 * SLOT_SIZE;
+
+// A reader gives up after this many slot switches in a row
+constexpr int MAX_READ_ATTEMPTS = 8;
+
+// Start of the region. The generation is odd while the writer switches slots.
+struct RegionHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t generation;
+    uint32_t activeSlot;
+    uint32_t slotSize;
+    uint32_t length[2];  // Bytes used in each slot, 0 = never written
+};
+static_assert(sizeof(RegionHeader) <= REGION_HEADER_SIZE);
+
+// Payload layout, see EncodeHistorySnapshot
+struct StringRef {
+    uint32_t offset;  // Into the string pool
+    uint32_t length;
+};
+
+struct PayloadHeader {
+    int64_t changeSeq;
+    uint32_t entryCount;
+    uint32_t tagCount;
+    uint32_t entryTagCount;  // Tag references of all entries together
+    uint32_t stringsSize;
+};
+
+struct EntryRecord {
+    int64_t id;
+    int64_t timestamp;
+    int32_t type;
+    int32_t copyCount;
+    uint32_t flags;
+    uint32_t firstTag;  // Index into the entry tag references
+    uint32_t tagCount;
+    uint32_t reserved;
+    StringRef preview;
+    StringRef sourceApp;
+    StringRef thumbnail;  // Empty if none, or it didn't fit
+};
+
+struct TagRecord {
+    StringRef name;
+    int32_t count;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(PayloadHeader) == 24);
+static_assert(sizeof(EntryRecord) == 64);
+static_assert(sizeof(TagRecord) == 16);
+
+constexpr uint32_t FLAG_FAVORITED = 1;
+constexpr uint32_t FLAG_TAGGED = 2;
+
+size_t EntrySize(const ClipboardEntry& entry) {
+    size_t size = sizeof(EntryRecord) + entry.preview.size() + entry.sourceApp.size();
+    for (const auto& tag : entry.tags) {
+        size += sizeof(StringRef) + tag.size();
+    }
+    return size;
+}
+
+// Appends records and strings at their final offsets
+class PayloadBuilder {
+public:
+    PayloadBuilder(std::vector<uint8_t>& out, size_t stringsStart) : m_out(out), m_stringsStart(stringsStart) {}
+
+    template<typename Record>
+    void Put(size_t& offset, const Record& record) {
+        std::memcpy(m_out.data() + offset, &record, sizeof(Record));
+        offset += sizeof(Record);
+    }
+
+    template<typename Bytes>
+    StringRef String(const Bytes& value) {
+        StringRef ref{static_cast<uint32_t>(m_out.size() - m_stringsStart), static_cast<uint32_t>(value.size())};
+        m_out.insert(m_out.end(), value.begin(), value.end());
+        return ref;
+    }
+
+private:
+    std::vector<uint8_t>& m_out;
+    size_t m_stringsStart;
+};
+
+template<typename Record>
+Record Get(const uint8_t* data, size_t offset) {
+    Record record;
+    std::memcpy(&record, data + offset, sizeof(Record));
+    return record;
+}
+
+template<typename Bytes>
+bool ReadString(const uint8_t* strings, uint32_t stringsSize, StringRef ref, Bytes& value) {
+    if (ref.offset > stringsSize || ref.length > stringsSize - ref.offset) {
+        return false;
+    }
+    value.assign(strings + ref.offset, strings + ref.offset + ref.length);
+    return true;
+}
+
+// The generation word is rewritten by the writer while readers look at it
+uint64_t LoadGeneration(const RegionHeader* header) {
+    uint64_t generation = *reinterpret_cast<const volatile uint64_t*>(&header->generation);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return generation;
+}
+
+uint64_t RecheckGeneration(const RegionHeader* header) {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return *reinterpret_cast<const volatile uint64_t*>(&header->generation);
+}
+
+void StoreGeneration(RegionHeader* header, uint64_t generation) {
+    std::atomic_thread_fence(std::memory_order_release);
+    *reinterpret_cast<volatile uint64_t*>(&header->generation) = generation;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+} // namespace
+
+std::string DefaultHistorySnapshotName() {
+#ifdef _WIN32
+    return "Local\\ClipX_HistorySnapshot";
+#else
+    return "/clipx_snapshot_" + std::to_string(::getuid());
+#endif
+}
+
+int EncodeHistorySnapshot(const HistorySnapshot& snapshot, size_t capacity, std::vector<uint8_t>& out) {
+    capacity = std::min<size_t>(capacity, UINT32_MAX);  // Offsets are 32-bit
+    size_t size = sizeof(PayloadHeader);
+    for (const auto& [name, count] : snapshot.tags) {
+        size += sizeof(TagRecord) + name.size();
+    }
+    if (size > capacity) {
+        return -1;
+    }
+
+    size_t entryCount = 0;
+    size_t entryTagCount = 0;
+    for (const auto& entry : snapshot.entries) {
+        size_t entrySize = EntrySize(entry);
+        if (entrySize > capacity - size) {
+            break;
+        }
+        size += entrySize;
+        entryTagCount += entry.tags.size();
+        entryCount++;
+    }
+
+    // Thumbnails take what the rows left, newest first: a row is never
+    // dropped for one
+    std::vector<bool> withThumbnail(entryCount, false);
+    for (size_t i = 0; i < entryCount; i++) {
+        size_t thumbnailSize = snapshot.entries[i].thumbnail.size();
+        if (thumbnailSize > 0 && thumbnailSize <= capacity - size) {
+            withThumbnail[i] = true;
+            size += thumbnailSize;
+        }
+    }
+
+    size_t stringsStart = sizeof(PayloadHeader) + entryCount * sizeof(EntryRecord) +
+                          snapshot.tags.size() * sizeof(TagRecord) + entryTagCount * sizeof(StringRef);
+    out.assign(stringsStart, 0);
+    out.reserve(size);
+    PayloadBuilder builder(out, stringsStart);
+
+    PayloadHeader header{};
+    header.changeSeq = snapshot.changeSeq;
+    header.entryCount = static_cast<uint32_t>(entryCount);
+    header.tagCount = static_cast<uint32_t>(snapshot.tags.size());
+    header.entryTagCount = static_cast<uint32_t>(entryTagCount);
+    header.stringsSize = static_cast<uint32_t>(size - stringsStart);
+    size_t offset = 0;
+    builder.Put(offset, header);
+
+    size_t entryTagOffset = stringsStart - entryTagCount * sizeof(StringRef);
+    uint32_t firstTag = 0;
+    for (size_t i = 0; i < entryCount; i++) {
+        const ClipboardEntry& entry = snapshot.entries[i];
+        EntryRecord record{};
+        record.id = entry.id;
+        record.timestamp = entry.timestamp;
+        record.type = static_cast<int32_t>(entry.type);
+        record.copyCount = entry.copyCount;
+        record.flags = (entry.isFavorited ? FLAG_FAVORITED : 0) | (entry.isTagged ? FLAG_TAGGED : 0);
+        record.firstTag = firstTag;
+        record.tagCount = static_cast<uint32_t>(entry.tags.size());
+        record.preview = builder.String(entry.preview);
+        record.sourceApp = builder.String(entry.sourceApp);
+        if (withThumbnail[i]) {
+            record.thumbnail = builder.String(entry.thumbnail);
+        }
+        builder.Put(offset, record);
+
+        for (const auto& tag : entry.tags) {
+            builder.Put(entryTagOffset, builder.String(tag));
+        }
+        firstTag += record.tagCount;
+    }
+
+    for (const auto& [name, count] : snapshot.tags) {
+        TagRecord record{};
+        record.name = builder.String(name);
+        record.count = count;
+        builder.Put(offset, record);
+    }
+    return static_cast<int>(entryCount);
+}
+
+bool DecodeHistorySnapshot(const uint8_t* data, size_t size, HistorySnapshot& snapshot) {
+    if (size < sizeof(PayloadHeader)) {
+        return false;
+    }
+    auto header = Get<PayloadHeader>(data, 0);
+
+    // 64-bit sums of 32-bit counts can't overflow
+    uint64_t stringsStart = sizeof(PayloadHeader) + uint64_t(header.entryCount) * sizeof(EntryRecord) +
+                            uint64_t(header.tagCount) * sizeof(TagRecord) +
+                            uint64_t(header.entryTagCount) * sizeof(StringRef);
+    if (stringsStart + header.stringsSize != size) {
+        return false;
+    }
+    const uint8_t* strings = data + stringsStart;
+    size_t entryTagOffset = static_cast<size_t>(stringsStart) - header.entryTagCount * sizeof(StringRef);
+
+    snapshot.changeSeq = header.changeSeq;
+    snapshot.entries.clear();
+    snapshot.entries.reserve(header.entryCount);
+    snapshot.tags.clear();
+    snapshot.tags.reserve(header.tagCount);
+
+    size_t offset = sizeof(PayloadHeader);
+    for (uint32_t i = 0; i < header.entryCount; i++, offset += sizeof(EntryRecord)) {
+        auto record = Get<EntryRecord>(data, offset);
+        if (record.firstTag > header.entryTagCount || record.tagCount > header.entryTagCount - record.firstTag) {
+            return false;
+        }
+
+        ClipboardEntry& entry = snapshot.entries.emplace_back();
+        entry.id = record.id;
+        entry.timestamp = record.timestamp;
+        entry.type = static_cast<ClipboardDataType>(record.type);
+        entry.copyCount = record.copyCount;
+        entry.isFavorited = (record.flags & FLAG_FAVORITED) != 0;
+        entry.isTagged = (record.flags & FLAG_TAGGED) != 0;
+        if (!ReadString(strings, header.stringsSize, record.preview, entry.preview) ||
+            !ReadString(strings, header.stringsSize, record.sourceApp, entry.sourceApp) ||
+            !ReadString(strings, header.stringsSize, record.thumbnail, entry.thumbnail)) {
+            return false;
+        }
+        entry.tags.resize(record.tagCount);
+        for (uint32_t t = 0; t < record.tagCount; t++) {
+            auto ref = Get<StringRef>(data, entryTagOffset + (record.firstTag + t) * sizeof(StringRef));
+            if (!ReadString(strings, header.stringsSize, ref, entry.tags[t])) {
+                return false;
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < header.tagCount; i++, offset += sizeof(TagRecord)) {
+        auto record = Get<TagRecord>(data, offset);
+        auto& [name, count] = snapshot.tags.emplace_back();
+        if (!ReadString(strings, header.stringsSize, record.name, name)) {
+            return false;
+        }
+        count = record.count;
+    }
+    return true;
+}
+
+bool HistorySnapshotWriter::Create(const std::string& name) {
+    m_memory = CreateNamedSharedMemory(name, REGION_SIZE);
+    if (!m_memory) {
+        return false;
+    }
+
+    // Fresh regions are zero-filled: generation 0, nothing published yet
+    auto* header = reinterpret_cast<RegionHeader*>(m_memory->Data());
+    header->version = HISTORY_SNAPSHOT_VERSION;
+    header->slotSize = static_cast<uint32_t>(SLOT_SIZE);
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = SNAPSHOT_MAGIC;
+    return true;
+}
+
+bool HistorySnapshotWriter::Publish(const HistorySnapshot& snapshot) {
+    CLIPX_TRACE_SPAN("snapshot.publish");
+    if (!m_memory) {
+        return false;
+    }
+
+    int written = EncodeHistorySnapshot(snapshot, SLOT_SIZE, m_buffer);
+    if (written < 0) {
+        LOG_WARN("History snapshot: tag list exceeds " + std::to_string(SLOT_SIZE) + " bytes");
+        return false;
+    }
+    if (static_cast<size_t>(written) < snapshot.entries.size()) {
+        LOG_DEBUG("History snapshot holds " + std::to_string(written) + " of " +
+                  std::to_string(snapshot.entries.size()) + " entries");
+    }
+
+    // Readers only look at the active slot, so the other one is free
+    auto* header = reinterpret_cast<RegionHeader*>(m_memory->Data());
+    uint32_t slot = header->activeSlot ^ 1;
+    std::memcpy(m_memory->Data() + REGION_HEADER_SIZE + slot * SLOT_SIZE, m_buffer.data(), m_buffer.size());
+
+    uint64_t generation = header->generation;
+    StoreGeneration(header, generation + 1);
+    header->length[slot] = static_cast<uint32_t>(m_buffer.size());
+    header->activeSlot = slot;
+    StoreGeneration(header, generation + 2);
+    return true;
+}
+
+bool ReadHistorySnapshot(const std::string& name, HistorySnapshot& snapshot) {
+    CLIPX_TRACE_SPAN("snapshot.read");
+    auto memory = OpenSharedMemory(name, REGION_SIZE);
+    if (!memory) {
+        return false;
+    }
+
+    const auto* header = reinterpret_cast<const RegionHeader*>(memory->Data());
+    if (header->magic != SNAPSHOT_MAGIC || header->version != HISTORY_SNAPSHOT_VERSION ||
+        header->slotSize != SLOT_SIZE) {
+        LOG_WARN("History snapshot has an unknown layout");
+        return false;
+    }
+
+    // A slot is only rewritten after the writer switched away from it, which
+    // changes the generation: an unchanged one means the copy is intact
+    std::vector<uint8_t> payload;
+    for (int attempt = 0; attempt < MAX_READ_ATTEMPTS; attempt++) {
+        uint64_t generation = LoadGeneration(header);
+        if (generation & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        uint32_t slot = header->activeSlot & 1;
+        uint32_t length = std::min<uint32_t>(header->length[slot], SLOT_SIZE);
+        const uint8_t* data = memory->Data() + REGION_HEADER_SIZE + slot * SLOT_SIZE;
+        payload.assign(data, data + length);
+
+        if (RecheckGeneration(header) == generation) {
+            return length != 0 && DecodeHistorySnapshot(payload.data(), payload.size(), snapshot);
+        }
+    }
+    LOG_DEBUG("History snapshot kept changing while read");
+    return false;
+}
+
+} // namespace clipx
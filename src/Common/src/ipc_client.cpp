@@ -0,0 +1,334 @@
+#include "common/ipc_client.h"
+#include "common/logger.h"
+#include "common/trace.h"
+#include <algorithm>
+
+namespace clipx {
+
+namespace {
+
+// How often the reader thread checks request deadlines while the
+// connection is quiet
+constexpr int READER_TICK_MS = 50;
+
+} // namespace
+
+IPCClient::IPCClient() = default;
+
+IPCClient::~IPCClient() {
+    Disconnect();
+}
+
+bool IPCClient::Connect(const std::string& address, int timeoutMs) {
+    if (m_connected) {
+        return true;
+    }
+    Disconnect();  // Reap the reader of a connection that was lost
+
+    CLIPX_TRACE_SPAN("ipc.connect");
+    m_connection = ConnectIPC(address, timeoutMs);
+    if (!m_connection) {
+        return false;
+    }
+
+    m_codec = IPCCodec::Json;
+    m_connected = true;
+    m_readerThread = std::thread(&IPCClient::ReaderLoop, this);
+    NegotiateCodec();
+    LOG_INFO("Connected to IPC server: " + address + " (" + CodecName(m_codec) + ")");
+    return true;
+}
+
+void IPCClient::Disconnect() {
+    if (m_connection) {
+        m_connection->Close();
+    }
+    if (m_readerThread.joinable()) {
+        m_readerThread.join();
+    }
+    m_connected = false;
+    FailAll("Disconnected");
+    m_connection.reset();
+}
+
+void IPCClient::NegotiateCodec() {
+    if (m_preferredCodec == IPCCodec::Json) {
+        return;
+    }
+
+    // Older servers answer PING without "codecs" and keep talking JSON
+    IPCRequest request;
+    request.action = IPCAction::PING;
+    IPCResponse response = SendRequest(request);
+    if (!response.success || !response.data.contains("codecs") || !response.data["codecs"].is_array()) {
+        return;
+    }
+
+    for (const auto& name : response.data["codecs"]) {
+        IPCCodec codec;
+        if (name.is_string() && CodecFromName(name.get<std::string>(), codec) && codec == m_preferredCodec) {
+            m_codec = codec;
+            return;
+        }
+    }
+}
+
+std::future<IPCResponse> IPCClient::SendAsync(IPCRequest request, int timeoutMs) {
+    PendingRequest pending;
+    pending.deadline = timeoutMs < 0 ? Clock::time_point::max() : Clock::now() + std::chrono::milliseconds(timeoutMs);
+    std::future<IPCResponse> future = pending.promise.get_future();
+    Submit(request, std::move(pending));
+    return future;
+}
+
+int32_t IPCClient::SendAsync(IPCRequest request, ResponseCallback callback, int timeoutMs) {
+    PendingRequest pending;
+    pending.callback = std::move(callback);
+    pending.deadline = timeoutMs < 0 ? Clock::time_point::max() : Clock::now() + std::chrono::milliseconds(timeoutMs);
+    return Submit(request, std::move(pending));
+}
+
+IPCResponse IPCClient::SendRequest(IPCRequest request, int timeoutMs) {
+    CLIPX_TRACE_SPAN("ipc.request");
+    return SendAsync(std::move(request), timeoutMs).get();
+}
+
+bool IPCClient::FetchEntryData(int64_t id, const DataVisitor& visitor, int timeoutMs) {
+    IPCRequest request;
+    request.action = IPCAction::GET_ENTRY;
+    request.params = {{"id", id}, {"with_data", true}};
+    IPCResponse response = SendRequest(request, timeoutMs);
+    if (!response.success) {
+        return false;
+    }
+    if (!response.data.contains("blob")) {
+        visitor(nullptr, 0);  // Empty payload
+        return true;
+    }
+
+    auto ref = JsonToSharedBlobRef(response.data["blob"]);
+    if (!ref) {
+        LOG_ERROR("Invalid shared blob reference");
+        return false;
+    }
+
+    SharedBlobView view;
+    bool valid = view.Open(*ref);
+    if (valid) {
+        visitor(view.Data(), view.Size());
+        valid = view.IsValid();
+    }
+    view.Close();
+
+    // Nobody waits for the answer; an expired lease is already gone
+    IPCRequest release;
+    release.action = IPCAction::RELEASE_BLOB;
+    release.params = {{"lease", ref->lease}};
+    SendAsync(std::move(release));
+
+    if (!valid) {
+        LOG_WARN("Shared blob reclaimed before it was read: entry " + std::to_string(id));
+    }
+    return valid;
+}
+
+int32_t IPCClient::Submit(IPCRequest& request, PendingRequest pending) {
+    CLIPX_TRACE_SPAN("ipc.send");
+    if (request.requestId == 0) {
+        request.requestId = NextRequestId();
+    }
+    int32_t requestId = request.requestId;
+
+    if (!m_connected) {
+        Deliver(pending, IPCResponse::Error(requestId, "Not connected", IPCError::IPC_CONNECTION_FAILED));
+        return requestId;
+    }
+
+    // Serialize request; while tracing, ClipD's spans continue ours
+    if (!request.trace.Valid()) {
+        request.trace = trace::Inject();
+    }
+    IPCCodec codec = m_codec;
+    std::vector<uint8_t> requestData;
+    EncodeRequest(request, codec, requestData);
+
+    // Registered before writing: the response may beat WriteMessage's return
+    {
+        std::lock_guard<std::mutex> lock(m_pendingMutex);
+        if (m_pending.count(requestId) != 0) {
+            LOG_ERROR("Request id already in flight: " + std::to_string(requestId));
+            Deliver(pending, IPCResponse::Error(requestId, "Duplicate request id", IPCError::IPC_INVALID_REQUEST));
+            return requestId;
+        }
+        m_pending.emplace(requestId, std::move(pending));
+    }
+    if (!m_connected) {
+        // Lost after the check above; FailAll may already have run
+        Complete(requestId, IPCResponse::Error(requestId, "Not connected", IPCError::IPC_CONNECTION_FAILED));
+        return requestId;
+    }
+
+    // Send request
+    bool sent;
+    {
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        sent = m_connection->WriteMessage(requestData, codec);
+    }
+    if (!sent) {
+        LOG_ERROR("Failed to send request");
+        Complete(requestId, IPCResponse::Error(requestId, "Failed to send request", IPCError::IPC_CONNECTION_FAILED));
+    }
+    return requestId;
+}
+
+void IPCClient::ReaderLoop() {
+    trace::SetThreadName("ipc reader");
+    std::vector<uint8_t> data;
+    while (true) {
+        if (!m_connection->WaitReadable(READER_TICK_MS)) {
+            ExpireRequests();
+            continue;
+        }
+
+        IPCCodec codec;
+        if (!m_connection->IsOpen() || !m_connection->ReadMessage(data, codec)) {
+            break;
+        }
+
+        IPCServerMessage message;
+        bool decoded;
+        {
+            CLIPX_TRACE_SPAN("ipc.decode");
+            decoded = DecodeServerMessage(data.data(), data.size(), codec, message);
+        }
+        if (!decoded) {
+            LOG_ERROR("Failed to parse server message");
+            break;  // Framing can't be trusted any more
+        }
+
+        if (message.isNotification) {
+            QueueNotification(std::move(message.notification));
+        } else {
+            Complete(message.response.requestId, std::move(message.response));
+        }
+        ExpireRequests();
+    }
+
+    if (m_connected.exchange(false)) {
+        LOG_WARN("IPC connection lost");
+    }
+    FailAll("Connection lost");
+}
+
+void IPCClient::QueueNotification(IPCNotification notification) {
+    {
+        std::lock_guard<std::mutex> lock(m_deliveryMutex);
+        if (m_queuedNotifications == MAX_QUEUED_NOTIFICATIONS) {
+            // Nobody is polling; a gap in change events would leave the
+            // client's model silently wrong, so ask it to reload instead
+            LOG_WARN("Notification queue full, replacing it with resync");
+            m_deliveries.erase(std::remove_if(m_deliveries.begin(), m_deliveries.end(),
+                                              [](const Delivery& delivery) { return !delivery.callback; }),
+                               m_deliveries.end());
+            notification = IPCNotification();
+            notification.event = IPCEvent::RESYNC;
+            notification.data = nlohmann::json::object();
+            m_queuedNotifications = 0;
+        }
+        Delivery delivery;
+        delivery.notification = std::move(notification);
+        m_deliveries.push_back(std::move(delivery));
+        m_queuedNotifications++;
+    }
+    Wake();
+}
+
+void IPCClient::Complete(int32_t requestId, IPCResponse response) {
+    PendingRequest pending;
+    {
+        std::lock_guard<std::mutex> lock(m_pendingMutex);
+        auto it = m_pending.find(requestId);
+        if (it == m_pending.end()) {
+            LOG_DEBUG("Dropping response to unknown or expired request " + std::to_string(requestId));
+            return;
+        }
+        pending = std::move(it->second);
+        m_pending.erase(it);
+    }
+    Deliver(pending, std::move(response));
+}
+
+void IPCClient::Deliver(PendingRequest& pending, IPCResponse response) {
+    if (!pending.callback) {
+        pending.promise.set_value(std::move(response));
+        return;
+    }
+
+    Delivery delivery;
+    delivery.callback = std::move(pending.callback);
+    delivery.response = std::move(response);
+    {
+        std::lock_guard<std::mutex> lock(m_deliveryMutex);
+        m_deliveries.push_back(std::move(delivery));
+    }
+    Wake();
+}
+
+void IPCClient::Wake() {
+    if (m_wake && !m_wakePending.exchange(true)) {
+        m_wake();
+    }
+}
+
+void IPCClient::ExpireRequests() {
+    auto now = Clock::now();
+    std::vector<std::pair<int32_t, PendingRequest>> expired;
+    {
+        std::lock_guard<std::mutex> lock(m_pendingMutex);
+        for (auto it = m_pending.begin(); it != m_pending.end();) {
+            if (it->second.deadline <= now) {
+                expired.emplace_back(it->first, std::move(it->second));
+                it = m_pending.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    for (auto& [requestId, pending] : expired) {
+        LOG_WARN("Request " + std::to_string(requestId) + " timed out");
+        Deliver(pending, IPCResponse::Error(requestId, "Request timed out", IPCError::IPC_TIMEOUT));
+    }
+}
+
+void IPCClient::FailAll(const std::string& error) {
+    std::unordered_map<int32_t, PendingRequest> pending;
+    {
+        std::lock_guard<std::mutex> lock(m_pendingMutex);
+        pending.swap(m_pending);
+    }
+    for (auto& [requestId, request] : pending) {
+        Deliver(request, IPCResponse::Error(requestId, error, IPCError::IPC_CONNECTION_FAILED));
+    }
+}
+
+void IPCClient::PollNotifications(const NotificationHandler& handler) {
+    m_wakePending = false;
+    std::deque<Delivery> deliveries;
+    {
+        std::lock_guard<std::mutex> lock(m_deliveryMutex);
+        deliveries.swap(m_deliveries);
+        m_queuedNotifications = 0;
+    }
+
+    // Handlers may send requests, whose callbacks wait for the next poll
+    for (auto& delivery : deliveries) {
+        if (delivery.callback) {
+            delivery.callback(delivery.response);
+        } else {
+            handler(delivery.notification);
+        }
+    }
+}
+
+} // namespace clipx
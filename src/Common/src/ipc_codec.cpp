@@ -0,0 +1,813 @@
+#include "common/ipc_codec.h"
+#include "common/json_stream.h"
+#include "common/msgpack.h"
+#include "common/logger.h"
+#include "common/utils.h"
+#include <algorithm>
+#include <cstring>
+
+namespace clipx {
+
+namespace {
+
+bool KeyIs(const char* key, size_t size, const char* name) {
+    return std::strlen(name) == size && std::memcmp(key, name, size) == 0;
+}
+
+bool ParseJsonText(const uint8_t* data, size_t size, nlohmann::json& json) {
+    try {
+        json = nlohmann::json::parse(data, data + size);
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Failed to parse IPC message: " + std::string(e.what()));
+        return false;
+    }
+}
+
+// ---- Generic JSON values ----
+
+void WriteValue(MsgPackWriter& writer, const nlohmann::json& value) {
+    switch (value.type()) {
+        case nlohmann::json::value_t::boolean:
+            writer.Bool(value.get<bool>());
+            break;
+        case nlohmann::json::value_t::number_integer:
+            writer.Int(value.get<int64_t>());
+            break;
+        case nlohmann::json::value_t::number_unsigned:
+            writer.UInt(value.get<uint64_t>());
+            break;
+        case nlohmann::json::value_t::number_float:
+            writer.Double(value.get<double>());
+            break;
+        case nlohmann::json::value_t::string:
+            writer.String(value.get_ref<const std::string&>());
+            break;
+        case nlohmann::json::value_t::binary: {
+            const auto& binary = value.get_binary();
+            writer.Binary(binary.data(), binary.size());
+            break;
+        }
+        case nlohmann::json::value_t::array:
+            writer.ArrayHeader(static_cast<uint32_t>(value.size()));
+            for (const auto& item : value) {
+                WriteValue(writer, item);
+            }
+            break;
+        case nlohmann::json::value_t::object:
+            writer.MapHeader(static_cast<uint32_t>(value.size()));
+            for (auto it = value.begin(); it != value.end(); ++it) {
+                writer.String(it.key());
+                WriteValue(writer, it.value());
+            }
+            break;
+        default:
+            writer.Nil();
+            break;
+    }
+}
+
+bool ReadValue(MsgPackReader& reader, nlohmann::json& value, int depth) {
+    if (depth > MsgPackReader::MAX_DEPTH) {
+        return false;
+    }
+
+    switch (reader.PeekType()) {
+        case MsgPackReader::Type::Nil:
+            value = nullptr;
+            return reader.ReadNil();
+        case MsgPackReader::Type::Bool: {
+            bool b;
+            if (!reader.ReadBool(b)) return false;
+            value = b;
+            return true;
+        }
+        case MsgPackReader::Type::Int: {
+            int64_t i;
+            if (!reader.ReadInt(i)) return false;
+            value = i;
+            return true;
+        }
+        case MsgPackReader::Type::UInt: {
+            uint64_t u;
+            if (!reader.ReadUInt(u)) return false;
+            value = u;
+            return true;
+        }
+        case MsgPackReader::Type::Float: {
+            double d;
+            if (!reader.ReadDouble(d)) return false;
+            value = d;
+            return true;
+        }
+        case MsgPackReader::Type::String: {
+            const char* s;
+            size_t n;
+            if (!reader.ReadString(s, n)) return false;
+            value = std::string(s, n);
+            return true;
+        }
+        case MsgPackReader::Type::Binary: {
+            const uint8_t* b;
+            size_t n;
+            if (!reader.ReadBinary(b, n)) return false;
+            value = nlohmann::json::binary(std::vector<uint8_t>(b, b + n));
+            return true;
+        }
+        case MsgPackReader::Type::Array: {
+            uint32_t count;
+            if (!reader.ReadArrayHeader(count)) return false;
+            value = nlohmann::json::array();
+            for (uint32_t i = 0; i < count; i++) {
+                nlohmann::json item;
+                if (!ReadValue(reader, item, depth + 1)) return false;
+                value.push_back(std::move(item));
+            }
+            return true;
+        }
+        case MsgPackReader::Type::Map: {
+            uint32_t count;
+            if (!reader.ReadMapHeader(count)) return false;
+            value = nlohmann::json::object();
+            for (uint32_t i = 0; i < count; i++) {
+                std::string key;
+                if (!reader.ReadString(key) || !ReadValue(reader, value[key], depth + 1)) return false;
+            }
+            return true;
+        }
+        case MsgPackReader::Type::Invalid:
+            break;
+    }
+    return false;
+}
+
+// ---- Typed entries (same keys as ClipboardEntryToJson) ----
+
+void WriteEntry(MsgPackWriter& writer, const ClipboardEntry& entry) {
+    writer.MapHeader(8 + (entry.tags.empty() ? 0 : 1) + (entry.thumbnail.empty() ? 0 : 1));
+    writer.String("id", 2);
+    writer.Int(entry.id);
+    writer.String("timestamp", 9);
+    writer.Int(entry.timestamp);
+    writer.String("type", 4);
+    writer.Int(static_cast<int32_t>(entry.type));
+    writer.String("preview", 7);
+    writer.String(entry.preview);
+    writer.String("source_app", 10);
+    writer.String(entry.sourceApp);
+    writer.String("copy_count", 10);
+    writer.Int(entry.copyCount);
+    writer.String("is_favorited", 12);
+    writer.Bool(entry.isFavorited);
+    writer.String("is_tagged", 9);
+    writer.Bool(entry.isTagged);
+    if (!entry.tags.empty()) {
+        writer.String("tags", 4);
+        writer.ArrayHeader(static_cast<uint32_t>(entry.tags.size()));
+        for (const auto& tag : entry.tags) {
+            writer.String(tag);
+        }
+    }
+    if (!entry.thumbnail.empty()) {
+        writer.String("thumbnail", 9);
+        writer.Binary(entry.thumbnail.data(), entry.thumbnail.size());
+    }
+}
+
+bool ReadEntry(MsgPackReader& reader, ClipboardEntry& entry) {
+    uint32_t fields;
+    if (!reader.ReadMapHeader(fields)) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < fields; i++) {
+        const char* key;
+        size_t keySize;
+        if (!reader.ReadString(key, keySize)) return false;
+
+        bool ok = true;
+        int64_t number = 0;
+        if (KeyIs(key, keySize, "id")) {
+            ok = reader.ReadInt(entry.id);
+        } else if (KeyIs(key, keySize, "timestamp")) {
+            ok = reader.ReadInt(entry.timestamp);
+        } else if (KeyIs(key, keySize, "type")) {
+            ok = reader.ReadInt(number);
+            entry.type = static_cast<ClipboardDataType>(number);
+        } else if (KeyIs(key, keySize, "preview")) {
+            ok = reader.ReadString(entry.preview);
+        } else if (KeyIs(key, keySize, "source_app")) {
+            ok = reader.ReadString(entry.sourceApp);
+        } else if (KeyIs(key, keySize, "copy_count")) {
+            ok = reader.ReadInt(number);
+            entry.copyCount = static_cast<int32_t>(number);
+        } else if (KeyIs(key, keySize, "is_favorited")) {
+            ok = reader.ReadBool(entry.isFavorited);
+        } else if (KeyIs(key, keySize, "is_tagged")) {
+            ok = reader.ReadBool(entry.isTagged);
+        } else if (KeyIs(key, keySize, "tags")) {
+            uint32_t count;
+            ok = reader.ReadArrayHeader(count);
+            for (uint32_t t = 0; ok && t < count; t++) {
+                std::string tag;
+                ok = reader.ReadString(tag);
+                if (ok) entry.tags.push_back(std::move(tag));
+            }
+        } else if (KeyIs(key, keySize, "thumbnail")) {
+            const uint8_t* data;
+            size_t size;
+            ok = reader.ReadBinary(data, size);
+            if (ok) entry.thumbnail.assign(data, data + size);
+        } else {
+            ok = reader.Skip();
+        }
+        if (!ok) return false;
+    }
+    return true;
+}
+
+// "data" object with the typed entries spliced in as data.entries
+void WriteData(MsgPackWriter& writer, const nlohmann::json& data,
+               const std::optional<std::vector<ClipboardEntry>>& entries) {
+    if (!entries) {
+        WriteValue(writer, data);
+        return;
+    }
+
+    size_t count = 1;
+    if (data.is_object()) {
+        count += data.size() - (data.contains("entries") ? 1 : 0);
+    }
+    writer.MapHeader(static_cast<uint32_t>(count));
+    if (data.is_object()) {
+        for (auto it = data.begin(); it != data.end(); ++it) {
+            if (it.key() == "entries") continue;
+            writer.String(it.key());
+            WriteValue(writer, it.value());
+        }
+    }
+
+    writer.String("entries", 7);
+    writer.ArrayHeader(static_cast<uint32_t>(entries->size()));
+    for (const auto& entry : *entries) {
+        WriteEntry(writer, entry);
+    }
+}
+
+bool ReadData(MsgPackReader& reader, nlohmann::json& data, std::optional<std::vector<ClipboardEntry>>& entries) {
+    if (reader.PeekType() != MsgPackReader::Type::Map) {
+        return ReadValue(reader, data, 1);
+    }
+
+    uint32_t count;
+    if (!reader.ReadMapHeader(count)) {
+        return false;
+    }
+
+    data = nlohmann::json::object();
+    for (uint32_t i = 0; i < count; i++) {
+        std::string key;
+        if (!reader.ReadString(key)) return false;
+
+        if (key == "entries" && reader.PeekType() == MsgPackReader::Type::Array) {
+            uint32_t entryCount;
+            if (!reader.ReadArrayHeader(entryCount)) return false;
+            entries.emplace();
+            // Every entry takes at least one byte; don't trust the count further
+            entries->reserve(std::min<size_t>(entryCount, 1024));
+            for (uint32_t e = 0; e < entryCount; e++) {
+                entries->emplace_back();
+                if (!ReadEntry(reader, entries->back())) return false;
+            }
+            continue;
+        }
+
+        if (!ReadValue(reader, data[key], 2)) return false;
+    }
+    return true;
+}
+
+// ---- JSON, streamed without building a tree ----
+
+void WriteValue(JsonWriter& writer, const nlohmann::json& value, int depth) {
+    if (depth > JsonWriter::MAX_DEPTH) {
+        writer.Null();
+        return;
+    }
+
+    switch (value.type()) {
+        case nlohmann::json::value_t::boolean:
+            writer.Bool(value.get<bool>());
+            break;
+        case nlohmann::json::value_t::number_integer:
+            writer.Int(value.get<int64_t>());
+            break;
+        case nlohmann::json::value_t::number_unsigned:
+            writer.UInt(value.get<uint64_t>());
+            break;
+        case nlohmann::json::value_t::number_float:
+            writer.Double(value.get<double>());
+            break;
+        case nlohmann::json::value_t::string:
+            writer.String(value.get_ref<const std::string&>());
+            break;
+        case nlohmann::json::value_t::binary: {
+            // Same shape as json::dump gives binary values
+            writer.BeginObject();
+            writer.Key("bytes", 5);
+            writer.BeginArray();
+            for (uint8_t byte : value.get_binary()) {
+                writer.UInt(byte);
+            }
+            writer.EndArray();
+            writer.Key("subtype", 7);
+            writer.Null();
+            writer.EndObject();
+            break;
+        }
+        case nlohmann::json::value_t::array:
+            writer.BeginArray();
+            for (const auto& item : value) {
+                WriteValue(writer, item, depth + 1);
+            }
+            writer.EndArray();
+            break;
+        case nlohmann::json::value_t::object:
+            writer.BeginObject();
+            for (auto it = value.begin(); it != value.end(); ++it) {
+                writer.Key(it.key());
+                WriteValue(writer, it.value(), depth + 1);
+            }
+            writer.EndObject();
+            break;
+        default:
+            writer.Null();
+            break;
+    }
+}
+
+void WriteEntry(JsonWriter& writer, const ClipboardEntry& entry) {
+    writer.BeginObject();
+    writer.Key("id", 2);
+    writer.Int(entry.id);
+    writer.Key("timestamp", 9);
+    writer.Int(entry.timestamp);
+    writer.Key("type", 4);
+    writer.Int(static_cast<int32_t>(entry.type));
+    writer.Key("preview", 7);
+    writer.String(entry.preview);
+    writer.Key("source_app", 10);
+    writer.String(entry.sourceApp);
+    writer.Key("copy_count", 10);
+    writer.Int(entry.copyCount);
+    writer.Key("is_favorited", 12);
+    writer.Bool(entry.isFavorited);
+    writer.Key("is_tagged", 9);
+    writer.Bool(entry.isTagged);
+    if (!entry.tags.empty()) {
+        writer.Key("tags", 4);
+        writer.BeginArray();
+        for (const auto& tag : entry.tags) {
+            writer.String(tag);
+        }
+        writer.EndArray();
+    }
+    if (!entry.thumbnail.empty()) {
+        writer.Key("thumbnail", 9);
+        writer.String(utils::Base64Encode(entry.thumbnail));
+    }
+    writer.EndObject();
+}
+
+void WriteData(JsonWriter& writer, const nlohmann::json& data,
+               const std::optional<std::vector<ClipboardEntry>>& entries) {
+    if (!entries) {
+        WriteValue(writer, data, 1);
+        return;
+    }
+
+    writer.BeginObject();
+    if (data.is_object()) {
+        for (auto it = data.begin(); it != data.end(); ++it) {
+            if (it.key() == "entries") continue;
+            writer.Key(it.key());
+            WriteValue(writer, it.value(), 2);
+        }
+    }
+    writer.Key("entries", 7);
+    writer.BeginArray();
+    for (const auto& entry : *entries) {
+        WriteEntry(writer, entry);
+    }
+    writer.EndArray();
+    writer.EndObject();
+}
+
+// ---- Typed request parameters ----
+
+// False when a field has an unexpected type; the caller then falls back
+// to a params tree, so handlers report the error as before
+bool ReadHistoryParams(JsonReader& reader, HistoryParams& params) {
+    if (!reader.BeginObject()) {
+        return false;
+    }
+
+    std::string_view key;
+    bool end;
+    while (reader.NextKey(key, end)) {
+        if (end) {
+            return reader.AtEnd();
+        }
+
+        bool ok;
+        int64_t number = 0;
+        if (key == "limit") {
+            ok = reader.ReadInt(number);
+            params.limit = static_cast<int>(number);
+        } else if (key == "offset") {
+            ok = reader.ReadInt(number);
+            params.offset = static_cast<int>(number);
+        } else if (key == "favorites_only") {
+            ok = reader.ReadBool(params.favoritesOnly);
+        } else if (key == "type") {
+            ok = reader.ReadInt(number);
+            params.type = static_cast<int>(number);
+        } else {
+            ok = reader.Skip();
+        }
+        if (!ok) return false;
+    }
+    return false;
+}
+
+bool ReadHistoryParams(MsgPackReader& reader, HistoryParams& params) {
+    uint32_t fields;
+    if (!reader.ReadMapHeader(fields)) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < fields; i++) {
+        const char* key;
+        size_t keySize;
+        if (!reader.ReadString(key, keySize)) return false;
+
+        bool ok;
+        int64_t number = 0;
+        if (KeyIs(key, keySize, "limit")) {
+            ok = reader.ReadInt(number);
+            params.limit = static_cast<int>(number);
+        } else if (KeyIs(key, keySize, "offset")) {
+            ok = reader.ReadInt(number);
+            params.offset = static_cast<int>(number);
+        } else if (KeyIs(key, keySize, "favorites_only")) {
+            ok = reader.ReadBool(params.favoritesOnly);
+        } else if (KeyIs(key, keySize, "type")) {
+            ok = reader.ReadInt(number);
+            params.type = static_cast<int>(number);
+        } else {
+            ok = reader.Skip();
+        }
+        if (!ok) return false;
+    }
+    return reader.AtEnd();
+}
+
+// Fills the request's parameters from the encoded "params" value (empty
+// when absent): typed for the actions that have a struct, else a tree
+bool DecodeParams(const uint8_t* data, size_t size, IPCCodec codec, IPCRequest& request) {
+    if (request.action == IPCAction::GET_HISTORY) {
+        HistoryParams history;
+        bool ok = size == 0;
+        if (!ok && codec == IPCCodec::Json) {
+            JsonReader reader(data, size);
+            ok = ReadHistoryParams(reader, history);
+        } else if (!ok) {
+            MsgPackReader reader(data, size);
+            ok = ReadHistoryParams(reader, history);
+        }
+        if (ok) {
+            request.history = history;
+            return true;
+        }
+    }
+
+    if (size == 0) {
+        request.params = nlohmann::json::object();
+        return true;
+    }
+    if (codec == IPCCodec::Json) {
+        return ParseJsonText(data, size, request.params);
+    }
+    MsgPackReader reader(data, size);
+    return ReadValue(reader, request.params, 1);
+}
+
+} // namespace
+
+uint32_t MagicForCodec(IPCCodec codec) {
+    return codec == IPCCodec::MsgPack ? IPC_MAGIC_MSGPACK : IPC_MAGIC;
+}
+
+bool CodecForMagic(uint32_t magic, IPCCodec& codec) {
+    if (magic == IPC_MAGIC) {
+        codec = IPCCodec::Json;
+        return true;
+    }
+    if (magic == IPC_MAGIC_MSGPACK) {
+        codec = IPCCodec::MsgPack;
+        return true;
+    }
+    return false;
+}
+
+const char* CodecName(IPCCodec codec) {
+    return codec == IPCCodec::MsgPack ? "msgpack" : "json";
+}
+
+bool CodecFromName(const std::string& name, IPCCodec& codec) {
+    if (name == "json") {
+        codec = IPCCodec::Json;
+        return true;
+    }
+    if (name == "msgpack") {
+        codec = IPCCodec::MsgPack;
+        return true;
+    }
+    return false;
+}
+
+void EncodeRequest(const IPCRequest& request, IPCCodec codec, std::vector<uint8_t>& out) {
+    if (codec == IPCCodec::Json) {
+        JsonWriter writer(out);
+        writer.BeginObject();
+        writer.Key("action", 6);
+        writer.String(request.action);
+        writer.Key("request_id", 10);
+        writer.Int(request.requestId);
+        writer.Key("params", 6);
+        WriteValue(writer, request.params, 1);
+        if (request.trace.Valid()) {
+            writer.Key("trace", 5);
+            writer.String(trace::FormatContext(request.trace));
+        }
+        writer.EndObject();
+        return;
+    }
+
+    MsgPackWriter writer(out);
+    writer.MapHeader(request.trace.Valid() ? 4 : 3);
+    writer.String("action", 6);
+    writer.String(request.action);
+    writer.String("request_id", 10);
+    writer.Int(request.requestId);
+    writer.String("params", 6);
+    WriteValue(writer, request.params);
+    if (request.trace.Valid()) {
+        writer.String("trace", 5);
+        writer.String(trace::FormatContext(request.trace));
+    }
+}
+
+void EncodeResponse(const IPCResponse& response, IPCCodec codec, std::vector<uint8_t>& out) {
+    const EncodedResponseData* encoded =
+        response.encoded && response.encoded->codec == codec ? response.encoded.get() : nullptr;
+
+    if (codec == IPCCodec::Json) {
+        JsonWriter writer(out);
+        writer.BeginObject();
+        writer.Key("request_id", 10);
+        writer.Int(response.requestId);
+        writer.Key("success", 7);
+        writer.Bool(response.success);
+        writer.Key("data", 4);
+        if (encoded) {
+            writer.RawValue(encoded->bytes.data(), encoded->bytes.size());
+        } else {
+            WriteData(writer, response.data, response.entries);
+        }
+        if (!response.error.empty()) {
+            writer.Key("error", 5);
+            writer.String(response.error);
+            writer.Key("error_code", 10);
+            writer.Int(response.errorCode);
+        }
+        writer.EndObject();
+        return;
+    }
+
+    MsgPackWriter writer(out);
+    writer.MapHeader(response.error.empty() ? 3 : 5);
+    writer.String("request_id", 10);
+    writer.Int(response.requestId);
+    writer.String("success", 7);
+    writer.Bool(response.success);
+    writer.String("data", 4);
+    if (encoded) {
+        writer.RawValue(encoded->bytes.data(), encoded->bytes.size());
+    } else {
+        WriteData(writer, response.data, response.entries);
+    }
+    if (!response.error.empty()) {
+        writer.String("error", 5);
+        writer.String(response.error);
+        writer.String("error_code", 10);
+        writer.Int(response.errorCode);
+    }
+}
+
+std::shared_ptr<const EncodedResponseData> EncodeResponseData(const IPCResponse& response, IPCCodec codec) {
+    auto encoded = std::make_shared<EncodedResponseData>();
+    encoded->codec = codec;
+    if (codec == IPCCodec::Json) {
+        JsonWriter writer(encoded->bytes);
+        WriteData(writer, response.data, response.entries);
+    } else {
+        MsgPackWriter writer(encoded->bytes);
+        WriteData(writer, response.data, response.entries);
+    }
+    return encoded;
+}
+
+void EncodeNotification(const IPCNotification& notification, IPCCodec codec, std::vector<uint8_t>& out) {
+    if (codec == IPCCodec::Json) {
+        JsonWriter writer(out);
+        writer.BeginObject();
+        writer.Key("event", 5);
+        writer.String(notification.event);
+        writer.Key("data", 4);
+        WriteData(writer, notification.data, notification.entries);
+        writer.EndObject();
+        return;
+    }
+
+    MsgPackWriter writer(out);
+    writer.MapHeader(2);
+    writer.String("event", 5);
+    writer.String(notification.event);
+    writer.String("data", 4);
+    WriteData(writer, notification.data, notification.entries);
+}
+
+bool DecodeRequest(const uint8_t* data, size_t size, IPCCodec codec, IPCRequest& request) {
+    request.action.clear();
+    request.requestId = 0;
+    request.params = nullptr;
+    request.history.reset();
+    request.trace = {};
+
+    // The envelope is read in place; "params" is only located, since how
+    // to decode it depends on the action, which may come after it
+    size_t paramsBegin = 0;
+    size_t paramsEnd = 0;
+    if (codec == IPCCodec::Json) {
+        JsonReader reader(data, size);
+        if (!reader.BeginObject()) {
+            return false;
+        }
+        std::string_view key;
+        bool end = false;
+        while (!end) {
+            if (!reader.NextKey(key, end)) return false;
+            if (end) break;
+
+            bool ok;
+            if (key == "action") {
+                ok = reader.ReadString(request.action);
+            } else if (key == "request_id") {
+                int64_t id = 0;
+                ok = reader.ReadInt(id);
+                request.requestId = static_cast<int32_t>(id);
+            } else if (key == "params") {
+                paramsBegin = reader.Position();
+                ok = reader.Skip();
+                paramsEnd = reader.Position();
+            } else if (key == "trace") {
+                std::string context;
+                ok = reader.ReadString(context);
+                trace::ParseContext(context, request.trace);
+            } else {
+                ok = reader.Skip();
+            }
+            if (!ok) return false;
+        }
+        if (!reader.AtEnd()) {
+            return false;
+        }
+    } else {
+        MsgPackReader reader(data, size);
+        uint32_t fields;
+        if (!reader.ReadMapHeader(fields)) {
+            return false;
+        }
+        for (uint32_t i = 0; i < fields; i++) {
+            const char* key;
+            size_t keySize;
+            if (!reader.ReadString(key, keySize)) return false;
+
+            bool ok;
+            if (KeyIs(key, keySize, "action")) {
+                ok = reader.ReadString(request.action);
+            } else if (KeyIs(key, keySize, "request_id")) {
+                int64_t id = 0;
+                ok = reader.ReadInt(id);
+                request.requestId = static_cast<int32_t>(id);
+            } else if (KeyIs(key, keySize, "params")) {
+                paramsBegin = reader.Position();
+                ok = reader.Skip();
+                paramsEnd = reader.Position();
+            } else if (KeyIs(key, keySize, "trace")) {
+                std::string context;
+                ok = reader.ReadString(context);
+                trace::ParseContext(context, request.trace);
+            } else {
+                ok = reader.Skip();
+            }
+            if (!ok) return false;
+        }
+        if (!reader.AtEnd()) {
+            return false;
+        }
+    }
+
+    return DecodeParams(data + paramsBegin, paramsEnd - paramsBegin, codec, request);
+}
+
+bool DecodeServerMessage(const uint8_t* data, size_t size, IPCCodec codec, IPCServerMessage& message) {
+    if (codec == IPCCodec::Json) {
+        nlohmann::json json;
+        if (!ParseJsonText(data, size, json) || !json.is_object()) {
+            return false;
+        }
+        try {
+            message.isNotification = IPCNotification::IsNotification(json);
+            if (message.isNotification) {
+                message.notification = IPCNotification::FromJson(json);
+            } else {
+                message.response = IPCResponse::FromJson(json);
+            }
+            return true;
+        } catch (const std::exception& e) {
+            LOG_ERROR("Malformed IPC message: " + std::string(e.what()));
+            return false;
+        }
+    }
+
+    MsgPackReader reader(data, size);
+    uint32_t fields;
+    if (!reader.ReadMapHeader(fields)) {
+        return false;
+    }
+
+    // Responses and notifications share the "data" layout; which one this
+    // is only becomes known once the keys have been seen
+    IPCResponse response;
+    IPCNotification notification;
+    nlohmann::json payload = nlohmann::json::object();
+    std::optional<std::vector<ClipboardEntry>> entries;
+    bool isNotification = false;
+
+    for (uint32_t i = 0; i < fields; i++) {
+        const char* key;
+        size_t keySize;
+        if (!reader.ReadString(key, keySize)) return false;
+
+        bool ok;
+        int64_t number = 0;
+        if (KeyIs(key, keySize, "event")) {
+            ok = reader.ReadString(notification.event);
+            isNotification = true;
+        } else if (KeyIs(key, keySize, "data")) {
+            ok = ReadData(reader, payload, entries);
+        } else if (KeyIs(key, keySize, "request_id")) {
+            ok = reader.ReadInt(number);
+            response.requestId = static_cast<int32_t>(number);
+        } else if (KeyIs(key, keySize, "success")) {
+            ok = reader.ReadBool(response.success);
+        } else if (KeyIs(key, keySize, "error")) {
+            ok = reader.ReadString(response.error);
+        } else if (KeyIs(key, keySize, "error_code")) {
+            ok = reader.ReadInt(number);
+            response.errorCode = static_cast<int32_t>(number);
+        } else {
+            ok = reader.Skip();
+        }
+        if (!ok) return false;
+    }
+    if (!reader.AtEnd()) {
+        return false;
+    }
+
+    message.isNotification = isNotification;
+    if (isNotification) {
+        notification.data = std::move(payload);
+        notification.entries = std::move(entries);
+        message.notification = std::move(notification);
+    } else {
+        response.data = std::move(payload);
+        response.entries = std::move(entries);
+        message.response = std::move(response);
+    }
+    return true;
+}
+
+} // namespace clipx
@@ -0,0 +1,92 @@
+#include "common/ipc_transport.h"
+#include "common/logger.h"
+#include <cstring>
+
+namespace clipx {
+
+bool IPCConnection::ReadMessage(std::vector<uint8_t>& payload, IPCCodec& codec, int timeoutMs) {
+    IPCHeader header;
+    if (!ReadExact(reinterpret_cast<uint8_t*>(&header), sizeof(header), timeoutMs)) {
+        return false;
+    }
+
+    if (!CodecForMagic(header.magic, codec)) {
+        LOG_ERROR("Invalid IPC header magic");
+        return false;
+    }
+    if (header.payloadSize > IPC_MAX_PAYLOAD_SIZE) {
+        LOG_ERROR("IPC payload too large: " + std::to_string(header.payloadSize));
+        return false;
+    }
+
+    payload.resize(header.payloadSize);
+    if (header.payloadSize > 0 && !ReadExact(payload.data(), header.payloadSize, timeoutMs)) {
+        LOG_ERROR("Failed to read full payload");
+        return false;
+    }
+    return true;
+}
+
+IPCReadResult IPCConnection::ReadAvailable(std::vector<uint8_t>& frame, size_t& filled, IPCCodec& codec) {
+    auto fill = [&](size_t size) {
+        while (filled < size) {
+            ptrdiff_t n = ReadSome(frame.data() + filled, size - filled);
+            if (n < 0) return IPCReadResult::Failed;
+            if (n == 0) return IPCReadResult::Pending;
+            filled += static_cast<size_t>(n);
+        }
+        return IPCReadResult::Message;
+    };
+
+    if (filled < IPC_FRAME_HEADER_SIZE) {
+        frame.resize(IPC_FRAME_HEADER_SIZE);
+        IPCReadResult result = fill(IPC_FRAME_HEADER_SIZE);
+        if (result != IPCReadResult::Message) {
+            return result;
+        }
+    }
+
+    IPCHeader header;
+    std::memcpy(&header, frame.data(), sizeof(header));
+    if (!CodecForMagic(header.magic, codec)) {
+        LOG_ERROR("Invalid IPC header magic");
+        return IPCReadResult::Failed;
+    }
+    if (header.payloadSize > IPC_MAX_PAYLOAD_SIZE) {
+        LOG_ERROR("IPC payload too large: " + std::to_string(header.payloadSize));
+        return IPCReadResult::Failed;
+    }
+    frame.resize(IPC_FRAME_HEADER_SIZE + header.payloadSize);
+    return fill(frame.size());
+}
+
+bool IPCConnection::WriteMessage(const std::vector<uint8_t>& payload, IPCCodec codec) {
+    // One write per frame: a single syscall, and the peer never sees a
+    // header without its payload
+    thread_local std::vector<uint8_t> frame;
+    frame.resize(IPC_FRAME_HEADER_SIZE);
+    frame.insert(frame.end(), payload.begin(), payload.end());
+    bool written = WriteFrame(frame, codec);
+
+    // Don't pin the memory of one huge message for the thread's lifetime
+    if (frame.capacity() > IPC_BUFFER_SIZE * 16) {
+        std::vector<uint8_t>().swap(frame);
+    }
+    return written;
+}
+
+bool IPCConnection::WriteFrame(std::vector<uint8_t>& frame, IPCCodec codec) {
+    size_t payloadSize = frame.size() - IPC_FRAME_HEADER_SIZE;
+    if (payloadSize > IPC_MAX_PAYLOAD_SIZE) {
+        LOG_ERROR("IPC payload too large: " + std::to_string(payloadSize));
+        return false;
+    }
+
+    IPCHeader header;
+    header.magic = MagicForCodec(codec);
+    header.payloadSize = static_cast<uint32_t>(payloadSize);
+    std::memcpy(frame.data(), &header, sizeof(header));
+    return WriteAll(frame.data(), frame.size(), IPC_DEFAULT_TIMEOUT_MS);
+}
+
+} // namespace clipx
@@ -0,0 +1,402 @@
+// Win32 named pipe backend of the IPC transport, with an I/O completion
+// port event loop.
+//
+// Readiness is detected with zero-byte overlapped reads: the read completes
+// on the port once data (or a hang-up) arrives, without consuming anything.
+// The actual frame is then read by a worker with event-based overlapped I/O
+// whose completions are kept off the port (low bit set on hEvent).
+
+#include "common/windows.h"
+#include "common/ipc_transport.h"
+#include "common/logger.h"
+#include "common/utils.h"
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+
+namespace clipx {
+
+namespace {
+
+// Milliseconds left until `deadline`, or INFINITE for a negative timeout
+DWORD Remaining(ULONGLONG deadline, int timeoutMs) {
+    if (timeoutMs < 0) return INFINITE;
+    ULONGLONG now = GetTickCount64();
+    return now < deadline ? static_cast<DWORD>(deadline - now) : 0;
+}
+
+class PipeConnection : public IPCConnection {
+public:
+    explicit PipeConnection(HANDLE pipe) : m_pipe(pipe) {
+        m_readEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+        m_writeEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+    }
+
+    ~PipeConnection() override {
+        Close();
+        if (m_watchPending) {
+            // The kernel still owns m_watch until the cancelled read completes
+            DWORD ignored;
+            GetOverlappedResult(m_pipe, &m_watch, &ignored, TRUE);
+        }
+        CloseHandle(m_pipe);
+        CloseHandle(m_readEvent);
+        CloseHandle(m_writeEvent);
+    }
+
+    HANDLE Handle() const { return m_pipe; }
+
+    bool WaitReadable(int timeoutMs) override {
+        DWORD available = 0;
+        if (!m_open || !PeekNamedPipe(m_pipe, nullptr, 0, nullptr, &available, nullptr)) {
+            return true;  // Broken pipe: let the next read report it
+        }
+        if (available > 0 || timeoutMs == 0) {
+            return available > 0;
+        }
+
+        // A zero-byte read completes once data or a hang-up arrives, without
+        // consuming anything
+        static uint8_t dummy;
+        ResetEvent(m_readEvent);
+        OVERLAPPED overlapped = {};
+        overlapped.hEvent = reinterpret_cast<HANDLE>(reinterpret_cast<uintptr_t>(m_readEvent) | 1);
+        DWORD transferred = 0;
+        if (ReadFile(m_pipe, &dummy, 0, &transferred, &overlapped) || GetLastError() != ERROR_IO_PENDING) {
+            return true;
+        }
+
+        if (WaitForSingleObject(m_readEvent, timeoutMs < 0 ? INFINITE : static_cast<DWORD>(timeoutMs)) != WAIT_OBJECT_0) {
+            CancelIoEx(m_pipe, &overlapped);
+        }
+        // Completed (possibly just before the cancel) unless it was aborted
+        return GetOverlappedResult(m_pipe, &overlapped, &transferred, TRUE) != FALSE ||
+               GetLastError() != ERROR_OPERATION_ABORTED;
+    }
+
+    void Close() override {
+        if (m_open.exchange(false)) {
+            CancelIoEx(m_pipe, nullptr);
+        }
+    }
+
+    // Connect (pending instance) or zero-byte read (accepted connection);
+    // owned by PipeListener and guarded by its mutex
+    OVERLAPPED m_watch = {};
+    bool m_watchPending = false;
+
+protected:
+    bool ReadExact(uint8_t* buffer, size_t size, int timeoutMs) override {
+        ULONGLONG deadline = GetTickCount64() + static_cast<ULONGLONG>(timeoutMs < 0 ? 0 : timeoutMs);
+        size_t done = 0;
+        while (done < size) {
+            DWORD transferred = 0;
+            if (!Transfer(false, buffer + done, static_cast<DWORD>(size - done), Remaining(deadline, timeoutMs),
+                          transferred) || transferred == 0) {
+                return false;
+            }
+            done += transferred;
+        }
+        return true;
+    }
+
+    bool WriteAll(const uint8_t* data, size_t size, int timeoutMs) override {
+        ULONGLONG deadline = GetTickCount64() + static_cast<ULONGLONG>(timeoutMs < 0 ? 0 : timeoutMs);
+        size_t done = 0;
+        while (done < size) {
+            DWORD transferred = 0;
+            if (!Transfer(true, const_cast<uint8_t*>(data + done), static_cast<DWORD>(size - done),
+                          Remaining(deadline, timeoutMs), transferred) || transferred == 0) {
+                return false;
+            }
+            done += transferred;
+        }
+        return true;
+    }
+
+    ptrdiff_t ReadSome(uint8_t* buffer, size_t size) override {
+        DWORD available = 0;
+        if (!m_open || !PeekNamedPipe(m_pipe, nullptr, 0, nullptr, &available, nullptr)) {
+            return -1;
+        }
+        if (available == 0) {
+            return 0;
+        }
+        // The bytes are already in the pipe, so the read completes at once
+        DWORD transferred = 0;
+        DWORD wanted = static_cast<DWORD>(std::min<size_t>(size, available));
+        if (!Transfer(false, buffer, wanted, IPC_DEFAULT_TIMEOUT_MS, transferred) || transferred == 0) {
+            return -1;
+        }
+        return static_cast<ptrdiff_t>(transferred);
+    }
+
+private:
+    // One overlapped ReadFile/WriteFile, waited for on its own event
+    bool Transfer(bool write, uint8_t* data, DWORD size, DWORD timeoutMs, DWORD& transferred) {
+        if (!m_open) {
+            return false;
+        }
+
+        HANDLE event = write ? m_writeEvent : m_readEvent;
+        ResetEvent(event);
+        OVERLAPPED overlapped = {};
+        // Low bit set: the completion is not queued to the listener's port
+        overlapped.hEvent = reinterpret_cast<HANDLE>(reinterpret_cast<uintptr_t>(event) | 1);
+
+        BOOL ok = write ? WriteFile(m_pipe, data, size, &transferred, &overlapped)
+                        : ReadFile(m_pipe, data, size, &transferred, &overlapped);
+        if (ok) {
+            return true;
+        }
+
+        DWORD error = GetLastError();
+        if (error != ERROR_IO_PENDING) {
+            return false;
+        }
+
+        if (WaitForSingleObject(event, timeoutMs) != WAIT_OBJECT_0) {
+            CancelIoEx(m_pipe, &overlapped);
+            GetOverlappedResult(m_pipe, &overlapped, &transferred, TRUE);
+            return false;
+        }
+        return GetOverlappedResult(m_pipe, &overlapped, &transferred, FALSE) != FALSE;
+    }
+
+    HANDLE m_pipe;
+    HANDLE m_readEvent;
+    HANDLE m_writeEvent;
+};
+
+class PipeListener : public IPCListener {
+public:
+    ~PipeListener() override {
+        Close();
+    }
+
+    bool Listen(const std::string& address, size_t maxConnections) override {
+        m_name = utils::Utf8ToWide(address);
+        m_maxConnections = maxConnections;
+        m_port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+        if (!m_port) {
+            LOG_ERROR("Failed to create IPC completion port: " + std::to_string(GetLastError()));
+            return false;
+        }
+        return CreatePendingInstance(true);
+    }
+
+    bool Wait(int timeoutMs,
+              std::vector<std::shared_ptr<IPCConnection>>& accepted,
+              std::vector<std::shared_ptr<IPCConnection>>& readable) override {
+        if (!m_port) {
+            return false;
+        }
+
+        OVERLAPPED_ENTRY entries[64];
+        ULONG count = 0;
+        if (!GetQueuedCompletionStatusEx(m_port, entries, 64, &count,
+                                         timeoutMs < 0 ? INFINITE : static_cast<DWORD>(timeoutMs), FALSE)) {
+            return GetLastError() == WAIT_TIMEOUT;
+        }
+
+        for (ULONG i = 0; i < count; i++) {
+            auto* pipe = reinterpret_cast<PipeConnection*>(entries[i].lpCompletionKey);
+            if (!pipe) {
+                continue;  // Wake()
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_pending && pipe == m_pending.get()) {
+                pipe->m_watchPending = false;
+                OnConnected(accepted);
+                continue;
+            }
+
+            auto it = m_connections.find(pipe);
+            if (it != m_connections.end()) {
+                pipe->m_watchPending = false;
+                readable.push_back(it->second);
+            } else {
+                // Removed while its read was pending; the object can go now
+                m_closing.erase(pipe);
+            }
+        }
+        return true;
+    }
+
+    void Rearm(const std::shared_ptr<IPCConnection>& connection) override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto* pipe = static_cast<PipeConnection*>(connection.get());
+        if (m_connections.count(pipe)) {
+            Watch(pipe);
+        }
+    }
+
+    void Remove(const std::shared_ptr<IPCConnection>& connection) override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto* pipe = static_cast<PipeConnection*>(connection.get());
+        auto it = m_connections.find(pipe);
+        if (it == m_connections.end()) {
+            return;
+        }
+        if (pipe->m_watchPending) {
+            // Keep the object alive until the cancelled read is dequeued, so a
+            // new connection at the same address can't receive its completion
+            m_closing[pipe] = it->second;
+        }
+        m_connections.erase(it);
+        connection->Close();
+    }
+
+    void Wake() override {
+        if (m_port) {
+            PostQueuedCompletionStatus(m_port, 0, 0, nullptr);
+        }
+    }
+
+    void Close() override {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (auto& [pipe, connection] : m_connections) {
+                connection->Close();
+            }
+            if (m_pending) {
+                m_pending->Close();
+            }
+            // Destructors wait for the cancelled reads
+            m_connections.clear();
+            m_closing.clear();
+            m_pending.reset();
+        }
+        if (m_port) {
+            CloseHandle(m_port);
+            m_port = nullptr;
+        }
+    }
+
+private:
+    // The next client connects to the pending instance
+    bool CreatePendingInstance(bool first) {
+        HANDLE handle = CreateNamedPipeW(
+            m_name.c_str(),
+            PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED | (first ? FILE_FLAG_FIRST_PIPE_INSTANCE : 0),
+            PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+            PIPE_UNLIMITED_INSTANCES,
+            IPC_BUFFER_SIZE,
+            IPC_BUFFER_SIZE,
+            0,
+            nullptr
+        );
+        if (handle == INVALID_HANDLE_VALUE) {
+            LOG_ERROR("Failed to create named pipe: " + std::to_string(GetLastError()));
+            return false;
+        }
+
+        auto pipe = std::make_shared<PipeConnection>(handle);
+        if (!CreateIoCompletionPort(handle, m_port, reinterpret_cast<ULONG_PTR>(pipe.get()), 0)) {
+            LOG_ERROR("Failed to attach named pipe to completion port: " + std::to_string(GetLastError()));
+            return false;
+        }
+
+        pipe->m_watch = {};
+        pipe->m_watchPending = true;
+        if (!ConnectNamedPipe(handle, &pipe->m_watch)) {
+            DWORD error = GetLastError();
+            if (error == ERROR_PIPE_CONNECTED) {
+                // Client raced in before ConnectNamedPipe; no packet is queued
+                PostQueuedCompletionStatus(m_port, 0, reinterpret_cast<ULONG_PTR>(pipe.get()), &pipe->m_watch);
+            } else if (error != ERROR_IO_PENDING) {
+                LOG_ERROR("ConnectNamedPipe failed: " + std::to_string(error));
+                pipe->m_watchPending = false;
+                return false;
+            }
+        }
+        m_pending = std::move(pipe);
+        return true;
+    }
+
+    // Called with m_mutex held when the pending instance got a client
+    void OnConnected(std::vector<std::shared_ptr<IPCConnection>>& accepted) {
+        std::shared_ptr<PipeConnection> pipe = std::move(m_pending);
+        DWORD ignored;
+        bool connected = GetOverlappedResult(pipe->Handle(), &pipe->m_watch, &ignored, FALSE) ||
+                         GetLastError() == ERROR_PIPE_CONNECTED;
+
+        if (!CreatePendingInstance(false)) {
+            LOG_ERROR("IPC listener can't accept further clients");
+        }
+
+        if (!connected) {
+            return;
+        }
+        if (m_connections.size() >= m_maxConnections) {
+            LOG_WARN("Refusing IPC connection: limit of " + std::to_string(m_maxConnections) + " reached");
+            return;
+        }
+
+        m_connections[pipe.get()] = pipe;
+        accepted.push_back(pipe);
+        Watch(pipe.get());
+    }
+
+    // Zero-byte read that completes on the port once input is waiting
+    void Watch(PipeConnection* pipe) {
+        static char dummy;
+        pipe->m_watch = {};
+        pipe->m_watchPending = true;
+        if (!ReadFile(pipe->Handle(), &dummy, 0, nullptr, &pipe->m_watch) && GetLastError() != ERROR_IO_PENDING) {
+            // Already broken: report it as readable so a worker closes it
+            PostQueuedCompletionStatus(m_port, 0, reinterpret_cast<ULONG_PTR>(pipe), &pipe->m_watch);
+        }
+    }
+
+    std::wstring m_name;
+    size_t m_maxConnections = 0;
+    HANDLE m_port = nullptr;
+    std::mutex m_mutex;
+    std::shared_ptr<PipeConnection> m_pending;
+    std::unordered_map<PipeConnection*, std::shared_ptr<IPCConnection>> m_connections;
+    std::unordered_map<PipeConnection*, std::shared_ptr<IPCConnection>> m_closing;
+};
+
+} // namespace
+
+std::unique_ptr<IPCListener> CreateIPCListener() {
+    return std::make_unique<PipeListener>();
+}
+
+std::unique_ptr<IPCConnection> ConnectIPC(const std::string& address, int timeoutMs) {
+    std::wstring name = utils::Utf8ToWide(address);
+    ULONGLONG deadline = GetTickCount64() + static_cast<ULONGLONG>(timeoutMs);
+
+    while (true) {
+        HANDLE pipe = CreateFileW(
+            name.c_str(),
+            GENERIC_READ | GENERIC_WRITE,
+            0,
+            nullptr,
+            OPEN_EXISTING,
+            FILE_FLAG_OVERLAPPED,
+            nullptr
+        );
+        if (pipe != INVALID_HANDLE_VALUE) {
+            return std::make_unique<PipeConnection>(pipe);
+        }
+
+        // All instances busy: wait for one to free up until the deadline
+        DWORD error = GetLastError();
+        if (error != ERROR_PIPE_BUSY || GetTickCount64() >= deadline) {
+            LOG_ERROR("Failed to connect to pipe: " + std::to_string(error));
+            return nullptr;
+        }
+        if (!WaitNamedPipeW(name.c_str(), 100)) {
+            Sleep(50);
+        }
+    }
+}
+
+std::string DefaultIPCAddress() {
+    return IPC_PIPE_NAME;
+}
+
+} // namespace clipx
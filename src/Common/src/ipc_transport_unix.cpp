@@ -0,0 +1,383 @@
+// AF_UNIX stream socket backend of the IPC transport, with an epoll
+// event loop. Used on Linux, mainly so the IPC stack can be exercised and
+// benchmarked outside Windows.
+
+#include "common/ipc_transport.h"
+#include "common/logger.h"
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+namespace clipx {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::string ErrnoString() {
+    return std::strerror(errno);
+}
+
+bool MakeSocketAddress(const std::string& path, sockaddr_un& addr) {
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        LOG_ERROR("Invalid IPC socket path: " + path);
+        return false;
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+// Clears the way for bind(): a socket file nobody accepts on is left over
+// from a crashed run and removed; one a server answers on is kept, and
+// false returned, so a second instance can't steal the address
+bool RemoveStaleSocket(const std::string& path, const sockaddr_un& addr) {
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (fd < 0) {
+        LOG_ERROR("Failed to create IPC socket: " + ErrnoString());
+        return false;
+    }
+    int error = ::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0 ? 0 : errno;
+    ::close(fd);
+
+    if (error == ENOENT) {
+        return true;
+    }
+    if (error == ECONNREFUSED) {
+        ::unlink(path.c_str());
+        return true;
+    }
+    // Connected, or the backlog is full (EAGAIN): a server is live there
+    LOG_ERROR("IPC address in use: " + path + (error ? std::string(" (") + std::strerror(error) + ")" : ""));
+    return false;
+}
+
+// Milliseconds left until `deadline`, or -1 (forever) for a negative timeout
+int Remaining(Clock::time_point deadline, int timeoutMs) {
+    if (timeoutMs < 0) return -1;
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+    return left > 0 ? static_cast<int>(left) : 0;
+}
+
+class SocketConnection : public IPCConnection {
+public:
+    explicit SocketConnection(int fd) : m_fd(fd) {}
+
+    ~SocketConnection() override {
+        Close();
+        ::close(m_fd);
+    }
+
+    int Fd() const { return m_fd; }
+
+    bool WaitReadable(int timeoutMs) override {
+        return !m_open || WaitFor(POLLIN, timeoutMs);
+    }
+
+    void Close() override {
+        // shutdown() wakes threads blocked on the socket; the descriptor
+        // itself stays valid until the destructor so it can't be reused
+        // under them
+        if (m_open.exchange(false)) {
+            ::shutdown(m_fd, SHUT_RDWR);
+        }
+    }
+
+protected:
+    bool ReadExact(uint8_t* buffer, size_t size, int timeoutMs) override {
+        auto deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+        size_t done = 0;
+        while (done < size) {
+            if (!m_open) return false;
+            if (!WaitFor(POLLIN, Remaining(deadline, timeoutMs))) return false;
+
+            ssize_t n = ::recv(m_fd, buffer + done, size - done, 0);
+            if (n > 0) {
+                done += static_cast<size_t>(n);
+            } else if (n == 0) {
+                return false;  // Peer closed
+            } else if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool WriteAll(const uint8_t* data, size_t size, int timeoutMs) override {
+        auto deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+        size_t done = 0;
+        while (done < size) {
+            if (!m_open) return false;
+
+            ssize_t n = ::send(m_fd, data + done, size - done, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (n > 0) {
+                done += static_cast<size_t>(n);
+            } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                if (!WaitFor(POLLOUT, Remaining(deadline, timeoutMs))) return false;
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    ptrdiff_t ReadSome(uint8_t* buffer, size_t size) override {
+        while (m_open) {
+            ssize_t n = ::recv(m_fd, buffer, size, MSG_DONTWAIT);
+            if (n > 0) return n;
+            if (n == 0) return -1;  // Peer closed
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            if (errno != EINTR) return -1;
+        }
+        return -1;
+    }
+
+private:
+    bool WaitFor(short events, int timeoutMs) {
+        pollfd pfd = {m_fd, events, 0};
+        while (true) {
+            int result = ::poll(&pfd, 1, timeoutMs);
+            if (result > 0) return true;
+            if (result == 0) return false;  // Timed out
+            if (errno != EINTR) return false;
+        }
+    }
+
+    int m_fd;
+};
+
+class SocketListener : public IPCListener {
+public:
+    ~SocketListener() override {
+        Close();
+    }
+
+    bool Listen(const std::string& address, size_t maxConnections) override {
+        sockaddr_un addr;
+        if (!MakeSocketAddress(address, addr)) {
+            return false;
+        }
+
+        if (!RemoveStaleSocket(address, addr)) {
+            return false;
+        }
+
+        m_listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+        if (m_listenFd < 0) {
+            LOG_ERROR("Failed to create IPC socket: " + ErrnoString());
+            return false;
+        }
+        if (::bind(m_listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            ::listen(m_listenFd, SOMAXCONN) != 0) {
+            LOG_ERROR("Failed to listen on " + address + ": " + ErrnoString());
+            Close();
+            return false;
+        }
+        m_path = address;
+        m_maxConnections = maxConnections;
+
+        m_epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+        m_wakeFd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (m_epollFd < 0 || m_wakeFd < 0) {
+            LOG_ERROR("Failed to create IPC event loop: " + ErrnoString());
+            Close();
+            return false;
+        }
+
+        // The listening and wake descriptors are told apart by their tag;
+        // connections carry their object pointer
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.ptr = &m_listenFd;
+        ::epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_listenFd, &event);
+        event.data.ptr = &m_wakeFd;
+        ::epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeFd, &event);
+        return true;
+    }
+
+    bool Wait(int timeoutMs,
+              std::vector<std::shared_ptr<IPCConnection>>& accepted,
+              std::vector<std::shared_ptr<IPCConnection>>& readable) override {
+        if (m_epollFd < 0) {
+            return false;
+        }
+
+        epoll_event events[64];
+        int count = ::epoll_wait(m_epollFd, events, 64, timeoutMs);
+        if (count < 0) {
+            return errno == EINTR;
+        }
+
+        for (int i = 0; i < count; i++) {
+            void* tag = events[i].data.ptr;
+            if (tag == &m_wakeFd) {
+                uint64_t value;
+                while (::read(m_wakeFd, &value, sizeof(value)) > 0) {}
+            } else if (tag == &m_listenFd) {
+                AcceptPending(accepted);
+            } else {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                auto it = m_connections.find(static_cast<SocketConnection*>(tag));
+                if (it != m_connections.end()) {
+                    readable.push_back(it->second);
+                }
+            }
+        }
+        return true;
+    }
+
+    void Rearm(const std::shared_ptr<IPCConnection>& connection) override {
+        auto* socket = static_cast<SocketConnection*>(connection.get());
+        epoll_event event = {};
+        event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+        event.data.ptr = socket;
+        ::epoll_ctl(m_epollFd, EPOLL_CTL_MOD, socket->Fd(), &event);
+    }
+
+    void Remove(const std::shared_ptr<IPCConnection>& connection) override {
+        auto* socket = static_cast<SocketConnection*>(connection.get());
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_connections.erase(socket) == 0) {
+                return;
+            }
+        }
+        ::epoll_ctl(m_epollFd, EPOLL_CTL_DEL, socket->Fd(), nullptr);
+        connection->Close();
+    }
+
+    void Wake() override {
+        if (m_wakeFd >= 0) {
+            uint64_t one = 1;
+            ssize_t ignored = ::write(m_wakeFd, &one, sizeof(one));
+            (void)ignored;
+        }
+    }
+
+    void Close() override {
+        std::unordered_map<SocketConnection*, std::shared_ptr<IPCConnection>> connections;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            connections.swap(m_connections);
+        }
+        for (auto& [socket, connection] : connections) {
+            connection->Close();
+        }
+
+        if (m_listenFd >= 0) {
+            ::close(m_listenFd);
+            m_listenFd = -1;
+            ::unlink(m_path.c_str());
+        }
+        if (m_epollFd >= 0) {
+            ::close(m_epollFd);
+            m_epollFd = -1;
+        }
+        if (m_wakeFd >= 0) {
+            ::close(m_wakeFd);
+            m_wakeFd = -1;
+        }
+    }
+
+private:
+    void AcceptPending(std::vector<std::shared_ptr<IPCConnection>>& accepted) {
+        while (true) {
+            int fd = ::accept4(m_listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR) continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    LOG_ERROR("IPC accept failed: " + ErrnoString());
+                }
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_connections.size() >= m_maxConnections) {
+                LOG_WARN("Refusing IPC connection: limit of " + std::to_string(m_maxConnections) + " reached");
+                ::close(fd);
+                continue;
+            }
+
+            auto connection = std::make_shared<SocketConnection>(fd);
+            m_connections[connection.get()] = connection;
+
+            epoll_event event = {};
+            event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+            event.data.ptr = connection.get();
+            ::epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event);
+            accepted.push_back(std::move(connection));
+        }
+    }
+
+    int m_listenFd = -1;
+    int m_epollFd = -1;
+    int m_wakeFd = -1;
+    std::string m_path;
+    size_t m_maxConnections = 0;
+    std::mutex m_mutex;
+    std::unordered_map<SocketConnection*, std::shared_ptr<IPCConnection>> m_connections;
+};
+
+} // namespace
+
+std::unique_ptr<IPCListener> CreateIPCListener() {
+    return std::make_unique<SocketListener>();
+}
+
+std::unique_ptr<IPCConnection> ConnectIPC(const std::string& address, int timeoutMs) {
+    sockaddr_un addr;
+    if (!MakeSocketAddress(address, addr)) {
+        return nullptr;
+    }
+
+    auto deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (true) {
+        int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            LOG_ERROR("Failed to create IPC socket: " + ErrnoString());
+            return nullptr;
+        }
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+            return std::make_unique<SocketConnection>(fd);
+        }
+
+        int error = errno;
+        ::close(fd);
+
+        // Not started yet, or the accept backlog is full: retry until the deadline
+        bool retry = error == ENOENT || error == ECONNREFUSED || error == EAGAIN || error == EINTR;
+        if (!retry || Clock::now() >= deadline) {
+            LOG_ERROR("Failed to connect to " + address + ": " + std::strerror(error));
+            return nullptr;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+}
+
+std::unique_ptr<IPCConnection> AdoptIPCSocket(int fd) {
+    return std::make_unique<SocketConnection>(fd);
+}
+
+std::string DefaultIPCAddress() {
+    const char* runtimeDir = std::getenv("XDG_RUNTIME_DIR");
+    if (runtimeDir && *runtimeDir) {
+        return std::string(runtimeDir) + "/clipx.sock";
+    }
+    return "/tmp/clipx-" + std::to_string(::getuid()) + ".sock";
+}
+
+} // namespace clipx
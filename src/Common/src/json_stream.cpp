@@ -0,0 +1,597 @@
+#include "common/json_stream.h"
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace clipx {
+
+namespace {
+
+const char HEX_DIGITS[] = "0123456789abcdef";
+
+// Length of the valid UTF-8 sequence at `p`, or 0 (RFC 3629: no overlong
+// forms, surrogates or code points above U+10FFFF)
+size_t Utf8SequenceLength(const uint8_t* p, size_t available) {
+    uint8_t lead = p[0];
+    size_t length;
+    uint8_t min = 0x80, max = 0xbf;  // Allowed range of the second byte
+    if (lead >= 0xc2 && lead <= 0xdf) {
+        length = 2;
+    } else if (lead >= 0xe0 && lead <= 0xef) {
+        length = 3;
+        if (lead == 0xe0) min = 0xa0;
+        if (lead == 0xed) max = 0x9f;
+    } else if (lead >= 0xf0 && lead <= 0xf4) {
+        length = 4;
+        if (lead == 0xf0) min = 0x90;
+        if (lead == 0xf4) max = 0x8f;
+    } else {
+        return 0;
+    }
+    if (available < length || p[1] < min || p[1] > max) {
+        return 0;
+    }
+    for (size_t i = 2; i < length; i++) {
+        if ((p[i] & 0xc0) != 0x80) return 0;
+    }
+    return length;
+}
+
+void AppendUtf8(std::string& out, uint32_t codePoint) {
+    if (codePoint < 0x80) {
+        out += static_cast<char>(codePoint);
+    } else if (codePoint < 0x800) {
+        out += static_cast<char>(0xc0 | (codePoint >> 6));
+        out += static_cast<char>(0x80 | (codePoint & 0x3f));
+    } else if (codePoint < 0x10000) {
+        out += static_cast<char>(0xe0 | (codePoint >> 12));
+        out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (codePoint & 0x3f));
+    } else {
+        out += static_cast<char>(0xf0 | (codePoint >> 18));
+        out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3f));
+        out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (codePoint & 0x3f));
+    }
+}
+
+bool ParseHex4(const char* p, uint32_t& value) {
+    value = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = p[i];
+        value <<= 4;
+        if (c >= '0' && c <= '9') value |= c - '0';
+        else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+        else return false;
+    }
+    return true;
+}
+
+// Decode the escapes of a string token's contents (quotes excluded)
+bool Unescape(std::string_view raw, std::string& out) {
+    out.clear();
+    for (size_t i = 0; i < raw.size(); i++) {
+        char c = raw[i];
+        if (c != '\\') {
+            out += c;
+            continue;
+        }
+        if (++i == raw.size()) return false;
+        switch (raw[i]) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                uint32_t unit;
+                if (raw.size() - i < 5 || !ParseHex4(raw.data() + i + 1, unit)) return false;
+                i += 4;
+                if (unit >= 0xd800 && unit <= 0xdbff) {
+                    // High surrogate, must be followed by an escaped low one
+                    uint32_t low;
+                    if (raw.size() - i < 7 || raw[i + 1] != '\\' || raw[i + 2] != 'u' ||
+                        !ParseHex4(raw.data() + i + 3, low) || low < 0xdc00 || low > 0xdfff) {
+                        return false;
+                    }
+                    i += 6;
+                    unit = 0x10000 + ((unit - 0xd800) << 10) + (low - 0xdc00);
+                } else if (unit >= 0xdc00 && unit <= 0xdfff) {
+                    return false;
+                }
+                AppendUtf8(out, unit);
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+// Scans a string token starting at the opening quote. `raw` is the text
+// between the quotes; `escaped` tells whether it needs Unescape.
+bool StringToken(const uint8_t* data, size_t size, size_t& pos, std::string_view& raw, bool& escaped) {
+    if (pos >= size || data[pos] != '"') {
+        return false;
+    }
+    size_t start = ++pos;
+    escaped = false;
+    while (pos < size) {
+        uint8_t c = data[pos];
+        if (c == '"') {
+            raw = std::string_view(reinterpret_cast<const char*>(data) + start, pos - start);
+            pos++;
+            return true;
+        }
+        if (c < 0x20) {
+            return false;  // Control characters must be escaped
+        }
+        if (c == '\\') {
+            escaped = true;
+            pos++;  // The escaped character can't end the string
+        }
+        pos++;
+    }
+    return false;
+}
+
+} // namespace
+
+// ---- JsonWriter ----
+
+void JsonWriter::BeforeValue() {
+    if (m_afterKey) {
+        m_afterKey = false;
+        return;
+    }
+    if (m_depth > 0 && m_depth <= MAX_DEPTH) {
+        uint64_t bit = uint64_t{1} << (m_depth - 1);
+        if (m_hasItems & bit) {
+            m_out.push_back(',');
+        }
+        m_hasItems |= bit;
+    }
+}
+
+void JsonWriter::Open(uint8_t bracket) {
+    BeforeValue();
+    m_out.push_back(bracket);
+    m_depth++;
+    if (m_depth <= MAX_DEPTH) {
+        m_hasItems &= ~(uint64_t{1} << (m_depth - 1));
+    }
+}
+
+void JsonWriter::Close(uint8_t bracket) {
+    m_out.push_back(bracket);
+    m_depth--;
+}
+
+void JsonWriter::BeginObject() {
+    Open('{');
+}
+
+void JsonWriter::EndObject() {
+    Close('}');
+}
+
+void JsonWriter::BeginArray() {
+    Open('[');
+}
+
+void JsonWriter::EndArray() {
+    Close(']');
+}
+
+void JsonWriter::Key(const char* data, size_t size) {
+    BeforeValue();
+    Escaped(data, size);
+    m_out.push_back(':');
+    m_afterKey = true;
+}
+
+void JsonWriter::RawValue(const uint8_t* data, size_t size) {
+    BeforeValue();
+    m_out.insert(m_out.end(), data, data + size);
+}
+
+void JsonWriter::Null() {
+    BeforeValue();
+    Raw("null", 4);
+}
+
+void JsonWriter::Bool(bool value) {
+    BeforeValue();
+    if (value) {
+        Raw("true", 4);
+    } else {
+        Raw("false", 5);
+    }
+}
+
+void JsonWriter::Int(int64_t value) {
+    BeforeValue();
+    char buffer[24];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    Raw(buffer, result.ptr - buffer);
+}
+
+void JsonWriter::UInt(uint64_t value) {
+    BeforeValue();
+    char buffer[24];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    Raw(buffer, result.ptr - buffer);
+}
+
+void JsonWriter::Double(double value) {
+    if (!std::isfinite(value)) {
+        Null();
+        return;
+    }
+    BeforeValue();
+
+    // Shortest of the usual precisions that reads back exactly
+    char buffer[32];
+    int length = std::snprintf(buffer, sizeof(buffer), "%.15g", value);
+    if (std::strtod(buffer, nullptr) != value) {
+        length = std::snprintf(buffer, sizeof(buffer), "%.17g", value);
+    }
+    Raw(buffer, length);
+
+    // Keep it a float for the reader: "2" would come back as an integer
+    if (std::strpbrk(buffer, ".eE") == nullptr) {
+        Raw(".0", 2);
+    }
+}
+
+void JsonWriter::String(const char* data, size_t size) {
+    BeforeValue();
+    Escaped(data, size);
+}
+
+void JsonWriter::Escaped(const char* data, size_t size) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+    m_out.push_back('"');
+
+    size_t run = 0;  // Start of the pending stretch that needs no escaping
+    for (size_t i = 0; i < size;) {
+        uint8_t c = p[i];
+        if (c >= 0x20 && c < 0x80 && c != '"' && c != '\\') {
+            i++;
+            continue;
+        }
+        if (c >= 0x80) {
+            size_t length = Utf8SequenceLength(p + i, size - i);
+            if (length > 0) {
+                i += length;
+                continue;
+            }
+        }
+
+        Raw(data + run, i - run);
+        switch (c) {
+            case '"': Raw("\\\"", 2); break;
+            case '\\': Raw("\\\\", 2); break;
+            case '\n': Raw("\\n", 2); break;
+            case '\r': Raw("\\r", 2); break;
+            case '\t': Raw("\\t", 2); break;
+            case '\b': Raw("\\b", 2); break;
+            case '\f': Raw("\\f", 2); break;
+            default:
+                if (c < 0x20) {
+                    char escape[6] = {'\\', 'u', '0', '0', HEX_DIGITS[c >> 4], HEX_DIGITS[c & 0xf]};
+                    Raw(escape, sizeof(escape));
+                } else {
+                    Raw("\xef\xbf\xbd", 3);  // Invalid UTF-8 byte
+                }
+                break;
+        }
+        run = ++i;
+    }
+    Raw(data + run, size - run);
+    m_out.push_back('"');
+}
+
+// ---- JsonReader ----
+
+void JsonReader::SkipWhitespace() {
+    while (m_pos < m_size) {
+        uint8_t c = m_data[m_pos];
+        if (c != ' ' && c != '\n' && c != '\r' && c != '\t') break;
+        m_pos++;
+    }
+}
+
+JsonReader::Type JsonReader::PeekType() {
+    SkipWhitespace();
+    if (m_pos >= m_size) {
+        return Type::Invalid;
+    }
+    switch (m_data[m_pos]) {
+        case 'n': return Type::Null;
+        case 't':
+        case 'f': return Type::Bool;
+        case '"': return Type::String;
+        case '[': return Type::Array;
+        case '{': return Type::Object;
+        default:
+            break;
+    }
+    uint8_t c = m_data[m_pos];
+    return (c == '-' || (c >= '0' && c <= '9')) ? Type::Number : Type::Invalid;
+}
+
+bool JsonReader::AtEnd() {
+    SkipWhitespace();
+    return m_pos >= m_size;
+}
+
+bool JsonReader::Literal(const char* text, size_t size) {
+    if (m_size - m_pos < size || std::memcmp(m_data + m_pos, text, size) != 0) {
+        return false;
+    }
+    m_pos += size;
+    return true;
+}
+
+bool JsonReader::ReadNull() {
+    return PeekType() == Type::Null && Literal("null", 4);
+}
+
+bool JsonReader::ReadBool(bool& value) {
+    if (PeekType() != Type::Bool) {
+        return false;
+    }
+    if (Literal("true", 4)) {
+        value = true;
+        return true;
+    }
+    if (Literal("false", 5)) {
+        value = false;
+        return true;
+    }
+    return false;
+}
+
+bool JsonReader::NumberToken(const char*& begin, size_t& size, bool& integral) {
+    if (PeekType() != Type::Number) {
+        return false;
+    }
+
+    size_t pos = m_pos;
+    auto digits = [&]() {
+        size_t start = pos;
+        while (pos < m_size && m_data[pos] >= '0' && m_data[pos] <= '9') pos++;
+        return pos > start;
+    };
+
+    if (m_data[pos] == '-') pos++;
+    if (pos < m_size && m_data[pos] == '0') {
+        pos++;
+    } else if (!digits()) {
+        return false;
+    }
+    integral = true;
+    if (pos < m_size && m_data[pos] == '.') {
+        pos++;
+        if (!digits()) return false;
+        integral = false;
+    }
+    if (pos < m_size && (m_data[pos] == 'e' || m_data[pos] == 'E')) {
+        pos++;
+        if (pos < m_size && (m_data[pos] == '+' || m_data[pos] == '-')) pos++;
+        if (!digits()) return false;
+        integral = false;
+    }
+
+    begin = reinterpret_cast<const char*>(m_data) + m_pos;
+    size = pos - m_pos;
+    return true;
+}
+
+bool JsonReader::ReadInt(int64_t& value) {
+    const char* begin;
+    size_t size;
+    bool integral;
+    if (!NumberToken(begin, size, integral) || !integral) {
+        return false;
+    }
+    auto result = std::from_chars(begin, begin + size, value);
+    if (result.ec != std::errc() || result.ptr != begin + size) {
+        return false;
+    }
+    m_pos += size;
+    return true;
+}
+
+bool JsonReader::ReadUInt(uint64_t& value) {
+    const char* begin;
+    size_t size;
+    bool integral;
+    if (!NumberToken(begin, size, integral) || !integral || *begin == '-') {
+        return false;
+    }
+    auto result = std::from_chars(begin, begin + size, value);
+    if (result.ec != std::errc() || result.ptr != begin + size) {
+        return false;
+    }
+    m_pos += size;
+    return true;
+}
+
+bool JsonReader::ReadDouble(double& value) {
+    const char* begin;
+    size_t size;
+    bool integral;
+    if (!NumberToken(begin, size, integral)) {
+        return false;
+    }
+
+    // strtod needs a terminated string; longer numbers are not plausible input
+    char buffer[64];
+    if (size >= sizeof(buffer)) {
+        return false;
+    }
+    std::memcpy(buffer, begin, size);
+    buffer[size] = '\0';
+    value = std::strtod(buffer, nullptr);
+    m_pos += size;
+    return true;
+}
+
+bool JsonReader::ReadString(std::string& value) {
+    if (PeekType() != Type::String) {
+        return false;
+    }
+    size_t pos = m_pos;
+    std::string_view raw;
+    bool escaped;
+    if (!StringToken(m_data, m_size, pos, raw, escaped)) {
+        return false;
+    }
+    if (escaped) {
+        if (!Unescape(raw, value)) return false;
+    } else {
+        value.assign(raw.data(), raw.size());
+    }
+    m_pos = pos;
+    return true;
+}
+
+bool JsonReader::BeginObject() {
+    if (PeekType() != Type::Object || m_depth >= MAX_DEPTH) {
+        return false;
+    }
+    m_pos++;
+    m_depth++;
+    m_hasItems &= ~(uint64_t{1} << (m_depth - 1));
+    return true;
+}
+
+bool JsonReader::BeginArray() {
+    if (PeekType() != Type::Array || m_depth >= MAX_DEPTH) {
+        return false;
+    }
+    m_pos++;
+    m_depth++;
+    m_hasItems &= ~(uint64_t{1} << (m_depth - 1));
+    return true;
+}
+
+bool JsonReader::NextInContainer(uint8_t close, bool& end) {
+    if (m_depth == 0) {
+        return false;
+    }
+    SkipWhitespace();
+    if (m_pos >= m_size) {
+        return false;
+    }
+
+    uint64_t bit = uint64_t{1} << (m_depth - 1);
+    if (m_data[m_pos] == close) {
+        m_pos++;
+        m_depth--;
+        end = true;
+        return true;
+    }
+    if (m_hasItems & bit) {
+        if (m_data[m_pos] != ',') return false;
+        m_pos++;
+        SkipWhitespace();
+        if (m_pos < m_size && m_data[m_pos] == close) return false;  // Trailing comma
+    }
+    m_hasItems |= bit;
+    end = false;
+    return true;
+}
+
+bool JsonReader::NextKey(std::string_view& key, bool& end) {
+    if (!NextInContainer('}', end)) {
+        return false;
+    }
+    if (end) {
+        return true;
+    }
+
+    std::string_view raw;
+    bool escaped;
+    if (!StringToken(m_data, m_size, m_pos, raw, escaped)) {
+        return false;
+    }
+    if (escaped) {
+        if (!Unescape(raw, m_keyScratch)) return false;
+        key = m_keyScratch;
+    } else {
+        key = raw;
+    }
+
+    SkipWhitespace();
+    if (m_pos >= m_size || m_data[m_pos] != ':') {
+        return false;
+    }
+    m_pos++;
+    return true;
+}
+
+bool JsonReader::NextItem(bool& end) {
+    return NextInContainer(']', end);
+}
+
+bool JsonReader::Skip(int depth) {
+    if (depth > MAX_DEPTH) {
+        return false;
+    }
+
+    switch (PeekType()) {
+        case Type::Null:
+            return ReadNull();
+        case Type::Bool: {
+            bool b;
+            return ReadBool(b);
+        }
+        case Type::Number: {
+            const char* begin;
+            size_t size;
+            bool integral;
+            if (!NumberToken(begin, size, integral)) return false;
+            m_pos += size;
+            return true;
+        }
+        case Type::String: {
+            std::string_view raw;
+            bool escaped;
+            return StringToken(m_data, m_size, m_pos, raw, escaped);
+        }
+        case Type::Array: {
+            if (!BeginArray()) return false;
+            bool end;
+            while (NextItem(end)) {
+                if (end) return true;
+                if (!Skip(depth + 1)) return false;
+            }
+            return false;
+        }
+        case Type::Object: {
+            if (!BeginObject()) return false;
+            std::string_view key;
+            bool end;
+            while (NextKey(key, end)) {
+                if (end) return true;
+                if (!Skip(depth + 1)) return false;
+            }
+            return false;
+        }
+        case Type::Invalid:
+            break;
+    }
+    return false;
+}
+
+} // namespace clipx
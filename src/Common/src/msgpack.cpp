@@ -0,0 +1,409 @@
+#include "common/msgpack.h"
+#include <cstring>
+
+namespace clipx {
+
+void MsgPackWriter::BigEndian(uint64_t value, int bytes) {
+    for (int i = bytes - 1; i >= 0; i--) {
+        Byte(static_cast<uint8_t>(value >> (i * 8)));
+    }
+}
+
+void MsgPackWriter::Nil() {
+    Byte(0xc0);
+}
+
+void MsgPackWriter::Bool(bool value) {
+    Byte(value ? 0xc3 : 0xc2);
+}
+
+void MsgPackWriter::Int(int64_t value) {
+    if (value >= 0) {
+        UInt(static_cast<uint64_t>(value));
+    } else if (value >= -32) {
+        Byte(static_cast<uint8_t>(value));
+    } else if (value >= INT8_MIN) {
+        Byte(0xd0);
+        BigEndian(static_cast<uint64_t>(value), 1);
+    } else if (value >= INT16_MIN) {
+        Byte(0xd1);
+        BigEndian(static_cast<uint64_t>(value), 2);
+    } else if (value >= INT32_MIN) {
+        Byte(0xd2);
+        BigEndian(static_cast<uint64_t>(value), 4);
+    } else {
+        Byte(0xd3);
+        BigEndian(static_cast<uint64_t>(value), 8);
+    }
+}
+
+void MsgPackWriter::UInt(uint64_t value) {
+    if (value <= 0x7f) {
+        Byte(static_cast<uint8_t>(value));
+    } else if (value <= UINT8_MAX) {
+        Byte(0xcc);
+        BigEndian(value, 1);
+    } else if (value <= UINT16_MAX) {
+        Byte(0xcd);
+        BigEndian(value, 2);
+    } else if (value <= UINT32_MAX) {
+        Byte(0xce);
+        BigEndian(value, 4);
+    } else {
+        Byte(0xcf);
+        BigEndian(value, 8);
+    }
+}
+
+void MsgPackWriter::Double(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    Byte(0xcb);
+    BigEndian(bits, 8);
+}
+
+void MsgPackWriter::String(const char* data, size_t size) {
+    if (size <= 31) {
+        Byte(static_cast<uint8_t>(0xa0 | size));
+    } else if (size <= UINT8_MAX) {
+        Byte(0xd9);
+        BigEndian(size, 1);
+    } else if (size <= UINT16_MAX) {
+        Byte(0xda);
+        BigEndian(size, 2);
+    } else {
+        Byte(0xdb);
+        BigEndian(size, 4);
+    }
+    m_out.insert(m_out.end(), data, data + size);
+}
+
+void MsgPackWriter::Binary(const uint8_t* data, size_t size) {
+    if (size <= UINT8_MAX) {
+        Byte(0xc4);
+        BigEndian(size, 1);
+    } else if (size <= UINT16_MAX) {
+        Byte(0xc5);
+        BigEndian(size, 2);
+    } else {
+        Byte(0xc6);
+        BigEndian(size, 4);
+    }
+    m_out.insert(m_out.end(), data, data + size);
+}
+
+void MsgPackWriter::ArrayHeader(uint32_t count) {
+    if (count <= 15) {
+        Byte(static_cast<uint8_t>(0x90 | count));
+    } else if (count <= UINT16_MAX) {
+        Byte(0xdc);
+        BigEndian(count, 2);
+    } else {
+        Byte(0xdd);
+        BigEndian(count, 4);
+    }
+}
+
+void MsgPackWriter::MapHeader(uint32_t count) {
+    if (count <= 15) {
+        Byte(static_cast<uint8_t>(0x80 | count));
+    } else if (count <= UINT16_MAX) {
+        Byte(0xde);
+        BigEndian(count, 2);
+    } else {
+        Byte(0xdf);
+        BigEndian(count, 4);
+    }
+}
+
+uint64_t MsgPackReader::BigEndian(size_t offset, int bytes) const {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value = (value << 8) | m_data[offset + i];
+    }
+    return value;
+}
+
+MsgPackReader::Type MsgPackReader::PeekType() const {
+    if (AtEnd()) return Type::Invalid;
+
+    uint8_t tag = m_data[m_pos];
+    if (tag <= 0x7f) return Type::UInt;
+    if (tag <= 0x8f) return Type::Map;
+    if (tag <= 0x9f) return Type::Array;
+    if (tag <= 0xbf) return Type::String;
+    if (tag >= 0xe0) return Type::Int;
+
+    switch (tag) {
+        case 0xc0: return Type::Nil;
+        case 0xc2: case 0xc3: return Type::Bool;
+        case 0xc4: case 0xc5: case 0xc6: return Type::Binary;
+        case 0xca: case 0xcb: return Type::Float;
+        case 0xcc: case 0xcd: case 0xce: case 0xcf: return Type::UInt;
+        case 0xd0: case 0xd1: case 0xd2: case 0xd3: return Type::Int;
+        case 0xd9: case 0xda: case 0xdb: return Type::String;
+        case 0xdc: case 0xdd: return Type::Array;
+        case 0xde: case 0xdf: return Type::Map;
+        default: return Type::Invalid;
+    }
+}
+
+bool MsgPackReader::ReadNil() {
+    if (AtEnd() || m_data[m_pos] != 0xc0) return false;
+    m_pos++;
+    return true;
+}
+
+bool MsgPackReader::ReadBool(bool& value) {
+    if (AtEnd() || (m_data[m_pos] != 0xc2 && m_data[m_pos] != 0xc3)) return false;
+    value = m_data[m_pos++] == 0xc3;
+    return true;
+}
+
+bool MsgPackReader::ReadUInt(uint64_t& value) {
+    if (AtEnd()) return false;
+
+    uint8_t tag = m_data[m_pos];
+    if (tag <= 0x7f) {
+        value = tag;
+        m_pos++;
+        return true;
+    }
+
+    int bytes = 0;
+    bool isSigned = false;
+    switch (tag) {
+        case 0xcc: bytes = 1; break;
+        case 0xcd: bytes = 2; break;
+        case 0xce: bytes = 4; break;
+        case 0xcf: bytes = 8; break;
+        case 0xd0: bytes = 1; isSigned = true; break;
+        case 0xd1: bytes = 2; isSigned = true; break;
+        case 0xd2: bytes = 4; isSigned = true; break;
+        case 0xd3: bytes = 8; isSigned = true; break;
+        default: return false;
+    }
+    if (!Has(1 + bytes)) return false;
+
+    uint64_t raw = BigEndian(m_pos + 1, bytes);
+    if (isSigned && (raw >> (bytes * 8 - 1)) != 0) {
+        return false;  // Negative
+    }
+    value = raw;
+    m_pos += 1 + bytes;
+    return true;
+}
+
+bool MsgPackReader::ReadInt(int64_t& value) {
+    if (AtEnd()) return false;
+
+    uint8_t tag = m_data[m_pos];
+    if (tag >= 0xe0) {
+        value = static_cast<int8_t>(tag);
+        m_pos++;
+        return true;
+    }
+
+    int bytes = 0;
+    switch (tag) {
+        case 0xd0: bytes = 1; break;
+        case 0xd1: bytes = 2; break;
+        case 0xd2: bytes = 4; break;
+        case 0xd3: bytes = 8; break;
+        default: {
+            uint64_t unsignedValue;
+            size_t start = m_pos;
+            if (!ReadUInt(unsignedValue)) return false;
+            if (unsignedValue > static_cast<uint64_t>(INT64_MAX)) {
+                m_pos = start;
+                return false;
+            }
+            value = static_cast<int64_t>(unsignedValue);
+            return true;
+        }
+    }
+    if (!Has(1 + bytes)) return false;
+
+    // Sign-extend from the encoded width
+    uint64_t raw = BigEndian(m_pos + 1, bytes);
+    int shift = 64 - bytes * 8;
+    value = static_cast<int64_t>(raw << shift) >> shift;
+    m_pos += 1 + bytes;
+    return true;
+}
+
+bool MsgPackReader::ReadDouble(double& value) {
+    if (AtEnd()) return false;
+
+    uint8_t tag = m_data[m_pos];
+    if (tag == 0xca) {
+        if (!Has(5)) return false;
+        uint32_t bits = static_cast<uint32_t>(BigEndian(m_pos + 1, 4));
+        float f;
+        std::memcpy(&f, &bits, sizeof(f));
+        value = f;
+        m_pos += 5;
+        return true;
+    }
+    if (tag == 0xcb) {
+        if (!Has(9)) return false;
+        uint64_t bits = BigEndian(m_pos + 1, 8);
+        std::memcpy(&value, &bits, sizeof(value));
+        m_pos += 9;
+        return true;
+    }
+
+    int64_t integer;
+    if (ReadInt(integer)) {
+        value = static_cast<double>(integer);
+        return true;
+    }
+    uint64_t unsignedInteger;
+    if (ReadUInt(unsignedInteger)) {
+        value = static_cast<double>(unsignedInteger);
+        return true;
+    }
+    return false;
+}
+
+bool MsgPackReader::ReadString(const char*& data, size_t& size) {
+    if (AtEnd()) return false;
+
+    uint8_t tag = m_data[m_pos];
+    size_t header = 1;
+    size_t length = 0;
+    if (tag >= 0xa0 && tag <= 0xbf) {
+        length = tag & 0x1f;
+    } else if (tag == 0xd9 || tag == 0xda || tag == 0xdb) {
+        int bytes = tag == 0xd9 ? 1 : (tag == 0xda ? 2 : 4);
+        if (!Has(1 + bytes)) return false;
+        length = static_cast<size_t>(BigEndian(m_pos + 1, bytes));
+        header += bytes;
+    } else {
+        return false;
+    }
+
+    if (!Has(header) || m_size - m_pos - header < length) return false;
+    data = reinterpret_cast<const char*>(m_data + m_pos + header);
+    size = length;
+    m_pos += header + length;
+    return true;
+}
+
+bool MsgPackReader::ReadString(std::string& value) {
+    const char* data;
+    size_t size;
+    if (!ReadString(data, size)) return false;
+    value.assign(data, size);
+    return true;
+}
+
+bool MsgPackReader::ReadBinary(const uint8_t*& data, size_t& size) {
+    if (AtEnd()) return false;
+
+    uint8_t tag = m_data[m_pos];
+    int bytes = tag == 0xc4 ? 1 : (tag == 0xc5 ? 2 : (tag == 0xc6 ? 4 : 0));
+    if (bytes == 0 || !Has(1 + bytes)) return false;
+
+    size_t length = static_cast<size_t>(BigEndian(m_pos + 1, bytes));
+    size_t header = 1 + bytes;
+    if (m_size - m_pos - header < length) return false;
+    data = m_data + m_pos + header;
+    size = length;
+    m_pos += header + length;
+    return true;
+}
+
+bool MsgPackReader::ReadArrayHeader(uint32_t& count) {
+    if (AtEnd()) return false;
+
+    uint8_t tag = m_data[m_pos];
+    if (tag >= 0x90 && tag <= 0x9f) {
+        count = tag & 0x0f;
+        m_pos++;
+        return true;
+    }
+    int bytes = tag == 0xdc ? 2 : (tag == 0xdd ? 4 : 0);
+    if (bytes == 0 || !Has(1 + bytes)) return false;
+    count = static_cast<uint32_t>(BigEndian(m_pos + 1, bytes));
+    m_pos += 1 + bytes;
+    return true;
+}
+
+bool MsgPackReader::ReadMapHeader(uint32_t& count) {
+    if (AtEnd()) return false;
+
+    uint8_t tag = m_data[m_pos];
+    if (tag >= 0x80 && tag <= 0x8f) {
+        count = tag & 0x0f;
+        m_pos++;
+        return true;
+    }
+    int bytes = tag == 0xde ? 2 : (tag == 0xdf ? 4 : 0);
+    if (bytes == 0 || !Has(1 + bytes)) return false;
+    count = static_cast<uint32_t>(BigEndian(m_pos + 1, bytes));
+    m_pos += 1 + bytes;
+    return true;
+}
+
+bool MsgPackReader::Skip(int depth) {
+    if (depth > MAX_DEPTH) return false;
+
+    size_t start = m_pos;
+    auto fail = [&]() {
+        m_pos = start;
+        return false;
+    };
+
+    switch (PeekType()) {
+        case Type::Nil:
+            return ReadNil();
+        case Type::Bool: {
+            bool b;
+            return ReadBool(b);
+        }
+        case Type::Int: {
+            int64_t i;
+            return ReadInt(i);
+        }
+        case Type::UInt: {
+            uint64_t u;
+            return ReadUInt(u);
+        }
+        case Type::Float: {
+            double d;
+            return ReadDouble(d);
+        }
+        case Type::String: {
+            const char* s;
+            size_t n;
+            return ReadString(s, n);
+        }
+        case Type::Binary: {
+            const uint8_t* b;
+            size_t n;
+            return ReadBinary(b, n);
+        }
+        case Type::Array: {
+            uint32_t count;
+            if (!ReadArrayHeader(count)) return false;
+            for (uint32_t i = 0; i < count; i++) {
+                if (!Skip(depth + 1)) return fail();
+            }
+            return true;
+        }
+        case Type::Map: {
+            uint32_t count;
+            if (!ReadMapHeader(count)) return false;
+            for (uint32_t i = 0; i < count; i++) {
+                if (!Skip(depth + 1) || !Skip(depth + 1)) return fail();
+            }
+            return true;
+        }
+        case Type::Invalid:
+            break;
+    }
+    return false;
+}
+
+} // namespace clipx
@@ -0,0 +1,900 @@
+#include "common/regex.h"
+#include <algorithm>
+
+namespace clipx {
+
+namespace {
+
+constexpr uint32_t TEXT_BOUNDARY = 0xFFFFFFFF;  // Before the first / after the last character
+constexpr uint32_t MAX_CODE_POINT = 0x10FFFF;
+constexpr size_t MAX_PROGRAM_SIZE = 20000;
+constexpr int MAX_REPEAT = 1000;
+constexpr size_t MAX_LITERALS = 4;
+
+// Decode one UTF-8 sequence; malformed input yields U+FFFD for one byte
+size_t DecodeUtf8(const unsigned char* p, size_t available, uint32_t& cp) {
+    unsigned char c = p[0];
+    if (c < 0x80) {
+        cp = c;
+        return 1;
+    }
+
+    size_t length = 0;
+    uint32_t value = 0;
+    uint32_t minimum = 0;
+    if ((c & 0xE0) == 0xC0) { length = 2; value = c & 0x1F; minimum = 0x80; }
+    else if ((c & 0xF0) == 0xE0) { length = 3; value = c & 0x0F; minimum = 0x800; }
+    else if ((c & 0xF8) == 0xF0) { length = 4; value = c & 0x07; minimum = 0x10000; }
+
+    if (length == 0 || length > available) {
+        cp = 0xFFFD;
+        return 1;
+    }
+    for (size_t i = 1; i < length; i++) {
+        if ((p[i] & 0xC0) != 0x80) {
+            cp = 0xFFFD;
+            return 1;
+        }
+        value = (value << 6) | (p[i] & 0x3F);
+    }
+    if (value < minimum || value > MAX_CODE_POINT || (value >= 0xD800 && value <= 0xDFFF)) {
+        cp = 0xFFFD;
+        return 1;
+    }
+    cp = value;
+    return length;
+}
+
+void AppendUtf8(std::string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+inline uint32_t FoldCase(uint32_t cp) {
+    return (cp >= 'A' && cp <= 'Z') ? cp + ('a' - 'A') : cp;
+}
+
+inline bool IsWordChar(uint32_t cp) {
+    return (cp >= 'a' && cp <= 'z') || (cp >= 'A' && cp <= 'Z') || (cp >= '0' && cp <= '9') || cp == '_';
+}
+
+void AddClassEscape(std::vector<Regex::Range>& ranges, char escape) {
+    std::vector<Regex::Range> set;
+    switch (escape) {
+        case 'd': case 'D':
+            set = {{'0', '9'}};
+            break;
+        case 'w': case 'W':
+            set = {{'0', '9'}, {'A', 'Z'}, {'_', '_'}, {'a', 'z'}};
+            break;
+        case 's': case 'S':
+            set = {{'\t', '\r'}, {' ', ' '}};
+            break;
+    }
+
+    if (escape >= 'a') {
+        ranges.insert(ranges.end(), set.begin(), set.end());
+        return;
+    }
+
+    // Upper case escapes are the complement of the set
+    uint32_t next = 0;
+    for (const auto& range : set) {
+        if (range.lo > next) ranges.push_back({next, range.lo - 1});
+        next = range.hi + 1;
+    }
+    ranges.push_back({next, MAX_CODE_POINT});
+}
+
+void NormalizeRanges(std::vector<Regex::Range>& ranges) {
+    std::sort(ranges.begin(), ranges.end(), [](const Regex::Range& a, const Regex::Range& b) {
+        return a.lo < b.lo;
+    });
+    std::vector<Regex::Range> merged;
+    for (const auto& range : ranges) {
+        if (!merged.empty() && range.lo <= merged.back().hi + 1) {
+            merged.back().hi = std::max(merged.back().hi, range.hi);
+        } else {
+            merged.push_back(range);
+        }
+    }
+    ranges.swap(merged);
+}
+
+struct Node {
+    enum Kind {
+        Empty,
+        Literal,
+        Class,
+        Any,
+        LineStart,
+        LineEnd,
+        WordBoundary,
+        NotWordBoundary,
+        Concat,
+        Alternate,
+        Repeat
+    };
+
+    Kind kind = Empty;
+    uint32_t cp = 0;
+    int classIndex = -1;
+    int min = 0;
+    int max = 0;  // -1 = unbounded
+    std::vector<Node> children;
+};
+
+// What the literal prefilter knows about a sub-expression
+struct LiteralInfo {
+    bool exact = false;             // The node only ever matches `text`
+    std::string text;
+    std::string prefix;             // Every match starts with this
+    std::string suffix;             // Every match ends with this
+    std::vector<std::string> must;  // Every match contains all of these
+
+    static LiteralInfo Exact(std::string s) {
+        LiteralInfo info;
+        info.exact = true;
+        info.text = std::move(s);
+        return info;
+    }
+    const std::string& Prefix() const { return exact ? text : prefix; }
+    const std::string& Suffix() const { return exact ? text : suffix; }
+};
+
+// Shorten a byte-wise common prefix/suffix so it doesn't split a UTF-8 sequence
+size_t TrimPrefixToBoundary(const std::string& s, size_t length) {
+    while (length > 0 && length < s.size() && (static_cast<unsigned char>(s[length]) & 0xC0) == 0x80) length--;
+    return length;
+}
+
+size_t TrimSuffixToBoundary(const std::string& s, size_t length) {
+    while (length > 0 && (static_cast<unsigned char>(s[s.size() - length]) & 0xC0) == 0x80) length--;
+    return length;
+}
+
+} // namespace
+
+// Parses a pattern into a syntax tree, then emits the VM program
+class RegexCompiler {
+public:
+    RegexCompiler(Regex& regex, const std::string& pattern, bool ignoreCase)
+        : m_regex(regex), m_ignoreCase(ignoreCase) {
+        const auto* bytes = reinterpret_cast<const unsigned char*>(pattern.data());
+        for (size_t i = 0; i < pattern.size();) {
+            uint32_t cp;
+            i += DecodeUtf8(bytes + i, pattern.size() - i, cp);
+            m_input.push_back(cp);
+        }
+    }
+
+    bool Compile(std::string& error) {
+        Node root;
+        if (!ParseAlternate(root)) {
+            error = m_error;
+            return false;
+        }
+        if (m_pos != m_input.size()) {
+            error = "Unmatched ')' at position " + std::to_string(m_pos);
+            return false;
+        }
+
+        if (!Emit(root)) {
+            error = m_error;
+            return false;
+        }
+        m_regex.m_program.push_back({Regex::Inst::Match});
+
+        CollectLiterals(Analyze(root));
+        return true;
+    }
+
+private:
+    bool Fail(const std::string& message) {
+        m_error = message;
+        return false;
+    }
+
+    bool AtEnd() const { return m_pos >= m_input.size(); }
+    uint32_t Peek() const { return m_input[m_pos]; }
+
+    bool ParseAlternate(Node& out) {
+        Node first;
+        if (!ParseConcat(first)) return false;
+        if (AtEnd() || Peek() != '|') {
+            out = std::move(first);
+            return true;
+        }
+
+        out.kind = Node::Alternate;
+        out.children.push_back(std::move(first));
+        while (!AtEnd() && Peek() == '|') {
+            m_pos++;
+            Node next;
+            if (!ParseConcat(next)) return false;
+            out.children.push_back(std::move(next));
+        }
+        return true;
+    }
+
+    bool ParseConcat(Node& out) {
+        out.kind = Node::Concat;
+        while (!AtEnd() && Peek() != '|' && Peek() != ')') {
+            Node item;
+            if (!ParseRepeat(item)) return false;
+            out.children.push_back(std::move(item));
+        }
+        if (out.children.empty()) {
+            out.kind = Node::Empty;
+        } else if (out.children.size() == 1) {
+            Node single = std::move(out.children[0]);
+            out = std::move(single);
+        }
+        return true;
+    }
+
+    // {n}, {n,} or {n,m}; anything else is a literal brace
+    bool ParseBraces(int& min, int& max) {
+        size_t pos = m_pos + 1;
+        auto readNumber = [&](int& value) {
+            size_t start = pos;
+            value = 0;
+            while (pos < m_input.size() && m_input[pos] >= '0' && m_input[pos] <= '9') {
+                value = std::min(value * 10 + static_cast<int>(m_input[pos] - '0'), MAX_REPEAT + 1);
+                pos++;
+            }
+            return pos > start;
+        };
+
+        if (!readNumber(min)) return false;
+        max = min;
+        if (pos < m_input.size() && m_input[pos] == ',') {
+            pos++;
+            if (!readNumber(max)) max = -1;
+        }
+        if (pos >= m_input.size() || m_input[pos] != '}') return false;
+        m_pos = pos + 1;
+        return true;
+    }
+
+    bool ParseRepeat(Node& out) {
+        if (!ParseAtom(out)) return false;
+
+        while (!AtEnd()) {
+            int min = 0;
+            int max = 0;
+            uint32_t c = Peek();
+            if (c == '*') { min = 0; max = -1; m_pos++; }
+            else if (c == '+') { min = 1; max = -1; m_pos++; }
+            else if (c == '?') { min = 0; max = 1; m_pos++; }
+            else if (c == '{' && ParseBraces(min, max)) {
+                if (min > MAX_REPEAT || max > MAX_REPEAT) return Fail("Repeat count exceeds " + std::to_string(MAX_REPEAT));
+                if (max != -1 && max < min) return Fail("Invalid repeat range");
+            } else {
+                break;
+            }
+
+            // Lazy quantifiers accept the same texts
+            if (!AtEnd() && Peek() == '?') m_pos++;
+
+            Node repeat;
+            repeat.kind = Node::Repeat;
+            repeat.min = min;
+            repeat.max = max;
+            repeat.children.push_back(std::move(out));
+            out = std::move(repeat);
+        }
+        return true;
+    }
+
+    bool ParseAtom(Node& out) {
+        uint32_t c = Peek();
+        m_pos++;
+
+        switch (c) {
+            case '(': {
+                if (m_pos + 1 < m_input.size() && Peek() == '?' && m_input[m_pos + 1] == ':') {
+                    m_pos += 2;
+                }
+                if (!ParseAlternate(out)) return false;
+                if (AtEnd() || Peek() != ')') return Fail("Missing ')'");
+                m_pos++;
+                return true;
+            }
+            case '[':
+                return ParseClass(out);
+            case '.':
+                out.kind = Node::Any;
+                return true;
+            case '^':
+                out.kind = Node::LineStart;
+                return true;
+            case '$':
+                out.kind = Node::LineEnd;
+                return true;
+            case '*': case '+': case '?':
+                return Fail("Nothing to repeat at position " + std::to_string(m_pos - 1));
+            case '\\':
+                return ParseEscape(out);
+            default:
+                out.kind = Node::Literal;
+                out.cp = c;
+                return true;
+        }
+    }
+
+    // Escapes valid both inside and outside classes. Sets `cp` for single
+    // characters or fills `ranges` for class shorthands.
+    bool ParseEscapeCommon(uint32_t& cp, std::vector<Regex::Range>* ranges, bool& isClass) {
+        if (AtEnd()) return Fail("Trailing backslash");
+        uint32_t c = Peek();
+        m_pos++;
+        isClass = false;
+
+        switch (c) {
+            case 'd': case 'D': case 'w': case 'W': case 's': case 'S':
+                isClass = true;
+                AddClassEscape(*ranges, static_cast<char>(c));
+                return true;
+            case 'n': cp = '\n'; return true;
+            case 'r': cp = '\r'; return true;
+            case 't': cp = '\t'; return true;
+            case 'f': cp = '\f'; return true;
+            case 'v': cp = '\v'; return true;
+            case '0': cp = 0; return true;
+            case 'x': {
+                uint32_t value = 0;
+                for (int i = 0; i < 2; i++) {
+                    if (AtEnd()) return Fail("Incomplete \\x escape");
+                    uint32_t h = Peek();
+                    m_pos++;
+                    if (h >= '0' && h <= '9') value = value * 16 + (h - '0');
+                    else if (h >= 'a' && h <= 'f') value = value * 16 + (h - 'a' + 10);
+                    else if (h >= 'A' && h <= 'F') value = value * 16 + (h - 'A' + 10);
+                    else return Fail("Invalid \\x escape");
+                }
+                cp = value;
+                return true;
+            }
+            default:
+                if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) {
+                    return Fail(std::string("Unsupported escape \\") + static_cast<char>(c));
+                }
+                cp = c;
+                return true;
+        }
+    }
+
+    bool ParseEscape(Node& out) {
+        if (!AtEnd() && (Peek() == 'b' || Peek() == 'B')) {
+            out.kind = Peek() == 'b' ? Node::WordBoundary : Node::NotWordBoundary;
+            m_pos++;
+            return true;
+        }
+
+        uint32_t cp = 0;
+        bool isClass = false;
+        Regex::CharClass cls;
+        if (!ParseEscapeCommon(cp, &cls.ranges, isClass)) return false;
+
+        if (isClass) {
+            out.kind = Node::Class;
+            out.classIndex = AddClass(std::move(cls));
+        } else {
+            out.kind = Node::Literal;
+            out.cp = cp;
+        }
+        return true;
+    }
+
+    bool ParseClass(Node& out) {
+        Regex::CharClass cls;
+        if (!AtEnd() && Peek() == '^') {
+            cls.negated = true;
+            m_pos++;
+        }
+
+        bool first = true;
+        while (true) {
+            if (AtEnd()) return Fail("Missing ']'");
+            uint32_t c = Peek();
+            if (c == ']' && !first) {
+                m_pos++;
+                break;
+            }
+            first = false;
+
+            uint32_t lo = c;
+            m_pos++;
+            if (c == '\\') {
+                bool isClass = false;
+                if (!ParseEscapeCommon(lo, &cls.ranges, isClass)) return false;
+                if (isClass) continue;
+            }
+
+            uint32_t hi = lo;
+            if (m_pos + 1 < m_input.size() && Peek() == '-' && m_input[m_pos + 1] != ']') {
+                m_pos++;
+                hi = Peek();
+                m_pos++;
+                if (hi == '\\') {
+                    bool isClass = false;
+                    if (!ParseEscapeCommon(hi, &cls.ranges, isClass)) return false;
+                    if (isClass) return Fail("Invalid class range");
+                }
+                if (hi < lo) return Fail("Invalid class range");
+            }
+            cls.ranges.push_back({lo, hi});
+        }
+
+        out.kind = Node::Class;
+        out.classIndex = AddClass(std::move(cls));
+        return true;
+    }
+
+    int AddClass(Regex::CharClass cls) {
+        if (m_ignoreCase) {
+            // Add the other ASCII case of every letter range
+            std::vector<Regex::Range> extra;
+            for (const auto& range : cls.ranges) {
+                uint32_t lo = std::max<uint32_t>(range.lo, 'A');
+                uint32_t hi = std::min<uint32_t>(range.hi, 'Z');
+                if (lo <= hi) extra.push_back({lo + 32, hi + 32});
+                lo = std::max<uint32_t>(range.lo, 'a');
+                hi = std::min<uint32_t>(range.hi, 'z');
+                if (lo <= hi) extra.push_back({lo - 32, hi - 32});
+            }
+            cls.ranges.insert(cls.ranges.end(), extra.begin(), extra.end());
+        }
+        NormalizeRanges(cls.ranges);
+        m_regex.m_classes.push_back(std::move(cls));
+        return static_cast<int>(m_regex.m_classes.size()) - 1;
+    }
+
+    int Append(Regex::Inst inst) {
+        m_regex.m_program.push_back(inst);
+        return static_cast<int>(m_regex.m_program.size()) - 1;
+    }
+
+    bool Emit(const Node& node) {
+        auto& program = m_regex.m_program;
+        if (program.size() > MAX_PROGRAM_SIZE) {
+            return Fail("Pattern is too large");
+        }
+
+        switch (node.kind) {
+            case Node::Empty:
+                return true;
+            case Node::Literal:
+                Append({Regex::Inst::Char, m_ignoreCase ? FoldCase(node.cp) : node.cp});
+                return true;
+            case Node::Class:
+                Append({Regex::Inst::Class, static_cast<uint32_t>(node.classIndex)});
+                return true;
+            case Node::Any:
+                Append({Regex::Inst::Any});
+                return true;
+            case Node::LineStart:
+                Append({Regex::Inst::LineStart});
+                return true;
+            case Node::LineEnd:
+                Append({Regex::Inst::LineEnd});
+                return true;
+            case Node::WordBoundary:
+                Append({Regex::Inst::WordBoundary});
+                return true;
+            case Node::NotWordBoundary:
+                Append({Regex::Inst::NotWordBoundary});
+                return true;
+            case Node::Concat:
+                for (const auto& child : node.children) {
+                    if (!Emit(child)) return false;
+                }
+                return true;
+            case Node::Alternate: {
+                //     split L1, next
+                // L1: child; jmp end
+                std::vector<int> jumps;
+                for (size_t i = 0; i < node.children.size(); i++) {
+                    if (i + 1 < node.children.size()) {
+                        int split = Append({Regex::Inst::Split});
+                        program[split].x = split + 1;
+                        if (!Emit(node.children[i])) return false;
+                        jumps.push_back(Append({Regex::Inst::Jmp}));
+                        program[split].y = static_cast<int>(program.size());
+                    } else if (!Emit(node.children[i])) {
+                        return false;
+                    }
+                }
+                for (int jump : jumps) {
+                    program[jump].x = static_cast<int>(program.size());
+                }
+                return true;
+            }
+            case Node::Repeat:
+                return EmitRepeat(node);
+        }
+        return true;
+    }
+
+    bool EmitRepeat(const Node& node) {
+        auto& program = m_regex.m_program;
+        const Node& child = node.children[0];
+
+        for (int i = 0; i < node.min; i++) {
+            if (!Emit(child)) return false;
+        }
+
+        if (node.max == -1) {
+            // L: split body, end; body; jmp L
+            int split = Append({Regex::Inst::Split});
+            program[split].x = split + 1;
+            if (!Emit(child)) return false;
+            int jump = Append({Regex::Inst::Jmp});
+            program[jump].x = split;
+            program[split].y = static_cast<int>(program.size());
+            return true;
+        }
+
+        // Optional copies: split body, end; body
+        for (int i = node.min; i < node.max; i++) {
+            int split = Append({Regex::Inst::Split});
+            program[split].x = split + 1;
+            if (!Emit(child)) return false;
+            program[split].y = static_cast<int>(program.size());
+        }
+        return true;
+    }
+
+    LiteralInfo Analyze(const Node& node) {
+        switch (node.kind) {
+            case Node::Empty:
+            case Node::LineStart:
+            case Node::LineEnd:
+            case Node::WordBoundary:
+            case Node::NotWordBoundary:
+                return LiteralInfo::Exact("");
+            case Node::Literal: {
+                std::string s;
+                AppendUtf8(s, FoldCase(node.cp));
+                return LiteralInfo::Exact(s);
+            }
+            case Node::Class: {
+                // A one-character class (after case folding) is a literal
+                const auto& cls = m_regex.m_classes[node.classIndex];
+                if (!cls.negated && !cls.ranges.empty()) {
+                    uint32_t folded = FoldCase(cls.ranges[0].lo);
+                    bool single = true;
+                    for (const auto& range : cls.ranges) {
+                        for (uint32_t cp = range.lo; cp <= range.hi && single; cp++) {
+                            single = FoldCase(cp) == folded;
+                        }
+                        if (!single) break;
+                    }
+                    if (single) {
+                        std::string s;
+                        AppendUtf8(s, folded);
+                        return LiteralInfo::Exact(s);
+                    }
+                }
+                return LiteralInfo();
+            }
+            case Node::Any:
+                return LiteralInfo();
+            case Node::Concat: {
+                LiteralInfo acc = LiteralInfo::Exact("");
+                for (const auto& child : node.children) {
+                    acc = Join(acc, Analyze(child));
+                }
+                return acc;
+            }
+            case Node::Alternate: {
+                std::vector<LiteralInfo> infos;
+                for (const auto& child : node.children) {
+                    infos.push_back(Analyze(child));
+                }
+
+                bool allSame = true;
+                for (const auto& info : infos) {
+                    allSame = allSame && info.exact && info.text == infos[0].text;
+                }
+                if (allSame) return infos[0];
+
+                LiteralInfo result;
+                result.prefix = infos[0].Prefix();
+                result.suffix = infos[0].Suffix();
+                for (const auto& info : infos) {
+                    const std::string& p = info.Prefix();
+                    size_t n = 0;
+                    while (n < result.prefix.size() && n < p.size() && result.prefix[n] == p[n]) n++;
+                    result.prefix.resize(TrimPrefixToBoundary(result.prefix, n));
+
+                    const std::string& s = info.Suffix();
+                    n = 0;
+                    while (n < result.suffix.size() && n < s.size() &&
+                           result.suffix[result.suffix.size() - 1 - n] == s[s.size() - 1 - n]) n++;
+                    n = TrimSuffixToBoundary(result.suffix, n);
+                    result.suffix = result.suffix.substr(result.suffix.size() - n);
+                }
+                return result;
+            }
+            case Node::Repeat: {
+                if (node.min == 0) return LiteralInfo();
+
+                LiteralInfo child = Analyze(node.children[0]);
+                if (child.exact && node.min == node.max && child.text.size() * node.min <= 64) {
+                    std::string s;
+                    for (int i = 0; i < node.min; i++) s += child.text;
+                    return LiteralInfo::Exact(s);
+                }
+
+                LiteralInfo result;
+                result.prefix = child.Prefix();
+                result.suffix = child.Suffix();
+                result.must = child.must;
+                if (child.exact) result.must.push_back(child.text);
+                return result;
+            }
+        }
+        return LiteralInfo();
+    }
+
+    static LiteralInfo Join(const LiteralInfo& a, const LiteralInfo& b) {
+        if (a.exact && b.exact) {
+            return LiteralInfo::Exact(a.text + b.text);
+        }
+
+        LiteralInfo result;
+        result.prefix = a.exact ? a.text + b.prefix : a.prefix;
+        result.suffix = b.exact ? a.suffix + b.text : b.suffix;
+        result.must = a.must;
+        result.must.insert(result.must.end(), b.must.begin(), b.must.end());
+        result.must.push_back(a.Suffix() + b.Prefix());
+        return result;
+    }
+
+    void CollectLiterals(const LiteralInfo& info) {
+        std::vector<std::string> all = info.must;
+        all.push_back(info.Prefix());
+        all.push_back(info.Suffix());
+
+        std::sort(all.begin(), all.end(), [](const std::string& a, const std::string& b) {
+            return a.size() > b.size();
+        });
+
+        // Keep the longest ones, dropping any that another literal already covers
+        auto& literals = m_regex.m_literals;
+        for (const auto& literal : all) {
+            if (literal.empty() || literals.size() >= MAX_LITERALS) continue;
+            bool covered = false;
+            for (const auto& kept : literals) {
+                if (kept.find(literal) != std::string::npos) {
+                    covered = true;
+                    break;
+                }
+            }
+            if (!covered) literals.push_back(literal);
+        }
+    }
+
+    Regex& m_regex;
+    bool m_ignoreCase;
+    std::vector<uint32_t> m_input;
+    size_t m_pos = 0;
+    std::string m_error;
+};
+
+std::shared_ptr<const Regex> Regex::Compile(const std::string& pattern, bool ignoreCase, std::string* error) {
+    std::string body = pattern;
+    if (body.compare(0, 4, "(?i)") == 0) {
+        ignoreCase = true;
+        body = body.substr(4);
+    }
+
+    std::shared_ptr<Regex> regex(new Regex());
+    regex->m_pattern = pattern;
+    regex->m_ignoreCase = ignoreCase;
+
+    std::string message;
+    RegexCompiler compiler(*regex, body, ignoreCase);
+    if (!compiler.Compile(message)) {
+        if (error) *error = message;
+        return nullptr;
+    }
+    return regex;
+}
+
+Regex::Result Regex::Search(const char* text, size_t size, Clock::time_point deadline) const {
+    // Thread lists and visit marks are reused across calls on the same thread
+    thread_local std::vector<int> currentList;
+    thread_local std::vector<int> nextList;
+    thread_local std::vector<int> stack;
+    thread_local std::vector<uint32_t> marks;
+    thread_local uint32_t generation = 0;
+
+    const size_t programSize = m_program.size();
+    if (marks.size() < programSize) {
+        marks.assign(programSize, 0);
+        generation = 0;
+    }
+
+    auto nextGeneration = [&]() {
+        if (++generation == 0) {
+            std::fill(marks.begin(), marks.end(), 0);
+            generation = 1;
+        }
+    };
+
+    // Follow empty transitions from pc and collect the consuming threads.
+    // prev/cur are the characters around the current position.
+    auto addThread = [&](std::vector<int>& list, int startPc, uint32_t prev, uint32_t cur) {
+        stack.clear();
+        stack.push_back(startPc);
+        while (!stack.empty()) {
+            int pc = stack.back();
+            stack.pop_back();
+            if (marks[pc] == generation) continue;
+            marks[pc] = generation;
+
+            const Inst& inst = m_program[pc];
+            switch (inst.op) {
+                case Inst::Jmp:
+                    stack.push_back(inst.x);
+                    break;
+                case Inst::Split:
+                    stack.push_back(inst.y);
+                    stack.push_back(inst.x);
+                    break;
+                case Inst::LineStart:
+                    if (prev == TEXT_BOUNDARY || prev == '\n') stack.push_back(pc + 1);
+                    break;
+                case Inst::LineEnd:
+                    if (cur == TEXT_BOUNDARY || cur == '\n' || (cur == '\r')) stack.push_back(pc + 1);
+                    break;
+                case Inst::WordBoundary:
+                case Inst::NotWordBoundary: {
+                    bool boundary = (prev != TEXT_BOUNDARY && IsWordChar(prev)) != (cur != TEXT_BOUNDARY && IsWordChar(cur));
+                    if (boundary == (inst.op == Inst::WordBoundary)) stack.push_back(pc + 1);
+                    break;
+                }
+                default:
+                    list.push_back(pc);
+                    break;
+            }
+        }
+    };
+
+    auto classMatches = [&](const CharClass& cls, uint32_t cp) {
+        bool inside = false;
+        for (const auto& range : cls.ranges) {
+            if (cp < range.lo) break;
+            if (cp <= range.hi) {
+                inside = true;
+                break;
+            }
+        }
+        return inside != cls.negated;
+    };
+
+    const auto* bytes = reinterpret_cast<const unsigned char*>(text);
+    size_t pos = 0;
+    uint32_t prev = TEXT_BOUNDARY;
+    uint32_t cur = TEXT_BOUNDARY;
+    size_t curLength = 0;
+    if (size > 0) curLength = DecodeUtf8(bytes, size, cur);
+
+    currentList.clear();
+    nextGeneration();
+    addThread(currentList, 0, prev, cur);
+
+    uint32_t steps = 0;
+    while (true) {
+        if ((++steps & 0x3FF) == 0 && deadline != Clock::time_point::max() && Clock::now() > deadline) {
+            return Result::Timeout;
+        }
+
+        size_t nextPos = pos + curLength;
+        uint32_t next = TEXT_BOUNDARY;
+        size_t nextLength = 0;
+        if (cur != TEXT_BOUNDARY && nextPos < size) {
+            nextLength = DecodeUtf8(bytes + nextPos, size - nextPos, next);
+        }
+
+        nextList.clear();
+        nextGeneration();
+
+        for (int pc : currentList) {
+            const Inst& inst = m_program[pc];
+            if (inst.op == Inst::Match) {
+                return Result::Match;
+            }
+            if (cur == TEXT_BOUNDARY) continue;
+
+            bool matched = false;
+            switch (inst.op) {
+                case Inst::Char:
+                    matched = (m_ignoreCase ? FoldCase(cur) : cur) == inst.value;
+                    break;
+                case Inst::Class:
+                    matched = classMatches(m_classes[inst.value], cur);
+                    break;
+                case Inst::Any:
+                    matched = cur != '\n';
+                    break;
+                default:
+                    break;
+            }
+            if (matched) {
+                addThread(nextList, pc + 1, cur, next);
+            }
+        }
+
+        if (cur == TEXT_BOUNDARY) {
+            return Result::NoMatch;
+        }
+
+        // Unanchored search: a match may also start at the next position
+        addThread(nextList, 0, cur, next);
+
+        currentList.swap(nextList);
+        prev = cur;
+        cur = next;
+        pos = nextPos;
+        curLength = nextLength;
+    }
+}
+
+RegexCache& RegexCache::Instance() {
+    static RegexCache instance;
+    return instance;
+}
+
+std::shared_ptr<const Regex> RegexCache::Get(const std::string& pattern, bool ignoreCase, std::string* error) {
+    Key key = (ignoreCase ? "i:" : "c:") + pattern;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_index.find(key);
+        if (it != m_index.end()) {
+            m_lru.splice(m_lru.begin(), m_lru, it->second);
+            return it->second->second;
+        }
+    }
+
+    // Compile outside the lock; a concurrent miss on the same pattern just
+    // compiles it twice
+    auto regex = Regex::Compile(pattern, ignoreCase, error);
+    if (!regex) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_index.find(key);
+    if (it != m_index.end()) {
+        m_lru.splice(m_lru.begin(), m_lru, it->second);
+        return it->second->second;
+    }
+
+    m_lru.emplace_front(key, regex);
+    m_index[key] = m_lru.begin();
+    if (m_lru.size() > MAX_ENTRIES) {
+        m_index.erase(m_lru.back().first);
+        m_lru.pop_back();
+    }
+    return regex;
+}
+
+} // namespace clipx
@@ -0,0 +1,238 @@
+#include "common/search_query.h"
+#include "common/utils.h"
+#include "common/regex.h"
+#include <cctype>
+#include <cstdio>
+#include <ctime>
+
+namespace clipx {
+
+namespace {
+
+struct Token {
+    std::string key;    // Empty for free text
+    std::string value;
+    bool quoted = false;
+};
+
+// Split on whitespace; a double quote runs to the next quote so values can
+// contain spaces, and inside it \" and \\ stand for a quote and a
+// backslash. A key is only recognized before an unquoted colon.
+std::vector<Token> Tokenize(const std::string& input) {
+    std::vector<Token> tokens;
+    size_t i = 0;
+    const size_t n = input.size();
+
+    while (i < n) {
+        while (i < n && std::isspace(static_cast<unsigned char>(input[i]))) i++;
+        if (i >= n) break;
+
+        Token token;
+        std::string current;
+        bool sawColon = false;
+
+        while (i < n && !std::isspace(static_cast<unsigned char>(input[i]))) {
+            char c = input[i];
+            if (c == '"') {
+                for (i++; i < n && input[i] != '"'; i++) {
+                    if (input[i] == '\\' && i + 1 < n && (input[i + 1] == '"' || input[i + 1] == '\\')) i++;
+                    current += input[i];
+                }
+                token.quoted = true;
+                if (i < n) i++;  // Closing quote
+                continue;
+            }
+            if (c == ':' && !sawColon && !token.quoted && !current.empty()) {
+                token.key = utils::ToLower(current);
+                current.clear();
+                sawColon = true;
+                i++;
+                continue;
+            }
+            current += c;
+            i++;
+        }
+
+        token.value = current;
+        tokens.push_back(std::move(token));
+    }
+
+    return tokens;
+}
+
+std::optional<ClipboardDataType> ParseType(const std::string& value) {
+    std::string v = utils::ToLower(value);
+    if (v == "text" || v == "txt") return ClipboardDataType::Text;
+    if (v == "html") return ClipboardDataType::Html;
+    if (v == "rtf") return ClipboardDataType::Rtf;
+    if (v == "image" || v == "img") return ClipboardDataType::Image;
+    if (v == "files" || v == "file") return ClipboardDataType::Files;
+    return std::nullopt;
+}
+
+// YYYY-MM-DD (local midnight) or <number><m|h|d|w> before `now`
+std::optional<int64_t> ParseWhen(const std::string& value, int64_t now) {
+    if (value.empty()) return std::nullopt;
+
+    int year = 0, month = 0, day = 0;
+    char trailing = 0;
+    if (std::sscanf(value.c_str(), "%4d-%2d-%2d%c", &year, &month, &day, &trailing) == 3) {
+        if (month < 1 || month > 12 || day < 1 || day > 31) return std::nullopt;
+        std::tm tm = {};
+        tm.tm_year = year - 1900;
+        tm.tm_mon = month - 1;
+        tm.tm_mday = day;
+        tm.tm_isdst = -1;
+        std::time_t t = std::mktime(&tm);
+        if (t == static_cast<std::time_t>(-1)) return std::nullopt;
+        return static_cast<int64_t>(t) * 1000;
+    }
+
+    size_t digits = 0;
+    while (digits < value.size() && std::isdigit(static_cast<unsigned char>(value[digits]))) digits++;
+    if (digits == 0 || digits + 1 != value.size() || digits > 9) return std::nullopt;
+
+    int64_t amount = std::stoll(value.substr(0, digits));
+    int64_t unitMs = 0;
+    switch (std::tolower(static_cast<unsigned char>(value.back()))) {
+        case 'm': unitMs = 60LL * 1000; break;
+        case 'h': unitMs = 60LL * 60 * 1000; break;
+        case 'd': unitMs = 24LL * 60 * 60 * 1000; break;
+        case 'w': unitMs = 7LL * 24 * 60 * 60 * 1000; break;
+        default: return std::nullopt;
+    }
+    return now - amount * unitMs;
+}
+
+bool ContainsLower(const std::string& haystack, const std::string& needleLower) {
+    return utils::ToLower(haystack).find(needleLower) != std::string::npos;
+}
+
+} // namespace
+
+bool SearchQuery::IsEmpty() const {
+    return terms.empty() && regex.empty() && !HasFilters();
+}
+
+bool SearchQuery::HasFilters() const {
+    return !tags.empty() || !apps.empty() || type.has_value() || favoritesOnly ||
+           before.has_value() || after.has_value();
+}
+
+SearchQuery ParseSearchQuery(const std::string& input, int64_t now) {
+    if (now == 0) now = utils::GetCurrentTimestamp();
+
+    SearchQuery query;
+    for (const auto& token : Tokenize(input)) {
+        const std::string& key = token.key;
+        const std::string& value = token.value;
+
+        if (key.empty()) {
+            if (!token.quoted && (utils::ToLower(value) == "fav")) {
+                query.favoritesOnly = true;
+            } else if (!value.empty()) {
+                query.terms.push_back(value);
+            }
+            continue;
+        }
+
+        bool handled = false;
+        if (key == "tag" && !value.empty()) {
+            query.tags.push_back(value);
+            handled = true;
+        } else if (key == "app" && !value.empty()) {
+            query.apps.push_back(value);
+            handled = true;
+        } else if (key == "type") {
+            if (auto type = ParseType(value)) {
+                query.type = type;
+                handled = true;
+            }
+        } else if (key == "is" && utils::ToLower(value) == "fav") {
+            query.favoritesOnly = true;
+            handled = true;
+        } else if (key == "before" || key == "after") {
+            if (auto when = ParseWhen(value, now)) {
+                // Relative ages read naturally as "older/newer than", which
+                // is the same comparison as for absolute dates
+                if (key == "before") query.before = *when;
+                else query.after = *when;
+                handled = true;
+            }
+        }
+
+        if (!handled) {
+            // Not a filter we understand, search for it literally
+            query.terms.push_back(key + ":" + value);
+        }
+    }
+
+    return query;
+}
+
+SearchQuery MakeRegexQuery(const std::string& pattern, bool ignoreCase) {
+    SearchQuery query;
+    query.regex = pattern;
+    query.regexIgnoreCase = ignoreCase;
+    return query;
+}
+
+bool MatchesSearchQuery(const SearchQuery& query, const ClipboardEntry& entry) {
+    if (query.type.has_value() && entry.type != *query.type) return false;
+    if (query.favoritesOnly && !entry.isFavorited) return false;
+    if (query.before.has_value() && entry.timestamp >= *query.before) return false;
+    if (query.after.has_value() && entry.timestamp < *query.after) return false;
+
+    for (const auto& tag : query.tags) {
+        std::string tagLower = utils::ToLower(tag);
+        bool found = false;
+        for (const auto& entryTag : entry.tags) {
+            if (utils::ToLower(entryTag) == tagLower) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) return false;
+    }
+
+    for (const auto& app : query.apps) {
+        if (!ContainsLower(entry.sourceApp, utils::ToLower(app))) return false;
+    }
+
+    for (const auto& term : query.terms) {
+        std::string termLower = utils::ToLower(term);
+        bool found = ContainsLower(entry.preview, termLower);
+        for (size_t i = 0; !found && i < entry.tags.size(); i++) {
+            found = ContainsLower(entry.tags[i], termLower);
+        }
+        if (!found) return false;
+    }
+
+    if (!query.regex.empty()) {
+        auto regex = RegexCache::Instance().Get(query.regex, query.regexIgnoreCase);
+        if (!regex || !regex->Search(entry.preview)) return false;
+    }
+
+    return true;
+}
+
+std::string FormatQueryFilter(const std::string& key, const std::string& value) {
+    bool needsQuotes = value.empty();
+    for (char c : value) {
+        if (std::isspace(static_cast<unsigned char>(c)) || c == ':' || c == '"') {
+            needsQuotes = true;
+            break;
+        }
+    }
+    if (!needsQuotes) return key + ":" + value;
+
+    std::string quoted = key + ":\"";
+    for (char c : value) {
+        if (c == '"' || c == '\\') quoted += '\\';
+        quoted += c;
+    }
+    quoted += '"';
+    return quoted;
+}
+
+} // namespace clipx
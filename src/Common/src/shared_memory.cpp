@@ -0,0 +1,60 @@
+#include "common/shared_memory.h"
+#include <atomic>
+#include <cstring>
+
+namespace clipx {
+
+namespace {
+
+// The stamp is an aligned 8-byte word the server may rewrite while we read
+uint64_t LoadStamp(const uint8_t* header) {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return *reinterpret_cast<const volatile uint64_t*>(header);
+}
+
+} // namespace
+
+bool SharedBlobView::Open(const SharedBlobRef& ref) {
+    Close();
+    if (ref.offset < SHARED_BLOB_HEADER_SIZE || ref.offset % SHARED_BLOB_HEADER_SIZE != 0 ||
+        ref.offset > ref.capacity || ref.length > ref.capacity - ref.offset) {
+        return false;
+    }
+
+    m_memory = OpenSharedMemory(ref.name, static_cast<size_t>(ref.capacity));
+    if (!m_memory) {
+        return false;
+    }
+    m_ref = ref;
+    if (!IsValid()) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void SharedBlobView::Close() {
+    m_memory.reset();
+    m_ref = SharedBlobRef{};
+}
+
+const uint8_t* SharedBlobView::Data() const {
+    return m_memory ? m_memory->Data() + m_ref.offset : nullptr;
+}
+
+bool SharedBlobView::IsValid() const {
+    return m_memory && LoadStamp(m_memory->Data() + m_ref.offset - SHARED_BLOB_HEADER_SIZE) == m_ref.lease;
+}
+
+bool SharedBlobView::CopyTo(std::vector<uint8_t>& out) const {
+    if (!IsValid()) {
+        return false;
+    }
+    out.resize(Size());
+    if (!out.empty()) {
+        std::memcpy(out.data(), Data(), out.size());
+    }
+    return IsValid();
+}
+
+} // namespace clipx
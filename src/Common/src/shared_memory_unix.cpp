@@ -0,0 +1,99 @@
+// POSIX shm backend of SharedMemory. Used on Linux, mainly so the
+// shared-memory payload channel can be exercised outside Windows.
+
+#include "common/shared_memory.h"
+#include "common/logger.h"
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <random>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace clipx {
+
+namespace {
+
+class PosixSharedMemory : public SharedMemory {
+public:
+    PosixSharedMemory(std::string name, uint8_t* data, size_t size, bool owner) : m_owner(owner) {
+        m_name = std::move(name);
+        m_data = data;
+        m_size = size;
+    }
+
+    ~PosixSharedMemory() override {
+        ::munmap(m_data, m_size);
+        if (m_owner) {
+            ::shm_unlink(m_name.c_str());
+        }
+    }
+
+private:
+    bool m_owner;
+};
+
+std::string UniqueName() {
+    static std::atomic<uint64_t> serial{0};
+    static const uint64_t key = (static_cast<uint64_t>(std::random_device{}()) << 32) ^ std::random_device{}();
+    return "/clipx_blob_" + std::to_string(::getpid()) + "_" + std::to_string(++serial) + "_" + std::to_string(key);
+}
+
+std::unique_ptr<SharedMemory> CreateRegion(std::string name, size_t size) {
+    int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        LOG_ERROR("shm_open failed: " + std::string(std::strerror(errno)));
+        return nullptr;
+    }
+
+    void* data = MAP_FAILED;
+    if (::ftruncate(fd, static_cast<off_t>(size)) == 0) {
+        data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    int error = errno;
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        LOG_ERROR("Failed to map shared memory: " + std::string(std::strerror(error)));
+        ::shm_unlink(name.c_str());
+        return nullptr;
+    }
+    return std::make_unique<PosixSharedMemory>(std::move(name), static_cast<uint8_t*>(data), size, true);
+}
+
+} // namespace
+
+std::unique_ptr<SharedMemory> CreateSharedMemory(size_t size) {
+    return CreateRegion(UniqueName(), size);
+}
+
+// shm objects outlive their creator, so a live owner can't be told from a
+// crashed one. ClipD runs once per user; the newest creator wins.
+std::unique_ptr<SharedMemory> CreateNamedSharedMemory(const std::string& name, size_t size) {
+    ::shm_unlink(name.c_str());
+    return CreateRegion(name, size);
+}
+
+std::unique_ptr<SharedMemory> OpenSharedMemory(const std::string& name, size_t size) {
+    int fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        LOG_DEBUG("Shared memory gone: " + name);
+        return nullptr;
+    }
+
+    // A region smaller than claimed would fault on access
+    struct stat info;
+    void* data = MAP_FAILED;
+    if (::fstat(fd, &info) == 0 && static_cast<uint64_t>(info.st_size) >= size) {
+        data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        LOG_ERROR("Failed to map shared memory: " + name);
+        return nullptr;
+    }
+    return std::make_unique<PosixSharedMemory>(name, static_cast<uint8_t*>(data), size, false);
+}
+
+} // namespace clipx
@@ -0,0 +1,90 @@
+// Win32 backend of SharedMemory: named file mappings backed by the paging
+// file, in the session-local namespace. The mapping object lives as long as
+// any process holds a handle or view, so the creator "removes" the name by
+// closing its handle.
+
+#include "common/windows.h"
+#include "common/shared_memory.h"
+#include "common/logger.h"
+#include "common/utils.h"
+#include <atomic>
+#include <random>
+
+namespace clipx {
+
+namespace {
+
+class FileMappingMemory : public SharedMemory {
+public:
+    FileMappingMemory(std::string name, HANDLE mapping, uint8_t* data, size_t size) : m_mapping(mapping) {
+        m_name = std::move(name);
+        m_data = data;
+        m_size = size;
+    }
+
+    ~FileMappingMemory() override {
+        UnmapViewOfFile(m_data);
+        CloseHandle(m_mapping);
+    }
+
+private:
+    HANDLE m_mapping;
+};
+
+std::string UniqueName() {
+    static std::atomic<uint64_t> serial{0};
+    static const uint64_t key = (static_cast<uint64_t>(std::random_device{}()) << 32) ^ std::random_device{}();
+    return "Local\\ClipX_Blob_" + std::to_string(GetCurrentProcessId()) + "_" + std::to_string(++serial) + "_" +
+           std::to_string(key);
+}
+
+std::unique_ptr<SharedMemory> CreateRegion(std::string name, size_t size) {
+    uint64_t size64 = size;
+    HANDLE mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                        static_cast<DWORD>(size64 >> 32), static_cast<DWORD>(size64),
+                                        utils::Utf8ToWide(name).c_str());
+    if (!mapping || GetLastError() == ERROR_ALREADY_EXISTS) {
+        LOG_ERROR("CreateFileMapping failed: " + std::to_string(GetLastError()));
+        if (mapping) CloseHandle(mapping);
+        return nullptr;
+    }
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size);
+    if (!data) {
+        LOG_ERROR("MapViewOfFile failed: " + std::to_string(GetLastError()));
+        CloseHandle(mapping);
+        return nullptr;
+    }
+    return std::make_unique<FileMappingMemory>(std::move(name), mapping, static_cast<uint8_t*>(data), size);
+}
+
+} // namespace
+
+std::unique_ptr<SharedMemory> CreateSharedMemory(size_t size) {
+    return CreateRegion(UniqueName(), size);
+}
+
+// The mapping disappears with its last handle, so a taken name belongs to
+// a running creator (or a reader still holding it open)
+std::unique_ptr<SharedMemory> CreateNamedSharedMemory(const std::string& name, size_t size) {
+    return CreateRegion(name, size);
+}
+
+std::unique_ptr<SharedMemory> OpenSharedMemory(const std::string& name, size_t size) {
+    HANDLE mapping = OpenFileMappingW(FILE_MAP_READ, FALSE, utils::Utf8ToWide(name).c_str());
+    if (!mapping) {
+        LOG_DEBUG("Shared memory gone: " + name);
+        return nullptr;
+    }
+
+    // Mapping more than the section holds fails here instead of faulting later
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, size);
+    if (!data) {
+        LOG_ERROR("Failed to map shared memory: " + name);
+        CloseHandle(mapping);
+        return nullptr;
+    }
+    return std::make_unique<FileMappingMemory>(name, mapping, static_cast<uint8_t*>(data), size);
+}
+
+} // namespace clipx
@@ -0,0 +1,188 @@
+#include "common/simhash.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace clipx {
+
+namespace simhash {
+
+namespace {
+
+inline bool IsSpace(unsigned char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+inline uint64_t MixShingle(uint32_t shingle) {
+    uint64_t h = (static_cast<uint64_t>(shingle) + 0x632BE59BD9B4E019ULL) * 0x9E3779B97F4A7C15ULL;
+    h ^= h >> 32;
+    h *= 0xD6E8FEB86659FD93ULL;
+    h ^= h >> 32;
+    return h;
+}
+
+// SPREAD[v] holds bit i of v in byte i, so adding it to a 64-bit word bumps
+// eight byte-wide bit counters at once
+struct SpreadTable {
+    std::array<uint64_t, 256> values{};
+    SpreadTable() {
+        for (int v = 0; v < 256; v++) {
+            uint64_t spread = 0;
+            for (int bit = 0; bit < 8; bit++) {
+                if (v & (1 << bit)) spread |= 1ULL << (bit * 8);
+            }
+            values[v] = spread;
+        }
+    }
+};
+
+const SpreadTable SPREAD;
+
+} // namespace
+
+uint64_t Compute(const char* text, size_t size) {
+    // Normalize into a per-thread buffer
+    thread_local std::vector<char> buffer;
+    const size_t limit = std::min(size, MAX_TEXT_LENGTH);
+    if (buffer.size() < limit) buffer.resize(limit);
+
+    char* out = buffer.data();
+    size_t length = 0;
+    bool pendingSpace = false;
+    for (size_t i = 0; i < size && length < limit; i++) {
+        char c = text[i];
+        if (IsSpace(static_cast<unsigned char>(c))) {
+            pendingSpace = length != 0;
+            continue;
+        }
+        if (pendingSpace) {
+            out[length++] = ' ';
+            pendingSpace = false;
+            if (length == limit) break;
+        }
+        out[length++] = c >= '0' && c <= '9' ? '0' : c;
+    }
+
+    if (length < MIN_TEXT_LENGTH) {
+        return 0;
+    }
+
+    // Eight words of byte counters; flushed into the totals before a byte
+    // counter can overflow
+    uint32_t totals[64] = {};
+    uint64_t lanes[8] = {};
+    int pending = 0;
+
+    auto flush = [&]() {
+        for (int word = 0; word < 8; word++) {
+            for (int bit = 0; bit < 8; bit++) {
+                totals[word * 8 + bit] += static_cast<uint32_t>((lanes[word] >> (bit * 8)) & 0xFF);
+            }
+            lanes[word] = 0;
+        }
+        pending = 0;
+    };
+
+    // Each distinct shingle counts once. Weighting by frequency would let
+    // boilerplate repeated on every line (indentation, "File ", ");") outvote
+    // the content, making unrelated texts of the same shape look alike.
+    thread_local std::vector<uint64_t> table;
+    size_t tableSize = 64;
+    while (tableSize < length * 2) tableSize <<= 1;
+    table.assign(tableSize, 0);
+    uint64_t* seen = table.data();
+    const size_t mask = tableSize - 1;
+
+    size_t shingles = 0;
+    for (size_t i = 0; i + 4 <= length; i++) {
+        uint32_t shingle;
+        std::memcpy(&shingle, out + i, sizeof(shingle));
+        uint64_t h = MixShingle(shingle);
+        uint64_t key = h | 1;  // 0 marks an empty slot
+
+        size_t slot = static_cast<size_t>(h >> 7) & mask;
+        while (seen[slot] != 0 && seen[slot] != key) slot = (slot + 1) & mask;
+        if (seen[slot] == key) continue;
+        seen[slot] = key;
+
+        for (int word = 0; word < 8; word++) {
+            lanes[word] += SPREAD.values[(h >> (word * 8)) & 0xFF];
+        }
+        shingles++;
+        if (++pending == 255) flush();
+    }
+    flush();
+
+    // A bit is set when most shingles had it set
+    uint64_t fingerprint = 0;
+    for (int bit = 0; bit < 64; bit++) {
+        if (static_cast<size_t>(totals[bit]) * 2 > shingles) {
+            fingerprint |= 1ULL << bit;
+        }
+    }
+    return fingerprint != 0 ? fingerprint : 1;
+}
+
+} // namespace simhash
+
+void SimHashIndex::Add(int64_t id, uint64_t fingerprint) {
+    Remove(id);
+    m_fingerprints[id] = fingerprint;
+    for (int band = 0; band < BANDS; band++) {
+        m_buckets[BandKey(fingerprint, band)].push_back(id);
+    }
+}
+
+void SimHashIndex::Remove(int64_t id) {
+    auto it = m_fingerprints.find(id);
+    if (it == m_fingerprints.end()) {
+        return;
+    }
+
+    for (int band = 0; band < BANDS; band++) {
+        auto bucket = m_buckets.find(BandKey(it->second, band));
+        if (bucket == m_buckets.end()) continue;
+        auto& ids = bucket->second;
+        for (size_t i = 0; i < ids.size(); i++) {
+            if (ids[i] == id) {
+                ids[i] = ids.back();
+                ids.pop_back();
+                break;
+            }
+        }
+        if (ids.empty()) m_buckets.erase(bucket);
+    }
+    m_fingerprints.erase(it);
+}
+
+void SimHashIndex::Clear() {
+    m_fingerprints.clear();
+    m_buckets.clear();
+}
+
+std::optional<int64_t> SimHashIndex::FindNearest(uint64_t fingerprint, int maxDistance,
+                                                 std::optional<int64_t> exclude) const {
+    if (fingerprint == 0 || maxDistance < 0) {
+        return std::nullopt;
+    }
+    if (maxDistance > MAX_DISTANCE) maxDistance = MAX_DISTANCE;
+
+    std::optional<int64_t> best;
+    int bestDistance = maxDistance + 1;
+    for (int band = 0; band < BANDS && bestDistance > 0; band++) {
+        auto bucket = m_buckets.find(BandKey(fingerprint, band));
+        if (bucket == m_buckets.end()) continue;
+
+        for (int64_t id : bucket->second) {
+            if (exclude && id == *exclude) continue;
+            int distance = simhash::Distance(fingerprint, m_fingerprints.at(id));
+            if (distance < bestDistance) {
+                bestDistance = distance;
+                best = id;
+            }
+        }
+    }
+    return best;
+}
+
+} // namespace clipx
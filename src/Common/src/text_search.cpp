@@ -0,0 +1,83 @@
+#include "common/text_search.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CLIPX_HAS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace clipx {
+namespace text {
+
+static inline uint8_t LowerAscii(uint8_t c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<uint8_t>(c | 0x20) : c;
+}
+
+// Compare needle[begin, end) against p[begin, end)
+static inline bool EqualsAt(const uint8_t* p, const std::string& needle, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        if (LowerAscii(p[i]) != static_cast<uint8_t>(needle[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static size_t FindScalar(const uint8_t* haystack, size_t size, const std::string& needle, size_t from) {
+    const size_t n = needle.size();
+    const uint8_t first = static_cast<uint8_t>(needle[0]);
+    for (size_t i = from; i + n <= size; i++) {
+        if (LowerAscii(haystack[i]) == first && EqualsAt(haystack + i, needle, 1, n)) {
+            return i;
+        }
+    }
+    return NOT_FOUND;
+}
+
+#ifdef CLIPX_HAS_SSE2
+// Fold 'A'..'Z' to lowercase in 16 bytes at once. Bytes >= 0x80 are negative
+// under the signed compare, so UTF-8 sequences pass through untouched.
+static inline __m128i LowerAscii16(__m128i v) {
+    const __m128i aMinus1 = _mm_set1_epi8('A' - 1);
+    const __m128i zPlus1 = _mm_set1_epi8('Z' + 1);
+    const __m128i caseBit = _mm_set1_epi8(0x20);
+    __m128i isUpper = _mm_and_si128(_mm_cmpgt_epi8(v, aMinus1), _mm_cmplt_epi8(v, zPlus1));
+    return _mm_or_si128(v, _mm_and_si128(isUpper, caseBit));
+}
+#endif
+
+size_t FindCaseInsensitive(const uint8_t* haystack, size_t size, const std::string& needleLower) {
+    const size_t n = needleLower.size();
+    if (n == 0) return 0;
+    if (!haystack || size < n) return NOT_FOUND;
+
+    size_t i = 0;
+
+#ifdef CLIPX_HAS_SSE2
+    // Compare the first and last needle byte against 16 candidate positions per
+    // step and only verify the positions where both agree
+    const __m128i first = _mm_set1_epi8(static_cast<char>(needleLower[0]));
+    const __m128i last = _mm_set1_epi8(static_cast<char>(needleLower[n - 1]));
+
+    for (; i + n - 1 + 16 <= size; i += 16) {
+        __m128i blockFirst = LowerAscii16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(haystack + i)));
+        __m128i blockLast = LowerAscii16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(haystack + i + n - 1)));
+
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(blockFirst, first), _mm_cmpeq_epi8(blockLast, last))));
+
+        while (mask != 0) {
+            unsigned bit = 0;
+            while (((mask >> bit) & 1u) == 0) bit++;
+            if (EqualsAt(haystack + i + bit, needleLower, 1, n - 1)) {
+                return i + bit;
+            }
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    return FindScalar(haystack, size, needleLower, i);
+}
+
+} // namespace text
+} // namespace clipx
@@ -0,0 +1,102 @@
+#include "common/thread_pool.h"
+#include "common/trace.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace clipx {
+
+ThreadPool::ThreadPool(size_t threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    m_threads.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; i++) {
+        m_threads.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+
+    for (auto& thread : m_threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.push_back(std::move(task));
+    }
+    m_cv.notify_one();
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& fn) {
+    if (count == 0) return;
+
+    // Helpers that are still queued when the caller returns must not touch fn,
+    // so the caller only waits for helpers that actually started draining.
+    // Once the caller's own drain ends the counter is past count for good.
+    struct State {
+        std::atomic<size_t> next{0};
+        size_t active = 0;
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+    auto state = std::make_shared<State>();
+    const std::function<void(size_t)>* body = &fn;
+
+    // The caller participates, so only count - 1 helpers are ever useful
+    size_t helpers = std::min(m_threads.size(), count - 1);
+    for (size_t i = 0; i < helpers; i++) {
+        Submit([state, count, body]() {
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->active++;
+            }
+            size_t index;
+            while ((index = state->next.fetch_add(1)) < count) {
+                (*body)(index);
+            }
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (--state->active == 0) {
+                state->done.notify_one();
+            }
+        });
+    }
+
+    size_t index;
+    while ((index = state->next.fetch_add(1)) < count) {
+        fn(index);
+    }
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->done.wait(lock, [&state]() { return state->active == 0; });
+}
+
+void ThreadPool::WorkerLoop() {
+    trace::SetThreadName("worker");
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+            if (m_stopping && m_tasks.empty()) {
+                return;
+            }
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+        task();
+    }
+}
+
+} // namespace clipx
@@ -0,0 +1,348 @@
+#include "common/thumbnail.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CLIPX_HAS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace clipx {
+namespace image {
+
+namespace {
+
+// biCompression values
+constexpr uint32_t COMPRESSION_RGB = 0;
+constexpr uint32_t COMPRESSION_BITFIELDS = 3;
+constexpr uint32_t COMPRESSION_ALPHABITFIELDS = 6;
+
+constexpr size_t INFO_HEADER_SIZE = 40;  // BITMAPINFOHEADER
+constexpr int MAX_DIMENSION = 1 << 16;
+
+uint32_t ReadU32(const uint8_t* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+uint16_t ReadU16(const uint8_t* p) {
+    uint16_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+void WriteU32(uint8_t* p, uint32_t value) {
+    std::memcpy(p, &value, sizeof(value));
+}
+
+void WriteU16(uint8_t* p, uint16_t value) {
+    std::memcpy(p, &value, sizeof(value));
+}
+
+// One channel of a 16/32 bpp pixel, scaled to 0..255
+struct MaskChannel {
+    uint32_t mask = 0;
+    int shift = 0;
+    uint32_t max = 0;
+
+    explicit MaskChannel(uint32_t m) : mask(m) {
+        if (mask == 0) return;
+        while (((mask >> shift) & 1u) == 0) shift++;
+        max = mask >> shift;
+    }
+
+    uint8_t Extract(uint32_t pixel) const {
+        if (max == 0) return 0;
+        return static_cast<uint8_t>(((pixel & mask) >> shift) * 255u / max);
+    }
+};
+
+// 32 bpp pixels that are BGRX or BGRA bytes already
+bool IsBgra(const DibInfo& info) {
+    return info.bitCount == 32 && info.masks[0] == 0x00FF0000 && info.masks[1] == 0x0000FF00 &&
+           info.masks[2] == 0x000000FF && (info.masks[3] == 0 || info.masks[3] == 0xFF000000);
+}
+
+// Source rows as BGRA: straight from the DIB when its layout already is,
+// converted into a scratch row otherwise. `y` counts from the top.
+class RowReader {
+public:
+    explicit RowReader(const DibInfo& info)
+        : m_info(info), m_direct(IsBgra(info)),
+          m_red(info.masks[0]), m_green(info.masks[1]), m_blue(info.masks[2]), m_alpha(info.masks[3]) {
+        if (!m_direct) {
+            m_scratch.resize(static_cast<size_t>(info.width) * 4);
+        }
+    }
+
+    const uint8_t* Row(int y) {
+        int stored = m_info.topDown ? y : m_info.height - 1 - y;
+        const uint8_t* src = m_info.bits + static_cast<size_t>(stored) * m_info.stride;
+        if (m_direct) {
+            return src;
+        }
+
+        uint8_t* out = m_scratch.data();
+        const int width = m_info.width;
+        switch (m_info.bitCount) {
+            case 24:
+                for (int x = 0; x < width; x++, src += 3, out += 4) {
+                    out[0] = src[0];
+                    out[1] = src[1];
+                    out[2] = src[2];
+                    out[3] = 255;
+                }
+                break;
+            case 16:
+            case 32: {
+                const size_t bytes = static_cast<size_t>(m_info.bitCount) / 8;
+                for (int x = 0; x < width; x++, src += bytes, out += 4) {
+                    uint32_t pixel = bytes == 2 ? ReadU16(src) : ReadU32(src);
+                    out[0] = m_blue.Extract(pixel);
+                    out[1] = m_green.Extract(pixel);
+                    out[2] = m_red.Extract(pixel);
+                    out[3] = m_alpha.mask ? m_alpha.Extract(pixel) : 255;
+                }
+                break;
+            }
+            default: {
+                // Palette indices, most significant bits first
+                const int bpp = m_info.bitCount;
+                const uint32_t indexMask = (1u << bpp) - 1;
+                for (int x = 0; x < width; x++, out += 4) {
+                    size_t bit = static_cast<size_t>(x) * bpp;
+                    uint32_t index = (src[bit / 8] >> (8 - bpp - bit % 8)) & indexMask;
+                    if (index < m_info.paletteSize) {
+                        const uint8_t* color = m_info.palette + index * 4;
+                        out[0] = color[0];
+                        out[1] = color[1];
+                        out[2] = color[2];
+                    } else {
+                        out[0] = out[1] = out[2] = 0;
+                    }
+                    out[3] = 255;
+                }
+                break;
+            }
+        }
+        return m_scratch.data();
+    }
+
+private:
+    const DibInfo& m_info;
+    bool m_direct;
+    MaskChannel m_red, m_green, m_blue, m_alpha;
+    std::vector<uint8_t> m_scratch;
+};
+
+// acc[i] += row[i] for `count` bytes; the hot loop of the vertical pass
+void AccumulateRow(uint32_t* acc, const uint8_t* row, size_t count) {
+    size_t i = 0;
+#ifdef CLIPX_HAS_SSE2
+    // Widen 16 bytes to four vectors of 32-bit lanes per step
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= count; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+        __m128i lo = _mm_unpacklo_epi8(v, zero);
+        __m128i hi = _mm_unpackhi_epi8(v, zero);
+        __m128i* a = reinterpret_cast<__m128i*>(acc + i);
+        _mm_storeu_si128(a + 0, _mm_add_epi32(_mm_loadu_si128(a + 0), _mm_unpacklo_epi16(lo, zero)));
+        _mm_storeu_si128(a + 1, _mm_add_epi32(_mm_loadu_si128(a + 1), _mm_unpackhi_epi16(lo, zero)));
+        _mm_storeu_si128(a + 2, _mm_add_epi32(_mm_loadu_si128(a + 2), _mm_unpacklo_epi16(hi, zero)));
+        _mm_storeu_si128(a + 3, _mm_add_epi32(_mm_loadu_si128(a + 3), _mm_unpackhi_epi16(hi, zero)));
+    }
+#endif
+    for (; i < count; i++) {
+        acc[i] += row[i];
+    }
+}
+
+// Channel sums of the column sums [x0, x1), one pixel (4 lanes) at a time
+void SumColumns(const uint32_t* acc, int x0, int x1, uint32_t sum[4]) {
+#ifdef CLIPX_HAS_SSE2
+    __m128i total = _mm_setzero_si128();
+    for (int x = x0; x < x1; x++) {
+        total = _mm_add_epi32(total, _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + static_cast<size_t>(x) * 4)));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(sum), total);
+#else
+    sum[0] = sum[1] = sum[2] = sum[3] = 0;
+    for (int x = x0; x < x1; x++) {
+        for (int c = 0; c < 4; c++) {
+            sum[c] += acc[static_cast<size_t>(x) * 4 + c];
+        }
+    }
+#endif
+}
+
+} // namespace
+
+bool ParseDib(const uint8_t* data, size_t size, DibInfo& info) {
+    if (!data || size < INFO_HEADER_SIZE) {
+        return false;
+    }
+
+    const uint32_t headerSize = ReadU32(data);
+    if (headerSize < INFO_HEADER_SIZE || headerSize > size) {
+        return false;
+    }
+
+    int32_t width = static_cast<int32_t>(ReadU32(data + 4));
+    int32_t height = static_cast<int32_t>(ReadU32(data + 8));
+    uint16_t planes = ReadU16(data + 12);
+    uint16_t bitCount = ReadU16(data + 14);
+    uint32_t compression = ReadU32(data + 16);
+    uint32_t colorsUsed = ReadU32(data + 32);
+
+    if (planes != 1 || width <= 0 || height == 0 || height == INT32_MIN || width > MAX_DIMENSION ||
+        std::abs(height) > MAX_DIMENSION) {
+        return false;
+    }
+    if (bitCount != 1 && bitCount != 4 && bitCount != 8 && bitCount != 16 && bitCount != 24 && bitCount != 32) {
+        return false;
+    }
+
+    DibInfo parsed;
+    parsed.width = width;
+    parsed.height = std::abs(height);
+    parsed.topDown = height < 0;
+    parsed.bitCount = bitCount;
+
+    size_t offset = headerSize;
+    if (compression == COMPRESSION_BITFIELDS || compression == COMPRESSION_ALPHABITFIELDS) {
+        if (bitCount != 16 && bitCount != 32) {
+            return false;
+        }
+        const size_t maskCount = compression == COMPRESSION_ALPHABITFIELDS ? 4 : 3;
+        if (headerSize >= INFO_HEADER_SIZE + 4 * maskCount) {
+            // V2-V5 headers carry the masks themselves
+            for (size_t i = 0; i < maskCount; i++) parsed.masks[i] = ReadU32(data + INFO_HEADER_SIZE + 4 * i);
+        } else {
+            if (size - offset < 4 * maskCount) return false;
+            for (size_t i = 0; i < maskCount; i++) parsed.masks[i] = ReadU32(data + offset + 4 * i);
+            offset += 4 * maskCount;
+        }
+        if (headerSize >= INFO_HEADER_SIZE + 16) {
+            parsed.masks[3] = ReadU32(data + INFO_HEADER_SIZE + 12);
+        }
+    } else if (compression == COMPRESSION_RGB) {
+        if (bitCount == 16) {
+            parsed.masks[0] = 0x7C00;  // 5-5-5
+            parsed.masks[1] = 0x03E0;
+            parsed.masks[2] = 0x001F;
+        } else if (bitCount == 32) {
+            parsed.masks[0] = 0x00FF0000;  // Top byte unused
+            parsed.masks[1] = 0x0000FF00;
+            parsed.masks[2] = 0x000000FF;
+        }
+    } else {
+        return false;
+    }
+
+    // Color table: required below 16 bpp, optional (and skipped) above
+    uint32_t colors = colorsUsed;
+    if (bitCount <= 8) {
+        const uint32_t maxColors = 1u << bitCount;
+        if (colors == 0 || colors > maxColors) colors = maxColors;
+    }
+    if (colors > (size - offset) / 4) {
+        return false;
+    }
+    if (bitCount <= 8) {
+        parsed.palette = data + offset;
+        parsed.paletteSize = colors;
+    }
+    offset += static_cast<size_t>(colors) * 4;
+
+    parsed.stride = ((static_cast<size_t>(width) * bitCount + 31) / 32) * 4;
+    const uint64_t pixelBytes = static_cast<uint64_t>(parsed.stride) * static_cast<uint64_t>(parsed.height);
+    if (pixelBytes > size - offset) {
+        return false;
+    }
+    parsed.bits = data + offset;
+
+    info = parsed;
+    return true;
+}
+
+std::vector<uint8_t> ScaleDib(const DibInfo& info, int width, int height) {
+    if (width <= 0 || height <= 0 || width > info.width || height > info.height || !info.bits) {
+        return {};
+    }
+
+    // Channel sums of one box must fit 32 bits
+    const uint64_t maxArea = (static_cast<uint64_t>(info.width) / width + 1) * (info.height / height + 1);
+    if (maxArea > UINT32_MAX / 255) {
+        return {};
+    }
+
+    const size_t srcWidth = static_cast<size_t>(info.width);
+    const bool keepAlpha = info.masks[3] != 0;
+    RowReader reader(info);
+    std::vector<uint32_t> acc(srcWidth * 4);
+    std::vector<uint8_t> out(static_cast<size_t>(width) * height * 4);
+
+    // Box edges: target pixel i covers source [i * src / dst, (i + 1) * src / dst),
+    // never empty while dst <= src
+    for (int ty = 0; ty < height; ty++) {
+        const int y0 = static_cast<int>(static_cast<int64_t>(ty) * info.height / height);
+        const int y1 = static_cast<int>(static_cast<int64_t>(ty + 1) * info.height / height);
+
+        std::fill(acc.begin(), acc.end(), 0u);
+        for (int y = y0; y < y1; y++) {
+            AccumulateRow(acc.data(), reader.Row(y), srcWidth * 4);
+        }
+
+        uint8_t* dst = out.data() + static_cast<size_t>(ty) * width * 4;
+        for (int tx = 0; tx < width; tx++, dst += 4) {
+            const int x0 = static_cast<int>(static_cast<int64_t>(tx) * info.width / width);
+            const int x1 = static_cast<int>(static_cast<int64_t>(tx + 1) * info.width / width);
+            const uint32_t area = static_cast<uint32_t>(x1 - x0) * static_cast<uint32_t>(y1 - y0);
+
+            uint32_t sum[4];
+            SumColumns(acc.data(), x0, x1, sum);
+            for (int c = 0; c < 3; c++) {
+                dst[c] = static_cast<uint8_t>((sum[c] + area / 2) / area);
+            }
+            dst[3] = keepAlpha ? static_cast<uint8_t>((sum[3] + area / 2) / area) : 255;
+        }
+    }
+    return out;
+}
+
+std::vector<uint8_t> MakeThumbnail(const uint8_t* dib, size_t size, int maxSide) {
+    DibInfo info;
+    if (maxSide <= 0 || !ParseDib(dib, size, info)) {
+        return {};
+    }
+
+    int width = info.width;
+    int height = info.height;
+    if (width > maxSide || height > maxSide) {
+        const int longest = std::max(width, height);
+        width = std::max(1, static_cast<int>((static_cast<int64_t>(width) * maxSide + longest / 2) / longest));
+        height = std::max(1, static_cast<int>((static_cast<int64_t>(height) * maxSide + longest / 2) / longest));
+    }
+
+    std::vector<uint8_t> pixels = ScaleDib(info, width, height);
+    if (pixels.empty()) {
+        return {};
+    }
+
+    std::vector<uint8_t> thumbnail(INFO_HEADER_SIZE + pixels.size(), 0);
+    uint8_t* header = thumbnail.data();
+    WriteU32(header, static_cast<uint32_t>(INFO_HEADER_SIZE));
+    WriteU32(header + 4, static_cast<uint32_t>(width));
+    WriteU32(header + 8, static_cast<uint32_t>(-height));  // Top-down
+    WriteU16(header + 12, 1);
+    WriteU16(header + 14, 32);
+    WriteU32(header + 16, COMPRESSION_RGB);
+    WriteU32(header + 20, static_cast<uint32_t>(pixels.size()));
+    std::memcpy(thumbnail.data() + INFO_HEADER_SIZE, pixels.data(), pixels.size());
+    return thumbnail;
+}
+
+} // namespace image
+} // namespace clipx
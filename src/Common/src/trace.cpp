@@ -0,0 +1,495 @@
+#ifdef _WIN32
+#include "common/windows.h"
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "common/trace.h"
+#include "common/utils.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace clipx {
+namespace trace {
+
+std::atomic<bool> g_enabled{false};
+
+namespace {
+
+constexpr size_t BUFFER_EVENTS = 4096;  // Per thread; more within a flush interval are dropped
+constexpr auto FLUSH_INTERVAL = std::chrono::seconds(1);
+
+enum class Phase : char {
+    Complete = 'X',
+    Instant = 'i',
+    FlowStart = 's',
+    FlowEnd = 'f'
+};
+
+struct Event {
+    Phase phase = Phase::Complete;
+    const char* name = nullptr;
+    uint64_t ts = 0;   // Nanoseconds, steady clock
+    uint64_t dur = 0;
+    uint64_t traceId = 0;
+    uint64_t spanId = 0;    // Flow events: the hop id
+    uint64_t parentId = 0;
+};
+
+// Single producer (its thread), single consumer (Flush, under its mutex).
+// The producer never waits: when the ring is full the event is counted
+// and dropped.
+struct ThreadBuffer {
+    std::array<Event, BUFFER_EVENTS> events;
+    std::atomic<uint64_t> head{0};  // Next slot the thread writes
+    std::atomic<uint64_t> tail{0};  // Next slot Flush reads
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<const char*> name{nullptr};
+    uint32_t tid = 0;
+
+    // Flush only
+    const char* writtenName = nullptr;
+    uint64_t reportedDropped = 0;
+};
+
+struct State {
+    std::mutex buffersMutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    uint32_t nextTid = 1;
+
+    std::mutex flushMutex;  // Held while draining and writing the file
+    std::string path;
+    uint32_t pid = 0;
+
+    std::mutex flusherMutex;
+    std::condition_variable flusherCv;
+    bool stopping = false;
+    std::thread flusher;
+};
+
+State& GetState() {
+    static State state;
+    return state;
+}
+
+thread_local std::shared_ptr<ThreadBuffer> t_buffer;
+thread_local Context t_current;
+thread_local const char* t_threadName = nullptr;
+
+uint64_t NowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+uint32_t ProcessId() {
+#ifdef _WIN32
+    return static_cast<uint32_t>(GetCurrentProcessId());
+#else
+    return static_cast<uint32_t>(getpid());
+#endif
+}
+
+// Random per process, so ids from ClipD and the Overlay don't collide;
+// positive 63-bit values, never 0
+uint64_t NewId() {
+    static std::atomic<uint64_t> next{std::random_device{}() ^ (NowNs() << 16) ^ ProcessId()};
+    uint64_t x = next.fetch_add(0x9E3779B97F4A7C15ull, std::memory_order_relaxed);
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    x = (x ^ (x >> 31)) & 0x7FFFFFFFFFFFFFFFull;
+    return x != 0 ? x : 1;
+}
+
+ThreadBuffer& Buffer() {
+    if (!t_buffer) {
+        auto buffer = std::make_shared<ThreadBuffer>();
+        buffer->name = t_threadName;
+        State& state = GetState();
+        std::lock_guard<std::mutex> lock(state.buffersMutex);
+        buffer->tid = state.nextTid++;
+        state.buffers.push_back(buffer);
+        t_buffer = std::move(buffer);
+    }
+    return *t_buffer;
+}
+
+void Push(const Event& event) {
+    ThreadBuffer& buffer = Buffer();
+    uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    if (head - buffer.tail.load(std::memory_order_acquire) >= BUFFER_EVENTS) {
+        buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffer.events[head % BUFFER_EVENTS] = event;
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+bool AppendToFile(const std::string& path, const std::string& text) {
+    if (text.empty()) {
+        return true;
+    }
+    // One append per write, so the Overlay and ClipD can share the file
+#ifdef _WIN32
+    HANDLE file = CreateFileW(utils::Utf8ToWide(path).c_str(), FILE_APPEND_DATA, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                              nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    DWORD written = 0;
+    BOOL ok = WriteFile(file, text.data(), static_cast<DWORD>(text.size()), &written, nullptr);
+    CloseHandle(file);
+    return ok && written == text.size();
+#else
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    ssize_t written = write(fd, text.data(), text.size());
+    close(fd);
+    return written == static_cast<ssize_t>(text.size());
+#endif
+}
+
+void AppendEscaped(std::string& out, const char* text) {
+    for (const char* p = text; *p; p++) {
+        char c = *p;
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out += ' ';
+        } else {
+            out += c;
+        }
+    }
+}
+
+// Chrome wants microseconds; fractions are allowed
+void AppendMicros(std::string& out, uint64_t ns) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%llu.%03u", static_cast<unsigned long long>(ns / 1000),
+                  static_cast<unsigned>(ns % 1000));
+    out += text;
+}
+
+void AppendHex(std::string& out, uint64_t value) {
+    char text[24];
+    std::snprintf(text, sizeof(text), "\"%016llx\"", static_cast<unsigned long long>(value));
+    out += text;
+}
+
+void AppendHeader(std::string& out, const char* phase, const char* name, uint32_t pid, uint32_t tid) {
+    out += "{\"ph\":\"";
+    out += phase;
+    out += "\",\"name\":\"";
+    AppendEscaped(out, name);
+    out += "\",\"pid\":";
+    out += std::to_string(pid);
+    out += ",\"tid\":";
+    out += std::to_string(tid);
+}
+
+void AppendEvent(std::string& out, const Event& event, uint32_t pid, uint32_t tid) {
+    switch (event.phase) {
+        case Phase::Complete:
+            AppendHeader(out, "X", event.name, pid, tid);
+            out += ",\"cat\":\"clipx\",\"ts\":";
+            AppendMicros(out, event.ts);
+            out += ",\"dur\":";
+            AppendMicros(out, event.dur);
+            out += ",\"args\":{\"trace\":";
+            AppendHex(out, event.traceId);
+            out += ",\"span\":";
+            AppendHex(out, event.spanId);
+            out += ",\"parent\":";
+            AppendHex(out, event.parentId);
+            out += "}},\n";
+            break;
+        case Phase::Instant:
+            AppendHeader(out, "i", event.name, pid, tid);
+            out += ",\"cat\":\"clipx\",\"s\":\"t\",\"ts\":";
+            AppendMicros(out, event.ts);
+            out += ",\"args\":{\"trace\":";
+            AppendHex(out, event.traceId);
+            out += "}},\n";
+            break;
+        case Phase::FlowStart:
+        case Phase::FlowEnd:
+            // Binds to the span enclosing it on each side of the hop
+            AppendHeader(out, event.phase == Phase::FlowStart ? "s" : "f", event.name, pid, tid);
+            out += ",\"cat\":\"clipx\",\"id\":";
+            AppendHex(out, event.spanId);
+            if (event.phase == Phase::FlowEnd) {
+                out += ",\"bp\":\"e\"";
+            }
+            out += ",\"ts\":";
+            AppendMicros(out, event.ts);
+            out += "},\n";
+            break;
+    }
+}
+
+void AppendMetadata(std::string& out, const char* kind, const char* name, uint32_t pid, uint32_t tid) {
+    AppendHeader(out, "M", kind, pid, tid);
+    out += ",\"args\":{\"name\":\"";
+    AppendEscaped(out, name);
+    out += "\"}},\n";
+}
+
+void FlusherLoop() {
+    State& state = GetState();
+    std::unique_lock<std::mutex> lock(state.flusherMutex);
+    while (!state.stopping) {
+        state.flusherCv.wait_for(lock, FLUSH_INTERVAL, [&state]() { return state.stopping; });
+        lock.unlock();
+        Flush();
+        lock.lock();
+    }
+}
+
+} // namespace
+
+std::string FormatContext(const Context& context) {
+    char text[40];
+    std::snprintf(text, sizeof(text), "%016llx-%016llx", static_cast<unsigned long long>(context.traceId),
+                  static_cast<unsigned long long>(context.spanId));
+    return text;
+}
+
+bool ParseContext(const std::string& text, Context& context) {
+    if (text.size() != 33 || text[16] != '-') {
+        return false;
+    }
+    uint64_t values[2] = {};
+    for (int part = 0; part < 2; part++) {
+        for (size_t i = part * 17; i < part * 17 + 16u; i++) {
+            char c = text[i];
+            int digit = c >= '0' && c <= '9' ? c - '0'
+                      : c >= 'a' && c <= 'f' ? c - 'a' + 10
+                      : c >= 'A' && c <= 'F' ? c - 'A' + 10
+                      : -1;
+            if (digit < 0) {
+                return false;
+            }
+            values[part] = (values[part] << 4) | static_cast<uint64_t>(digit);
+        }
+    }
+    context.traceId = values[0];
+    context.spanId = values[1];
+    return context.Valid();
+}
+
+bool Start(const std::string& path, const char* processName, bool append) {
+    Stop();
+
+    std::error_code error;
+    std::filesystem::path parent = std::filesystem::u8path(path).parent_path();
+    if (!parent.empty()) {
+        std::filesystem::create_directories(parent, error);
+    }
+
+    State& state = GetState();
+    {
+        std::lock_guard<std::mutex> lock(state.flushMutex);
+        state.pid = ProcessId();
+
+        // The array is left open; whoever starts the file opens it
+        bool fresh = !append || utils::GetFileSize(path) <= 0;
+        if (!append && !std::ofstream(std::filesystem::u8path(path), std::ios::binary | std::ios::trunc)) {
+            return false;
+        }
+
+        std::string header = fresh ? "[\n" : "";
+        AppendMetadata(header, "process_name", processName, state.pid, 0);
+        if (!AppendToFile(path, header)) {
+            return false;
+        }
+        state.path = path;
+    }
+
+    if (!t_threadName) {
+        SetThreadName("main");
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(state.flusherMutex);
+        state.stopping = false;
+    }
+    g_enabled = true;
+    state.flusher = std::thread(FlusherLoop);
+    return true;
+}
+
+void Stop() {
+    State& state = GetState();
+    g_enabled = false;
+    {
+        std::lock_guard<std::mutex> lock(state.flusherMutex);
+        state.stopping = true;
+    }
+    state.flusherCv.notify_all();
+    if (state.flusher.joinable()) {
+        state.flusher.join();
+    }
+
+    Flush();
+    std::lock_guard<std::mutex> lock(state.flushMutex);
+    state.path.clear();
+}
+
+void Flush() {
+    State& state = GetState();
+    std::lock_guard<std::mutex> lock(state.flushMutex);
+    if (state.path.empty()) {
+        return;
+    }
+
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+        std::lock_guard<std::mutex> buffersLock(state.buffersMutex);
+        buffers = state.buffers;
+    }
+
+    std::string out;
+    for (const auto& buffer : buffers) {
+        const char* name = buffer->name.load(std::memory_order_relaxed);
+        if (name && name != buffer->writtenName) {
+            AppendMetadata(out, "thread_name", name, state.pid, buffer->tid);
+            buffer->writtenName = name;
+        }
+
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        uint64_t tail = buffer->tail.load(std::memory_order_relaxed);
+        for (; tail != head; tail++) {
+            AppendEvent(out, buffer->events[tail % BUFFER_EVENTS], state.pid, buffer->tid);
+        }
+        buffer->tail.store(tail, std::memory_order_release);
+
+        uint64_t dropped = buffer->dropped.load(std::memory_order_relaxed);
+        if (dropped != buffer->reportedDropped) {
+            AppendHeader(out, "i", "trace events dropped", state.pid, buffer->tid);
+            out += ",\"s\":\"t\",\"ts\":";
+            AppendMicros(out, NowNs());
+            out += ",\"args\":{\"count\":" + std::to_string(dropped - buffer->reportedDropped) + "}},\n";
+            buffer->reportedDropped = dropped;
+        }
+    }
+    AppendToFile(state.path, out);
+
+    // Buffers of threads that have exited and been drained are let go
+    std::lock_guard<std::mutex> buffersLock(state.buffersMutex);
+    buffers.clear();
+    state.buffers.erase(std::remove_if(state.buffers.begin(), state.buffers.end(),
+                                       [](const std::shared_ptr<ThreadBuffer>& buffer) {
+                                           return buffer.use_count() == 1 &&
+                                                  buffer->tail.load(std::memory_order_relaxed) ==
+                                                      buffer->head.load(std::memory_order_acquire);
+                                       }),
+                        state.buffers.end());
+}
+
+void SetThreadName(const char* name) {
+    t_threadName = name;
+    if (t_buffer) {
+        t_buffer->name.store(name, std::memory_order_relaxed);
+    }
+}
+
+Context Current() {
+    return t_current;
+}
+
+Context Inject() {
+    if (!Enabled() || !t_current.Valid()) {
+        return {};
+    }
+    Event event;
+    event.phase = Phase::FlowStart;
+    event.name = "hop";
+    event.ts = NowNs();
+    event.traceId = t_current.traceId;
+    event.spanId = NewId();
+    Push(event);
+    return {t_current.traceId, event.spanId};
+}
+
+void Instant(const char* name) {
+    if (!Enabled()) {
+        return;
+    }
+    Event event;
+    event.phase = Phase::Instant;
+    event.name = name;
+    event.ts = NowNs();
+    event.traceId = t_current.traceId;
+    Push(event);
+}
+
+void Span::Begin(const char* name, const Context* remote) {
+    m_name = name;
+    m_outer = t_current;
+    m_context.spanId = NewId();
+    m_start = NowNs();
+    if (remote && remote->Valid()) {
+        m_context.traceId = remote->traceId;
+        m_parentId = remote->spanId;
+        Event hop;
+        hop.phase = Phase::FlowEnd;
+        hop.name = "hop";
+        hop.ts = m_start;
+        hop.traceId = remote->traceId;
+        hop.spanId = remote->spanId;
+        Push(hop);
+    } else if (m_outer.Valid()) {
+        m_context.traceId = m_outer.traceId;
+        m_parentId = m_outer.spanId;
+    } else {
+        m_context.traceId = NewId();
+    }
+    t_current = m_context;
+}
+
+void Span::Adopt(const Context& remote) {
+    // Spans already closed under this one keep the trace id they had
+    if (!m_name || !remote.Valid()) {
+        return;
+    }
+    m_context.traceId = remote.traceId;
+    m_parentId = remote.spanId;
+    if (t_current.spanId == m_context.spanId) {
+        t_current.traceId = remote.traceId;
+    }
+    Event hop;
+    hop.phase = Phase::FlowEnd;
+    hop.name = "hop";
+    hop.ts = m_start;
+    hop.traceId = remote.traceId;
+    hop.spanId = remote.spanId;
+    Push(hop);
+}
+
+void Span::End() {
+    Event event;
+    event.phase = Phase::Complete;
+    event.name = m_name;
+    event.ts = m_start;
+    event.dur = NowNs() - m_start;
+    event.traceId = m_context.traceId;
+    event.spanId = m_context.spanId;
+    event.parentId = m_parentId;
+    Push(event);
+    t_current = m_outer;
+}
+
+} // namespace trace
+} // namespace clipx
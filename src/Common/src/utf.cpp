@@ -0,0 +1,522 @@
+#include "common/utf.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CLIPX_HAS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// Builds with CLIPX_ENABLE_AVX2 also step over ASCII 32 bytes at a time and
+// convert runs of three-byte characters (CJK) with byte shuffles
+#if defined(__AVX2__)
+#define CLIPX_HAS_AVX2 1
+#include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace clipx {
+namespace utf {
+
+namespace {
+
+constexpr uint32_t INVALID = 0xFFFFFFFF;
+constexpr uint32_t REPLACEMENT = 0xFFFD;
+
+inline bool IsContinuation(uint8_t b) {
+    return (b & 0xC0) == 0x80;
+}
+
+// `c` is a Unicode scalar value
+inline char* PutUtf8(char* out, uint32_t c) {
+    if (c < 0x80) {
+        *out++ = static_cast<char>(c);
+    } else if (c < 0x800) {
+        *out++ = static_cast<char>(0xC0 | (c >> 6));
+        *out++ = static_cast<char>(0x80 | (c & 0x3F));
+    } else if (c < 0x10000) {
+        *out++ = static_cast<char>(0xE0 | (c >> 12));
+        *out++ = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+        *out++ = static_cast<char>(0x80 | (c & 0x3F));
+    } else {
+        *out++ = static_cast<char>(0xF0 | (c >> 18));
+        *out++ = static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+        *out++ = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+        *out++ = static_cast<char>(0x80 | (c & 0x3F));
+    }
+    return out;
+}
+
+// The code point of the sequence at `p` (p < end), or INVALID. `length` is
+// the bytes it spans, or for INVALID the maximal subpart to replace: the
+// lead byte and the continuation bytes that could still have followed it.
+inline uint32_t DecodeUtf8(const uint8_t* p, const uint8_t* end, size_t& length) {
+    const uint8_t b0 = p[0];
+    const size_t avail = static_cast<size_t>(end - p);
+    length = 1;
+    if (b0 < 0x80) {
+        return b0;
+    }
+    if (b0 < 0xC2) {
+        return INVALID;  // Continuation byte or overlong two-byte lead
+    }
+    if (b0 < 0xE0) {
+        if (avail < 2 || !IsContinuation(p[1])) return INVALID;
+        length = 2;
+        return ((b0 & 0x1Fu) << 6) | (p[1] & 0x3Fu);
+    }
+    if (b0 < 0xF0) {
+        // E0 would be overlong below A0, ED a surrogate from A0
+        const uint8_t lo = b0 == 0xE0 ? 0xA0 : 0x80;
+        const uint8_t hi = b0 == 0xED ? 0x9F : 0xBF;
+        if (avail < 2 || p[1] < lo || p[1] > hi) return INVALID;
+        length = 2;
+        if (avail < 3 || !IsContinuation(p[2])) return INVALID;
+        length = 3;
+        return ((b0 & 0x0Fu) << 12) | ((p[1] & 0x3Fu) << 6) | (p[2] & 0x3Fu);
+    }
+    if (b0 < 0xF5) {
+        // F0 would be overlong below 90, F4 past U+10FFFF from 90
+        const uint8_t lo = b0 == 0xF0 ? 0x90 : 0x80;
+        const uint8_t hi = b0 == 0xF4 ? 0x8F : 0xBF;
+        if (avail < 2 || p[1] < lo || p[1] > hi) return INVALID;
+        length = 2;
+        if (avail < 3 || !IsContinuation(p[2])) return INVALID;
+        length = 3;
+        if (avail < 4 || !IsContinuation(p[3])) return INVALID;
+        length = 4;
+        return ((b0 & 0x07u) << 18) | ((p[1] & 0x3Fu) << 12) | ((p[2] & 0x3Fu) << 6) | (p[3] & 0x3Fu);
+    }
+    return INVALID;
+}
+
+// One sequence from `p` to `out` as UTF-16 (Unit of 2 bytes) or UTF-32
+template<typename Unit>
+inline Unit* DecodeInto(const uint8_t*& p, const uint8_t* end, Unit* out, bool& ok) {
+    if (*p < 0x80) {
+        *out++ = static_cast<Unit>(*p++);
+        return out;
+    }
+    // CJK and most other BMP text: a well-formed three-byte sequence,
+    // checked in one go rather than byte by byte
+    if ((*p & 0xF0) == 0xE0 && end - p >= 3 && IsContinuation(p[1]) && IsContinuation(p[2])) {
+        const uint32_t c = ((p[0] & 0x0Fu) << 12) | ((p[1] & 0x3Fu) << 6) | (p[2] & 0x3Fu);
+        if (c >= 0x800 && (c & 0xF800) != 0xD800) {
+            p += 3;
+            *out++ = static_cast<Unit>(c);
+            return out;
+        }
+    }
+    size_t length;
+    uint32_t c = DecodeUtf8(p, end, length);
+    p += length;
+    if (c == INVALID) {
+        ok = false;
+        c = REPLACEMENT;
+    }
+    if (sizeof(Unit) == 2 && c >= 0x10000) {
+        c -= 0x10000;
+        *out++ = static_cast<Unit>(0xD800 + (c >> 10));
+        *out++ = static_cast<Unit>(0xDC00 + (c & 0x3FF));
+        return out;
+    }
+    *out++ = static_cast<Unit>(c);
+    return out;
+}
+
+// One code point from UTF-16 at `p` to `out`; pairs are joined
+template<typename Unit>
+inline char* EncodeUtf16Into(const Unit*& p, const Unit* end, char* out, bool& ok) {
+    uint32_t c = static_cast<uint16_t>(*p++);
+    if (c >= 0xD800 && c <= 0xDFFF) {
+        uint32_t low = p < end ? static_cast<uint16_t>(*p) : 0;
+        if (c < 0xDC00 && low >= 0xDC00 && low <= 0xDFFF) {
+            p++;
+            c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+        } else {
+            ok = false;
+            c = REPLACEMENT;
+        }
+    }
+    return PutUtf8(out, c);
+}
+
+template<typename Unit>
+inline char* EncodeUtf32Into(const Unit*& p, char* out, bool& ok) {
+    uint32_t c = static_cast<uint32_t>(*p++);
+    if (c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF)) {
+        ok = false;
+        c = REPLACEMENT;
+    }
+    return PutUtf8(out, c);
+}
+
+// One code point from UTF-16 (Unit of 2 bytes) or UTF-32 at `p` to `out`
+template<typename Unit>
+inline char* EncodeInto(const Unit*& p, const Unit* end, char* out, bool& ok) {
+    if (sizeof(Unit) == 2) {
+        return EncodeUtf16Into(p, end, out, ok);
+    }
+    return EncodeUtf32Into(p, out, ok);
+}
+
+// Number of set bits below the first clear one in a 16-bit movemask
+inline size_t TrailingOnes(uint32_t mask) {
+    const uint32_t clear = ~mask & 0xFFFF;
+    if (clear == 0) {
+        return 16;
+    }
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, clear);
+    return index;
+#else
+    return static_cast<size_t>(__builtin_ctz(clear));
+#endif
+}
+
+// The vector steps below convert a fixed-size block and return how many
+// leading units of it were of their kind (ASCII, three-byte); the output
+// past those is scratch that the next step overwrites. The callers keep
+// enough input left that the block fits the worst-case output size.
+
+#ifdef CLIPX_HAS_SSE2
+// Up to 16 leading ASCII bytes, widened
+template<typename Unit>
+inline size_t AsciiFromUtf8(const uint8_t* in, Unit* out) {
+    const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+    const __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+    __m128i* dst = reinterpret_cast<__m128i*>(out);
+    if (sizeof(Unit) == 2) {
+        _mm_storeu_si128(dst, lo);
+        _mm_storeu_si128(dst + 1, hi);
+    } else {
+        _mm_storeu_si128(dst, _mm_unpacklo_epi16(lo, zero));
+        _mm_storeu_si128(dst + 1, _mm_unpackhi_epi16(lo, zero));
+        _mm_storeu_si128(dst + 2, _mm_unpacklo_epi16(hi, zero));
+        _mm_storeu_si128(dst + 3, _mm_unpackhi_epi16(hi, zero));
+    }
+    return TrailingOnes(~static_cast<uint32_t>(_mm_movemask_epi8(bytes)));
+}
+
+// Up to 16 leading ASCII UTF-16 or UTF-32 units, narrowed
+template<typename Unit>
+inline size_t AsciiToUtf8(const Unit* in, char* out) {
+    const __m128i* src = reinterpret_cast<const __m128i*>(in);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i narrow;
+    __m128i isAscii;  // 0xFF per ASCII unit
+    if (sizeof(Unit) == 2) {
+        const __m128i high = _mm_set1_epi16(static_cast<short>(0xFF80));
+        const __m128i a = _mm_loadu_si128(src);
+        const __m128i b = _mm_loadu_si128(src + 1);
+        narrow = _mm_packus_epi16(a, b);
+        isAscii = _mm_packs_epi16(_mm_cmpeq_epi16(_mm_and_si128(a, high), zero),
+                                  _mm_cmpeq_epi16(_mm_and_si128(b, high), zero));
+    } else {
+        const __m128i high = _mm_set1_epi32(static_cast<int>(0xFFFFFF80));
+        const __m128i a = _mm_loadu_si128(src);
+        const __m128i b = _mm_loadu_si128(src + 1);
+        const __m128i c = _mm_loadu_si128(src + 2);
+        const __m128i d = _mm_loadu_si128(src + 3);
+        narrow = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+        isAscii = _mm_packs_epi16(_mm_packs_epi32(_mm_cmpeq_epi32(_mm_and_si128(a, high), zero),
+                                                  _mm_cmpeq_epi32(_mm_and_si128(b, high), zero)),
+                                  _mm_packs_epi32(_mm_cmpeq_epi32(_mm_and_si128(c, high), zero),
+                                                  _mm_cmpeq_epi32(_mm_and_si128(d, high), zero)));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), narrow);
+    return TrailingOnes(static_cast<uint32_t>(_mm_movemask_epi8(isAscii)));
+}
+#endif
+
+#ifdef CLIPX_HAS_AVX2
+// 32 bytes, if all ASCII, widened
+template<typename Unit>
+inline bool AsciiFromUtf8x32(const uint8_t* in, Unit* out) {
+    const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+    if (_mm256_movemask_epi8(bytes) != 0) {
+        return false;
+    }
+    __m256i* dst = reinterpret_cast<__m256i*>(out);
+    const __m128i lo = _mm256_castsi256_si128(bytes);
+    const __m128i hi = _mm256_extracti128_si256(bytes, 1);
+    if (sizeof(Unit) == 2) {
+        _mm256_storeu_si256(dst, _mm256_cvtepu8_epi16(lo));
+        _mm256_storeu_si256(dst + 1, _mm256_cvtepu8_epi16(hi));
+    } else {
+        _mm256_storeu_si256(dst, _mm256_cvtepu8_epi32(lo));
+        _mm256_storeu_si256(dst + 1, _mm256_cvtepu8_epi32(_mm_srli_si128(lo, 8)));
+        _mm256_storeu_si256(dst + 2, _mm256_cvtepu8_epi32(hi));
+        _mm256_storeu_si256(dst + 3, _mm256_cvtepu8_epi32(_mm_srli_si128(hi, 8)));
+    }
+    return true;
+}
+
+// 32 UTF-16 units, if all ASCII, narrowed
+template<typename Unit>
+inline bool AsciiToUtf8x32(const Unit* in, char* out) {
+    if (sizeof(Unit) != 2) {
+        return false;
+    }
+    const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+    const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 16));
+    if (!_mm256_testz_si256(_mm256_or_si256(a, b), _mm256_set1_epi16(static_cast<short>(0xFF80)))) {
+        return false;
+    }
+    // The pack works per 128-bit lane; put the quarters back in order
+    const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), packed);
+    return true;
+}
+
+// Up to 8 leading units that take three bytes (U+0800..U+FFFF, no
+// surrogates), as 24 bytes of UTF-8
+template<typename Unit>
+inline size_t ThreeByteToUtf8(const Unit* in, char* out) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i* src = reinterpret_cast<const __m128i*>(in);
+    __m128i units;
+    __m128i wide;  // Nonzero per UTF-32 unit above U+FFFF
+    if (sizeof(Unit) == 2) {
+        units = _mm_loadu_si128(src);
+        wide = zero;
+    } else {
+        const __m128i a = _mm_loadu_si128(src);
+        const __m128i b = _mm_loadu_si128(src + 1);
+        units = _mm_packus_epi32(a, b);
+        wide = _mm_packs_epi32(_mm_srli_epi32(a, 16), _mm_srli_epi32(b, 16));
+    }
+    const __m128i top = _mm_and_si128(units, _mm_set1_epi16(static_cast<short>(0xF800)));
+    const __m128i bad = _mm_or_si128(_mm_cmpeq_epi16(top, zero),
+                                     _mm_cmpeq_epi16(top, _mm_set1_epi16(static_cast<short>(0xD800))));
+    const __m128i good = _mm_andnot_si128(bad, _mm_cmpeq_epi16(wide, zero));
+
+    const __m128i sixBits = _mm_set1_epi16(0x3F);
+    const __m128i lead = _mm_or_si128(_mm_srli_epi16(units, 12), _mm_set1_epi16(0xE0));
+    const __m128i middle = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(units, 6), sixBits), _mm_set1_epi16(0x80));
+    const __m128i last = _mm_or_si128(_mm_and_si128(units, sixBits), _mm_set1_epi16(0x80));
+
+    // Bytes 0-7 leads, 8-15 middles; and the last bytes
+    const __m128i leadMiddle = _mm_packus_epi16(lead, middle);
+    const __m128i lasts = _mm_packus_epi16(last, last);
+
+    const __m128i first16 = _mm_or_si128(
+        _mm_shuffle_epi8(leadMiddle, _mm_setr_epi8(0, 8, -1, 1, 9, -1, 2, 10, -1, 3, 11, -1, 4, 12, -1, 5)),
+        _mm_shuffle_epi8(lasts, _mm_setr_epi8(-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1)));
+    const __m128i next8 = _mm_or_si128(
+        _mm_shuffle_epi8(leadMiddle, _mm_setr_epi8(13, -1, 6, 14, -1, 7, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+        _mm_shuffle_epi8(lasts, _mm_setr_epi8(-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, -1, -1, -1, -1, -1, -1)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), first16);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out + 16), next8);
+    return TrailingOnes(static_cast<uint32_t>(_mm_movemask_epi8(good))) / 2;
+}
+
+// Up to 8 leading valid three-byte sequences of the next 24 bytes, as
+// units. Reads 32 bytes.
+template<typename Unit>
+inline size_t ThreeByteFromUtf8(const uint8_t* in, Unit* out) {
+    const __m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    const __m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 16));
+
+    // Byte k of every sequence into the low half of a 16-bit lane; bytes
+    // 0-15 come from r0, 16-23 from r1
+    const __m128i lead = _mm_or_si128(
+        _mm_shuffle_epi8(r0, _mm_setr_epi8(0, -1, 3, -1, 6, -1, 9, -1, 12, -1, 15, -1, -1, -1, -1, -1)),
+        _mm_shuffle_epi8(r1, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, -1, 5, -1)));
+    const __m128i second = _mm_or_si128(
+        _mm_shuffle_epi8(r0, _mm_setr_epi8(1, -1, 4, -1, 7, -1, 10, -1, 13, -1, -1, -1, -1, -1, -1, -1)),
+        _mm_shuffle_epi8(r1, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, -1, 3, -1, 6, -1)));
+    const __m128i third = _mm_or_si128(
+        _mm_shuffle_epi8(r0, _mm_setr_epi8(2, -1, 5, -1, 8, -1, 11, -1, 14, -1, -1, -1, -1, -1, -1, -1)),
+        _mm_shuffle_epi8(r1, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, -1, 4, -1, 7, -1)));
+
+    const __m128i continuationMask = _mm_set1_epi16(0xC0);
+    const __m128i continuation = _mm_set1_epi16(0x80);
+    __m128i good = _mm_cmpeq_epi16(_mm_and_si128(lead, _mm_set1_epi16(0xF0)), _mm_set1_epi16(0xE0));
+    good = _mm_and_si128(good, _mm_cmpeq_epi16(_mm_and_si128(second, continuationMask), continuation));
+    good = _mm_and_si128(good, _mm_cmpeq_epi16(_mm_and_si128(third, continuationMask), continuation));
+
+    const __m128i sixBits = _mm_set1_epi16(0x3F);
+    const __m128i units = _mm_or_si128(
+        _mm_or_si128(_mm_slli_epi16(_mm_and_si128(lead, _mm_set1_epi16(0x0F)), 12),
+                     _mm_slli_epi16(_mm_and_si128(second, sixBits), 6)),
+        _mm_and_si128(third, sixBits));
+
+    // Overlong (below U+0800) or a surrogate
+    const __m128i top = _mm_and_si128(units, _mm_set1_epi16(static_cast<short>(0xF800)));
+    const __m128i bad = _mm_or_si128(_mm_cmpeq_epi16(top, _mm_setzero_si128()),
+                                     _mm_cmpeq_epi16(top, _mm_set1_epi16(static_cast<short>(0xD800))));
+    good = _mm_andnot_si128(bad, good);
+
+    __m128i* dst = reinterpret_cast<__m128i*>(out);
+    if (sizeof(Unit) == 2) {
+        _mm_storeu_si128(dst, units);
+    } else {
+        _mm_storeu_si128(dst, _mm_unpacklo_epi16(units, _mm_setzero_si128()));
+        _mm_storeu_si128(dst + 1, _mm_unpackhi_epi16(units, _mm_setzero_si128()));
+    }
+    return TrailingOnes(static_cast<uint32_t>(_mm_movemask_epi8(good))) / 2;
+}
+#endif
+
+// Inputs shorter than this (paths, labels, UI strings) go straight to the
+// scalar loop: the vector blocks would run at most once or twice and the
+// checks around them cost more than they save
+constexpr size_t VECTOR_MIN_SIZE = 64;
+
+// With AVX2 the loops stay on the three-byte step while it converts whole
+// blocks and convert only the code point that stops it on its own.
+// Otherwise a block that is not all ASCII is converted one code point at
+// a time, so mixed text does not pay for a failed check on every character.
+
+template<typename Unit>
+size_t FromUtf8(const char* input, size_t size, Unit* out, bool* valid) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(input);
+    const uint8_t* end = p + size;
+    Unit* o = out;
+    bool ok = true;
+
+    while (size >= VECTOR_MIN_SIZE && end - p >= 32) {
+#ifdef CLIPX_HAS_AVX2
+        if (AsciiFromUtf8x32(p, o)) {
+            p += 32;
+            o += 32;
+            continue;
+        }
+#endif
+#ifdef CLIPX_HAS_SSE2
+        const size_t ascii = AsciiFromUtf8(p, o);
+        p += ascii;
+        o += ascii;
+        if (ascii == 16) {
+            continue;
+        }
+#endif
+#ifdef CLIPX_HAS_AVX2
+        while (end - p >= 32) {
+            const size_t threeByte = ThreeByteFromUtf8(p, o);
+            p += threeByte * 3;
+            o += threeByte;
+            if (threeByte < 8) {
+                break;
+            }
+        }
+        if (p < end) {
+            o = DecodeInto(p, end, o, ok);
+        }
+#else
+        const uint8_t* blockEnd = p + 16;
+        while (p < blockEnd) {
+            o = DecodeInto(p, end, o, ok);
+        }
+#endif
+    }
+    while (p < end) {
+        o = DecodeInto(p, end, o, ok);
+    }
+
+    if (valid) *valid = ok;
+    return static_cast<size_t>(o - out);
+}
+
+template<typename Unit>
+size_t ToUtf8(const Unit* in, size_t size, char* out, bool* valid) {
+    const Unit* p = in;
+    const Unit* end = in + size;
+    char* o = out;
+    bool ok = true;
+
+    while (size >= VECTOR_MIN_SIZE && end - p >= 32) {
+#ifdef CLIPX_HAS_AVX2
+        if (AsciiToUtf8x32(p, o)) {
+            p += 32;
+            o += 32;
+            continue;
+        }
+#endif
+#ifdef CLIPX_HAS_SSE2
+        const size_t ascii = AsciiToUtf8(p, o);
+        p += ascii;
+        o += ascii;
+        if (ascii == 16) {
+            continue;
+        }
+#endif
+#ifdef CLIPX_HAS_AVX2
+        while (end - p >= 32) {
+            const size_t threeByte = ThreeByteToUtf8(p, o);
+            p += threeByte;
+            o += threeByte * 3;
+            if (threeByte < 8) {
+                break;
+            }
+        }
+        if (p < end) {
+            o = EncodeInto(p, end, o, ok);
+        }
+#else
+        const Unit* blockEnd = p + 16;
+        while (p < blockEnd) {
+            o = EncodeInto(p, end, o, ok);
+        }
+#endif
+    }
+    while (p < end) {
+        o = EncodeInto(p, end, o, ok);
+    }
+
+    if (valid) *valid = ok;
+    return static_cast<size_t>(o - out);
+}
+
+} // namespace
+
+size_t Utf16ToUtf8(const char16_t* in, size_t size, char* out, bool* valid) {
+    return ToUtf8(in, size, out, valid);
+}
+
+size_t Utf32ToUtf8(const char32_t* in, size_t size, char* out, bool* valid) {
+    return ToUtf8(in, size, out, valid);
+}
+
+size_t WideToUtf8(const wchar_t* in, size_t size, char* out, bool* valid) {
+    return ToUtf8(in, size, out, valid);
+}
+
+size_t Utf8ToUtf16(const char* in, size_t size, char16_t* out, bool* valid) {
+    return FromUtf8(in, size, out, valid);
+}
+
+size_t Utf8ToUtf32(const char* in, size_t size, char32_t* out, bool* valid) {
+    return FromUtf8(in, size, out, valid);
+}
+
+size_t Utf8ToWide(const char* in, size_t size, wchar_t* out, bool* valid) {
+    return FromUtf8(in, size, out, valid);
+}
+
+bool ValidateUtf8(const char* data, size_t size) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+    const uint8_t* end = p + size;
+    while (p < end) {
+#ifdef CLIPX_HAS_SSE2
+        if (end - p >= 16 && _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) == 0) {
+            p += 16;
+            continue;
+        }
+#endif
+        size_t length;
+        if (DecodeUtf8(p, end, length) == INVALID) {
+            return false;
+        }
+        p += length;
+    }
+    return true;
+}
+
+} // namespace utf
+} // namespace clipx
@@ -1,12 +1,17 @@
+#ifdef _WIN32
 #include "common/windows.h"
+#include <shlobj.h>
+#endif
 #include "common/utils.h"
 #include "common/logger.h"
-#include <shlobj.h>
+#include "common/utf.h"
 #include <chrono>
+#include <cstdlib>
 #include <iomanip>
 #include <sstream>
 #include <filesystem>
 #include <algorithm>
+#include <array>
 #include <ctime>
 
 namespace clipx {
@@ -19,13 +24,20 @@ int64_t GetCurrentTimestamp() {
 }
 
 std::string GetExecutableDir() {
+#ifdef _WIN32
     wchar_t buffer[MAX_PATH];
     GetModuleFileNameW(nullptr, buffer, MAX_PATH);
     std::filesystem::path exePath(buffer);
     return exePath.parent_path().string();
+#else
+    std::error_code error;
+    std::filesystem::path exePath = std::filesystem::read_symlink("/proc/self/exe", error);
+    return error ? std::filesystem::current_path().string() : exePath.parent_path().string();
+#endif
 }
 
 std::string GetAppDataDir() {
+#ifdef _WIN32
     wchar_t* path = nullptr;
     if (SUCCEEDED(SHGetKnownFolderPath(FOLDERID_RoamingAppData, 0, nullptr, &path))) {
         std::wstring wpath(path);
@@ -34,6 +46,16 @@ std::string GetAppDataDir() {
         EnsureDirectory(result);
         return result;
     }
+#else
+    const char* dataHome = std::getenv("XDG_DATA_HOME");
+    const char* home = std::getenv("HOME");
+    if ((dataHome && *dataHome) || (home && *home)) {
+        std::string result = (dataHome && *dataHome) ? std::string(dataHome) + "/ClipX"
+                                                     : std::string(home) + "/.local/share/ClipX";
+        EnsureDirectory(result);
+        return result;
+    }
+#endif
     return GetExecutableDir();
 }
 
@@ -73,29 +95,28 @@ std::vector<uint8_t> ComputeHash(const std::vector<uint8_t>& data) {
     return hash;
 }
 
-std::string WideToUtf8(const std::wstring& wstr) {
-    if (wstr.empty()) return "";
-
-    int size = WideCharToMultiByte(CP_UTF8, 0, wstr.c_str(), static_cast<int>(wstr.length()),
-                                    nullptr, 0, nullptr, nullptr);
-    if (size == 0) return "";
+// Below this many input units a conversion goes through a stack buffer
+// and the result is allocated at its exact size; above, one pass into a
+// string of the worst-case size, trimmed afterwards
+constexpr size_t SHORT_CONVERSION_SIZE = 128;
 
-    std::string result(size, 0);
-    WideCharToMultiByte(CP_UTF8, 0, wstr.c_str(), static_cast<int>(wstr.length()),
-                        &result[0], size, nullptr, nullptr);
+std::string WideToUtf8(const std::wstring& wstr) {
+    if (wstr.size() < SHORT_CONVERSION_SIZE) {
+        char buffer[utf::MaxUtf8ForWide(SHORT_CONVERSION_SIZE)];
+        return std::string(buffer, utf::WideToUtf8(wstr.data(), wstr.size(), buffer));
+    }
+    std::string result(utf::MaxUtf8ForWide(wstr.size()), '\0');
+    result.resize(utf::WideToUtf8(wstr.data(), wstr.size(), &result[0]));
     return result;
 }
 
 std::wstring Utf8ToWide(const std::string& str) {
-    if (str.empty()) return L"";
-
-    int size = MultiByteToWideChar(CP_UTF8, 0, str.c_str(), static_cast<int>(str.length()),
-                                    nullptr, 0);
-    if (size == 0) return L"";
-
-    std::wstring result(size, 0);
-    MultiByteToWideChar(CP_UTF8, 0, str.c_str(), static_cast<int>(str.length()),
-                        &result[0], size);
+    if (str.size() < SHORT_CONVERSION_SIZE) {
+        wchar_t buffer[utf::MaxWideForUtf8(SHORT_CONVERSION_SIZE)];
+        return std::wstring(buffer, utf::Utf8ToWide(str.data(), str.size(), buffer));
+    }
+    std::wstring result(utf::MaxWideForUtf8(str.size()), L'\0');
+    result.resize(utf::Utf8ToWide(str.data(), str.size(), &result[0]));
     return result;
 }
 
@@ -104,14 +125,6 @@ std::string FormatTimestamp(int64_t timestamp) {
     auto now = std::chrono::system_clock::now();
     auto diff = std::chrono::duration_cast<std::chrono::seconds>(now - time);
 
-    std::tm tm;
-    time_t timeT = std::chrono::system_clock::to_time_t(time);
-#ifdef _WIN32
-    localtime_s(&tm, &timeT);
-#else
-    localtime_r(&timeT, &tm);
-#endif
-
     if (diff.count() < 60) {
         return "Just now";
     } else if (diff.count() < 3600) {
@@ -124,9 +137,16 @@ std::string FormatTimestamp(int64_t timestamp) {
         int days = static_cast<int>(diff.count() / 86400);
         return std::to_string(days) + " day" + (days > 1 ? "s" : "") + " ago";
     } else {
-        std::ostringstream oss;
-        oss << std::put_time(&tm, "%Y-%m-%d");
-        return oss.str();
+        std::tm tm;
+        time_t timeT = std::chrono::system_clock::to_time_t(time);
+#ifdef _WIN32
+        localtime_s(&tm, &timeT);
+#else
+        localtime_r(&timeT, &tm);
+#endif
+        char date[16];
+        std::strftime(date, sizeof(date), "%Y-%m-%d", &tm);
+        return date;
     }
 }
 
@@ -296,59 +316,47 @@ std::string Base64Encode(const std::vector<uint8_t>& data) {
     std::string result;
     result.reserve(((data.size() + 2) / 3) * 4);
 
-    size_t i = 0;
-    while (i < data.size()) {
-        uint32_t octet_a = i < data.size() ? data[i++] : 0;
-        uint32_t octet_b = i < data.size() ? data[i++] : 0;
-        uint32_t octet_c = i < data.size() ? data[i++] : 0;
-
-        uint32_t triple = (octet_a << 16) | (octet_b << 8) | octet_c;
+    for (size_t i = 0; i < data.size(); i += 3) {
+        const size_t remaining = data.size() - i;
+        uint32_t triple = static_cast<uint32_t>(data[i]) << 16;
+        if (remaining > 1) triple |= static_cast<uint32_t>(data[i + 1]) << 8;
+        if (remaining > 2) triple |= data[i + 2];
 
         result += base64_chars[(triple >> 18) & 0x3F];
         result += base64_chars[(triple >> 12) & 0x3F];
-        result += (i - 2 <= data.size()) ? base64_chars[(triple >> 6) & 0x3F] : '=';
-        result += (i - 1 <= data.size()) ? base64_chars[triple & 0x3F] : '=';
+        result += remaining > 1 ? base64_chars[(triple >> 6) & 0x3F] : '=';
+        result += remaining > 2 ? base64_chars[triple & 0x3F] : '=';
     }
 
     return result;
 }
 
 std::vector<uint8_t> Base64Decode(const std::string& encoded) {
-    static int decodeTable[256];
-    static bool initialized = false;
-
-    if (!initialized) {
-        std::fill(decodeTable, decodeTable + 256, -1);
+    static const auto decodeTable = []() {
+        std::array<int8_t, 256> table;
+        table.fill(-1);
         for (int i = 0; i < 64; i++) {
-            decodeTable[static_cast<unsigned char>(base64_chars[i])] = i;
+            table[static_cast<unsigned char>(base64_chars[i])] = static_cast<int8_t>(i);
         }
-        initialized = true;
-    }
+        return table;
+    }();
 
     std::vector<uint8_t> result;
     result.reserve((encoded.size() / 4) * 3);
 
-    size_t i = 0;
-    while (i < encoded.size()) {
-        int sextet_a = (i < encoded.size() && encoded[i] != '=') ?
-                       decodeTable[static_cast<unsigned char>(encoded[i++])] : 0;
-        int sextet_b = (i < encoded.size() && encoded[i] != '=') ?
-                       decodeTable[static_cast<unsigned char>(encoded[i++])] : 0;
-        int sextet_c = (i < encoded.size() && encoded[i] != '=') ?
-                       decodeTable[static_cast<unsigned char>(encoded[i++])] : 0;
-        int sextet_d = (i < encoded.size() && encoded[i] != '=') ?
-                       decodeTable[static_cast<unsigned char>(encoded[i++])] : 0;
-
-        uint32_t triple = (sextet_a << 18) | (sextet_b << 12) | (sextet_c << 6) | sextet_d;
-
-        if (sextet_a != -1 && sextet_b != -1) {
-            result.push_back(static_cast<uint8_t>((triple >> 16) & 0xFF));
-            if (encoded[i - 2] != '=') {
-                result.push_back(static_cast<uint8_t>((triple >> 8) & 0xFF));
-            }
-            if (encoded[i - 1] != '=') {
-                result.push_back(static_cast<uint8_t>(triple & 0xFF));
-            }
+    // Stops at padding or the first character outside the alphabet
+    uint32_t bits = 0;
+    int count = 0;
+    for (char c : encoded) {
+        int sextet = decodeTable[static_cast<unsigned char>(c)];
+        if (sextet < 0) {
+            break;
+        }
+        bits = (bits << 6) | static_cast<uint32_t>(sextet);
+        count += 6;
+        if (count >= 8) {
+            count -= 8;
+            result.push_back(static_cast<uint8_t>((bits >> count) & 0xFF));
         }
     }
 
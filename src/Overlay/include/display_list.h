@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "render_cache.h"
+
+namespace clipx {
+
+struct DrawRect {
+    int left = 0;
+    int top = 0;
+    int right = 0;
+    int bottom = 0;
+
+    bool Empty() const { return right <= left || bottom <= top; }
+    bool Intersects(const DrawRect& other) const;
+    DrawRect Union(const DrawRect& other) const;  // Bounding box; an empty side is ignored
+    bool operator==(const DrawRect& other) const;
+    bool operator!=(const DrawRect& other) const { return !(*this == other); }
+};
+
+using DrawColor = uint32_t;  // 0x00BBGGRR, the COLORREF layout
+
+// One primitive of the overlay's painting, as the renderer draws it
+struct DrawOp {
+    enum class Kind {
+        Fill,
+        RoundRect,
+        Text,
+        Icon,
+        Image,
+        Line
+    };
+
+    Kind kind = Kind::Fill;
+    DrawRect rect;          // Shape, text box, icon square or image box; a line runs left,top -> right,bottom
+    DrawColor color = 0;    // Fill, text, icon or line color
+    DrawColor border = 0;   // Round rects; no border if 0
+    int radius = 0;
+    int width = 0;          // Border or line width
+    uint32_t format = 0;    // Text: DrawText flags
+    TextStyle style = TextStyle::Normal;
+    std::wstring text;
+    std::string icon;
+    std::shared_ptr<const std::vector<uint8_t>> image;  // Packed DIB, fitted into rect; compared by identity
+
+    DrawRect Bounds() const;  // Pixels it may touch
+    bool operator==(const DrawOp& other) const;
+    bool operator!=(const DrawOp& other) const { return !(*this == other); }
+};
+
+// A frame as a list of draw ops, grouped into chunks that are compared as
+// a whole: the search bar, the tag panel, each row slot. Painting replays
+// the ops; ComputeDamage compares two frames to find what needs it.
+class DisplayList {
+public:
+    struct Chunk {
+        uint64_t key = 0;
+        size_t begin = 0;  // Op range
+        size_t end = 0;
+        DrawRect bounds;
+    };
+
+    void Clear();
+
+    // Ops added from here on belong to chunk `key`. Keys are unique in a
+    // frame; ops added before the first chunk form chunk 0.
+    void BeginChunk(uint64_t key);
+
+    void Fill(const DrawRect& rect, DrawColor color);
+    void RoundRect(const DrawRect& rect, int radius, DrawColor fill, DrawColor border = 0, int borderWidth = 0);
+    void Text(std::wstring text, const DrawRect& rect, uint32_t format, DrawColor color, TextStyle style);
+    void Icon(int x, int y, int size, std::string icon, DrawColor color);
+    void Image(const DrawRect& rect, std::shared_ptr<const std::vector<uint8_t>> dib);
+    void Line(int x1, int y1, int x2, int y2, DrawColor color, int width = 1);
+    void Add(DrawOp op);
+
+    const std::vector<DrawOp>& Ops() const { return m_ops; }
+    const std::vector<Chunk>& Chunks() const { return m_chunks; }
+
+private:
+    std::vector<DrawOp> m_ops;
+    std::vector<Chunk> m_chunks;
+};
+
+// Rectangles that changed from one frame to the next. A chunk that differs
+// in any op, or exists in only one frame, damages its bounds in both.
+// Overlapping or touching rectangles are merged; more than `maxRects`
+// collapse into their bounding box.
+std::vector<DrawRect> ComputeDamage(const DisplayList& before, const DisplayList& after, size_t maxRects = 8);
+
+} // namespace clipx
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "common/search_query.h"
+#include "list_model.h"
+
+namespace clipx {
+
+// Search box input matched against rows the overlay already holds, by the
+// rules of MatchesSearchQuery. Terms are lowered once per query and rows
+// are compared without copies. Regex queries match nothing locally.
+class LocalMatcher {
+public:
+    explicit LocalMatcher(const std::string& input, int64_t now = 0);
+
+    bool Matches(const UIEntry& entry) const;
+
+private:
+    SearchQuery m_query;
+    std::vector<std::string> m_terms;  // Lowercase
+    std::vector<std::string> m_tags;
+    std::vector<std::string> m_apps;
+};
+
+// Rows to show while a search streams in. `server` is what ClipD returned
+// so far, newest first, as it searches. Until it is done, local matches
+// older than its last row follow it: the server hasn't reached them yet.
+// Newer ones it skipped don't match by its rules and are dropped. Rows
+// already on screen thus stay where they are from one batch to the next.
+std::vector<UIEntry> MergeSearchResults(const std::vector<UIEntry>& server, const std::vector<UIEntry>& local,
+                                        bool done);
+
+// Instant results for the overlay's search box: every keystroke is first
+// answered from the rows the overlay knows (the history it had loaded,
+// earlier results), then corrected by ClipD's results as they arrive.
+class InstantSearch {
+public:
+    static constexpr size_t MAX_KNOWN = 2000;
+    static constexpr size_t MAX_MATCHES = 100;  // The server search's limit
+
+    void AddKnown(const std::vector<UIEntry>& rows);  // Replaces known rows with the same id
+    void ClearKnown();
+    size_t KnownCount() const { return m_known.size(); }
+
+    // A new query: returns the local matches to show now
+    const std::vector<UIEntry>& Begin(const std::string& input, int64_t now = 0);
+
+    // The next batch of the server's results for the query; returns the
+    // rows to show now
+    const std::vector<UIEntry>& AddResults(const std::vector<UIEntry>& rows, bool done);
+
+    // From the change feed, so that later merges don't bring back a stale
+    // or deleted row
+    void Update(int64_t id, const std::function<void(UIEntry&)>& update);
+    void Remove(const std::function<bool(const UIEntry&)>& predicate);
+
+private:
+    std::vector<UIEntry> m_known;   // Newest first
+    std::vector<UIEntry> m_local;   // Local matches of the query
+    std::vector<UIEntry> m_server;  // Server results so far
+    std::vector<UIEntry> m_shown;
+};
+
+} // namespace clipx
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "common/types.h"
+
+namespace clipx {
+
+struct UIEntry {
+    int64_t id;
+    std::string preview;
+    std::string sourceApp;
+    int64_t timestamp = 0;
+    ClipboardDataType type;
+    bool isFavorited;
+    int copyCount;
+    std::vector<std::string> tags;
+    std::shared_ptr<const std::vector<uint8_t>> thumbnail;  // Image rows: 32 bpp DIB from ClipD, shared by copies
+};
+
+// Rows [offset, offset + limit) the model wants. Answer with PageLoaded (or
+// PageFailed), passing the request back unchanged.
+struct ListPageRequest {
+    size_t offset = 0;
+    size_t limit = 0;
+    uint64_t generation = 0;  // Of the list it was made for
+};
+
+// Headless model of a long list shown through a small viewport. Only a
+// contiguous window of rows around the viewport is materialized: pages are
+// fetched ahead of the scroll direction and rows far behind it are evicted,
+// so memory stays bounded however long the list is. Rows not loaded yet
+// read as nullptr.
+//
+// The list length is known once the server reports it (SetTotal) or a page
+// comes back short; until then Count() is a lower bound that grows as the
+// viewport nears the end.
+//
+// Edits from the change feed are applied to the window in place. Pages are
+// tagged with the data version (change seq) they were read at, and only
+// used if it matches the version of the model, so a page can't undo or
+// double an edit it raced with. The selection follows its entry.
+//
+// Not thread-safe; the overlay drives it from the UI thread.
+class VirtualListModel {
+public:
+    struct Options {
+        size_t pageSize = 50;
+        size_t maxRows = 300;      // Materialized rows kept around the viewport
+        size_t prefetchPages = 1;  // Loaded ahead of the scroll direction
+    };
+
+    using FetchCallback = std::function<void(const ListPageRequest& request)>;
+
+    VirtualListModel();
+    explicit VirtualListModel(Options options);
+
+    // Without one the list is what Reset and Append hand in, and nothing is
+    // ever evicted
+    void SetFetchCallback(FetchCallback fetch);
+
+    // Starts a new list from its first rows. `complete`: there are no more;
+    // otherwise the rest is fetched as needed. Version 0 disables the
+    // version check. The selection stays on its entry if the rows have it.
+    void Reset(std::vector<UIEntry> rows, bool complete, int64_t version = 0);
+    void Append(const std::vector<UIEntry>& rows);  // At the end of a complete list
+
+    // The full length of the list as of the model's version, e.g. the total
+    // reported with the first page: the scroll range covers all of it and
+    // rows are fetched wherever the viewport goes
+    void SetTotal(size_t total);
+
+    // False if the page was dropped: made for an earlier list, or read at
+    // another version than the model's (then it is requested again once the
+    // versions agree)
+    bool PageLoaded(const ListPageRequest& request, std::vector<UIEntry> rows, int64_t version);
+    void PageFailed(const ListPageRequest& request);
+
+    // Version after edits were applied
+    void SetVersion(int64_t version);
+    int64_t GetVersion() const { return m_version; }
+
+    size_t Count() const { return m_count; }
+    bool IsComplete() const { return m_complete; }
+    const UIEntry* Row(size_t index) const;
+    size_t LoadedRows() const { return m_rows.size(); }
+    std::vector<UIEntry> LoadedEntries() const { return {m_rows.begin(), m_rows.end()}; }
+
+    // Viewport: `visible` rows from `first`, clamped to the list
+    void SetViewport(size_t first, size_t visible);
+    void ScrollBy(int delta);
+    void EnsureVisible(size_t index);
+    size_t First() const { return m_first; }
+    size_t Visible() const { return m_visible; }
+
+    void Select(size_t index);  // Clamped; scrolls it into view
+    size_t Selected() const { return m_selected; }
+    const UIEntry* SelectedRow() const { return Row(m_selected); }
+
+    // Edits. Inserted entries go to the top; Update and Remove reach loaded
+    // rows only, and rows moved or removed outside the window make the model
+    // reload the window.
+    void Upsert(const UIEntry& entry);
+    bool Update(int64_t id, const std::function<void(UIEntry&)>& update, bool moveToTop);
+    size_t Remove(const std::function<bool(const UIEntry&)>& predicate);
+
+    int FindLoaded(int64_t id) const;  // Index, or -1 if not loaded
+
+private:
+    enum class PageKind {
+        Above,    // Extends the window upward
+        Below,    // Extends it downward
+        Replace   // Becomes the window
+    };
+
+    struct Pending {
+        ListPageRequest request;
+        PageKind kind;
+    };
+
+    size_t End() const { return m_start + m_rows.size(); }
+    bool AllLoaded() const { return m_complete && m_start == 0 && End() == m_count; }
+    int64_t SelectedId() const;
+    void FollowSelection(int64_t selectedId, size_t fallback);
+    void MoveLoadedToTop(size_t index);
+    void Reload();
+    void Merge(PageKind kind, size_t offset, std::vector<UIEntry>& rows);
+    void DropPastEnd();
+    void Evict();
+    void Clamp();
+    void RequestMissing();
+    void Fetch(size_t offset, size_t limit, PageKind kind);
+    bool IsPending(PageKind kind) const;
+
+    Options m_options;
+    FetchCallback m_fetch;
+
+    std::deque<UIEntry> m_rows;  // Rows m_start .. End() - 1
+    size_t m_start = 0;
+    size_t m_count = 0;
+    bool m_complete = true;
+
+    uint64_t m_generation = 0;
+    int64_t m_version = 0;
+    bool m_awaitingVersion = false;  // A page was ahead of m_version
+    bool m_reloading = false;        // Loaded rows may be misplaced until the next replace page
+    std::vector<Pending> m_pending;  // At most one above and one below the window, or one replace
+
+    size_t m_first = 0;
+    size_t m_visible = 1;
+    bool m_scrollingUp = false;
+    size_t m_selected = 0;
+};
+
+} // namespace clipx
@@ -5,29 +5,30 @@
 #include <functional>
 #include "common/windows.h"
 #include "common/types.h"
+#include "display_list.h"
+#include "list_model.h"
+#include "render_cache.h"
+#include "renderer.h"
 
 namespace clipx {
 
-struct UIEntry {
-    int64_t id;
-    std::string preview;
-    std::string sourceApp;
-    std::string timestampStr;
-    ClipboardDataType type;
-    bool isFavorited;
-    int copyCount;
-    std::vector<std::string> tags;
-};
-
 class OverlayWindow {
 public:
     using OnEntrySelectedCallback = std::function<void(int64_t id)>;
     using OnCloseCallback = std::function<void()>;
-    using OnSearchCallback = std::function<void(const std::string&)>;
+    using OnSearchCallback = std::function<void(const std::string& query, bool typed)>;  // typed: from the keyboard
     using OnAddTagCallback = std::function<void(int64_t entryId, const std::string& tag)>;
     using OnDeleteCallback = std::function<void(int64_t entryId)>;
     using OnGetTagsCallback = std::function<std::vector<std::string>(int64_t entryId)>;
     using OnGetAllTagsCallback = std::function<std::vector<std::pair<std::string, int>>()>;
+    using OnIpcWakeCallback = std::function<void()>;
+    using OnTimerCallback = std::function<void(UINT_PTR id)>;
+    using OnFetchRowsCallback = VirtualListModel::FetchCallback;
+
+    // Posted from the IPC reader thread when messages are waiting. Handled
+    // by the window procedure, so it is also processed inside menus and
+    // dialogs.
+    static constexpr UINT WM_IPC_WAKE = WM_APP + 1;
 
     OverlayWindow();
     ~OverlayWindow();
@@ -36,7 +37,23 @@ public:
     void Show();
     void Hide();
 
-    void SetEntries(const std::vector<UIEntry>& entries);
+    // The list is virtual: `complete` false means rows past these are
+    // requested through the fetch callback as the user scrolls, and handed
+    // back with RowsLoaded. `version` is the change seq the rows reflect.
+    void SetEntries(const std::vector<UIEntry>& entries, bool complete = true, int64_t version = 0);
+    void AppendEntries(const std::vector<UIEntry>& entries);  // Keeps selection and scroll position
+    void RowsLoaded(const ListPageRequest& request, std::vector<UIEntry> rows, int64_t version);
+    void RowsFailed(const ListPageRequest& request);
+    void SetListVersion(int64_t version);  // After applying changes up to this seq
+    void SetListTotal(size_t total);       // Length of the whole list, loaded or not
+    std::vector<UIEntry> LoadedEntries() const;  // Rows materialized now
+
+    // Incremental edits; the selection stays on the same entry
+    void UpsertEntry(const UIEntry& entry);  // Inserted at the top, or replaced and moved there
+    bool UpdateEntry(int64_t id, const std::function<void(UIEntry&)>& update, bool moveToTop);
+    void RemoveEntries(const std::function<bool(const UIEntry&)>& predicate);
+    void RefreshTagPanel();
+
     void SetOnEntrySelected(OnEntrySelectedCallback callback);
     void SetOnClose(OnCloseCallback callback);
     void SetOnSearch(OnSearchCallback callback);
@@ -44,6 +61,13 @@ public:
     void SetOnDelete(OnDeleteCallback callback);
     void SetOnGetTags(OnGetTagsCallback callback);
     void SetOnGetAllTags(OnGetAllTagsCallback callback);
+    void SetOnIpcWake(OnIpcWakeCallback callback);
+    void SetOnFetchRows(OnFetchRowsCallback callback);
+    void SetOnTimer(OnTimerCallback callback);
+
+    // One-shot timers on the UI thread; starting a running one restarts it
+    void StartTimer(UINT_PTR id, int delayMs);
+    void StopTimer(UINT_PTR id);
 
     HWND GetHwnd() const { return m_hwnd; }
 
@@ -52,6 +76,8 @@ private:
     LRESULT WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
     void OnPaint();
+    void BuildDisplayList(DisplayList& list, int width, int height);
+    void Redraw();
     void OnKeyDown(WPARAM vk);
     void OnChar(WPARAM ch);
     void OnMouseMove(int x, int y);
@@ -64,11 +90,11 @@ private:
     int GetItemAtPosition(int x, int y);
     int GetTagAtPosition(int x, int y);  // Returns -2 for "All", -1 for none, 0+ for tag index
     void SelectItem(int index);
-    void EnsureVisible(int index);
     void Scroll(int delta);
     void ShowContextMenu(int x, int y, int itemIndex);
     std::wstring ShowSimpleInputDialog(const std::wstring& title, const std::wstring& prompt);
     int GetTextWidth(const std::string& text);
+    void CreateFonts(int dpi);  // Also resets text measured with the old ones
 
     HINSTANCE m_hInstance = nullptr;
     HWND m_hwnd = nullptr;
@@ -84,16 +110,14 @@ private:
     int m_borderRadius = 8;
     int m_tagPanelHeight = 36;
 
-    // State
-    std::vector<UIEntry> m_entries;
+    // State. The list model owns the rows, the scroll position and the
+    // selection.
+    VirtualListModel m_list;
     std::string m_searchText;
-    int m_selectedIndex = 0;
-    int m_scrollOffset = 0;
     int m_hoverIndex = -1;
     int m_visibleItemCount = 0;
     bool m_searchFocused = true;
     bool m_showingDialog = false;  // Prevents auto-hide when showing child dialogs
-    bool m_isSearching = false;    // Prevents auto-hide during search operations
     bool m_caretVisible = false;   // Caret visibility state for search box
 
     // Tag panel state
@@ -110,14 +134,22 @@ private:
     OnDeleteCallback m_onDelete;
     OnGetTagsCallback m_onGetTags;
     OnGetAllTagsCallback m_onGetAllTags;
+    OnIpcWakeCallback m_onIpcWake;
+    OnTimerCallback m_onTimer;
 
     // GDI objects
     HDC m_memDC = nullptr;
     HBITMAP m_memBitmap = nullptr;
     HBITMAP m_oldBitmap = nullptr;
+    int m_memWidth = 0;
+    int m_memHeight = 0;
+    bool m_painted = false;  // Marks the first paint in traces
+    DisplayList m_displayList;  // Last frame built; the back buffer shows it once painted
     HFONT m_font = nullptr;
     HFONT m_fontBold = nullptr;
     HFONT m_fontSmall = nullptr;
+    renderer::GdiTextMeasurer m_measurer;
+    RenderCache m_renderCache{m_measurer};
 
     // Colors - Glass theme (dark semi-transparent)
     COLORREF m_bgColor = RGB(32, 32, 32);              // Dark background
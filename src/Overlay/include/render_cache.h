@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "list_model.h"
+
+namespace clipx {
+
+enum class TextStyle {
+    Normal,
+    Bold,
+    Small
+};
+
+// Text extents in the overlay's fonts. GDI in the window; anything that
+// returns stable widths elsewhere.
+class TextMeasurer {
+public:
+    virtual ~TextMeasurer() = default;
+    virtual int Measure(TextStyle style, const std::wstring& text) = 0;
+};
+
+struct TagPill {
+    std::wstring text;
+    int width = 0;  // Including padding; 0 for no pill
+};
+
+// What painting a row needs: its strings in UTF-16 and its tag pills
+// measured
+struct EntryLayout {
+    std::wstring preview;
+    std::wstring secondary;     // Source app and time
+    std::vector<TagPill> tags;  // Right to left, as drawn; at most ROW_TAGS
+    TagPill more;               // "+N" for tags left out
+};
+
+struct TagPanelLayout {
+    TagPill all;
+    std::vector<TagPill> tags;  // In tag list order
+    TagPill more;               // "..." when they don't all fit
+};
+
+// Converts and measures each entry the first time it is drawn and keeps the
+// result by id, so repaints and hit tests do no conversion or measuring.
+// An entry is laid out again when a field it shows changes. Time labels are
+// relative, so they stay as first drawn until Invalidate.
+//
+// Returned references are valid until the next call.
+class RenderCache {
+public:
+    static constexpr size_t ROW_TAGS = 3;
+    static constexpr int ROW_TAG_PADDING = 6;
+    static constexpr int PANEL_TAG_PADDING = 8;
+    static constexpr size_t MAX_ENTRIES = 512;  // Above the list model's window
+
+    explicit RenderCache(TextMeasurer& measurer);
+
+    const EntryLayout& Entry(const UIEntry& entry);
+    const TagPanelLayout& TagPanel(const std::vector<std::pair<std::string, int>>& tags);
+
+    // Drops everything. For font or DPI changes, and to refresh time labels.
+    void Invalidate();
+
+    size_t Size() const { return m_entries.size(); }
+
+private:
+    struct Cached {
+        uint64_t fingerprint = 0;
+        EntryLayout layout;
+    };
+
+    TagPill Pill(TextStyle style, std::wstring text, int padding);
+    void Layout(const UIEntry& entry, EntryLayout& layout);
+
+    TextMeasurer& m_measurer;
+    std::unordered_map<int64_t, Cached> m_entries;
+
+    bool m_panelValid = false;
+    std::vector<std::pair<std::string, int>> m_panelTags;
+    TagPanelLayout m_panel;
+};
+
+} // namespace clipx
@@ -1,7 +1,11 @@
 #pragma once
 
 #include <windows.h>
+#include <cstdint>
 #include <string>
+#include <vector>
+#include "display_list.h"
+#include "render_cache.h"
 
 namespace clipx {
 namespace renderer {
@@ -16,9 +20,35 @@ void DrawRoundedRect(HDC hdc, const RECT* rect, int radius, COLORREF fillColor,
 void DrawText(HDC hdc, const std::wstring& text, const RECT* rect, UINT format, COLORREF color);
 void DrawIcon(HDC hdc, int x, int y, int size, const std::string& iconType, COLORREF color);
 void DrawLine(HDC hdc, int x1, int y1, int x2, int y2, COLORREF color, int width = 1);
+// A packed 32 bpp DIB scaled into `rect` keeping its aspect ratio, centered
+void DrawThumbnail(HDC hdc, const RECT* rect, const std::vector<uint8_t>& dib);
 
 // Helper to get type icon
 std::string GetTypeIcon(int type);
 
+// Draws the ops of `list` that reach `clip`, in order; the caller sets the
+// clip region itself. `fonts` is indexed by TextStyle. Returns the number
+// of ops drawn.
+size_t Replay(HDC hdc, const DisplayList& list, const RECT& clip, const HFONT (&fonts)[3]);
+
+// Measures on a memory DC of its own, so it works outside WM_PAINT. The
+// fonts stay owned by the caller.
+class GdiTextMeasurer : public TextMeasurer {
+public:
+    GdiTextMeasurer();
+    ~GdiTextMeasurer() override;
+
+    GdiTextMeasurer(const GdiTextMeasurer&) = delete;
+    GdiTextMeasurer& operator=(const GdiTextMeasurer&) = delete;
+
+    void SetFonts(HFONT normal, HFONT bold, HFONT smallFont);
+    int Measure(TextStyle style, const std::wstring& text) override;
+
+private:
+    HDC m_dc = nullptr;
+    HGDIOBJ m_oldFont = nullptr;
+    HFONT m_fonts[3] = {};
+};
+
 } // namespace renderer
 } // namespace clipx
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace clipx {
+
+// Turns search box edits into searches. Typed text waits DEBOUNCE_MS after
+// the last keystroke; at most one search runs at a time, and queries that
+// pile up behind it collapse into the newest. Every query gets a new
+// generation, so a result can tell whether it is still wanted.
+//
+// Single-threaded and driven by its clock: the owner calls Poll once
+// NextDeadline has passed (a window timer in the overlay). The start
+// callback hands the query to something asynchronous, an IPC request,
+// whose completion is reported back with Finished.
+class SearchExecutor {
+public:
+    static constexpr int64_t DEBOUNCE_MS = 300;
+
+    struct Query {
+        std::string text;
+        uint64_t generation = 0;
+    };
+
+    using Clock = std::function<int64_t()>;  // Milliseconds, monotonic
+    using StartCallback = std::function<void(const Query& query)>;
+
+    static int64_t SteadyClockMs();
+
+    explicit SearchExecutor(StartCallback start, Clock clock = SteadyClockMs, int64_t debounceMs = DEBOUNCE_MS);
+
+    // Replaces any query not started yet; results of earlier ones go stale
+    void Submit(std::string text);     // Typed: starts after the debounce
+    void SubmitNow(std::string text);  // Clicked: starts as soon as nothing runs
+    void Cancel();                     // Nothing pending, and no result wanted
+
+    // Starts the pending query if it is due and no other one runs
+    void Poll();
+
+    // The search started for `generation` is done, or failed. Starts a
+    // query queued behind it if that one is due.
+    void Finished(uint64_t generation);
+
+    // Clock time Poll should next run at, or -1 if there is nothing to wait
+    // for (nothing pending, or waiting for Finished)
+    int64_t NextDeadline() const;
+
+    bool IsCurrent(uint64_t generation) const { return generation == m_generation; }
+    bool IsRunning() const { return m_running != 0; }
+    bool HasPending() const { return m_pending; }
+
+private:
+    void Queue(std::string text, int64_t due);
+
+    StartCallback m_start;
+    Clock m_clock;
+    int64_t m_debounceMs;
+
+    uint64_t m_generation = 0;  // Of the newest query
+    bool m_pending = false;     // Newest query not started yet
+    std::string m_pendingText;
+    int64_t m_due = 0;
+    uint64_t m_running = 0;     // Generation of the started one, 0 if none
+};
+
+} // namespace clipx
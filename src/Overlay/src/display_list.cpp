@@ -0,0 +1,194 @@
+#include "display_list.h"
+#include <algorithm>
+#include <unordered_map>
+
+namespace clipx {
+
+bool DrawRect::Intersects(const DrawRect& other) const {
+    return left < other.right && other.left < right && top < other.bottom && other.top < bottom;
+}
+
+DrawRect DrawRect::Union(const DrawRect& other) const {
+    if (Empty()) return other;
+    if (other.Empty()) return *this;
+    return {std::min(left, other.left), std::min(top, other.top), std::max(right, other.right),
+            std::max(bottom, other.bottom)};
+}
+
+bool DrawRect::operator==(const DrawRect& other) const {
+    return left == other.left && top == other.top && right == other.right && bottom == other.bottom;
+}
+
+DrawRect DrawOp::Bounds() const {
+    switch (kind) {
+        case Kind::RoundRect:
+            // Region-based; it reaches one pixel past right and bottom
+            return {rect.left, rect.top, rect.right + 1, rect.bottom + 1};
+        case Kind::Line: {
+            int pad = std::max(width, 1);
+            return {std::min(rect.left, rect.right) - pad, std::min(rect.top, rect.bottom) - pad,
+                    std::max(rect.left, rect.right) + pad, std::max(rect.top, rect.bottom) + pad};
+        }
+        default:
+            return rect;
+    }
+}
+
+bool DrawOp::operator==(const DrawOp& other) const {
+    return kind == other.kind && rect == other.rect && color == other.color && border == other.border &&
+           radius == other.radius && width == other.width && format == other.format && style == other.style &&
+           text == other.text && icon == other.icon && image == other.image;
+}
+
+void DisplayList::Clear() {
+    m_ops.clear();
+    m_chunks.clear();
+}
+
+void DisplayList::BeginChunk(uint64_t key) {
+    Chunk chunk;
+    chunk.key = key;
+    chunk.begin = chunk.end = m_ops.size();
+    m_chunks.push_back(chunk);
+}
+
+void DisplayList::Fill(const DrawRect& rect, DrawColor color) {
+    DrawOp op;
+    op.kind = DrawOp::Kind::Fill;
+    op.rect = rect;
+    op.color = color;
+    Add(std::move(op));
+}
+
+void DisplayList::RoundRect(const DrawRect& rect, int radius, DrawColor fill, DrawColor border, int borderWidth) {
+    DrawOp op;
+    op.kind = DrawOp::Kind::RoundRect;
+    op.rect = rect;
+    op.radius = radius;
+    op.color = fill;
+    op.border = border;
+    op.width = borderWidth;
+    Add(std::move(op));
+}
+
+void DisplayList::Text(std::wstring text, const DrawRect& rect, uint32_t format, DrawColor color, TextStyle style) {
+    DrawOp op;
+    op.kind = DrawOp::Kind::Text;
+    op.rect = rect;
+    op.format = format;
+    op.color = color;
+    op.style = style;
+    op.text = std::move(text);
+    Add(std::move(op));
+}
+
+void DisplayList::Icon(int x, int y, int size, std::string icon, DrawColor color) {
+    DrawOp op;
+    op.kind = DrawOp::Kind::Icon;
+    op.rect = {x, y, x + size, y + size};
+    op.color = color;
+    op.icon = std::move(icon);
+    Add(std::move(op));
+}
+
+void DisplayList::Image(const DrawRect& rect, std::shared_ptr<const std::vector<uint8_t>> dib) {
+    DrawOp op;
+    op.kind = DrawOp::Kind::Image;
+    op.rect = rect;
+    op.image = std::move(dib);
+    Add(std::move(op));
+}
+
+void DisplayList::Line(int x1, int y1, int x2, int y2, DrawColor color, int width) {
+    DrawOp op;
+    op.kind = DrawOp::Kind::Line;
+    op.rect = {x1, y1, x2, y2};
+    op.color = color;
+    op.width = width;
+    Add(std::move(op));
+}
+
+void DisplayList::Add(DrawOp op) {
+    if (m_chunks.empty()) {
+        BeginChunk(0);
+    }
+    Chunk& chunk = m_chunks.back();
+    chunk.bounds = chunk.bounds.Union(op.Bounds());
+    m_ops.push_back(std::move(op));
+    chunk.end = m_ops.size();
+}
+
+namespace {
+
+bool SameOps(const DisplayList& a, const DisplayList::Chunk& ca, const DisplayList& b, const DisplayList::Chunk& cb) {
+    if (ca.end - ca.begin != cb.end - cb.begin) {
+        return false;
+    }
+    return std::equal(a.Ops().begin() + static_cast<ptrdiff_t>(ca.begin), a.Ops().begin() + static_cast<ptrdiff_t>(ca.end),
+                      b.Ops().begin() + static_cast<ptrdiff_t>(cb.begin));
+}
+
+bool Touches(const DrawRect& a, const DrawRect& b) {
+    return a.left <= b.right && b.left <= a.right && a.top <= b.bottom && b.top <= a.bottom;
+}
+
+} // namespace
+
+std::vector<DrawRect> ComputeDamage(const DisplayList& before, const DisplayList& after, size_t maxRects) {
+    std::unordered_map<uint64_t, size_t> previous;
+    previous.reserve(before.Chunks().size());
+    for (size_t i = 0; i < before.Chunks().size(); i++) {
+        previous[before.Chunks()[i].key] = i;
+    }
+
+    std::vector<DrawRect> damage;
+    std::vector<bool> matched(before.Chunks().size(), false);
+    for (const auto& chunk : after.Chunks()) {
+        auto it = previous.find(chunk.key);
+        if (it == previous.end()) {
+            damage.push_back(chunk.bounds);
+            continue;
+        }
+        const auto& old = before.Chunks()[it->second];
+        matched[it->second] = true;
+        if (!SameOps(before, old, after, chunk)) {
+            damage.push_back(old.bounds);
+            damage.push_back(chunk.bounds);
+        }
+    }
+    for (size_t i = 0; i < before.Chunks().size(); i++) {
+        if (!matched[i]) {
+            damage.push_back(before.Chunks()[i].bounds);
+        }
+    }
+
+    damage.erase(std::remove_if(damage.begin(), damage.end(), [](const DrawRect& r) { return r.Empty(); }),
+                 damage.end());
+
+    // Merge until nothing touches; a handful of rects, so quadratic is fine
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (size_t i = 0; i < damage.size() && !merged; i++) {
+            for (size_t j = i + 1; j < damage.size(); j++) {
+                if (Touches(damage[i], damage[j])) {
+                    damage[i] = damage[i].Union(damage[j]);
+                    damage.erase(damage.begin() + static_cast<ptrdiff_t>(j));
+                    merged = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (damage.size() > maxRects) {
+        DrawRect box;
+        for (const auto& rect : damage) {
+            box = box.Union(rect);
+        }
+        damage.assign(1, box);
+    }
+    return damage;
+}
+
+} // namespace clipx
@@ -0,0 +1,172 @@
+#include "instant_search.h"
+#include "common/utils.h"
+#include <algorithm>
+#include <cctype>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace clipx {
+
+namespace {
+
+// utils::ToLower(haystack).find(needleLower) without the copy
+bool ContainsLower(const std::string& haystack, const std::string& needleLower) {
+    auto it = std::search(haystack.begin(), haystack.end(), needleLower.begin(), needleLower.end(),
+                          [](char h, char n) {
+                              return static_cast<char>(std::tolower(static_cast<unsigned char>(h))) == n;
+                          });
+    return it != haystack.end() || needleLower.empty();
+}
+
+bool EqualsLower(const std::string& value, const std::string& lower) {
+    return value.size() == lower.size() && ContainsLower(value, lower);
+}
+
+std::vector<std::string> Lowered(const std::vector<std::string>& values) {
+    std::vector<std::string> lowered;
+    lowered.reserve(values.size());
+    for (const auto& value : values) {
+        lowered.push_back(utils::ToLower(value));
+    }
+    return lowered;
+}
+
+// The order of both the history and the server search
+bool Newer(const UIEntry& a, const UIEntry& b) {
+    if (a.timestamp != b.timestamp) return a.timestamp > b.timestamp;
+    return a.id > b.id;
+}
+
+} // namespace
+
+LocalMatcher::LocalMatcher(const std::string& input, int64_t now)
+    : m_query(ParseSearchQuery(input, now)),
+      m_terms(Lowered(m_query.terms)),
+      m_tags(Lowered(m_query.tags)),
+      m_apps(Lowered(m_query.apps)) {}
+
+bool LocalMatcher::Matches(const UIEntry& entry) const {
+    if (!m_query.regex.empty()) return false;
+    if (m_query.type.has_value() && entry.type != *m_query.type) return false;
+    if (m_query.favoritesOnly && !entry.isFavorited) return false;
+    if (m_query.before.has_value() && entry.timestamp >= *m_query.before) return false;
+    if (m_query.after.has_value() && entry.timestamp < *m_query.after) return false;
+
+    for (const auto& tag : m_tags) {
+        bool found = false;
+        for (size_t i = 0; !found && i < entry.tags.size(); i++) {
+            found = EqualsLower(entry.tags[i], tag);
+        }
+        if (!found) return false;
+    }
+
+    for (const auto& app : m_apps) {
+        if (!ContainsLower(entry.sourceApp, app)) return false;
+    }
+
+    for (const auto& term : m_terms) {
+        bool found = ContainsLower(entry.preview, term);
+        for (size_t i = 0; !found && i < entry.tags.size(); i++) {
+            found = ContainsLower(entry.tags[i], term);
+        }
+        if (!found) return false;
+    }
+
+    return true;
+}
+
+std::vector<UIEntry> MergeSearchResults(const std::vector<UIEntry>& server, const std::vector<UIEntry>& local,
+                                        bool done) {
+    std::vector<UIEntry> merged = server;
+    if (done) {
+        return merged;
+    }
+
+    std::unordered_set<int64_t> returned;
+    returned.reserve(server.size());
+    for (const auto& entry : server) {
+        returned.insert(entry.id);
+    }
+
+    for (const auto& entry : local) {
+        if (returned.count(entry.id)) continue;
+        // Equal timestamps may still come, the server's order among them is
+        // not ours
+        if (!server.empty() && entry.timestamp > server.back().timestamp) continue;
+        merged.push_back(entry);
+    }
+    return merged;
+}
+
+void InstantSearch::AddKnown(const std::vector<UIEntry>& rows) {
+    std::unordered_map<int64_t, size_t> index;
+    index.reserve(m_known.size());
+    for (size_t i = 0; i < m_known.size(); i++) {
+        index[m_known[i].id] = i;
+    }
+
+    bool added = false;
+    for (const auto& row : rows) {
+        auto it = index.find(row.id);
+        if (it != index.end()) {
+            m_known[it->second] = row;
+        } else {
+            index[row.id] = m_known.size();
+            m_known.push_back(row);
+            added = true;
+        }
+    }
+    if (!added) {
+        return;
+    }
+
+    std::stable_sort(m_known.begin(), m_known.end(), Newer);
+    if (m_known.size() > MAX_KNOWN) {
+        m_known.resize(MAX_KNOWN);
+    }
+}
+
+void InstantSearch::ClearKnown() {
+    m_known.clear();
+    m_known.shrink_to_fit();
+}
+
+const std::vector<UIEntry>& InstantSearch::Begin(const std::string& input, int64_t now) {
+    LocalMatcher matcher(input, now);
+    m_local.clear();
+    for (const auto& entry : m_known) {
+        if (m_local.size() >= MAX_MATCHES) break;
+        if (matcher.Matches(entry)) {
+            m_local.push_back(entry);
+        }
+    }
+
+    m_server.clear();
+    m_shown = m_local;
+    return m_shown;
+}
+
+const std::vector<UIEntry>& InstantSearch::AddResults(const std::vector<UIEntry>& rows, bool done) {
+    m_server.insert(m_server.end(), rows.begin(), rows.end());
+    m_shown = MergeSearchResults(m_server, m_local, done);
+    return m_shown;
+}
+
+void InstantSearch::Update(int64_t id, const std::function<void(UIEntry&)>& update) {
+    for (auto* rows : {&m_known, &m_local, &m_server, &m_shown}) {
+        for (auto& entry : *rows) {
+            if (entry.id == id) {
+                update(entry);
+                break;
+            }
+        }
+    }
+}
+
+void InstantSearch::Remove(const std::function<bool(const UIEntry&)>& predicate) {
+    for (auto* rows : {&m_known, &m_local, &m_server, &m_shown}) {
+        rows->erase(std::remove_if(rows->begin(), rows->end(), predicate), rows->end());
+    }
+}
+
+} // namespace clipx
@@ -0,0 +1,385 @@
+#include "list_model.h"
+#include <algorithm>
+#include <iterator>
+
+namespace clipx {
+
+VirtualListModel::VirtualListModel() : VirtualListModel(Options{}) {}
+
+VirtualListModel::VirtualListModel(Options options) : m_options(options) {
+    m_options.pageSize = std::max<size_t>(m_options.pageSize, 1);
+    m_options.maxRows = std::max(m_options.maxRows, m_options.pageSize * 2);
+}
+
+void VirtualListModel::SetFetchCallback(FetchCallback fetch) {
+    m_fetch = std::move(fetch);
+}
+
+void VirtualListModel::Reset(std::vector<UIEntry> rows, bool complete, int64_t version) {
+    int64_t selectedId = SelectedId();
+
+    m_generation++;
+    m_pending.clear();
+    m_awaitingVersion = false;
+    m_reloading = false;
+    m_rows.assign(std::make_move_iterator(rows.begin()), std::make_move_iterator(rows.end()));
+    m_start = 0;
+    m_count = m_rows.size();
+    m_complete = complete;
+    m_version = version;
+
+    FollowSelection(selectedId, m_selected);
+    RequestMissing();
+}
+
+void VirtualListModel::Append(const std::vector<UIEntry>& rows) {
+    if (End() == m_count) {
+        m_rows.insert(m_rows.end(), rows.begin(), rows.end());
+    }
+    m_count += rows.size();
+    Evict();
+}
+
+void VirtualListModel::SetTotal(size_t total) {
+    m_complete = true;
+    m_count = total;
+    DropPastEnd();
+    Clamp();
+    RequestMissing();
+}
+
+bool VirtualListModel::PageLoaded(const ListPageRequest& request, std::vector<UIEntry> rows, int64_t version) {
+    auto it = std::find_if(m_pending.begin(), m_pending.end(), [&request](const Pending& pending) {
+        return pending.request.generation == request.generation && pending.request.offset == request.offset &&
+               pending.request.limit == request.limit;
+    });
+    if (request.generation != m_generation || it == m_pending.end()) {
+        return false;
+    }
+    PageKind kind = it->kind;
+    m_pending.erase(it);
+
+    // Read before edits the model has (ask again now) or after edits it is
+    // about to get (ask again once SetVersion catches up)
+    if (m_version != 0 && version != 0 && version != m_version) {
+        if (version > m_version) {
+            m_awaitingVersion = true;
+        } else {
+            RequestMissing();
+        }
+        return false;
+    }
+
+    // A short page ends the list
+    if (rows.size() < request.limit) {
+        m_complete = true;
+        m_count = request.offset + rows.size();
+    } else {
+        m_count = std::max(m_count, request.offset + rows.size());
+    }
+
+    Merge(kind, request.offset, rows);
+    Clamp();
+    Evict();
+    RequestMissing();
+    return true;
+}
+
+void VirtualListModel::PageFailed(const ListPageRequest& request) {
+    // Not asked again right away: the next viewport change does
+    m_pending.erase(std::remove_if(m_pending.begin(), m_pending.end(), [&request](const Pending& pending) {
+        return pending.request.generation == request.generation && pending.request.offset == request.offset &&
+               pending.request.limit == request.limit;
+    }), m_pending.end());
+}
+
+void VirtualListModel::SetVersion(int64_t version) {
+    m_version = version;
+    if (m_awaitingVersion) {
+        m_awaitingVersion = false;
+        RequestMissing();
+    }
+}
+
+const UIEntry* VirtualListModel::Row(size_t index) const {
+    if (index < m_start || index >= End()) {
+        return nullptr;
+    }
+    return &m_rows[index - m_start];
+}
+
+void VirtualListModel::SetViewport(size_t first, size_t visible) {
+    if (first != m_first) {
+        m_scrollingUp = first < m_first;
+    }
+    m_first = first;
+    m_visible = std::max<size_t>(visible, 1);
+    Clamp();
+    RequestMissing();
+}
+
+void VirtualListModel::ScrollBy(int delta) {
+    size_t first = m_first;
+    if (delta < 0) {
+        size_t up = static_cast<size_t>(-static_cast<int64_t>(delta));
+        first = first > up ? first - up : 0;
+    } else {
+        first += static_cast<size_t>(delta);
+    }
+    SetViewport(first, m_visible);
+}
+
+void VirtualListModel::EnsureVisible(size_t index) {
+    if (index < m_first) {
+        SetViewport(index, m_visible);
+    } else if (index >= m_first + m_visible) {
+        SetViewport(index - m_visible + 1, m_visible);
+    }
+}
+
+void VirtualListModel::Select(size_t index) {
+    if (m_count == 0) {
+        m_selected = 0;
+        return;
+    }
+    m_selected = std::min(index, m_count - 1);
+    EnsureVisible(m_selected);
+}
+
+void VirtualListModel::Upsert(const UIEntry& entry) {
+    int64_t selectedId = SelectedId();
+    size_t fallback = m_selected;
+
+    int index = FindLoaded(entry.id);
+    if (index >= 0) {
+        m_rows[index - m_start] = entry;
+        MoveLoadedToTop(index);
+    } else {
+        // New rows push everything down, loaded or not. A viewport scrolled
+        // away from the top moves along, so what it shows stays put.
+        m_count++;
+        if (m_start == 0) {
+            m_rows.push_front(entry);
+        } else {
+            m_start++;
+        }
+        if (m_first > 0) {
+            m_first++;
+        }
+        fallback++;
+    }
+
+    FollowSelection(selectedId, fallback);
+    Evict();
+    RequestMissing();
+}
+
+bool VirtualListModel::Update(int64_t id, const std::function<void(UIEntry&)>& update, bool moveToTop) {
+    int index = FindLoaded(id);
+    if (index < 0) {
+        // Moved up from outside the window: the rows in between shifted by
+        // an amount only a reload tells
+        if (moveToTop && !AllLoaded()) {
+            Reload();
+        }
+        return false;
+    }
+
+    int64_t selectedId = SelectedId();
+    update(m_rows[index - m_start]);
+    if (selectedId == id) {
+        selectedId = m_rows[index - m_start].id;  // May have been renumbered
+    }
+    if (moveToTop && index > 0) {
+        MoveLoadedToTop(index);
+    }
+    FollowSelection(selectedId, m_selected);
+    RequestMissing();
+    return true;
+}
+
+size_t VirtualListModel::Remove(const std::function<bool(const UIEntry&)>& predicate) {
+    int64_t selectedId = SelectedId();
+    bool allLoaded = AllLoaded();
+
+    auto end = std::remove_if(m_rows.begin(), m_rows.end(), predicate);
+    size_t removed = static_cast<size_t>(std::distance(end, m_rows.end()));
+    m_rows.erase(end, m_rows.end());
+    m_count -= std::min(removed, m_count);
+
+    // Unloaded rows may match as well
+    if (!allLoaded) {
+        Reload();
+    }
+
+    // A removed selection moves to the entry that took its place
+    FollowSelection(selectedId, m_selected);
+    RequestMissing();
+    return removed;
+}
+
+int VirtualListModel::FindLoaded(int64_t id) const {
+    for (size_t i = 0; i < m_rows.size(); i++) {
+        if (m_rows[i].id == id) {
+            return static_cast<int>(m_start + i);
+        }
+    }
+    return -1;
+}
+
+int64_t VirtualListModel::SelectedId() const {
+    const UIEntry* row = SelectedRow();
+    return row ? row->id : 0;
+}
+
+void VirtualListModel::FollowSelection(int64_t selectedId, size_t fallback) {
+    int index = selectedId != 0 ? FindLoaded(selectedId) : -1;
+    if (index >= 0 && static_cast<size_t>(index) != m_selected) {
+        m_selected = static_cast<size_t>(index);
+        Clamp();
+        EnsureVisible(m_selected);
+        return;
+    }
+    if (index < 0) {
+        m_selected = fallback;
+    }
+    Clamp();
+}
+
+void VirtualListModel::MoveLoadedToTop(size_t index) {
+    UIEntry entry = std::move(m_rows[index - m_start]);
+    m_rows.erase(m_rows.begin() + static_cast<ptrdiff_t>(index - m_start));
+    if (m_start == 0) {
+        m_rows.push_front(std::move(entry));
+    } else {
+        // It left the window upward, so the rows it passed move down one
+        m_start++;
+    }
+}
+
+// Loaded rows stay visible until the replacement arrives
+void VirtualListModel::Reload() {
+    if (!m_fetch) {
+        return;
+    }
+    m_generation++;
+    m_pending.clear();
+    m_awaitingVersion = false;
+    m_reloading = true;
+    RequestMissing();
+}
+
+void VirtualListModel::Merge(PageKind kind, size_t offset, std::vector<UIEntry>& rows) {
+    auto first = std::make_move_iterator(rows.begin());
+    auto last = std::make_move_iterator(rows.end());
+
+    if (kind == PageKind::Replace || m_rows.empty()) {
+        m_rows.assign(first, last);
+        m_start = offset;
+        m_reloading = false;
+    } else if (kind == PageKind::Above) {
+        // Only the part up to the window is new; a page that doesn't reach
+        // it (evicted meanwhile, or the list shrank) is dropped
+        if (offset < m_start && offset + rows.size() >= m_start) {
+            m_rows.insert(m_rows.begin(), first, first + static_cast<ptrdiff_t>(m_start - offset));
+            m_start = offset;
+        }
+    } else if (offset <= End() && offset + rows.size() > End()) {
+        m_rows.insert(m_rows.end(), first + static_cast<ptrdiff_t>(End() - offset), last);
+    }
+
+    DropPastEnd();
+}
+
+// Rows past a known end are gone
+void VirtualListModel::DropPastEnd() {
+    if (m_complete && End() > m_count) {
+        size_t keep = m_count > m_start ? m_count - m_start : 0;
+        m_rows.erase(m_rows.begin() + static_cast<ptrdiff_t>(keep), m_rows.end());
+        m_start = std::min(m_start, m_count);
+    }
+}
+
+// Drop rows from whichever end is farther from the viewport
+void VirtualListModel::Evict() {
+    if (!m_fetch) {
+        return;
+    }
+    size_t center = m_first + m_visible / 2;
+    while (m_rows.size() > m_options.maxRows) {
+        size_t before = center > m_start ? center - m_start : 0;
+        size_t after = End() > center ? End() - center : 0;
+        if (before > after) {
+            m_rows.pop_front();
+            m_start++;
+        } else {
+            m_rows.pop_back();
+        }
+    }
+}
+
+void VirtualListModel::Clamp() {
+    size_t maxFirst = m_count > m_visible ? m_count - m_visible : 0;
+    m_first = std::min(m_first, maxFirst);
+    m_selected = m_count > 0 ? std::min(m_selected, m_count - 1) : 0;
+}
+
+// Requests the rows the viewport needs, plus prefetchPages more in the
+// direction it last moved. The window grows one page at a time on either
+// side; PageLoaded asks again until it covers everything wanted.
+void VirtualListModel::RequestMissing() {
+    if (!m_fetch || m_awaitingVersion || IsPending(PageKind::Replace)) {
+        return;
+    }
+
+    size_t pageSize = m_options.pageSize;
+    size_t ahead = m_options.prefetchPages * pageSize;
+    size_t wantBegin = m_first;
+    size_t wantEnd = m_first + m_visible;
+    if (m_scrollingUp) {
+        wantBegin = wantBegin > ahead ? wantBegin - ahead : 0;
+    } else {
+        wantEnd += ahead;
+    }
+    if (m_complete) {
+        wantEnd = std::min(wantEnd, m_count);
+    }
+    if (wantBegin >= wantEnd) {
+        return;
+    }
+
+    // Nothing usable there (a jump, or a reload): one page becomes the window
+    if (m_reloading || m_rows.empty() || wantEnd <= m_start || wantBegin >= End()) {
+        Fetch(wantBegin, std::max(pageSize, wantEnd - wantBegin), PageKind::Replace);
+        return;
+    }
+
+    if (wantBegin < m_start && !IsPending(PageKind::Above)) {
+        size_t offset = m_start > pageSize ? m_start - pageSize : 0;
+        Fetch(offset, m_start - offset, PageKind::Above);
+    }
+    if (wantEnd > End() && !IsPending(PageKind::Below) && !IsPending(PageKind::Replace)) {
+        Fetch(End(), pageSize, PageKind::Below);
+    }
+}
+
+// The callback may answer synchronously, re-entering PageLoaded
+void VirtualListModel::Fetch(size_t offset, size_t limit, PageKind kind) {
+    ListPageRequest request;
+    request.offset = offset;
+    request.limit = limit;
+    request.generation = m_generation;
+    if (kind == PageKind::Replace) {
+        m_pending.clear();
+    }
+    m_pending.push_back({request, kind});
+    m_fetch(request);
+}
+
+bool VirtualListModel::IsPending(PageKind kind) const {
+    return std::any_of(m_pending.begin(), m_pending.end(), [kind](const Pending& pending) {
+        return pending.kind == kind;
+    });
+}
+
+} // namespace clipx
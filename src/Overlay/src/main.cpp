@@ -2,14 +2,20 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <algorithm>
+#include <optional>
 
 #include "common/types.h"
 #include "common/logger.h"
 #include "common/config.h"
 #include "common/ipc_protocol.h"
 #include "common/utils.h"
-#include "ipc_client.h"
+#include "common/ipc_client.h"
+#include "common/history_snapshot.h"
+#include "common/trace.h"
 #include "overlay_window.h"
+#include "search_executor.h"
+#include "instant_search.h"
 
 namespace clipx {
 
@@ -19,20 +25,29 @@ public:
         m_hInstance = hInstance;
 
         // Initialize logger (minimal logging for overlay)
-        Logger::Instance().Init(utils::GetAppDataDir() + "\\logs\\overlay.log", LogLevel::Debug);
-
-        // Connect to ClipD
-        if (!m_ipcClient.Connect(IPC_PIPE_NAME, 2000)) {
-            LOG_ERROR("Failed to connect to ClipD");
-            return false;
+        {
+            CLIPX_TRACE_SPAN("logger.init");
+            Logger::Instance().Init(utils::GetAppDataDir() + "\\logs\\overlay.log", LogLevel::Debug);
         }
 
         // Create overlay window
-        if (!m_overlayWindow.Initialize(m_hInstance)) {
-            LOG_ERROR("Failed to initialize overlay window");
-            return false;
+        {
+            CLIPX_TRACE_SPAN("window.init");
+            if (!m_overlayWindow.Initialize(m_hInstance)) {
+                LOG_ERROR("Failed to initialize overlay window");
+                return false;
+            }
         }
 
+        // Search batches and change events are dispatched on the UI thread
+        HWND hwnd = m_overlayWindow.GetHwnd();
+        m_ipcClient.SetWakeCallback([hwnd]() {
+            PostMessage(hwnd, OverlayWindow::WM_IPC_WAKE, 0, 0);
+        });
+        m_overlayWindow.SetOnIpcWake([this]() {
+            DispatchNotifications();
+        });
+
         m_overlayWindow.SetOnEntrySelected([this](int64_t id) {
             OnEntrySelected(id);
         });
@@ -41,8 +56,22 @@ public:
             PostQuitMessage(0);
         });
 
-        m_overlayWindow.SetOnSearch([this](const std::string& keyword) {
-            SearchHistory(keyword);
+        // Typed queries are debounced; none of them blocks the UI thread.
+        // Rows already here are filtered right away in the meantime.
+        m_overlayWindow.SetOnSearch([this](const std::string& query, bool typed) {
+            ShowInstantResults(query);
+            if (typed) {
+                m_search.Submit(query);
+            } else {
+                m_search.SubmitNow(query);
+            }
+            ScheduleSearch();
+        });
+        m_overlayWindow.SetOnTimer([this](UINT_PTR id) {
+            if (id == SEARCH_TIMER_ID) {
+                m_search.Poll();
+                ScheduleSearch();
+            }
         });
 
         m_overlayWindow.SetOnAddTag([this](int64_t entryId, const std::string& tag) {
@@ -57,19 +86,62 @@ public:
             return GetTagsForEntry(entryId);
         });
 
+        // Older history is paged in as the list scrolls
+        m_overlayWindow.SetOnFetchRows([this](const ListPageRequest& request) {
+            FetchHistoryRows(request);
+        });
+
         m_overlayWindow.SetOnGetAllTags([this]() -> std::vector<std::pair<std::string, int>> {
+            if (m_snapshotTags) {
+                auto tags = std::move(*m_snapshotTags);
+                m_snapshotTags.reset();
+                return tags;
+            }
             return GetAllTags();
         });
 
-        // Load initial data
-        LoadHistory();
+        // Paint what ClipD last published before the connection is up
+        HistorySnapshot snapshot;
+        bool fromSnapshot = ReadHistorySnapshot(DefaultHistorySnapshotName(), snapshot);
+        if (fromSnapshot) {
+            m_overlayWindow.SetEntries(ToUIEntries(snapshot.entries), snapshot.entries.size() < HISTORY_SNAPSHOT_ROWS,
+                                       snapshot.changeSeq);
+            m_showingHistory = true;
+            m_historySeq = snapshot.changeSeq;
+            m_snapshotTags = std::move(snapshot.tags);
+            m_overlayWindow.Show();
+            UpdateWindow(hwnd);
+            m_shown = true;
+            LOG_DEBUG("Painted " + std::to_string(snapshot.entries.size()) + " entries from the snapshot");
+        }
+
+        // Connect to ClipD
+        if (!m_ipcClient.Connect(DefaultIPCAddress(), 2000)) {
+            LOG_ERROR("Failed to connect to ClipD");
+            return false;
+        }
+
+        // Subscribe before loading so no change can fall in between; events
+        // for entries the first page already has are applied idempotently.
+        // A snapshot is brought up to date from its seq instead of reloaded.
+        Subscribe();
+        if (fromSnapshot) {
+            CatchUpHistory();
+            if (m_historySeq != snapshot.changeSeq) {
+                m_overlayWindow.RefreshTagPanel();
+            }
+        } else {
+            LoadHistory();
+        }
 
         LOG_INFO("Overlay initialized");
         return true;
     }
 
     void Run() {
-        m_overlayWindow.Show();
+        if (!m_shown) {
+            m_overlayWindow.Show();
+        }
 
         MSG msg;
         while (GetMessage(&msg, nullptr, 0, 0)) {
@@ -82,58 +154,134 @@ public:
 
 private:
     void LoadHistory() {
+        CLIPX_TRACE_SPAN("history.load");
         IPCRequest request;
         request.action = IPCAction::GET_HISTORY;
-        request.requestId = 1;
         request.params = {
-            {"limit", 100},
+            {"limit", HISTORY_FIRST_PAGE},
             {"offset", 0}
         };
 
-        IPCResponse response = m_ipcClient.SendRequest(request);
+        ShowHistory(m_ipcClient.SendRequest(request));
+    }
 
+    void ShowHistory(const IPCResponse& response) {
         if (!response.success) {
             LOG_ERROR("Failed to load history: " + response.error);
             return;
         }
 
-        std::vector<UIEntry> entries;
+        std::vector<UIEntry> entries = ToUIEntries(response.GetEntries());
 
-        if (response.data.contains("entries") && response.data["entries"].is_array()) {
-            for (const auto& item : response.data["entries"]) {
-                UIEntry entry;
-                entry.id = item.value("id", static_cast<int64_t>(0));
-                entry.preview = item.value("preview", "");
-                entry.sourceApp = item.value("source_app", "");
-                entry.type = static_cast<ClipboardDataType>(item.value("type", 1));
-                entry.isFavorited = item.value("is_favorited", false);
-                entry.copyCount = item.value("copy_count", 1);
-
-                // Parse tags
-                if (item.contains("tags") && item["tags"].is_array()) {
-                    for (const auto& tag : item["tags"]) {
-                        if (tag.is_string()) {
-                            entry.tags.push_back(tag.get<std::string>());
-                        }
-                    }
-                }
+        m_showingHistory = true;
+        m_historySeq = response.data.value("seq", static_cast<int64_t>(0));
+        m_instant.ClearKnown();
+        m_overlayWindow.SetEntries(entries, entries.size() < HISTORY_FIRST_PAGE, m_historySeq);
+        if (response.data.contains("total")) {
+            m_overlayWindow.SetListTotal(response.data["total"].get<size_t>());
+        }
+        LOG_DEBUG("Loaded " + std::to_string(entries.size()) + " entries");
+    }
+
+    // Rows further down the history list. The list model drops pages read
+    // at another change seq than the one it shows.
+    void FetchHistoryRows(const ListPageRequest& request) {
+        if (!m_showingHistory) {
+            m_overlayWindow.RowsFailed(request);
+            return;
+        }
+
+        IPCRequest page;
+        page.action = IPCAction::GET_HISTORY;
+        page.params = {
+            {"limit", request.limit},
+            {"offset", request.offset}
+        };
+
+        m_ipcClient.SendAsync(page, [this, request](const IPCResponse& response) {
+            if (!response.success) {
+                LOG_WARN("Failed to load history rows: " + response.error);
+                m_overlayWindow.RowsFailed(request);
+                return;
+            }
+            m_overlayWindow.RowsLoaded(request, ToUIEntries(response.GetEntries()),
+                                       response.data.value("seq", static_cast<int64_t>(0)));
+        });
+    }
+
+    // Brings the history list up to date after change events were dropped:
+    // replays the missed changes while ClipD still has them, reloads if not
+    void CatchUpHistory() {
+        CLIPX_TRACE_SPAN("history.catch_up");
+        while (m_historySeq != 0) {
+            IPCRequest request;
+            request.action = IPCAction::GET_CHANGES_SINCE;
+            request.params = {{"seq", m_historySeq}};
 
-                // Format timestamp
-                int64_t timestamp = item.value("timestamp", static_cast<int64_t>(0));
-                entry.timestampStr = utils::FormatTimestamp(timestamp);
+            IPCResponse response = m_ipcClient.SendRequest(request);
 
-                entries.push_back(entry);
+            if (!response.success || response.data.value("resync", true)) {
+                break;
+            }
+
+            const nlohmann::json& changes = response.data["changes"];
+            for (const auto& item : changes) {
+                EntryChange change;
+                if (NotificationToEntryChange(IPCNotification::FromJson(item), change)) {
+                    ApplyChange(change);
+                }
+            }
+            m_historySeq = response.data.value("seq", m_historySeq);
+            m_overlayWindow.SetListVersion(m_historySeq);
+            if (!response.data.value("has_more", false)) {
+                LOG_DEBUG("Caught up with " + std::to_string(changes.size()) + " changes");
+                return;
             }
         }
+        LoadHistory();
+    }
 
-        m_overlayWindow.SetEntries(entries);
-        LOG_DEBUG("Loaded " + std::to_string(entries.size()) + " entries");
+    void Subscribe() {
+        IPCRequest request;
+        request.action = IPCAction::SUBSCRIBE;
+
+        IPCResponse response = m_ipcClient.SendRequest(request);
+
+        if (!response.success) {
+            LOG_WARN("Failed to subscribe to changes: " + response.error);
+        }
+    }
+
+    static UIEntry ToUIEntry(const ClipboardEntry& item) {
+        UIEntry entry;
+        entry.id = item.id;
+        entry.preview = item.preview;
+        entry.sourceApp = item.sourceApp;
+        entry.type = item.type;
+        entry.isFavorited = item.isFavorited;
+        entry.copyCount = item.copyCount;
+        entry.tags = item.tags;
+        entry.timestamp = item.timestamp;
+        if (!item.thumbnail.empty()) {
+            entry.thumbnail = std::make_shared<const std::vector<uint8_t>>(item.thumbnail);
+        }
+        return entry;
+    }
+
+    static std::vector<UIEntry> ToUIEntries(const std::vector<ClipboardEntry>& items) {
+        std::vector<UIEntry> entries;
+        entries.reserve(items.size());
+
+        for (const auto& item : items) {
+            entries.push_back(ToUIEntry(item));
+        }
+
+        return entries;
     }
 
     void OnEntrySelected(int64_t id) {
         IPCRequest request;
         request.action = IPCAction::SET_CLIPBOARD;
-        request.requestId = 2;
         request.params = {{"id", id}};
 
         IPCResponse response = m_ipcClient.SendRequest(request);
@@ -179,66 +327,207 @@ private:
         SendInput(4, inputs, sizeof(INPUT));
     }
 
-    void SearchHistory(const std::string& keyword) {
-        std::vector<UIEntry> entries;
+    // Arms the window timer for the executor's next deadline
+    void ScheduleSearch() {
+        int64_t deadline = m_search.NextDeadline();
+        if (deadline < 0) {
+            m_overlayWindow.StopTimer(SEARCH_TIMER_ID);
+            return;
+        }
+        int64_t delay = std::max<int64_t>(deadline - SearchExecutor::SteadyClockMs(), 0);
+        m_overlayWindow.StartTimer(SEARCH_TIMER_ID, static_cast<int>(delay));
+    }
 
-        if (keyword.empty()) {
-            // If keyword is empty, load all history
-            LoadHistory();
+    // Filters the rows the overlay knows by the query, so the list follows
+    // typing before ClipD answers. Leaving the history keeps its loaded rows
+    // to filter; server results are added as they come.
+    void ShowInstantResults(const std::string& query) {
+        if (query.empty()) {
+            return;  // The history is reloaded instead
+        }
+        if (m_showingHistory) {
+            m_instant.ClearKnown();
+            m_instant.AddKnown(m_overlayWindow.LoadedEntries());
+        }
+        m_overlayWindow.SetEntries(m_instant.Begin(query));
+        m_showingHistory = false;
+        m_historySeq = 0;
+    }
+
+    // Started by m_search. Responses of superseded queries are dropped; the
+    // list keeps the instant results until the newest query has its own.
+    void StartSearch(const SearchExecutor::Query& query) {
+        uint64_t generation = query.generation;
+
+        if (query.text.empty()) {
+            // Back to the history
+            CancelActiveSearch();
+
+            IPCRequest request;
+            request.action = IPCAction::GET_HISTORY;
+            request.params = {
+                {"limit", HISTORY_FIRST_PAGE},
+                {"offset", 0}
+            };
+            m_ipcClient.SendAsync(request, [this, generation](const IPCResponse& response) {
+                m_search.Finished(generation);
+                ScheduleSearch();
+                if (m_search.IsCurrent(generation)) {
+                    ShowHistory(response);
+                }
+            });
             return;
         }
 
-        // Search via IPC
+        // Start a streamed search; the server cancels our previous one.
+        // Batches are matched by job id from here on.
         IPCRequest request;
         request.action = IPCAction::SEARCH;
-        request.requestId = 10;
+        request.requestId = m_ipcClient.NextRequestId();
         request.params = {
-            {"keyword", keyword},
-            {"limit", 100}
+            {"keyword", query.text},
+            {"limit", 100},
+            {"stream", true},
+            {"first_batch", SEARCH_FIRST_BATCH}
         };
 
-        IPCResponse response = m_ipcClient.SendRequest(request);
+        m_activeSearchJob = request.requestId;
+        m_activeSearchGeneration = generation;
+        m_activeSearchKeyword = query.text;
+
+        m_ipcClient.SendAsync(request, [this, generation, jobId = request.requestId](const IPCResponse& response) {
+            m_search.Finished(generation);
+            ScheduleSearch();
+            if (!response.success && jobId == m_activeSearchJob) {
+                // The instant results stay
+                LOG_ERROR("Failed to search: " + response.error);
+                m_activeSearchJob = 0;
+            }
+        });
+    }
 
-        if (!response.success) {
-            LOG_ERROR("Failed to search: " + response.error);
-            m_overlayWindow.SetEntries(entries);
-            return;
+    void DispatchNotifications() {
+        m_ipcClient.PollNotifications([this](const IPCNotification& notification) {
+            if (notification.event == IPCEvent::SEARCH_RESULTS) {
+                OnSearchResults(notification);
+                return;
+            }
+            if (notification.event == IPCEvent::RESYNC) {
+                if (m_showingHistory) {
+                    CatchUpHistory();
+                }
+                return;
+            }
+
+            // Changes already in the list: sent before a reload or catch-up
+            // that included them
+            EntryChange change;
+            if (NotificationToEntryChange(notification, change) &&
+                !(m_showingHistory && change.seq != 0 && change.seq <= m_historySeq)) {
+                ApplyChange(change);
+            }
+        });
+    }
+
+    // Patch the displayed list in place. Search results only take updates
+    // of entries they already show; new entries appear in the history view.
+    void ApplyChange(const EntryChange& change) {
+        if (m_showingHistory && change.seq > m_historySeq) {
+            m_historySeq = change.seq;
         }
 
-        if (response.data.contains("entries") && response.data["entries"].is_array()) {
-            for (const auto& item : response.data["entries"]) {
-                UIEntry entry;
-                entry.id = item.value("id", static_cast<int64_t>(0));
-                entry.preview = item.value("preview", "");
-                entry.sourceApp = item.value("source_app", "");
-                entry.type = static_cast<ClipboardDataType>(item.value("type", 1));
-                entry.isFavorited = item.value("is_favorited", false);
-                entry.copyCount = item.value("copy_count", 1);
-
-                // Parse tags
-                if (item.contains("tags") && item["tags"].is_array()) {
-                    for (const auto& tag : item["tags"]) {
-                        if (tag.is_string()) {
-                            entry.tags.push_back(tag.get<std::string>());
-                        }
-                    }
+        switch (change.kind) {
+            case EntryChange::Kind::Inserted:
+                if (m_showingHistory) {
+                    m_overlayWindow.UpsertEntry(ToUIEntry(change.entry));
                 }
+                break;
+
+            case EntryChange::Kind::Updated: {
+                // A newer timestamp means the entry was copied again
+                auto update = [&change](UIEntry& entry) {
+                    if (change.newId) entry.id = *change.newId;
+                    if (change.preview) entry.preview = *change.preview;
+                    if (change.sourceApp) entry.sourceApp = *change.sourceApp;
+                    if (change.copyCount) entry.copyCount = *change.copyCount;
+                    if (change.isFavorited) entry.isFavorited = *change.isFavorited;
+                    if (change.timestamp) entry.timestamp = *change.timestamp;
+                };
+                m_overlayWindow.UpdateEntry(change.id, update, m_showingHistory && change.timestamp.has_value());
+                m_instant.Update(change.id, update);
+                break;
+            }
 
-                int64_t timestamp = item.value("timestamp", static_cast<int64_t>(0));
-                entry.timestampStr = utils::FormatTimestamp(timestamp);
+            case EntryChange::Kind::Deleted: {
+                auto deleted = [&change](const UIEntry& entry) {
+                    if (change.allPersisted && entry.id > 0) return true;
+                    if (change.olderThan && entry.id > 0 && !entry.isFavorited &&
+                        entry.timestamp < *change.olderThan) return true;
+                    return std::find(change.ids.begin(), change.ids.end(), entry.id) != change.ids.end();
+                };
+                m_overlayWindow.RemoveEntries(deleted);
+                m_instant.Remove(deleted);
+                break;
+            }
 
-                entries.push_back(entry);
+            case EntryChange::Kind::TagsChanged: {
+                auto update = [&change](UIEntry& entry) {
+                    entry.tags = change.tags;
+                };
+                m_overlayWindow.UpdateEntry(change.id, update, false);
+                m_instant.Update(change.id, update);
+                m_overlayWindow.RefreshTagPanel();
+                break;
             }
         }
 
-        m_overlayWindow.SetEntries(entries);
-        LOG_DEBUG("Search found " + std::to_string(entries.size()) + " entries for: " + keyword);
+        if (m_showingHistory) {
+            m_overlayWindow.SetListVersion(m_historySeq);
+        }
+    }
+
+    void OnSearchResults(const IPCNotification& notification) {
+        const nlohmann::json& data = notification.data;
+        // Batches of superseded searches may still be in flight, and the
+        // newest job's are unwanted once newer text is waiting to be sent
+        if (data.value("job_id", 0) != m_activeSearchJob || m_activeSearchJob == 0 ||
+            !m_search.IsCurrent(m_activeSearchGeneration)) {
+            return;
+        }
+
+        std::vector<UIEntry> entries = ToUIEntries(notification.GetEntries());
+        bool done = data.value("done", false);
+
+        // Merged over the instant results; a search that ran out of time
+        // didn't get to rule out the rest of them
+        bool complete = done && !data.value("timed_out", false);
+        m_instant.AddKnown(entries);
+        m_overlayWindow.SetEntries(m_instant.AddResults(entries, complete));
+
+        if (done) {
+            LOG_DEBUG("Search finished in " + std::to_string(data.value("elapsed_ms", 0.0)) +
+                      " ms for: " + m_activeSearchKeyword);
+            m_activeSearchJob = 0;
+        }
+    }
+
+    void CancelActiveSearch() {
+        if (m_activeSearchJob == 0) {
+            return;
+        }
+
+        IPCRequest request;
+        request.action = IPCAction::CANCEL_SEARCH;
+        request.params = {{"job_id", m_activeSearchJob}};
+        // Nothing to wait for: batches of the old job are ignored by job_id
+        m_ipcClient.SendAsync(request);
+
+        m_activeSearchJob = 0;
     }
 
     void AddTagToEntry(int64_t entryId, const std::string& tag) {
         IPCRequest request;
         request.action = IPCAction::ADD_TAG;
-        request.requestId = 11;
         request.params = {
             {"id", entryId},
             {"tag", tag}
@@ -256,7 +545,6 @@ private:
     void DeleteEntry(int64_t entryId) {
         IPCRequest request;
         request.action = IPCAction::DELETE_ENTRY;
-        request.requestId = 12;
         request.params = {{"id", entryId}};
 
         IPCResponse response = m_ipcClient.SendRequest(request);
@@ -265,15 +553,15 @@ private:
             LOG_ERROR("Failed to delete entry: " + response.error);
         } else {
             LOG_INFO("Deleted entry: " + std::to_string(entryId));
-            // Reload history
-            LoadHistory();
+            // The entry_deleted event does the same; removing it now keeps
+            // the list in step with the key press
+            m_overlayWindow.RemoveEntries([entryId](const UIEntry& entry) { return entry.id == entryId; });
         }
     }
 
     std::vector<std::string> GetTagsForEntry(int64_t entryId) {
         IPCRequest request;
         request.action = IPCAction::GET_TAGS;
-        request.requestId = 13;
         request.params = {{"id", entryId}};
 
         IPCResponse response = m_ipcClient.SendRequest(request);
@@ -300,7 +588,6 @@ private:
     std::vector<std::pair<std::string, int>> GetAllTags() {
         IPCRequest request;
         request.action = IPCAction::GET_ALL_TAGS;
-        request.requestId = 14;
 
         IPCResponse response = m_ipcClient.SendRequest(request);
 
@@ -327,20 +614,72 @@ private:
 
     void Shutdown() {
         m_ipcClient.Disconnect();
+        trace::Stop();
         Logger::Instance().Shutdown();
     }
 
+    // About one screenful at the default window height
+    static constexpr int SEARCH_FIRST_BATCH = 10;
+
+    static constexpr UINT_PTR SEARCH_TIMER_ID = 1;
+
+    // Rows fetched when the history is (re)loaded; the list model pages in
+    // the rest
+    static constexpr size_t HISTORY_FIRST_PAGE = 100;
+
     HINSTANCE m_hInstance = nullptr;
     IPCClient m_ipcClient;
     OverlayWindow m_overlayWindow;
+
+    // Streamed search state
+    SearchExecutor m_search{[this](const SearchExecutor::Query& query) { StartSearch(query); }};
+    int32_t m_activeSearchJob = 0;
+    uint64_t m_activeSearchGeneration = 0;
+    InstantSearch m_instant;
+    std::string m_activeSearchKeyword;
+
+    // The list shows the history rather than search results, as of this
+    // change seq (0 when unknown)
+    bool m_showingHistory = false;
+    int64_t m_historySeq = 0;
+
+    // Painted from the HistorySnapshot before connecting; its tags answer
+    // the tag panel's first request
+    bool m_shown = false;
+    std::optional<std::vector<std::pair<std::string, int>>> m_snapshotTags;
 };
 
+// ClipD passes --trace=<context> when it traces; the Overlay then records
+// into the same file, continuing the trace of the hotkey press
+static bool StartTracing(const std::wstring& cmdLine, trace::Context& context) {
+    const std::wstring flag = L"--trace=";
+    size_t pos = cmdLine.find(flag);
+    if (pos == std::wstring::npos) {
+        return false;
+    }
+    std::wstring value = cmdLine.substr(pos + flag.size());
+    value = value.substr(0, value.find(L' '));
+    if (!trace::ParseContext(utils::WideToUtf8(value), context)) {
+        return false;
+    }
+    return trace::Start(utils::GetAppDataDir() + "\\logs\\trace.json", "Overlay", true);
+}
+
 } // namespace clipx
 
 int APIENTRY wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLine, int nCmdShow) {
     clipx::OverlayApp app;
 
-    if (!app.Initialize(hInstance)) {
+    clipx::trace::Context context;
+    clipx::StartTracing(lpCmdLine ? lpCmdLine : L"", context);
+
+    bool initialized;
+    {
+        clipx::trace::Span startup("overlay.startup", context);
+        initialized = app.Initialize(hInstance);
+    }
+    if (!initialized) {
+        clipx::trace::Stop();
         return 1;
     }
 
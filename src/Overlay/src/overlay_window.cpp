@@ -2,6 +2,8 @@
 #include "renderer.h"
 #include "common/logger.h"
 #include "common/utils.h"
+#include "common/search_query.h"
+#include "common/trace.h"
 #include <windowsx.h>
 #include <algorithm>
 #include <dwmapi.h>
@@ -59,9 +61,11 @@ OverlayWindow::~OverlayWindow() {
         DeleteObject(m_memBitmap);
         DeleteDC(m_memDC);
     }
+    m_measurer.SetFonts(nullptr, nullptr, nullptr);
     if (m_font) DeleteObject(m_font);
     if (m_fontBold) DeleteObject(m_fontBold);
     if (m_fontSmall) DeleteObject(m_fontSmall);
+    renderer::Cleanup();
     if (m_hwnd) DestroyWindow(m_hwnd);
 }
 
@@ -84,18 +88,10 @@ bool OverlayWindow::Initialize(HINSTANCE hInstance) {
     }
 
     // Create fonts
-    LOGFONTW lf = {};
-    lf.lfHeight = -14;
-    lf.lfWeight = FW_NORMAL;
-    wcscpy_s(lf.lfFaceName, L"Segoe UI");
-    m_font = CreateFontIndirectW(&lf);
-
-    lf.lfWeight = FW_BOLD;
-    m_fontBold = CreateFontIndirectW(&lf);
-
-    lf.lfHeight = -11;
-    lf.lfWeight = FW_NORMAL;
-    m_fontSmall = CreateFontIndirectW(&lf);
+    HDC screenDC = GetDC(nullptr);
+    int dpi = screenDC ? GetDeviceCaps(screenDC, LOGPIXELSY) : USER_DEFAULT_SCREEN_DPI;
+    if (screenDC) ReleaseDC(nullptr, screenDC);
+    CreateFonts(dpi);
 
     // Initialize renderer
     renderer::Initialize();
@@ -176,12 +172,13 @@ void OverlayWindow::Show() {
 
     // Reset state
     m_searchText.clear();
-    m_selectedIndex = 0;
-    m_scrollOffset = 0;
+    m_list.SetViewport(0, m_list.Visible());
+    m_list.Select(0);
     m_searchFocused = true;
     m_caretVisible = false;  // Will be set to true in WM_SETFOCUS
     m_selectedTag.clear();
     m_hoverTagIndex = -1;
+    m_renderCache.Invalidate();  // Time labels are relative to now
 
     // Load all tags for tag panel
     if (m_onGetAllTags) {
@@ -204,11 +201,65 @@ void OverlayWindow::Hide() {
     LOG_DEBUG("Overlay hidden");
 }
 
-void OverlayWindow::SetEntries(const std::vector<UIEntry>& entries) {
-    m_entries = entries;
+void OverlayWindow::SetEntries(const std::vector<UIEntry>& entries, bool complete, int64_t version) {
+    m_list.Reset(entries, complete, version);
     UpdateLayout();
 }
 
+void OverlayWindow::AppendEntries(const std::vector<UIEntry>& entries) {
+    m_list.Append(entries);
+    UpdateLayout();
+}
+
+std::vector<UIEntry> OverlayWindow::LoadedEntries() const {
+    return m_list.LoadedEntries();
+}
+
+void OverlayWindow::RowsLoaded(const ListPageRequest& request, std::vector<UIEntry> rows, int64_t version) {
+    if (m_list.PageLoaded(request, std::move(rows), version)) {
+        UpdateLayout();
+    }
+}
+
+void OverlayWindow::RowsFailed(const ListPageRequest& request) {
+    m_list.PageFailed(request);
+}
+
+void OverlayWindow::SetListTotal(size_t total) {
+    m_list.SetTotal(total);
+    UpdateLayout();
+}
+
+void OverlayWindow::SetListVersion(int64_t version) {
+    m_list.SetVersion(version);
+}
+
+void OverlayWindow::UpsertEntry(const UIEntry& entry) {
+    m_list.Upsert(entry);
+    UpdateLayout();
+}
+
+bool OverlayWindow::UpdateEntry(int64_t id, const std::function<void(UIEntry&)>& update, bool moveToTop) {
+    if (!m_list.Update(id, update, moveToTop)) {
+        return false;
+    }
+    Redraw();
+    return true;
+}
+
+void OverlayWindow::RemoveEntries(const std::function<bool(const UIEntry&)>& predicate) {
+    if (m_list.Remove(predicate) > 0) {
+        UpdateLayout();
+    }
+}
+
+void OverlayWindow::RefreshTagPanel() {
+    if (m_onGetAllTags) {
+        m_allTags = m_onGetAllTags();
+    }
+    Redraw();
+}
+
 void OverlayWindow::SetOnEntrySelected(OnEntrySelectedCallback callback) {
     m_onEntrySelected = std::move(callback);
 }
@@ -221,6 +272,18 @@ void OverlayWindow::SetOnSearch(OnSearchCallback callback) {
     m_onSearch = std::move(callback);
 }
 
+void OverlayWindow::SetOnTimer(OnTimerCallback callback) {
+    m_onTimer = std::move(callback);
+}
+
+void OverlayWindow::StartTimer(UINT_PTR id, int delayMs) {
+    SetTimer(m_hwnd, id, static_cast<UINT>(std::max(delayMs, static_cast<int>(USER_TIMER_MINIMUM))), nullptr);
+}
+
+void OverlayWindow::StopTimer(UINT_PTR id) {
+    KillTimer(m_hwnd, id);
+}
+
 void OverlayWindow::SetOnAddTag(OnAddTagCallback callback) {
     m_onAddTag = std::move(callback);
 }
@@ -237,6 +300,14 @@ void OverlayWindow::SetOnGetAllTags(OnGetAllTagsCallback callback) {
     m_onGetAllTags = std::move(callback);
 }
 
+void OverlayWindow::SetOnIpcWake(OnIpcWakeCallback callback) {
+    m_onIpcWake = std::move(callback);
+}
+
+void OverlayWindow::SetOnFetchRows(OnFetchRowsCallback callback) {
+    m_list.SetFetchCallback(std::move(callback));
+}
+
 LRESULT CALLBACK OverlayWindow::WndProcStatic(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
     OverlayWindow* window = nullptr;
 
@@ -281,6 +352,12 @@ LRESULT OverlayWindow::WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam
             ShowCaret(m_hwnd);
             return 0;
 
+        case WM_DPICHANGED:
+            CreateFonts(HIWORD(wParam));
+            m_displayList.Clear();  // Ops may be unchanged, but not their fonts
+            Redraw();
+            return 0;
+
         case WM_ERASEBKGND:
             // Prevent flickering - we handle background in WM_PAINT
             return 1;
@@ -289,7 +366,7 @@ LRESULT OverlayWindow::WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam
             m_caretVisible = false;
             HideCaret(m_hwnd);
             DestroyCaret();
-            if (!m_showingDialog && !m_isSearching) {
+            if (!m_showingDialog) {
                 Hide();
             }
             return 0;
@@ -315,11 +392,25 @@ LRESULT OverlayWindow::WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam
             return 0;
 
         case WM_ACTIVATE:
-            if (LOWORD(wParam) == WA_INACTIVE && !m_showingDialog && !m_isSearching) {
+            if (LOWORD(wParam) == WA_INACTIVE && !m_showingDialog) {
                 Hide();
             }
             return 0;
 
+        case WM_TIMER:
+            // One-shot
+            KillTimer(m_hwnd, wParam);
+            if (m_onTimer) {
+                m_onTimer(wParam);
+            }
+            return 0;
+
+        case WM_IPC_WAKE:
+            if (m_onIpcWake) {
+                m_onIpcWake();
+            }
+            return 0;
+
         case WM_DESTROY:
             PostQuitMessage(0);
             return 0;
@@ -329,112 +420,86 @@ LRESULT OverlayWindow::WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam
     }
 }
 
-void OverlayWindow::OnPaint() {
-    PAINTSTRUCT ps;
-    HDC hdc = BeginPaint(m_hwnd, &ps);
-
-    // Create or resize memory DC
-    RECT clientRect;
-    GetClientRect(m_hwnd, &clientRect);
-    int width = clientRect.right - clientRect.left;
-    int height = clientRect.bottom - clientRect.top;
-
-    if (!m_memDC || !m_memBitmap) {
-        m_memDC = CreateCompatibleDC(hdc);
-        m_memBitmap = CreateCompatibleBitmap(hdc, width, height);
-        m_oldBitmap = static_cast<HBITMAP>(SelectObject(m_memDC, m_memBitmap));
-    }
+// Chunks of the display list; rows are keyed by their slot in the viewport
+enum : uint64_t {
+    CHUNK_FRAME = 1,
+    CHUNK_SEARCH,
+    CHUNK_TAG_PANEL,
+    CHUNK_TOOLBAR,
+    CHUNK_ROW = 0x100
+};
 
-    // Clear background
-    renderer::FillRect(m_memDC, &clientRect, m_bgColor);
+void OverlayWindow::BuildDisplayList(DisplayList& list, int width, int height) {
+    list.Clear();
 
-    // Draw rounded border
-    RECT borderRect = {0, 0, width, height};
-    renderer::DrawRoundedRect(m_memDC, &borderRect, m_borderRadius, m_bgColor, m_borderColor, 1);
+    // Background and rounded border
+    list.BeginChunk(CHUNK_FRAME);
+    list.Fill({0, 0, width, height}, m_bgColor);
+    list.RoundRect({0, 0, width, height}, m_borderRadius, m_bgColor, m_borderColor, 1);
 
-    // Draw search bar
-    RECT searchRect = {m_padding, m_padding, width - m_padding, m_padding + m_searchBarHeight};
-    renderer::DrawRoundedRect(m_memDC, &searchRect, 4, m_searchBgColor, m_borderColor, 1);
+    // Search bar, its text and magnifying glass icon
+    list.BeginChunk(CHUNK_SEARCH);
+    DrawRect searchRect = {m_padding, m_padding, width - m_padding, m_padding + m_searchBarHeight};
+    list.RoundRect(searchRect, 4, m_searchBgColor, m_borderColor, 1);
 
-    // Draw search icon and text
-    std::wstring searchText = utils::Utf8ToWide(m_searchText.empty() ? "Search..." : m_searchText);
     COLORREF searchColor = m_searchText.empty() ? m_textSecondaryColor : m_textColor;
-    RECT textRect = {searchRect.left + 30, searchRect.top + 5, searchRect.right - 10, searchRect.bottom - 5};
-    SelectObject(m_memDC, m_font);
-    renderer::DrawText(m_memDC, searchText, &textRect, DT_LEFT | DT_VCENTER | DT_SINGLELINE, searchColor);
+    DrawRect textRect = {searchRect.left + 30, searchRect.top + 5, searchRect.right - 10, searchRect.bottom - 5};
+    list.Text(utils::Utf8ToWide(m_searchText.empty() ? "Search..." : m_searchText), textRect,
+              DT_LEFT | DT_VCENTER | DT_SINGLELINE, searchColor, TextStyle::Normal);
+    list.Icon(searchRect.left + 8, searchRect.top + 12, 16, "search", m_textSecondaryColor);
 
-    // Draw magnifying glass icon
-    renderer::DrawIcon(m_memDC, searchRect.left + 8, searchRect.top + 12, 16, "search", m_textSecondaryColor);
-
-    // Draw tag panel
+    // Tag panel
     int tagPanelY = m_searchBarHeight + m_padding * 2;
     if (m_showTagPanel && !m_allTags.empty()) {
-        RECT tagPanelRect = {m_padding, tagPanelY, width - m_padding, tagPanelY + m_tagPanelHeight};
-        renderer::FillRect(m_memDC, &tagPanelRect, RGB(40, 40, 45));
-
-        // Draw tag panel border
-        renderer::DrawLine(m_memDC, tagPanelRect.left, tagPanelRect.bottom - 1, tagPanelRect.right, tagPanelRect.bottom - 1, m_borderColor);
+        list.BeginChunk(CHUNK_TAG_PANEL);
+        DrawRect tagPanelRect = {m_padding, tagPanelY, width - m_padding, tagPanelY + m_tagPanelHeight};
+        list.Fill(tagPanelRect, RGB(40, 40, 45));
+        list.Line(tagPanelRect.left, tagPanelRect.bottom - 1, tagPanelRect.right, tagPanelRect.bottom - 1, m_borderColor);
 
-        // Draw tags horizontally
+        // Tags horizontally
+        const TagPanelLayout& panel = m_renderCache.TagPanel(m_allTags);
         int tagX = tagPanelRect.left + 8;
         int tagY = tagPanelRect.top + 6;
         int tagHeight = 22;
-        int tagPaddingX = 8;
-        int tagPaddingY = 4;
+        int tagPaddingX = RenderCache::PANEL_TAG_PADDING;
+        UINT tagFormat = DT_CENTER | DT_VCENTER | DT_SINGLELINE;
 
-        SelectObject(m_memDC, m_fontSmall);
-
-        // Draw "All" tag first (to clear filter)
-        std::wstring allTagText = L"All";
+        // "All" tag first (to clear filter)
         bool isAllSelected = m_selectedTag.empty();
         COLORREF allTagBg = isAllSelected ? m_accentColor : RGB(70, 70, 75);
         COLORREF allTagTextCol = isAllSelected ? RGB(255, 255, 255) : m_textColor;
+        int allTagWidth = panel.all.width;
 
-        SIZE allTextSize;
-        GetTextExtentPoint32W(m_memDC, allTagText.c_str(), static_cast<int>(allTagText.length()), &allTextSize);
-        int allTagWidth = allTextSize.cx + tagPaddingX * 2;
-
-        RECT allTagRect = {tagX, tagY, tagX + allTagWidth, tagY + tagHeight};
-        renderer::DrawRoundedRect(m_memDC, &allTagRect, 4, allTagBg);
-        RECT allTextRect = {tagX + tagPaddingX, tagY, tagX + allTagWidth - tagPaddingX, tagY + tagHeight};
-        renderer::DrawText(m_memDC, allTagText, &allTextRect, DT_CENTER | DT_VCENTER | DT_SINGLELINE, allTagTextCol);
+        list.RoundRect({tagX, tagY, tagX + allTagWidth, tagY + tagHeight}, 4, allTagBg);
+        list.Text(panel.all.text, {tagX + tagPaddingX, tagY, tagX + allTagWidth - tagPaddingX, tagY + tagHeight},
+                  tagFormat, allTagTextCol, TextStyle::Small);
 
         tagX += allTagWidth + 8;
 
-        // Draw each tag
         for (size_t i = 0; i < m_allTags.size() && tagX < tagPanelRect.right - 8; i++) {
-            const auto& [tagName, count] = m_allTags[i];
-            std::wstring tagText = utils::Utf8ToWide(tagName) + L" (" + std::to_wstring(count) + L")";
+            const std::string& tagName = m_allTags[i].first;
+            const TagPill& pill = panel.tags[i];
 
             bool isSelected = m_selectedTag == tagName;
             bool isHovered = static_cast<int>(i) == m_hoverTagIndex;
             COLORREF tagBg = isSelected ? m_accentColor : (isHovered ? RGB(80, 100, 120) : m_tagBgColor);
             COLORREF tagTextCol = isSelected ? RGB(255, 255, 255) : m_tagTextColor;
-
-            SIZE textSize;
-            GetTextExtentPoint32W(m_memDC, tagText.c_str(), static_cast<int>(tagText.length()), &textSize);
-            int tagWidth = textSize.cx + tagPaddingX * 2;
+            int tagWidth = pill.width;
 
             if (tagX + tagWidth > tagPanelRect.right - 8) {
                 // Not enough space, show "..." indicator
-                std::wstring moreText = L"...";
-                SIZE moreSize;
-                GetTextExtentPoint32W(m_memDC, moreText.c_str(), static_cast<int>(moreText.length()), &moreSize);
-                int moreWidth = moreSize.cx + tagPaddingX * 2;
-
+                int moreWidth = panel.more.width;
                 if (tagX + moreWidth <= tagPanelRect.right - 8) {
-                    RECT moreRect = {tagX, tagY, tagX + moreWidth, tagY + tagHeight};
-                    renderer::DrawRoundedRect(m_memDC, &moreRect, 4, RGB(70, 70, 75));
-                    RECT moreTextRect = {tagX + tagPaddingX, tagY, tagX + moreWidth - tagPaddingX, tagY + tagHeight};
-                    renderer::DrawText(m_memDC, moreText, &moreTextRect, DT_CENTER | DT_VCENTER | DT_SINGLELINE, m_textSecondaryColor);
+                    list.RoundRect({tagX, tagY, tagX + moreWidth, tagY + tagHeight}, 4, RGB(70, 70, 75));
+                    list.Text(panel.more.text, {tagX + tagPaddingX, tagY, tagX + moreWidth - tagPaddingX, tagY + tagHeight},
+                              tagFormat, m_textSecondaryColor, TextStyle::Small);
                 }
                 break;
             }
 
-            RECT tagRect = {tagX, tagY, tagX + tagWidth, tagY + tagHeight};
-            renderer::DrawRoundedRect(m_memDC, &tagRect, 4, tagBg);
-            RECT textRect = {tagX + tagPaddingX, tagY, tagX + tagWidth - tagPaddingX, tagY + tagHeight};
-            renderer::DrawText(m_memDC, tagText, &textRect, DT_CENTER | DT_VCENTER | DT_SINGLELINE, tagTextCol);
+            list.RoundRect({tagX, tagY, tagX + tagWidth, tagY + tagHeight}, 4, tagBg);
+            list.Text(pill.text, {tagX + tagPaddingX, tagY, tagX + tagWidth - tagPaddingX, tagY + tagHeight},
+                      tagFormat, tagTextCol, TextStyle::Small);
 
             tagX += tagWidth + 6;
         }
@@ -442,123 +507,172 @@ void OverlayWindow::OnPaint() {
         tagPanelY += m_tagPanelHeight;
     }
 
-    // Draw items
+    // Items
     int itemY = tagPanelY;
     m_visibleItemCount = 0;
     int itemAreaBottom = height - m_toolbarHeight - m_padding;  // Bottom of item drawing area
 
-    for (size_t i = static_cast<size_t>(m_scrollOffset); i < m_entries.size(); i++) {
+    for (size_t i = m_list.First(); i < m_list.Count(); i++) {
         // Check if the next item would fit in the available space
         if (itemY + m_itemHeight > itemAreaBottom) {
             break;
         }
+        list.BeginChunk(CHUNK_ROW + static_cast<uint64_t>(m_visibleItemCount));
         int itemIndex = static_cast<int>(i);
-        RECT itemRect = {m_padding, itemY, width - m_padding, itemY + m_itemHeight};
+        DrawRect itemRect = {m_padding, itemY, width - m_padding, itemY + m_itemHeight};
 
-        // Determine item colors
+        // Item colors
         COLORREF itemColor = m_itemColor;
-        if (itemIndex == m_selectedIndex) {
+        if (i == m_list.Selected()) {
             itemColor = m_itemSelectedColor;
         } else if (itemIndex == m_hoverIndex) {
             itemColor = m_itemHoverColor;
         }
+        list.RoundRect(itemRect, 4, itemColor);
+
+        itemY += m_itemHeight + 4;
+        m_visibleItemCount++;
 
-        // Draw item background
-        renderer::DrawRoundedRect(m_memDC, &itemRect, 4, itemColor);
+        // Rows still being fetched show as empty items
+        const UIEntry* entry = m_list.Row(i);
+        if (!entry) {
+            continue;
+        }
 
-        // Draw icon
-        std::string iconType = renderer::GetTypeIcon(static_cast<int>(m_entries[i].type));
-        if (m_entries[i].isFavorited) {
-            iconType = "favorite";
+        // Icon, or the thumbnail ClipD made for an image
+        if (entry->thumbnail && !entry->isFavorited) {
+            list.Image({itemRect.left + 4, itemRect.top + 11, itemRect.left + 36, itemRect.top + 43}, entry->thumbnail);
+        } else {
+            std::string iconType = renderer::GetTypeIcon(static_cast<int>(entry->type));
+            if (entry->isFavorited) {
+                iconType = "favorite";
+            }
+            list.Icon(itemRect.left + 8, itemRect.top + 15, 24, iconType,
+                      entry->isFavorited ? RGB(255, 180, 0) : m_accentColor);
         }
-        renderer::DrawIcon(m_memDC, itemRect.left + 8, itemRect.top + 15, 24, iconType,
-                          m_entries[i].isFavorited ? RGB(255, 180, 0) : m_accentColor);
-
-        // Draw preview text
-        SelectObject(m_memDC, m_font);
-        std::wstring preview = utils::Utf8ToWide(m_entries[i].preview);
-        RECT previewRect = {itemRect.left + 40, itemRect.top + 8, itemRect.right - 8, itemRect.top + 32};
-        renderer::DrawText(m_memDC, preview, &previewRect, DT_LEFT | DT_TOP | DT_SINGLELINE | DT_END_ELLIPSIS, m_textColor);
-
-        // Draw secondary info (source app and timestamp)
-        SelectObject(m_memDC, m_fontSmall);
-        std::wstring secondary = utils::Utf8ToWide(m_entries[i].sourceApp + " · " + m_entries[i].timestampStr);
-        RECT secondaryRect = {itemRect.left + 40, itemRect.top + 36, itemRect.right - 8, itemRect.bottom - 8};
-        renderer::DrawText(m_memDC, secondary, &secondaryRect, DT_LEFT | DT_TOP | DT_SINGLELINE, m_textSecondaryColor);
-
-        // Draw tags on right side
-        if (!m_entries[i].tags.empty()) {
+
+        // Preview text, then source app and timestamp
+        const EntryLayout& layout = m_renderCache.Entry(*entry);
+        list.Text(layout.preview, {itemRect.left + 40, itemRect.top + 8, itemRect.right - 8, itemRect.top + 32},
+                  DT_LEFT | DT_TOP | DT_SINGLELINE | DT_END_ELLIPSIS, m_textColor, TextStyle::Normal);
+        list.Text(layout.secondary, {itemRect.left + 40, itemRect.top + 36, itemRect.right - 8, itemRect.bottom - 8},
+                  DT_LEFT | DT_TOP | DT_SINGLELINE, m_textSecondaryColor, TextStyle::Small);
+
+        // Tags on right side, newest first
+        if (!layout.tags.empty()) {
             int tagX = itemRect.right - 8;
             int tagY = itemRect.top + 8;
             int tagHeight = 18;
-            int tagPadding = 6;
-            int maxTags = 3;  // Maximum tags to show
-            int tagsShown = 0;
-
-            for (auto it = m_entries[i].tags.rbegin(); it != m_entries[i].tags.rend() && tagsShown < maxTags; ++it, ++tagsShown) {
-                std::wstring tagText = utils::Utf8ToWide(*it);
+            int tagPadding = RenderCache::ROW_TAG_PADDING;
+            UINT tagFormat = DT_CENTER | DT_VCENTER | DT_SINGLELINE;
 
-                // Calculate tag width
-                SIZE textSize;
-                SelectObject(m_memDC, m_fontSmall);
-                GetTextExtentPoint32W(m_memDC, tagText.c_str(), static_cast<int>(tagText.length()), &textSize);
-                int tagWidth = textSize.cx + tagPadding * 2;
+            for (const TagPill& pill : layout.tags) {
+                int tagWidth = pill.width;
 
                 tagX -= tagWidth + 4;
                 if (tagX < itemRect.left + 40) break;  // Don't overlap with text
 
-                // Draw tag background
-                RECT tagRect = {tagX, tagY, tagX + tagWidth, tagY + tagHeight};
-                renderer::DrawRoundedRect(m_memDC, &tagRect, 3, m_tagBgColor);
-
-                // Draw tag text
-                RECT tagTextRect = {tagX + tagPadding, tagY, tagX + tagWidth - tagPadding, tagY + tagHeight};
-                renderer::DrawText(m_memDC, tagText, &tagTextRect, DT_CENTER | DT_VCENTER | DT_SINGLELINE, m_tagTextColor);
+                list.RoundRect({tagX, tagY, tagX + tagWidth, tagY + tagHeight}, 3, m_tagBgColor);
+                list.Text(pill.text, {tagX + tagPadding, tagY, tagX + tagWidth - tagPadding, tagY + tagHeight},
+                          tagFormat, m_tagTextColor, TextStyle::Small);
             }
 
             // If more tags than shown, show +N indicator
-            if (m_entries[i].tags.size() > static_cast<size_t>(maxTags)) {
-                int moreCount = static_cast<int>(m_entries[i].tags.size()) - maxTags;
-                std::wstring moreText = L"+" + std::to_wstring(moreCount);
-
-                SIZE textSize;
-                SelectObject(m_memDC, m_fontSmall);
-                GetTextExtentPoint32W(m_memDC, moreText.c_str(), static_cast<int>(moreText.length()), &textSize);
-                int moreWidth = textSize.cx + tagPadding * 2;
+            if (layout.more.width > 0) {
+                int moreWidth = layout.more.width;
 
                 tagX -= moreWidth + 4;
                 if (tagX >= itemRect.left + 40) {
-                    RECT moreRect = {tagX, tagY, tagX + moreWidth, tagY + tagHeight};
-                    renderer::DrawRoundedRect(m_memDC, &moreRect, 3, RGB(70, 70, 75));
-
-                    RECT moreTextRect = {tagX + tagPadding, tagY, tagX + moreWidth - tagPadding, tagY + tagHeight};
-                    renderer::DrawText(m_memDC, moreText, &moreTextRect, DT_CENTER | DT_VCENTER | DT_SINGLELINE, m_textSecondaryColor);
+                    list.RoundRect({tagX, tagY, tagX + moreWidth, tagY + tagHeight}, 3, RGB(70, 70, 75));
+                    list.Text(layout.more.text, {tagX + tagPadding, tagY, tagX + moreWidth - tagPadding, tagY + tagHeight},
+                              tagFormat, m_textSecondaryColor, TextStyle::Small);
                 }
             }
         }
+    }
 
-        itemY += m_itemHeight + 4;
-        m_visibleItemCount++;
+    // Toolbar with stats and shortcut hints
+    list.BeginChunk(CHUNK_TOOLBAR);
+    DrawRect toolbarRect = {m_padding, height - m_toolbarHeight - m_padding, width - m_padding, height - m_padding};
+    list.Fill(toolbarRect, m_bgColor);
+    list.Line(toolbarRect.left, toolbarRect.top, toolbarRect.right, toolbarRect.top, m_borderColor);
+
+    std::wstring statsText = L"Total: " + std::to_wstring(m_list.Count()) + (m_list.IsComplete() ? L"" : L"+") + L" items";
+    DrawRect statsRect = {toolbarRect.left + 8, toolbarRect.top + 10, toolbarRect.right - 8, toolbarRect.bottom - 10};
+    list.Text(std::move(statsText), statsRect, DT_LEFT | DT_VCENTER, m_textSecondaryColor, TextStyle::Small);
+    list.Text(L"Enter=Select  Esc=Close  Del=Delete", statsRect, DT_RIGHT | DT_VCENTER, m_textSecondaryColor, TextStyle::Small);
+}
+
+// Every state change ends here instead of invalidating the whole window:
+// the new frame is compared with the last one and only what differs is
+// repainted, so a hover or selection change costs the rows involved.
+void OverlayWindow::Redraw() {
+    if (!m_hwnd) {
+        return;
+    }
+    CLIPX_TRACE_SPAN("frame.build");
+    RECT clientRect;
+    GetClientRect(m_hwnd, &clientRect);
+
+    DisplayList next;
+    BuildDisplayList(next, clientRect.right - clientRect.left, clientRect.bottom - clientRect.top);
+    for (const DrawRect& damage : ComputeDamage(m_displayList, next)) {
+        RECT rect = {damage.left, damage.top, damage.right, damage.bottom};
+        InvalidateRect(m_hwnd, &rect, FALSE);
     }
+    m_displayList = std::move(next);
+}
 
-    // Draw toolbar
-    RECT toolbarRect = {m_padding, height - m_toolbarHeight - m_padding, width - m_padding, height - m_padding};
-    renderer::FillRect(m_memDC, &toolbarRect, m_bgColor);
-    renderer::DrawLine(m_memDC, toolbarRect.left, toolbarRect.top, toolbarRect.right, toolbarRect.top, m_borderColor);
+void OverlayWindow::OnPaint() {
+    CLIPX_TRACE_SPAN("paint");
+    // Damage from Redraw, or whatever was uncovered
+    HRGN updateRgn = CreateRectRgn(0, 0, 0, 0);
+    GetUpdateRgn(m_hwnd, updateRgn, FALSE);
 
-    SelectObject(m_memDC, m_fontSmall);
-    std::wstring statsText = L"Total: " + std::to_wstring(m_entries.size()) + L" items";
-    RECT statsRect = {toolbarRect.left + 8, toolbarRect.top + 10, toolbarRect.right - 8, toolbarRect.bottom - 10};
-    renderer::DrawText(m_memDC, statsText, &statsRect, DT_LEFT | DT_VCENTER, m_textSecondaryColor);
+    PAINTSTRUCT ps;
+    HDC hdc = BeginPaint(m_hwnd, &ps);
 
-    // Draw shortcut hints
-    std::wstring shortcutsText = L"Enter=Select  Esc=Close  Del=Delete";
-    renderer::DrawText(m_memDC, shortcutsText, &statsRect, DT_RIGHT | DT_VCENTER, m_textSecondaryColor);
+    RECT clientRect;
+    GetClientRect(m_hwnd, &clientRect);
+    int width = clientRect.right - clientRect.left;
+    int height = clientRect.bottom - clientRect.top;
+
+    // A new back buffer holds nothing yet: draw all of it
+    RECT clip = ps.rcPaint;
+    if (!m_memDC || width != m_memWidth || height != m_memHeight) {
+        if (!m_memDC) {
+            m_memDC = CreateCompatibleDC(hdc);
+        }
+        if (m_memBitmap) {
+            SelectObject(m_memDC, m_oldBitmap);
+            DeleteObject(m_memBitmap);
+        }
+        m_memBitmap = CreateCompatibleBitmap(hdc, width, height);
+        m_oldBitmap = static_cast<HBITMAP>(SelectObject(m_memDC, m_memBitmap));
+        m_memWidth = width;
+        m_memHeight = height;
+
+        BuildDisplayList(m_displayList, width, height);
+        clip = clientRect;
+    } else {
+        SelectClipRgn(m_memDC, updateRgn);
+    }
+
+    HFONT fonts[] = {m_font, m_fontBold, m_fontSmall};
+    renderer::Replay(m_memDC, m_displayList, clip, fonts);
+    SelectClipRgn(m_memDC, nullptr);
 
     // Copy to screen
-    BitBlt(hdc, 0, 0, width, height, m_memDC, 0, 0, SRCCOPY);
+    BitBlt(hdc, ps.rcPaint.left, ps.rcPaint.top, ps.rcPaint.right - ps.rcPaint.left, ps.rcPaint.bottom - ps.rcPaint.top,
+           m_memDC, ps.rcPaint.left, ps.rcPaint.top, SRCCOPY);
 
     EndPaint(m_hwnd, &ps);
+    DeleteObject(updateRgn);
+
+    if (!m_painted) {
+        m_painted = true;
+        trace::Instant("first paint");
+    }
 }
 
 void OverlayWindow::OnKeyDown(WPARAM vk) {
@@ -568,35 +682,33 @@ void OverlayWindow::OnKeyDown(WPARAM vk) {
             break;
 
         case VK_RETURN:
-            if (m_selectedIndex >= 0 && m_selectedIndex < static_cast<int>(m_entries.size())) {
+            if (const UIEntry* entry = m_list.SelectedRow()) {
                 if (m_onEntrySelected) {
-                    m_onEntrySelected(m_entries[m_selectedIndex].id);
+                    m_onEntrySelected(entry->id);
                 }
                 Hide();
             }
             break;
 
         case VK_UP:
-            if (m_selectedIndex > 0) {
-                m_selectedIndex--;
-                EnsureVisible(m_selectedIndex);
-                InvalidateRect(m_hwnd, nullptr, FALSE);
+            if (m_list.Selected() > 0) {
+                m_list.Select(m_list.Selected() - 1);
+                Redraw();
             }
             break;
 
         case VK_DOWN:
-            if (m_selectedIndex < static_cast<int>(m_entries.size()) - 1) {
-                m_selectedIndex++;
-                EnsureVisible(m_selectedIndex);
-                InvalidateRect(m_hwnd, nullptr, FALSE);
+            if (m_list.Selected() + 1 < m_list.Count()) {
+                m_list.Select(m_list.Selected() + 1);
+                Redraw();
             }
             break;
 
         case VK_DELETE:
             // Delete selected item
-            if (m_selectedIndex >= 0 && m_selectedIndex < static_cast<int>(m_entries.size())) {
+            if (const UIEntry* entry = m_list.SelectedRow()) {
                 if (m_onDelete) {
-                    m_onDelete(m_entries[m_selectedIndex].id);
+                    m_onDelete(entry->id);
                 }
             }
             break;
@@ -618,20 +730,17 @@ void OverlayWindow::OnKeyDown(WPARAM vk) {
                 // Update caret position
                 SetCaretPos(m_padding + 30 + GetTextWidth(m_searchText), m_padding + 12);
 
-                // Trigger search callback with protection against focus loss
                 if (m_onSearch) {
-                    m_isSearching = true;
-                    m_onSearch(m_searchText);
-                    m_isSearching = false;
+                    m_onSearch(m_searchText, true);
                 }
-                InvalidateRect(m_hwnd, nullptr, FALSE);
+                Redraw();
             }
             break;
 
         case 'F':
             if (GetKeyState(VK_CONTROL) & 0x8000) {
                 m_searchFocused = true;
-                InvalidateRect(m_hwnd, nullptr, FALSE);
+                Redraw();
             }
             break;
     }
@@ -673,13 +782,10 @@ void OverlayWindow::OnChar(WPARAM ch) {
         // Update caret position (always update if window has focus)
         SetCaretPos(m_padding + 30 + GetTextWidth(m_searchText), m_padding + 12);
 
-        // Trigger search callback with protection against focus loss
         if (m_onSearch) {
-            m_isSearching = true;
-            m_onSearch(m_searchText);
-            m_isSearching = false;
+            m_onSearch(m_searchText, true);
         }
-        InvalidateRect(m_hwnd, nullptr, FALSE);
+        Redraw();
     }
 }
 
@@ -688,14 +794,14 @@ void OverlayWindow::OnMouseMove(int x, int y) {
     int tagIndex = GetTagAtPosition(x, y);
     if (tagIndex != m_hoverTagIndex) {
         m_hoverTagIndex = tagIndex;
-        InvalidateRect(m_hwnd, nullptr, FALSE);
+        Redraw();
     }
 
     // Check for item hover
     int itemIndex = GetItemAtPosition(x, y);
     if (itemIndex != m_hoverIndex) {
         m_hoverIndex = itemIndex;
-        InvalidateRect(m_hwnd, nullptr, FALSE);
+        Redraw();
     }
 }
 
@@ -708,23 +814,23 @@ void OverlayWindow::OnMouseDown(int x, int y, bool isRight) {
             m_selectedTag.clear();
             m_searchText.clear();
             if (m_onSearch) {
-                m_onSearch("");
+                m_onSearch("", false);
             }
         } else if (tagIndex >= 0 && tagIndex < static_cast<int>(m_allTags.size())) {
-            // Tag clicked - filter by tag
+            // Tag clicked - filter by tag (exact tag lookup, not a text search)
             m_selectedTag = m_allTags[tagIndex].first;
             if (m_onSearch) {
-                m_onSearch(m_selectedTag);
+                m_onSearch(FormatQueryFilter("tag", m_selectedTag), false);
             }
         }
-        InvalidateRect(m_hwnd, nullptr, FALSE);
+        Redraw();
         return;
     }
 
     int itemIndex = GetItemAtPosition(x, y);
     if (itemIndex >= 0) {
-        m_selectedIndex = itemIndex;
-        InvalidateRect(m_hwnd, nullptr, FALSE);
+        m_list.Select(itemIndex);
+        Redraw();
 
         if (isRight) {
             ShowContextMenu(x, y, itemIndex);
@@ -735,9 +841,10 @@ void OverlayWindow::OnMouseDown(int x, int y, bool isRight) {
 void OverlayWindow::OnMouseUp(int x, int y, bool isRight) {
     if (!isRight) {
         int itemIndex = GetItemAtPosition(x, y);
-        if (itemIndex >= 0 && itemIndex == m_selectedIndex) {
+        const UIEntry* entry = itemIndex >= 0 ? m_list.Row(itemIndex) : nullptr;
+        if (entry && static_cast<size_t>(itemIndex) == m_list.Selected()) {
             if (m_onEntrySelected) {
-                m_onEntrySelected(m_entries[itemIndex].id);
+                m_onEntrySelected(entry->id);
             }
             Hide();
         }
@@ -753,12 +860,14 @@ void OverlayWindow::UpdateLayout() {
     int tagPanelHeight = (m_showTagPanel && !m_allTags.empty()) ? m_tagPanelHeight : 0;
     // Fixed content includes search bar, tag panel, toolbar, and padding
     int contentHeight = m_searchBarHeight + m_padding * 2 + tagPanelHeight + m_toolbarHeight + m_padding;
-    int itemsHeight = static_cast<int>(m_entries.size()) * (m_itemHeight + 4);
+    size_t maxItems = static_cast<size_t>(std::max(0, m_maxHeight - contentHeight) / (m_itemHeight + 4) + 1);
+    int itemsHeight = static_cast<int>(std::min(m_list.Count(), maxItems)) * (m_itemHeight + 4);
     m_height = std::min(contentHeight + itemsHeight, m_maxHeight);
 
     // Adjust visible item count - available height for items
     int availableHeight = m_height - (m_searchBarHeight + m_padding * 2 + tagPanelHeight + m_toolbarHeight + m_padding);
     m_visibleItemCount = std::max(1, availableHeight / (m_itemHeight + 4));
+    m_list.SetViewport(m_list.First(), m_visibleItemCount);
 
     if (m_hwnd) {
         RECT rect;
@@ -766,21 +875,22 @@ void OverlayWindow::UpdateLayout() {
         SetWindowPos(m_hwnd, nullptr, rect.left, rect.top, m_width, m_height, SWP_NOZORDER);
     }
 
-    InvalidateRect(m_hwnd, nullptr, FALSE);
+    Redraw();
 }
 
 int OverlayWindow::GetItemAtPosition(int x, int y) {
     int tagPanelHeight = (m_showTagPanel && !m_allTags.empty()) ? m_tagPanelHeight : 0;
-    int itemY = m_searchBarHeight + m_padding * 2 + tagPanelHeight;
-
-    for (size_t i = static_cast<size_t>(m_scrollOffset); i < m_entries.size(); i++) {
-        if (y >= itemY && y < itemY + m_itemHeight) {
-            return static_cast<int>(i);
-        }
-        itemY += m_itemHeight + 4;
+    int offset = y - (m_searchBarHeight + m_padding * 2 + tagPanelHeight);
+    if (offset < 0 || offset % (m_itemHeight + 4) >= m_itemHeight) {
+        return -1;
     }
 
-    return -1;
+    int slot = offset / (m_itemHeight + 4);
+    size_t index = m_list.First() + slot;
+    if (slot >= m_visibleItemCount || index >= m_list.Count()) {
+        return -1;
+    }
+    return static_cast<int>(index);
 }
 
 int OverlayWindow::GetTagAtPosition(int x, int y) {
@@ -792,18 +902,13 @@ int OverlayWindow::GetTagAtPosition(int x, int y) {
     if (y < tagPanelTop || y > tagPanelBottom) return -1;
     if (x < m_padding + 8) return -1;
 
+    const TagPanelLayout& panel = m_renderCache.TagPanel(m_allTags);
     int tagX = m_padding + 8;
     int tagY = tagPanelTop + 6;
     int tagHeight = 22;
-    int tagPaddingX = 8;
-
-    SelectObject(m_memDC, m_fontSmall);
 
     // Check "All" tag
-    std::wstring allTagText = L"All";
-    SIZE allTextSize;
-    GetTextExtentPoint32W(m_memDC, allTagText.c_str(), static_cast<int>(allTagText.length()), &allTextSize);
-    int allTagWidth = allTextSize.cx + tagPaddingX * 2;
+    int allTagWidth = panel.all.width;
 
     if (x >= tagX && x < tagX + allTagWidth && y >= tagY && y < tagY + tagHeight) {
         return -2;  // Special value for "All" tag
@@ -811,13 +916,8 @@ int OverlayWindow::GetTagAtPosition(int x, int y) {
     tagX += allTagWidth + 8;
 
     // Check each tag
-    for (size_t i = 0; i < m_allTags.size(); i++) {
-        const auto& [tagName, count] = m_allTags[i];
-        std::wstring tagText = utils::Utf8ToWide(tagName) + L" (" + std::to_wstring(count) + L")";
-
-        SIZE textSize;
-        GetTextExtentPoint32W(m_memDC, tagText.c_str(), static_cast<int>(tagText.length()), &textSize);
-        int tagWidth = textSize.cx + tagPaddingX * 2;
+    for (size_t i = 0; i < panel.tags.size(); i++) {
+        int tagWidth = panel.tags[i].width;
 
         if (x >= tagX && x < tagX + tagWidth && y >= tagY && y < tagY + tagHeight) {
             return static_cast<int>(i);
@@ -829,36 +929,27 @@ int OverlayWindow::GetTagAtPosition(int x, int y) {
 }
 
 void OverlayWindow::SelectItem(int index) {
-    if (index >= 0 && index < static_cast<int>(m_entries.size())) {
-        m_selectedIndex = index;
-        EnsureVisible(index);
-        InvalidateRect(m_hwnd, nullptr, FALSE);
-    }
-}
-
-void OverlayWindow::EnsureVisible(int index) {
-    int visibleStart = m_scrollOffset;
-    int visibleEnd = m_scrollOffset + m_visibleItemCount - 1;
-
-    if (index < visibleStart) {
-        m_scrollOffset = index;
-    } else if (index > visibleEnd) {
-        m_scrollOffset = index - m_visibleItemCount + 1;
+    if (index >= 0 && static_cast<size_t>(index) < m_list.Count()) {
+        m_list.Select(index);
+        Redraw();
     }
 }
 
 void OverlayWindow::Scroll(int delta) {
-    int newOffset = m_scrollOffset + delta;
-    int maxOffset = std::max(0, static_cast<int>(m_entries.size()) - m_visibleItemCount);
-    m_scrollOffset = std::max(0, std::min(newOffset, maxOffset));
-    InvalidateRect(m_hwnd, nullptr, FALSE);
+    m_list.ScrollBy(delta);
+    Redraw();
 }
 
 void OverlayWindow::ShowContextMenu(int x, int y, int itemIndex) {
-    if (itemIndex < 0 || itemIndex >= static_cast<int>(m_entries.size())) {
+    const UIEntry* entry = itemIndex >= 0 ? m_list.Row(itemIndex) : nullptr;
+    if (!entry) {
         return;
     }
 
+    // Change events handled while the menu or a dialog is open may reorder
+    // the list, so refer to the entry by id from here on
+    int64_t entryId = entry->id;
+
     HMENU hMenu = CreatePopupMenu();
     AppendMenuW(hMenu, MF_STRING, 1, L"Add Tag");
     AppendMenuW(hMenu, MF_STRING, 3, L"View Tags");
@@ -884,14 +975,13 @@ void OverlayWindow::ShowContextMenu(int x, int y, int itemIndex) {
             std::wstring tag = ShowSimpleInputDialog(L"Add Tag", L"Enter tag name:");
             if (!tag.empty() && m_onAddTag) {
                 std::string tagUtf8 = utils::WideToUtf8(tag);
-                m_onAddTag(m_entries[itemIndex].id, tagUtf8);
-                // Update the entry's local tags list
-                m_entries[itemIndex].tags.push_back(tagUtf8);
+                // The entry's tags are updated by the tags_changed event
+                m_onAddTag(entryId, tagUtf8);
                 // Refresh tag panel
                 if (m_onGetAllTags) {
                     m_allTags = m_onGetAllTags();
                 }
-                InvalidateRect(m_hwnd, nullptr, FALSE);
+                Redraw();
             }
             break;
         }
@@ -899,8 +989,7 @@ void OverlayWindow::ShowContextMenu(int x, int y, int itemIndex) {
             if (m_onDelete) {
                 // Keep dialog flag true during delete to prevent window hiding
                 m_showingDialog = true;
-                m_onDelete(m_entries[itemIndex].id);
-                // Note: entries will be updated via SetEntries callback from main.cpp
+                m_onDelete(entryId);
                 // Refresh tag panel
                 if (m_onGetAllTags) {
                     m_allTags = m_onGetAllTags();
@@ -908,14 +997,14 @@ void OverlayWindow::ShowContextMenu(int x, int y, int itemIndex) {
                 // Reset flag after delete completes
                 m_showingDialog = false;
                 // Ensure window stays visible and focused
-                InvalidateRect(m_hwnd, nullptr, FALSE);
+                Redraw();
             }
             break;
         case 3: { // View Tags
             if (m_onGetTags) {
                 // Set flag to prevent auto-hide when showing message box
                 m_showingDialog = true;
-                std::vector<std::string> tags = m_onGetTags(m_entries[itemIndex].id);
+                std::vector<std::string> tags = m_onGetTags(entryId);
                 m_showingDialog = false;
 
                 if (tags.empty()) {
@@ -1107,24 +1196,33 @@ std::wstring OverlayWindow::ShowSimpleInputDialog(const std::wstring& title, con
 }
 
 int OverlayWindow::GetTextWidth(const std::string& text) {
-    if (!m_font || text.empty()) return 0;
-
-    std::wstring wtext = utils::Utf8ToWide(text);
+    if (text.empty()) return 0;
+    return m_measurer.Measure(TextStyle::Normal, utils::Utf8ToWide(text));
+}
 
-    // Get window DC and select font
-    HDC hdc = GetDC(m_hwnd);
-    if (!hdc) return 0;
+void OverlayWindow::CreateFonts(int dpi) {
+    // Nothing may still have the old fonts selected when they are deleted
+    m_measurer.SetFonts(nullptr, nullptr, nullptr);
+    if (m_memDC) SelectObject(m_memDC, GetStockObject(DEFAULT_GUI_FONT));
+    if (m_font) DeleteObject(m_font);
+    if (m_fontBold) DeleteObject(m_fontBold);
+    if (m_fontSmall) DeleteObject(m_fontSmall);
 
-    HFONT oldFont = static_cast<HFONT>(SelectObject(hdc, m_font));
+    LOGFONTW lf = {};
+    lf.lfHeight = -MulDiv(14, dpi, USER_DEFAULT_SCREEN_DPI);
+    lf.lfWeight = FW_NORMAL;
+    wcscpy_s(lf.lfFaceName, L"Segoe UI");
+    m_font = CreateFontIndirectW(&lf);
 
-    // Use DrawText with DT_CALCRECT to get accurate text width
-    RECT rect = {0, 0, 0, 0};
-    DrawTextW(hdc, wtext.c_str(), static_cast<int>(wtext.length()), &rect, DT_LEFT | DT_SINGLELINE | DT_CALCRECT);
+    lf.lfWeight = FW_BOLD;
+    m_fontBold = CreateFontIndirectW(&lf);
 
-    SelectObject(hdc, oldFont);
-    ReleaseDC(m_hwnd, hdc);
+    lf.lfHeight = -MulDiv(11, dpi, USER_DEFAULT_SCREEN_DPI);
+    lf.lfWeight = FW_NORMAL;
+    m_fontSmall = CreateFontIndirectW(&lf);
 
-    return rect.right;
+    m_measurer.SetFonts(m_font, m_fontBold, m_fontSmall);
+    m_renderCache.Invalidate();
 }
 
 } // namespace clipx
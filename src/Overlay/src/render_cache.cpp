@@ -0,0 +1,116 @@
+#include "render_cache.h"
+#include "common/utils.h"
+
+namespace clipx {
+
+namespace {
+
+// FNV-1a over everything a row shows. Fields are length-prefixed so moving
+// text from one field to the next changes it.
+class Fingerprint {
+public:
+    void Add(const void* data, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; i++) {
+            m_hash ^= bytes[i];
+            m_hash *= 1099511628211ULL;
+        }
+    }
+
+    void Add(const std::string& text) {
+        uint64_t size = text.size();
+        Add(&size, sizeof(size));
+        Add(text.data(), text.size());
+    }
+
+    uint64_t Value() const { return m_hash; }
+
+private:
+    uint64_t m_hash = 14695981039346656037ULL;
+};
+
+uint64_t FingerprintOf(const UIEntry& entry) {
+    Fingerprint fp;
+    fp.Add(entry.preview);
+    fp.Add(entry.sourceApp);
+    fp.Add(&entry.timestamp, sizeof(entry.timestamp));
+    uint64_t tagCount = entry.tags.size();
+    fp.Add(&tagCount, sizeof(tagCount));
+    for (const auto& tag : entry.tags) {
+        fp.Add(tag);
+    }
+    return fp.Value();
+}
+
+} // namespace
+
+RenderCache::RenderCache(TextMeasurer& measurer) : m_measurer(measurer) {}
+
+const EntryLayout& RenderCache::Entry(const UIEntry& entry) {
+    uint64_t fingerprint = FingerprintOf(entry);
+
+    auto it = m_entries.find(entry.id);
+    if (it != m_entries.end()) {
+        if (it->second.fingerprint != fingerprint) {
+            it->second.fingerprint = fingerprint;
+            Layout(entry, it->second.layout);
+        }
+        return it->second.layout;
+    }
+
+    // Rows scrolled far away are gone from the list model too
+    if (m_entries.size() >= MAX_ENTRIES) {
+        m_entries.clear();
+    }
+    Cached& cached = m_entries[entry.id];
+    cached.fingerprint = fingerprint;
+    Layout(entry, cached.layout);
+    return cached.layout;
+}
+
+const TagPanelLayout& RenderCache::TagPanel(const std::vector<std::pair<std::string, int>>& tags) {
+    if (m_panelValid && tags == m_panelTags) {
+        return m_panel;
+    }
+
+    m_panelTags = tags;
+    m_panel.all = Pill(TextStyle::Small, L"All", PANEL_TAG_PADDING);
+    m_panel.more = Pill(TextStyle::Small, L"...", PANEL_TAG_PADDING);
+    m_panel.tags.clear();
+    m_panel.tags.reserve(tags.size());
+    for (const auto& [name, count] : tags) {
+        m_panel.tags.push_back(Pill(TextStyle::Small, utils::Utf8ToWide(name) + L" (" + std::to_wstring(count) + L")",
+                                    PANEL_TAG_PADDING));
+    }
+    m_panelValid = true;
+    return m_panel;
+}
+
+void RenderCache::Invalidate() {
+    m_entries.clear();
+    m_panelValid = false;
+}
+
+TagPill RenderCache::Pill(TextStyle style, std::wstring text, int padding) {
+    TagPill pill;
+    pill.width = m_measurer.Measure(style, text) + padding * 2;
+    pill.text = std::move(text);
+    return pill;
+}
+
+void RenderCache::Layout(const UIEntry& entry, EntryLayout& layout) {
+    layout.preview = utils::Utf8ToWide(entry.preview);
+    layout.secondary = utils::Utf8ToWide(entry.sourceApp + " · " + utils::FormatTimestamp(entry.timestamp));
+
+    layout.tags.clear();
+    for (auto it = entry.tags.rbegin(); it != entry.tags.rend() && layout.tags.size() < ROW_TAGS; ++it) {
+        layout.tags.push_back(Pill(TextStyle::Small, utils::Utf8ToWide(*it), ROW_TAG_PADDING));
+    }
+
+    layout.more = TagPill{};
+    if (entry.tags.size() > ROW_TAGS) {
+        layout.more = Pill(TextStyle::Small, L"+" + std::to_wstring(entry.tags.size() - ROW_TAGS), ROW_TAG_PADDING);
+    }
+}
+
+} // namespace clipx
@@ -9,12 +9,57 @@
 
 #include <uxtheme.h>
 #include <dwmapi.h>
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <unordered_map>
+#include <utility>
 
 namespace clipx {
 namespace renderer {
 
+// The theme has a handful of colors, so brushes and pens are kept until
+// Cleanup. Never deleted by the drawing functions.
+static constexpr size_t MAX_CACHED_OBJECTS = 64;
+static std::unordered_map<COLORREF, HBRUSH> g_brushes;
+static std::map<std::pair<COLORREF, int>, HPEN> g_pens;
+
+static void ReleaseCached() {
+    for (auto& [color, brush] : g_brushes) {
+        DeleteObject(brush);
+    }
+    for (auto& [key, pen] : g_pens) {
+        DeleteObject(pen);
+    }
+    g_brushes.clear();
+    g_pens.clear();
+}
+
 static HBRUSH CreateSolidBrushCached(COLORREF color) {
-    return CreateSolidBrush(color);
+    auto it = g_brushes.find(color);
+    if (it != g_brushes.end()) {
+        return it->second;
+    }
+    if (g_brushes.size() >= MAX_CACHED_OBJECTS) {
+        ReleaseCached();
+    }
+    HBRUSH brush = CreateSolidBrush(color);
+    g_brushes[color] = brush;
+    return brush;
+}
+
+static HPEN CreatePenCached(COLORREF color, int width) {
+    auto key = std::make_pair(color, width);
+    auto it = g_pens.find(key);
+    if (it != g_pens.end()) {
+        return it->second;
+    }
+    if (g_pens.size() >= MAX_CACHED_OBJECTS) {
+        ReleaseCached();
+    }
+    HPEN pen = CreatePen(PS_SOLID, width, color);
+    g_pens[key] = pen;
+    return pen;
 }
 
 void Initialize() {
@@ -23,33 +68,23 @@ void Initialize() {
 }
 
 void Cleanup() {
-    // Clean up any cached resources
+    ReleaseCached();
 }
 
 void FillRect(HDC hdc, const RECT* rect, COLORREF color) {
-    HBRUSH brush = CreateSolidBrushCached(color);
-    ::FillRect(hdc, rect, brush);
-    DeleteObject(brush);
+    ::FillRect(hdc, rect, CreateSolidBrushCached(color));
 }
 
 void DrawRoundedRect(HDC hdc, const RECT* rect, int radius, COLORREF fillColor, COLORREF borderColor, int borderWidth) {
-    // Get dimensions
-    int width = rect->right - rect->left;
-    int height = rect->bottom - rect->top;
-
     // Create a rounded rectangle region
     HRGN rgn = CreateRoundRectRgn(rect->left, rect->top, rect->right + 1, rect->bottom + 1, radius * 2, radius * 2);
 
     // Fill the region
-    HBRUSH fillBrush = CreateSolidBrush(fillColor);
-    FillRgn(hdc, rgn, fillBrush);
-    DeleteObject(fillBrush);
+    FillRgn(hdc, rgn, CreateSolidBrushCached(fillColor));
 
     // Draw border if specified
     if (borderWidth > 0 && borderColor != 0) {
-        HBRUSH borderBrush = CreateSolidBrush(borderColor);
-        FrameRgn(hdc, rgn, borderBrush, borderWidth, borderWidth);
-        DeleteObject(borderBrush);
+        FrameRgn(hdc, rgn, CreateSolidBrushCached(borderColor), borderWidth, borderWidth);
     }
 
     DeleteObject(rgn);
@@ -66,10 +101,8 @@ void DrawText(HDC hdc, const std::wstring& text, const RECT* rect, UINT format,
 
 void DrawIcon(HDC hdc, int x, int y, int size, const std::string& iconType, COLORREF color) {
     // Draw a simple colored circle or shape to represent the icon
-    HBRUSH brush = CreateSolidBrush(color);
-    HPEN pen = CreatePen(PS_SOLID, 1, color);
-    HGDIOBJ oldBrush = SelectObject(hdc, brush);
-    HGDIOBJ oldPen = SelectObject(hdc, pen);
+    HGDIOBJ oldBrush = SelectObject(hdc, CreateSolidBrushCached(color));
+    HGDIOBJ oldPen = SelectObject(hdc, CreatePenCached(color, 1));
 
     if (iconType == "text") {
         // Draw a document-like shape
@@ -110,19 +143,84 @@ void DrawIcon(HDC hdc, int x, int y, int size, const std::string& iconType, COLO
 
     SelectObject(hdc, oldBrush);
     SelectObject(hdc, oldPen);
-    DeleteObject(brush);
-    DeleteObject(pen);
 }
 
 void DrawLine(HDC hdc, int x1, int y1, int x2, int y2, COLORREF color, int width) {
-    HPEN pen = CreatePen(PS_SOLID, width, color);
-    HGDIOBJ oldPen = SelectObject(hdc, pen);
+    HGDIOBJ oldPen = SelectObject(hdc, CreatePenCached(color, width));
 
     MoveToEx(hdc, x1, y1, nullptr);
     LineTo(hdc, x2, y2);
 
     SelectObject(hdc, oldPen);
-    DeleteObject(pen);
+}
+
+void DrawThumbnail(HDC hdc, const RECT* rect, const std::vector<uint8_t>& dib) {
+    if (dib.size() < sizeof(BITMAPINFOHEADER)) {
+        return;
+    }
+    BITMAPINFOHEADER header;
+    memcpy(&header, dib.data(), sizeof(header));
+    int width = header.biWidth;
+    int height = header.biHeight < 0 ? -header.biHeight : header.biHeight;
+    if (header.biSize != sizeof(BITMAPINFOHEADER) || header.biBitCount != 32 || width <= 0 || height <= 0 ||
+        dib.size() - sizeof(header) < static_cast<size_t>(width) * height * 4) {
+        return;
+    }
+
+    int boxWidth = rect->right - rect->left;
+    int boxHeight = rect->bottom - rect->top;
+    int drawWidth = boxWidth;
+    int drawHeight = boxHeight;
+    if (width * boxHeight > height * boxWidth) {
+        drawHeight = std::max(1, height * boxWidth / width);
+    } else {
+        drawWidth = std::max(1, width * boxHeight / height);
+    }
+    int x = rect->left + (boxWidth - drawWidth) / 2;
+    int y = rect->top + (boxHeight - drawHeight) / 2;
+
+    int oldMode = SetStretchBltMode(hdc, HALFTONE);
+    SetBrushOrgEx(hdc, 0, 0, nullptr);
+    StretchDIBits(hdc, x, y, drawWidth, drawHeight, 0, 0, width, height, dib.data() + sizeof(header),
+                  reinterpret_cast<const BITMAPINFO*>(dib.data()), DIB_RGB_COLORS, SRCCOPY);
+    SetStretchBltMode(hdc, oldMode);
+}
+
+size_t Replay(HDC hdc, const DisplayList& list, const RECT& clip, const HFONT (&fonts)[3]) {
+    DrawRect clipRect = {static_cast<int>(clip.left), static_cast<int>(clip.top), static_cast<int>(clip.right),
+                         static_cast<int>(clip.bottom)};
+    size_t drawn = 0;
+    for (const DrawOp& op : list.Ops()) {
+        if (!op.Bounds().Intersects(clipRect)) {
+            continue;
+        }
+        RECT rect = {op.rect.left, op.rect.top, op.rect.right, op.rect.bottom};
+        switch (op.kind) {
+            case DrawOp::Kind::Fill:
+                FillRect(hdc, &rect, op.color);
+                break;
+            case DrawOp::Kind::RoundRect:
+                DrawRoundedRect(hdc, &rect, op.radius, op.color, op.border, op.width);
+                break;
+            case DrawOp::Kind::Text:
+                SelectObject(hdc, fonts[static_cast<int>(op.style)]);
+                DrawText(hdc, op.text, &rect, op.format, op.color);
+                break;
+            case DrawOp::Kind::Icon:
+                DrawIcon(hdc, rect.left, rect.top, rect.right - rect.left, op.icon, op.color);
+                break;
+            case DrawOp::Kind::Image:
+                if (op.image) {
+                    DrawThumbnail(hdc, &rect, *op.image);
+                }
+                break;
+            case DrawOp::Kind::Line:
+                DrawLine(hdc, rect.left, rect.top, rect.right, rect.bottom, op.color, op.width);
+                break;
+        }
+        drawn++;
+    }
+    return drawn;
 }
 
 std::string GetTypeIcon(int type) {
@@ -136,5 +234,41 @@ std::string GetTypeIcon(int type) {
     }
 }
 
+GdiTextMeasurer::GdiTextMeasurer() : m_dc(CreateCompatibleDC(nullptr)) {}
+
+GdiTextMeasurer::~GdiTextMeasurer() {
+    if (m_dc) {
+        if (m_oldFont) {
+            SelectObject(m_dc, m_oldFont);
+        }
+        DeleteDC(m_dc);
+    }
+}
+
+void GdiTextMeasurer::SetFonts(HFONT normal, HFONT bold, HFONT smallFont) {
+    // Deselect first: the previous fonts may be deleted after this
+    if (m_dc && m_oldFont) {
+        SelectObject(m_dc, m_oldFont);
+        m_oldFont = nullptr;
+    }
+    m_fonts[static_cast<int>(TextStyle::Normal)] = normal;
+    m_fonts[static_cast<int>(TextStyle::Bold)] = bold;
+    m_fonts[static_cast<int>(TextStyle::Small)] = smallFont;
+}
+
+int GdiTextMeasurer::Measure(TextStyle style, const std::wstring& text) {
+    HFONT font = m_fonts[static_cast<int>(style)];
+    if (!m_dc || !font || text.empty()) {
+        return 0;
+    }
+    HGDIOBJ previous = SelectObject(m_dc, font);
+    if (!m_oldFont) {
+        m_oldFont = previous;
+    }
+    SIZE size = {};
+    GetTextExtentPoint32W(m_dc, text.c_str(), static_cast<int>(text.length()), &size);
+    return size.cx;
+}
+
 } // namespace renderer
 } // namespace clipx
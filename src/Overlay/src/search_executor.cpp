@@ -0,0 +1,67 @@
+#include "search_executor.h"
+#include <chrono>
+
+namespace clipx {
+
+int64_t SearchExecutor::SteadyClockMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+SearchExecutor::SearchExecutor(StartCallback start, Clock clock, int64_t debounceMs)
+    : m_start(std::move(start)), m_clock(std::move(clock)), m_debounceMs(debounceMs) {}
+
+void SearchExecutor::Submit(std::string text) {
+    Queue(std::move(text), m_clock() + m_debounceMs);
+}
+
+void SearchExecutor::SubmitNow(std::string text) {
+    Queue(std::move(text), m_clock());
+    Poll();
+}
+
+void SearchExecutor::Cancel() {
+    m_generation++;
+    m_pending = false;
+    m_pendingText.clear();
+}
+
+void SearchExecutor::Poll() {
+    if (!m_pending || m_running != 0 || m_clock() < m_due) {
+        return;
+    }
+
+    Query query;
+    query.text = std::move(m_pendingText);
+    query.generation = m_generation;
+    m_pending = false;
+    m_pendingText.clear();
+    m_running = query.generation;
+
+    // May re-enter through Finished if the search completes synchronously
+    m_start(query);
+}
+
+void SearchExecutor::Finished(uint64_t generation) {
+    if (generation != m_running) {
+        return;
+    }
+    m_running = 0;
+    Poll();
+}
+
+int64_t SearchExecutor::NextDeadline() const {
+    if (!m_pending || m_running != 0) {
+        return -1;
+    }
+    return m_due;
+}
+
+void SearchExecutor::Queue(std::string text, int64_t due) {
+    m_generation++;
+    m_pending = true;
+    m_pendingText = std::move(text);
+    m_due = due;
+}
+
+} // namespace clipx
@@ -0,0 +1,265 @@
+#include "test.h"
+#include "data_manager.h"
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace clipx;
+
+namespace {
+
+constexpr int64_t BASE_TIME = 1700000000000;
+
+// A fresh in-memory database for one test
+struct Database {
+    Database() {
+        REQUIRE(DataManager::Instance().Initialize(":memory:"));
+        DataManager::Instance().DeleteAll();
+        DataManager::Instance().ClearMemoryEntries();
+    }
+    ~Database() {
+        DataManager::Instance().ClearMemoryEntries();
+        DataManager::Instance().Shutdown();
+    }
+};
+
+ClipboardEntry MakeEntry(int64_t timestamp, const std::string& text, bool stored = true) {
+    ClipboardEntry entry;
+    entry.timestamp = timestamp;
+    entry.type = ClipboardDataType::Text;
+    entry.data.assign(text.begin(), text.end());
+    entry.preview = text;
+    entry.sourceApp = "notepad.exe";
+    entry.isTagged = stored;
+    return entry;
+}
+
+std::vector<int64_t> Timestamps(const std::vector<ClipboardEntry>& entries) {
+    std::vector<int64_t> timestamps;
+    for (const auto& entry : entries) {
+        timestamps.push_back(entry.timestamp);
+    }
+    return timestamps;
+}
+
+} // namespace
+
+TEST(DataManager, PagesCoverTheHistoryOnce) {
+    Database db;
+    auto& data = DataManager::Instance();
+
+    // 120 stored rows and 10 memory entries between them, all distinct times
+    std::vector<int64_t> expected;
+    for (int i = 0; i < 130; i++) {
+        int64_t timestamp = BASE_TIME + i * 1000;
+        bool memory = i % 13 == 5;
+        if (memory) {
+            REQUIRE(data.InsertMemoryOnly(MakeEntry(timestamp, "memory " + std::to_string(i), false)) < 0);
+        } else {
+            REQUIRE(data.Insert(MakeEntry(timestamp, "stored " + std::to_string(i))) > 0);
+        }
+        expected.insert(expected.begin(), timestamp);
+    }
+
+    QueryOptions options;
+    options.limit = 50;
+    std::vector<int64_t> seen;
+    for (int offset : {0, 50, 100, 150}) {
+        options.offset = offset;
+        int64_t total = 0;
+        auto page = data.Query(options, &total);
+        CHECK(total == 130);
+        CHECK(page.size() == static_cast<size_t>(std::max(0, std::min(50, 130 - offset))));
+        auto timestamps = Timestamps(page);
+        seen.insert(seen.end(), timestamps.begin(), timestamps.end());
+    }
+    CHECK(seen == expected);
+
+    // A page wholly inside the stored rows, past the memory entries
+    options.offset = 60;
+    options.limit = 5;
+    CHECK((Timestamps(data.Query(options)) ==
+           std::vector<int64_t>(expected.begin() + 60, expected.begin() + 65)));
+}
+
+TEST(DataManager, TotalFollowsTheFilters) {
+    Database db;
+    auto& data = DataManager::Instance();
+    for (int i = 0; i < 12; i++) {
+        int64_t id = data.Insert(MakeEntry(BASE_TIME + i, "row " + std::to_string(i)));
+        REQUIRE(id > 0);
+        if (i % 4 == 0) {
+            data.SetFavorite(id, true);
+        }
+    }
+    data.InsertMemoryOnly(MakeEntry(BASE_TIME + 100, "memory", false));
+
+    QueryOptions options;
+    options.limit = 2;
+    int64_t total = 0;
+    CHECK(data.Query(options, &total).size() == 2);
+    CHECK(total == 13);
+
+    options.favoritesOnly = true;
+    options.offset = 2;
+    auto page = data.Query(options, &total);
+    CHECK(total == 3);
+    REQUIRE(page.size() == 1);
+    CHECK(page[0].timestamp == BASE_TIME);
+
+    options.favoritesOnly = false;
+    options.filterType = ClipboardDataType::Image;
+    CHECK(data.Query(options, &total).empty());
+    CHECK(total == 0);
+}
+
+TEST(DataManager, CollapsesWithinTheDistance) {
+    Database db;
+    auto& data = DataManager::Instance();
+    const uint64_t fingerprint = 0x0123456789ABCDEFULL;
+
+    ClipboardEntry memory = MakeEntry(BASE_TIME, "memory original", false);
+    memory.simhash = fingerprint;
+    int64_t memoryId = data.InsertMemoryOnly(memory);
+    REQUIRE(memoryId < 0);
+
+    // 3 bits away: too far at distance 2, collapsed at 3
+    ClipboardEntry copy = MakeEntry(BASE_TIME + 10, "memory copy", false);
+    copy.simhash = fingerprint ^ 0x7;
+    CHECK(!data.CollapseNearDuplicate(copy, 2).has_value());
+    CHECK(data.CollapseNearDuplicate(copy, 3) == std::optional<int64_t>(memoryId));
+
+    auto merged = data.GetEntry(memoryId);
+    REQUIRE(merged.has_value());
+    CHECK(merged->preview == "memory copy");
+    CHECK(merged->data == copy.data);
+    CHECK(merged->timestamp == BASE_TIME + 10);
+    CHECK(merged->copyCount == 2);
+
+    // The same for a stored row, which the history then shows once
+    ClipboardEntry stored = MakeEntry(BASE_TIME + 20, "stored original");
+    stored.isTagged = false;
+    stored.simhash = ~fingerprint;
+    int64_t storedId = data.Insert(stored);
+    REQUIRE(storedId > 0);
+    ClipboardEntry storedCopy = MakeEntry(BASE_TIME + 30, "stored copy", false);
+    storedCopy.simhash = ~fingerprint ^ 0x1;
+    CHECK(!data.CollapseNearDuplicate(storedCopy, 0).has_value());
+    CHECK(data.CollapseNearDuplicate(storedCopy, 1) == std::optional<int64_t>(storedId));
+
+    merged = data.GetEntry(storedId);
+    REQUIRE(merged.has_value());
+    CHECK(merged->preview == "stored copy");
+    CHECK(data.GetEntryData(storedId) == storedCopy.data);
+    CHECK(merged->timestamp == BASE_TIME + 30);
+    CHECK(merged->copyCount == 2);
+    CHECK((Timestamps(data.Query(QueryOptions{})) == std::vector<int64_t>{BASE_TIME + 30, BASE_TIME + 10}));
+}
+
+TEST(DataManager, ReCopiesWithNewNumbersCollapse) {
+    Database db;
+    auto& data = DataManager::Instance();
+
+    ClipboardEntry first = MakeEntry(BASE_TIME, "2024-05-01 12:00:01 ERROR [worker-3] request timed out id=48213", false);
+    first.simhash = simhash::Compute(first.data);
+    int64_t id = data.InsertMemoryOnly(first);
+
+    ClipboardEntry again = MakeEntry(BASE_TIME + 1, "2024-05-01 12:00:09 ERROR [worker-5]  request timed out id=48377\n", false);
+    again.simhash = simhash::Compute(again.data);
+    CHECK(data.CollapseNearDuplicate(again, 0) == std::optional<int64_t>(id));
+
+    ClipboardEntry other = MakeEntry(BASE_TIME + 2, "2024-05-01 12:00:12 INFO [worker-3] connection pool resized to 16", false);
+    other.simhash = simhash::Compute(other.data);
+    CHECK(!data.CollapseNearDuplicate(other, 3).has_value());
+    CHECK(data.GetEntry(id)->preview == again.preview);
+}
+
+TEST(DataManager, KeptEntriesAreNeverOverwritten) {
+    Database db;
+    auto& data = DataManager::Instance();
+    const uint64_t fingerprints[] = {0x1111111111111111ULL, 0x2222222222222222ULL, 0x4444444444444444ULL};
+
+    ClipboardEntry favorite = MakeEntry(BASE_TIME, "favorite");
+    favorite.isTagged = false;
+    favorite.simhash = fingerprints[0];
+    int64_t favoriteId = data.Insert(favorite);
+    REQUIRE(data.SetFavorite(favoriteId, true));
+
+    ClipboardEntry tagged = MakeEntry(BASE_TIME + 1, "tagged", false);
+    tagged.simhash = fingerprints[1];
+    int64_t taggedId = data.InsertMemoryOnly(tagged);
+    REQUIRE(data.AddTag(taggedId, "work"));
+
+    ClipboardEntry memory = MakeEntry(BASE_TIME + 2, "favorite in memory", false);
+    memory.isFavorited = true;
+    memory.simhash = fingerprints[2];
+    int64_t memoryId = data.InsertMemoryOnly(memory);
+
+    for (uint64_t fingerprint : fingerprints) {
+        ClipboardEntry copy = MakeEntry(BASE_TIME + 10, "copy", false);
+        copy.simhash = fingerprint;
+        CHECK(!data.CollapseNearDuplicate(copy, 3).has_value());
+    }
+
+    for (int64_t id : {favoriteId, memoryId}) {
+        auto entry = data.GetEntry(id);
+        REQUIRE(entry.has_value());
+        CHECK(entry->preview != "copy");
+        CHECK(entry->copyCount == 1);
+    }
+    auto query = data.Query(QueryOptions{});
+    CHECK(query.size() == 3);
+    for (const auto& entry : query) {
+        CHECK(entry.preview != "copy");
+    }
+}
+
+TEST(DataManager, SqlSearchAgreesWithMemoryMatching) {
+    Database db;
+    auto& data = DataManager::Instance();
+    const int64_t hour = 60 * 60 * 1000;
+
+    const char* const apps[] = {"notepad.exe", "Code.exe", "Windows Terminal", "chrome.exe"};
+    const char* const previews[] = {"meeting notes", "he said \"hi\"", "C:\\path\\file.txt", "100% done",
+                                    "under_score", "plain text"};
+    const std::vector<std::vector<std::string>> tagSets = {
+        {}, {"work"}, {"Work Notes"}, {"say \"hi\"", "work"}, {"back\\slash"}};
+
+    // The same entries as the database holds them, for MatchesSearchQuery
+    std::vector<ClipboardEntry> entries;
+    for (int i = 0; i < 40; i++) {
+        ClipboardEntry entry = MakeEntry(BASE_TIME + i * hour, previews[i % 6]);
+        entry.sourceApp = apps[i % 4];
+        int64_t id = data.Insert(entry);
+        REQUIRE(id > 0);
+        entry.tags = tagSets[i % 5];
+        for (const auto& tag : entry.tags) {
+            REQUIRE(data.AddTag(id, tag));
+        }
+        entries.push_back(entry);
+    }
+
+    const int64_t now = BASE_TIME + 40 * hour;
+    const char* const inputs[] = {
+        "tag:work", "tag:WORK", "tag:\"work notes\"", "tag:\"say \\\"hi\\\"\"", "tag:\"back\\\\slash\"",
+        "tag:wor", "app:code", "app:\"windows terminal\"", "app:EXE", "before:2023-11-15", "after:2023-11-15",
+        "before:12h", "after:12h", "after:2023-11-15 before:30h", "\"said \\\"hi\\\"\"", "\"C:\\path\"", "100%",
+        "_", "notes", "tag:work app:notepad after:1d", "work", "\"Work Notes\" app:terminal"};
+    for (const char* input : inputs) {
+        SearchQuery query = ParseSearchQuery(input, now);
+        std::vector<int64_t> expected;
+        for (const auto& entry : entries) {
+            if (MatchesSearchQuery(query, entry)) expected.push_back(entry.timestamp);
+        }
+        auto found = Timestamps(data.Search(query, 100));
+        std::sort(expected.begin(), expected.end());
+        std::sort(found.begin(), found.end());
+        if (found != expected) {
+            std::printf("  query %s: SQL found %zu entries, memory matching %zu\n", input, found.size(),
+                        expected.size());
+        }
+        CHECK(found == expected);
+        CHECK(!expected.empty() || std::string(input) == "tag:wor");
+    }
+}
@@ -0,0 +1,144 @@
+#include "test.h"
+#include "display_list.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace clipx;
+
+namespace {
+
+constexpr int WIDTH = 400;
+constexpr int BAR_HEIGHT = 48;
+constexpr int ROW_HEIGHT = 40;
+
+DrawRect RowRect(int slot) {
+    int top = BAR_HEIGHT + 4 + slot * (ROW_HEIGHT + 4);
+    return {0, top, WIDTH, top + ROW_HEIGHT};
+}
+
+// A frame laid out like the overlay's: the search bar, then one chunk per
+// row slot with a 4 px gap between them
+DisplayList MakeFrame(const std::vector<std::wstring>& rows, int selected = -1) {
+    DisplayList frame;
+    frame.BeginChunk(1);
+    frame.RoundRect({0, 0, WIDTH, BAR_HEIGHT}, 8, 0xFFFFFF, 0xCCCCCC, 1);
+    frame.Text(L"search", {12, 12, WIDTH - 12, BAR_HEIGHT - 12}, 0, 0x333333, TextStyle::Normal);
+    for (size_t i = 0; i < rows.size(); i++) {
+        int slot = static_cast<int>(i);
+        DrawRect rect = RowRect(slot);
+        frame.BeginChunk(100 + i);
+        frame.Fill(rect, slot == selected ? 0xF0D0C0 : 0xFFFFFF);
+        frame.Icon(rect.left + 8, rect.top + 12, 16, "text", 0x666666);
+        frame.Text(rows[i], {rect.left + 32, rect.top + 4, rect.right - 8, rect.bottom - 4}, 0, 0x000000,
+                   TextStyle::Normal);
+    }
+    return frame;
+}
+
+std::vector<std::wstring> Rows(size_t count) {
+    std::vector<std::wstring> rows;
+    for (size_t i = 0; i < count; i++) {
+        rows.push_back(L"row " + std::to_wstring(i));
+    }
+    return rows;
+}
+
+} // namespace
+
+TEST(DisplayList, IdenticalFrameHasNoDamage) {
+    DisplayList before = MakeFrame(Rows(8), 2);
+    DisplayList after = MakeFrame(Rows(8), 2);
+    CHECK(ComputeDamage(before, after).empty());
+    CHECK(ComputeDamage(before, before).empty());
+
+    DisplayList empty;
+    CHECK(ComputeDamage(empty, empty).empty());
+}
+
+TEST(DisplayList, ChangedRowDamagesOnlyThatRow) {
+    std::vector<std::wstring> rows = Rows(8);
+    DisplayList before = MakeFrame(rows);
+    rows[3] = L"edited";
+    DisplayList after = MakeFrame(rows);
+
+    std::vector<DrawRect> damage = ComputeDamage(before, after);
+    REQUIRE(damage.size() == 1);
+    CHECK(damage[0] == RowRect(3));
+}
+
+TEST(DisplayList, SelectionMoveDamagesBothRows) {
+    DisplayList before = MakeFrame(Rows(8), 1);
+    DisplayList after = MakeFrame(Rows(8), 5);
+
+    std::vector<DrawRect> damage = ComputeDamage(before, after);
+    REQUIRE(damage.size() == 2);
+    bool first = damage[0] == RowRect(1) || damage[1] == RowRect(1);
+    bool second = damage[0] == RowRect(5) || damage[1] == RowRect(5);
+    CHECK(first && second);
+}
+
+TEST(DisplayList, AddedAndRemovedChunksAreDamaged) {
+    DisplayList shorter = MakeFrame(Rows(3));
+    DisplayList longer = MakeFrame(Rows(4));
+
+    std::vector<DrawRect> grown = ComputeDamage(shorter, longer);
+    REQUIRE(grown.size() == 1);
+    CHECK(grown[0] == RowRect(3));
+
+    std::vector<DrawRect> shrunk = ComputeDamage(longer, shorter);
+    REQUIRE(shrunk.size() == 1);
+    CHECK(shrunk[0] == RowRect(3));
+}
+
+TEST(DisplayList, ImagesCompareByIdentity) {
+    auto dib = std::make_shared<const std::vector<uint8_t>>(64, uint8_t{1});
+    auto copy = std::make_shared<const std::vector<uint8_t>>(*dib);
+    DrawRect box = {10, 10, 58, 58};
+
+    DisplayList before;
+    before.BeginChunk(7);
+    before.Image(box, dib);
+    DisplayList same;
+    same.BeginChunk(7);
+    same.Image(box, dib);
+    DisplayList other;
+    other.BeginChunk(7);
+    other.Image(box, copy);
+
+    CHECK(ComputeDamage(before, same).empty());
+    std::vector<DrawRect> damage = ComputeDamage(before, other);
+    REQUIRE(damage.size() == 1);
+    CHECK(damage[0] == box);
+}
+
+TEST(DisplayList, AdjacentDamageMergesAndManyCollapse) {
+    // Round rects reach one pixel past their rect, so these two touch and
+    // merge; rows 4 px apart stay separate
+    DisplayList before;
+    before.BeginChunk(1);
+    before.RoundRect({0, 0, 100, 20}, 4, 0xFFFFFF);
+    before.BeginChunk(2);
+    before.RoundRect({0, 21, 100, 40}, 4, 0xFFFFFF);
+    DisplayList after;
+    after.BeginChunk(1);
+    after.RoundRect({0, 0, 100, 20}, 4, 0x000000);
+    after.BeginChunk(2);
+    after.RoundRect({0, 21, 100, 40}, 4, 0x000000);
+
+    std::vector<DrawRect> merged = ComputeDamage(before, after);
+    REQUIRE(merged.size() == 1);
+    CHECK(merged[0] == (DrawRect{0, 0, 101, 41}));
+
+    // Every row changed, more rects than allowed: one bounding box
+    std::vector<std::wstring> rows = Rows(8);
+    DisplayList a = MakeFrame(rows);
+    for (auto& row : rows) {
+        row += L"!";
+    }
+    DisplayList b = MakeFrame(rows);
+    std::vector<DrawRect> damage = ComputeDamage(a, b, 4);
+    REQUIRE(damage.size() == 1);
+    CHECK(damage[0] == RowRect(0).Union(RowRect(7)));
+    CHECK(ComputeDamage(a, b).size() == 8);
+}
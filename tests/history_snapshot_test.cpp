@@ -0,0 +1,253 @@
+#include "test.h"
+#include "common/history_snapshot.h"
+#include <cstring>
+#include <string>
+#include <vector>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+using namespace clipx;
+
+namespace {
+
+ClipboardEntry MakeEntry(int64_t id, const std::string& preview, std::vector<std::string> tags = {},
+                         size_t thumbnailSize = 0) {
+    ClipboardEntry entry;
+    entry.id = id;
+    entry.timestamp = 1700000000000 + id;
+    entry.type = thumbnailSize ? ClipboardDataType::Image : ClipboardDataType::Text;
+    entry.preview = preview;
+    entry.sourceApp = "notepad.exe";
+    entry.copyCount = static_cast<int32_t>(id % 5 + 1);
+    entry.isFavorited = id % 2 == 0;
+    entry.isTagged = !tags.empty();
+    entry.tags = std::move(tags);
+    for (size_t i = 0; i < thumbnailSize; i++) {
+        entry.thumbnail.push_back(static_cast<uint8_t>(i * 7 + id));
+    }
+    return entry;
+}
+
+HistorySnapshot MakeSnapshot() {
+    HistorySnapshot snapshot;
+    snapshot.changeSeq = 4711;
+    snapshot.entries.push_back(MakeEntry(10, "hello world", {"work", "urgent"}));
+    snapshot.entries.push_back(MakeEntry(9, "", {}, 300));
+    snapshot.entries.push_back(MakeEntry(8, "中文预览 · emoji 😀", {"个人"}));
+    snapshot.entries.push_back(MakeEntry(-3, "memory only entry"));
+    snapshot.tags = {{"work", 3}, {"urgent", 1}, {"个人", 2}, {"", 0}};
+    return snapshot;
+}
+
+void CheckSameEntry(const ClipboardEntry& a, const ClipboardEntry& b, bool withThumbnail = true) {
+    CHECK(a.id == b.id);
+    CHECK(a.timestamp == b.timestamp);
+    CHECK(a.type == b.type);
+    CHECK(a.preview == b.preview);
+    CHECK(a.sourceApp == b.sourceApp);
+    CHECK(a.copyCount == b.copyCount);
+    CHECK(a.isFavorited == b.isFavorited);
+    CHECK(a.isTagged == b.isTagged);
+    CHECK(a.tags == b.tags);
+    CHECK(a.data.empty() && b.data.empty());
+    if (withThumbnail) {
+        CHECK(a.thumbnail == b.thumbnail);
+    }
+}
+
+bool Decode(const std::vector<uint8_t>& buffer, HistorySnapshot& snapshot) {
+    return DecodeHistorySnapshot(buffer.data(), buffer.size(), snapshot);
+}
+
+// Offsets into the encoded payload, see the layout in history_snapshot.cpp
+constexpr size_t ENTRY_COUNT_OFFSET = 8;
+constexpr size_t STRINGS_SIZE_OFFSET = 20;
+constexpr size_t FIRST_ENTRY_OFFSET = 24;
+constexpr size_t ENTRY_FIRST_TAG_OFFSET = 28;
+constexpr size_t ENTRY_PREVIEW_OFFSET = 40;
+
+void PutU32(std::vector<uint8_t>& buffer, size_t offset, uint32_t value) {
+    std::memcpy(buffer.data() + offset, &value, sizeof(value));
+}
+
+} // namespace
+
+TEST(HistorySnapshot, RoundTrip) {
+    HistorySnapshot snapshot = MakeSnapshot();
+    std::vector<uint8_t> buffer;
+    REQUIRE(EncodeHistorySnapshot(snapshot, 1 << 20, buffer) == 4);
+
+    HistorySnapshot decoded;
+    REQUIRE(Decode(buffer, decoded));
+    CHECK(decoded.changeSeq == snapshot.changeSeq);
+    CHECK(decoded.tags == snapshot.tags);
+    REQUIRE(decoded.entries.size() == snapshot.entries.size());
+    for (size_t i = 0; i < snapshot.entries.size(); i++) {
+        CheckSameEntry(decoded.entries[i], snapshot.entries[i]);
+    }
+}
+
+TEST(HistorySnapshot, EmptySnapshot) {
+    HistorySnapshot snapshot;
+    std::vector<uint8_t> buffer;
+    REQUIRE(EncodeHistorySnapshot(snapshot, 1024, buffer) == 0);
+
+    HistorySnapshot decoded = MakeSnapshot();
+    REQUIRE(Decode(buffer, decoded));
+    CHECK(decoded.changeSeq == 0);
+    CHECK(decoded.entries.empty());
+    CHECK(decoded.tags.empty());
+}
+
+TEST(HistorySnapshot, TruncatesEntriesToCapacity) {
+    HistorySnapshot snapshot = MakeSnapshot();
+    for (auto& entry : snapshot.entries) {
+        entry.thumbnail.clear();
+    }
+    std::vector<uint8_t> full;
+    REQUIRE(EncodeHistorySnapshot(snapshot, 1 << 20, full) == 4);
+
+    // Every capacity below the full size keeps a prefix of the entries and
+    // never goes over
+    int previous = 0;
+    for (size_t capacity = 0; capacity <= full.size(); capacity++) {
+        std::vector<uint8_t> buffer;
+        int written = EncodeHistorySnapshot(snapshot, capacity, buffer);
+        if (written < 0) {
+            CHECK(previous == 0);
+            continue;
+        }
+        CHECK(buffer.size() <= capacity);
+        CHECK(written >= previous);
+        previous = written;
+
+        HistorySnapshot decoded;
+        REQUIRE(Decode(buffer, decoded));
+        REQUIRE(decoded.entries.size() == static_cast<size_t>(written));
+        CHECK(decoded.tags == snapshot.tags);
+        for (int i = 0; i < written; i++) {
+            CheckSameEntry(decoded.entries[i], snapshot.entries[i]);
+        }
+    }
+    CHECK(previous == 4);
+}
+
+TEST(HistorySnapshot, RejectsTagsThatDoNotFit) {
+    HistorySnapshot snapshot = MakeSnapshot();
+    std::vector<uint8_t> buffer;
+    CHECK(EncodeHistorySnapshot(snapshot, 32, buffer) == -1);
+}
+
+TEST(HistorySnapshot, DropsThumbnailsBeforeRows) {
+    HistorySnapshot snapshot;
+    snapshot.entries.push_back(MakeEntry(2, "image", {}, 400));
+    snapshot.entries.push_back(MakeEntry(1, "text"));
+    std::vector<uint8_t> full;
+    REQUIRE(EncodeHistorySnapshot(snapshot, 1 << 20, full) == 2);
+
+    // Room for both rows but not the thumbnail: both rows, no thumbnail
+    std::vector<uint8_t> buffer;
+    CHECK(EncodeHistorySnapshot(snapshot, full.size() - 1, buffer) == 2);
+    HistorySnapshot decoded;
+    REQUIRE(Decode(buffer, decoded));
+    REQUIRE(decoded.entries.size() == 2);
+    CHECK(decoded.entries[0].thumbnail.empty());
+    CheckSameEntry(decoded.entries[0], snapshot.entries[0], false);
+    CheckSameEntry(decoded.entries[1], snapshot.entries[1]);
+}
+
+TEST(HistorySnapshot, RejectsTruncatedBuffers) {
+    HistorySnapshot snapshot = MakeSnapshot();
+    std::vector<uint8_t> buffer;
+    REQUIRE(EncodeHistorySnapshot(snapshot, 1 << 20, buffer) == 4);
+
+    for (size_t size = 0; size < buffer.size(); size++) {
+        // A copy of exactly `size` bytes, so reading past it is caught by
+        // sanitizers
+        std::vector<uint8_t> prefix(buffer.begin(), buffer.begin() + size);
+        HistorySnapshot decoded;
+        CHECK(!DecodeHistorySnapshot(prefix.data(), prefix.size(), decoded));
+    }
+
+    std::vector<uint8_t> longer = buffer;
+    longer.push_back(0);
+    HistorySnapshot decoded;
+    CHECK(!Decode(longer, decoded));
+}
+
+TEST(HistorySnapshot, RejectsCorruptCountsAndOffsets) {
+    HistorySnapshot snapshot = MakeSnapshot();
+    std::vector<uint8_t> buffer;
+    REQUIRE(EncodeHistorySnapshot(snapshot, 1 << 20, buffer) == 4);
+    HistorySnapshot decoded;
+
+    std::vector<uint8_t> corrupt = buffer;
+    PutU32(corrupt, ENTRY_COUNT_OFFSET, 5);
+    CHECK(!Decode(corrupt, decoded));
+
+    corrupt = buffer;
+    PutU32(corrupt, STRINGS_SIZE_OFFSET, 0xFFFFFFF0);
+    CHECK(!Decode(corrupt, decoded));
+
+    corrupt = buffer;
+    PutU32(corrupt, FIRST_ENTRY_OFFSET + ENTRY_FIRST_TAG_OFFSET, 1000);
+    CHECK(!Decode(corrupt, decoded));
+
+    corrupt = buffer;
+    PutU32(corrupt, FIRST_ENTRY_OFFSET + ENTRY_PREVIEW_OFFSET, 0x7FFFFFFF);
+    CHECK(!Decode(corrupt, decoded));
+
+    corrupt = buffer;
+    PutU32(corrupt, FIRST_ENTRY_OFFSET + ENTRY_PREVIEW_OFFSET + 4, 0x10000);
+    CHECK(!Decode(corrupt, decoded));
+}
+
+TEST(HistorySnapshot, SurvivesEveryBitFlip) {
+    HistorySnapshot snapshot = MakeSnapshot();
+    std::vector<uint8_t> buffer;
+    REQUIRE(EncodeHistorySnapshot(snapshot, 1 << 20, buffer) == 4);
+
+    // Flips in the string pool only change text; anywhere else the decoder
+    // must either reject the buffer or produce strings that stay inside it
+    int rejected = 0;
+    for (size_t bit = 0; bit < buffer.size() * 8; bit++) {
+        std::vector<uint8_t> flipped = buffer;
+        flipped[bit / 8] ^= static_cast<uint8_t>(1u << (bit % 8));
+        HistorySnapshot decoded;
+        if (!Decode(flipped, decoded)) {
+            rejected++;
+            continue;
+        }
+        CHECK(decoded.entries.size() <= snapshot.entries.size());
+        for (const auto& entry : decoded.entries) {
+            CHECK(entry.preview.size() < flipped.size());
+            CHECK(entry.sourceApp.size() < flipped.size());
+            CHECK(entry.thumbnail.size() < flipped.size());
+            CHECK(entry.tags.size() <= 3);
+        }
+    }
+    CHECK(rejected > 0);
+}
+
+#ifndef _WIN32
+TEST(HistorySnapshot, PublishAndRead) {
+    const std::string name = "/clipx_test_snapshot_" + std::to_string(::getpid());
+    HistorySnapshotWriter writer;
+    REQUIRE(writer.Create(name));
+
+    HistorySnapshot decoded;
+    CHECK(!ReadHistorySnapshot(name, decoded));  // Nothing published yet
+
+    HistorySnapshot snapshot = MakeSnapshot();
+    for (int round = 0; round < 3; round++) {
+        snapshot.changeSeq++;
+        snapshot.entries.push_back(MakeEntry(100 + round, "round " + std::to_string(round)));
+        REQUIRE(writer.Publish(snapshot));
+        REQUIRE(ReadHistorySnapshot(name, decoded));
+        CHECK(decoded.changeSeq == snapshot.changeSeq);
+        REQUIRE(decoded.entries.size() == snapshot.entries.size());
+        CheckSameEntry(decoded.entries.back(), snapshot.entries.back());
+    }
+}
+#endif
@@ -0,0 +1,198 @@
+#include "test.h"
+#include "instant_search.h"
+#include "search_executor.h"
+#include <string>
+#include <vector>
+
+using namespace clipx;
+
+namespace {
+
+constexpr int64_t NOW = 1700000000000;
+constexpr int64_t HOUR = 3600 * 1000;
+
+UIEntry MakeEntry(int64_t id, int64_t timestamp, std::string preview, std::vector<std::string> tags = {},
+                  std::string app = "notepad.exe") {
+    UIEntry entry{};
+    entry.id = id;
+    entry.timestamp = timestamp;
+    entry.preview = std::move(preview);
+    entry.sourceApp = std::move(app);
+    entry.type = ClipboardDataType::Text;
+    entry.copyCount = 1;
+    entry.tags = std::move(tags);
+    return entry;
+}
+
+std::vector<int64_t> Ids(const std::vector<UIEntry>& rows) {
+    std::vector<int64_t> ids;
+    for (const auto& row : rows) {
+        ids.push_back(row.id);
+    }
+    return ids;
+}
+
+// Ten rows an hour apart, newest first; id 10 is the newest
+std::vector<UIEntry> History() {
+    std::vector<UIEntry> rows;
+    for (int64_t id = 10; id >= 1; id--) {
+        std::string preview = (id % 2 ? "odd report " : "even notes ") + std::to_string(id);
+        rows.push_back(MakeEntry(id, NOW - (10 - id) * HOUR, preview, id % 3 == 0 ? std::vector<std::string>{"Work"}
+                                                                                   : std::vector<std::string>{}));
+    }
+    return rows;
+}
+
+} // namespace
+
+TEST(InstantSearch, LocalMatcherFollowsTheQuerySyntax) {
+    UIEntry entry = MakeEntry(1, NOW - 2 * HOUR, "Quarterly Report draft", {"Work", "q3"}, "WINWORD.EXE");
+    auto matches = [&](const std::string& input) { return LocalMatcher(input, NOW).Matches(entry); };
+
+    CHECK(matches(""));
+    CHECK(matches("report"));
+    CHECK(matches("QUARTERLY draft"));
+    CHECK(!matches("report missing"));
+    CHECK(matches("q3"));  // Free text also matches tags
+    CHECK(matches("tag:work"));
+    CHECK(!matches("tag:wor"));  // Tags match exactly
+    CHECK(matches("app:winword"));
+    CHECK(!matches("app:excel"));
+    CHECK(matches("type:text"));
+    CHECK(!matches("type:image"));
+    CHECK(!matches("fav"));
+    CHECK(matches("after:3h"));
+    CHECK(!matches("after:1h"));
+    CHECK(matches("before:1h"));
+
+    entry.isFavorited = true;
+    CHECK(matches("fav report"));
+}
+
+TEST(InstantSearch, BeginFiltersKnownRows) {
+    InstantSearch search;
+    search.AddKnown(History());
+    CHECK(search.KnownCount() == 10);
+
+    CHECK((Ids(search.Begin("odd", NOW)) == std::vector<int64_t>{9, 7, 5, 3, 1}));
+    CHECK((Ids(search.Begin("tag:work", NOW)) == std::vector<int64_t>{9, 6, 3}));
+    CHECK(search.Begin("nothing like it", NOW).empty());
+
+    // Known rows replaced by id keep one copy, newest first
+    search.AddKnown({MakeEntry(4, NOW - 6 * HOUR, "renamed odd")});
+    CHECK(search.KnownCount() == 10);
+    CHECK((Ids(search.Begin("odd", NOW)) == std::vector<int64_t>{9, 7, 5, 4, 3, 1}));
+}
+
+TEST(InstantSearch, LocalMatchesAreCapped) {
+    InstantSearch search;
+    std::vector<UIEntry> rows;
+    for (int64_t id = 1; id <= 500; id++) {
+        rows.push_back(MakeEntry(id, NOW + id, "same"));
+    }
+    search.AddKnown(rows);
+    const auto& shown = search.Begin("same", NOW);
+    REQUIRE(shown.size() == InstantSearch::MAX_MATCHES);
+    CHECK(shown.front().id == 500);
+}
+
+TEST(InstantSearch, MergeDedupsAndKeepsOrder) {
+    std::vector<UIEntry> local = {MakeEntry(9, 900, "a"), MakeEntry(7, 700, "a"), MakeEntry(5, 500, "a"),
+                                  MakeEntry(3, 300, "a"), MakeEntry(1, 100, "a")};
+
+    // The server has reached 600: its rows first, then local ones older
+    // than that it hasn't looked at yet; 9 it skipped no longer matches
+    std::vector<UIEntry> server = {MakeEntry(8, 800, "a"), MakeEntry(7, 700, "a"), MakeEntry(6, 600, "a")};
+    CHECK((Ids(MergeSearchResults(server, local, false)) == std::vector<int64_t>{8, 7, 6, 5, 3, 1}));
+
+    // A local row on the server's last timestamp may still come
+    std::vector<UIEntry> tie = {MakeEntry(8, 800, "a"), MakeEntry(6, 500, "a")};
+    CHECK((Ids(MergeSearchResults(tie, local, false)) == std::vector<int64_t>{8, 6, 5, 3, 1}));
+
+    // Done: only what the server found
+    CHECK((Ids(MergeSearchResults(server, local, true)) == std::vector<int64_t>{8, 7, 6}));
+
+    // Nothing yet: the local matches as they are
+    CHECK((Ids(MergeSearchResults({}, local, false)) == Ids(local)));
+}
+
+TEST(InstantSearch, ServerBatchesCorrectTheLocalRows) {
+    InstantSearch search;
+    search.AddKnown(History());
+    CHECK((Ids(search.Begin("odd", NOW)) == std::vector<int64_t>{9, 7, 5, 3, 1}));
+
+    // First batch: 11 is new to us, 9 is confirmed; 7 is newer than the
+    // server's last row and was skipped, so it goes
+    std::vector<UIEntry> first = {MakeEntry(11, NOW + HOUR, "odd 11"), MakeEntry(9, NOW - HOUR, "odd report 9"),
+                                  MakeEntry(6, NOW - 4 * HOUR, "odd 6")};
+    CHECK((Ids(search.AddResults(first, false)) == std::vector<int64_t>{11, 9, 6, 5, 3, 1}));
+
+    std::vector<UIEntry> second = {MakeEntry(3, NOW - 7 * HOUR, "odd report 3")};
+    CHECK((Ids(search.AddResults(second, true)) == std::vector<int64_t>{11, 9, 6, 3}));
+}
+
+TEST(InstantSearch, ChangesReachEveryList) {
+    InstantSearch search;
+    search.AddKnown(History());
+    search.Begin("odd", NOW);
+    search.AddResults({MakeEntry(9, NOW - HOUR, "odd report 9")}, false);
+
+    search.Update(7, [](UIEntry& entry) { entry.isFavorited = true; });
+    search.Remove([](const UIEntry& entry) { return entry.id == 9 || entry.id == 5; });
+    const auto& shown = search.AddResults({}, false);
+    CHECK((Ids(shown) == std::vector<int64_t>{7, 3, 1}));
+    CHECK(search.KnownCount() == 8);
+
+    const auto& again = search.Begin("fav", NOW);
+    REQUIRE(again.size() == 1);
+    CHECK(again[0].id == 7);
+}
+
+TEST(InstantSearch, StaleResultsAfterTheQueryChangedAreDropped) {
+    // Wired as the overlay does: batches are merged only while the
+    // executor still wants the generation they were started for
+    int64_t now = 0;
+    std::vector<SearchExecutor::Query> started;
+    SearchExecutor executor([&](const SearchExecutor::Query& query) { started.push_back(query); },
+                            [&] { return now; });
+    InstantSearch search;
+    search.AddKnown(History());
+    std::vector<UIEntry> shown;
+    auto type = [&](const std::string& text) {
+        executor.Submit(text);
+        shown = search.Begin(text, NOW);
+    };
+    auto deliver = [&](uint64_t generation, const std::vector<UIEntry>& rows, bool done) {
+        if (executor.IsCurrent(generation)) {
+            shown = search.AddResults(rows, done);
+        }
+        if (done) {
+            executor.Finished(generation);
+        }
+    };
+
+    type("odd");
+    now += SearchExecutor::DEBOUNCE_MS;
+    executor.Poll();
+    REQUIRE(started.size() == 1);
+
+    type("even");
+    CHECK((Ids(shown) == std::vector<int64_t>{10, 8, 6, 4, 2}));
+
+    // "odd" answers late: the list keeps showing "even"
+    deliver(started[0].generation, {MakeEntry(9, NOW - HOUR, "odd report 9")}, false);
+    deliver(started[0].generation, {MakeEntry(1, NOW - 9 * HOUR, "odd report 1")}, true);
+    CHECK((Ids(shown) == std::vector<int64_t>{10, 8, 6, 4, 2}));
+
+    now += SearchExecutor::DEBOUNCE_MS;
+    executor.Poll();
+    REQUIRE(started.size() == 2);
+    CHECK(started[1].text == "even");
+    deliver(started[1].generation, {MakeEntry(10, NOW, "even notes 10"), MakeEntry(4, NOW - 6 * HOUR, "even notes 4")},
+            true);
+    CHECK((Ids(shown) == std::vector<int64_t>{10, 4}));
+
+    // A new query starts from its own local matches, not earlier results
+    type("odd");
+    CHECK((Ids(shown) == std::vector<int64_t>{9, 7, 5, 3, 1}));
+}
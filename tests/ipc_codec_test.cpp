@@ -0,0 +1,275 @@
+#include "test.h"
+#include "common/ipc_codec.h"
+#include "common/ipc_transport.h"
+#include "common/msgpack.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+using namespace clipx;
+
+namespace {
+
+// Both ends of an in-memory pipe: what is written can be read back
+class LoopbackConnection : public IPCConnection {
+public:
+    std::vector<uint8_t> bytes;
+    size_t readPos = 0;
+
+    bool WaitReadable(int) override { return readPos < bytes.size(); }
+    void Close() override { m_open = false; }
+
+protected:
+    bool ReadExact(uint8_t* buffer, size_t size, int) override {
+        if (bytes.size() - readPos < size) return false;
+        std::memcpy(buffer, bytes.data() + readPos, size);
+        readPos += size;
+        return true;
+    }
+    bool WriteAll(const uint8_t* data, size_t size, int) override {
+        bytes.insert(bytes.end(), data, data + size);
+        return true;
+    }
+    ptrdiff_t ReadSome(uint8_t* buffer, size_t size) override {
+        size = std::min(size, bytes.size() - readPos);
+        std::memcpy(buffer, bytes.data() + readPos, size);
+        readPos += size;
+        return static_cast<ptrdiff_t>(size);
+    }
+};
+
+nlohmann::json RoundTrip(const nlohmann::json& params) {
+    IPCRequest request;
+    request.action = "test";
+    request.requestId = 7;
+    request.params = params;
+
+    std::vector<uint8_t> bytes;
+    EncodeRequest(request, IPCCodec::MsgPack, bytes);
+    IPCRequest decoded;
+    REQUIRE(DecodeRequest(bytes.data(), bytes.size(), IPCCodec::MsgPack, decoded));
+    CHECK(decoded.action == "test");
+    CHECK(decoded.requestId == 7);
+    return decoded.params;
+}
+
+std::vector<uint8_t> Written(void (*write)(MsgPackWriter&)) {
+    std::vector<uint8_t> bytes;
+    MsgPackWriter writer(bytes);
+    write(writer);
+    return bytes;
+}
+
+} // namespace
+
+TEST(IPCCodec, NestedMapsRoundTrip) {
+    nlohmann::json params = {
+        {"query", "tag:work"},
+        {"options", {{"limit", 50}, {"offset", 0}, {"favorites", true}, {"filter", nullptr},
+                     {"nested", {{"deeper", {{"values", {1, 2.5, "three", false}}}}}}}},
+        {"empty", nlohmann::json::object()},
+        {"list", nlohmann::json::array()},
+        {"unicode", u8"\u4e2d\u6587 caf\u00e9"},
+    };
+    CHECK(RoundTrip(params) == params);
+}
+
+TEST(IPCCodec, NegativeIntegersUseTheSmallestEncoding) {
+    // Value, first byte, encoded size
+    const struct {
+        int64_t value;
+        uint8_t marker;
+        size_t size;
+    } cases[] = {
+        {-1, 0xFF, 1},
+        {-32, 0xE0, 1},
+        {-33, 0xD0, 2},
+        {-128, 0xD0, 2},
+        {-129, 0xD1, 3},
+        {-32768, 0xD1, 3},
+        {-32769, 0xD2, 5},
+        {std::numeric_limits<int32_t>::min(), 0xD2, 5},
+        {static_cast<int64_t>(std::numeric_limits<int32_t>::min()) - 1, 0xD3, 9},
+        {std::numeric_limits<int64_t>::min(), 0xD3, 9},
+    };
+    for (const auto& c : cases) {
+        std::vector<uint8_t> bytes;
+        MsgPackWriter writer(bytes);
+        writer.Int(c.value);
+        REQUIRE(bytes.size() == c.size);
+        CHECK(bytes[0] == c.marker);
+
+        MsgPackReader reader(bytes.data(), bytes.size());
+        CHECK(reader.PeekType() == MsgPackReader::Type::Int);
+        int64_t value = 0;
+        CHECK(reader.ReadInt(value));
+        CHECK(value == c.value);
+        CHECK(reader.AtEnd());
+
+        uint64_t unsignedValue = 0;
+        MsgPackReader unsignedReader(bytes.data(), bytes.size());
+        CHECK(!unsignedReader.ReadUInt(unsignedValue));
+    }
+
+    nlohmann::json params = {{"ints", {-1, -32, -33, -129, -32769, -2147483649LL, std::numeric_limits<int64_t>::min()}}};
+    CHECK(RoundTrip(params) == params);
+
+    // Beyond int64 stays unsigned
+    nlohmann::json big = {{"max", std::numeric_limits<uint64_t>::max()}};
+    CHECK(RoundTrip(big) == big);
+}
+
+TEST(IPCCodec, BinaryRoundTrips) {
+    for (size_t size : {size_t(0), size_t(255), size_t(256), size_t(65535), size_t(65536)}) {
+        std::vector<uint8_t> blob(size);
+        for (size_t i = 0; i < size; i++) blob[i] = static_cast<uint8_t>(i * 31);
+
+        nlohmann::json params = {{"blob", nlohmann::json::binary(blob)}};
+        nlohmann::json decoded = RoundTrip(params);
+        REQUIRE(decoded["blob"].is_binary());
+        CHECK(static_cast<const std::vector<uint8_t>&>(decoded["blob"].get_binary()) == blob);
+    }
+
+    // Entry thumbnails travel as binary inside typed entry lists
+    IPCResponse response;
+    response.requestId = 3;
+    response.success = true;
+    response.data = {{"total", 1}};
+    ClipboardEntry entry;
+    entry.id = -4;
+    entry.timestamp = 1700000000000;
+    entry.type = ClipboardDataType::Image;
+    entry.preview = "[Image]";
+    entry.tags = {"screenshots"};
+    entry.thumbnail.assign(70000, 0xAB);
+    response.entries = std::vector<ClipboardEntry>{entry};
+
+    std::vector<uint8_t> bytes;
+    EncodeResponse(response, IPCCodec::MsgPack, bytes);
+    IPCServerMessage message;
+    REQUIRE(DecodeServerMessage(bytes.data(), bytes.size(), IPCCodec::MsgPack, message));
+    REQUIRE(!message.isNotification);
+    CHECK(message.response.requestId == 3);
+    CHECK(message.response.data["total"] == 1);
+    REQUIRE(message.response.entries.has_value());
+    REQUIRE(message.response.entries->size() == 1);
+    const ClipboardEntry& decoded = message.response.entries->front();
+    CHECK(decoded.id == -4);
+    CHECK(decoded.timestamp == entry.timestamp);
+    CHECK(decoded.type == ClipboardDataType::Image);
+    CHECK(decoded.tags == entry.tags);
+    CHECK(decoded.thumbnail == entry.thumbnail);
+}
+
+TEST(IPCCodec, ThirtyTwoBitLengths) {
+    // Past 65535 strings, binaries, arrays and maps switch to 32-bit lengths
+    auto string32 = Written([](MsgPackWriter& w) { w.String(std::string(65536, 's')); });
+    CHECK(string32[0] == 0xDB);
+    auto binary32 = Written([](MsgPackWriter& w) {
+        std::vector<uint8_t> blob(65536);
+        w.Binary(blob.data(), blob.size());
+    });
+    CHECK(binary32[0] == 0xC6);
+    CHECK(Written([](MsgPackWriter& w) { w.ArrayHeader(65536); })[0] == 0xDD);
+    CHECK(Written([](MsgPackWriter& w) { w.MapHeader(65536); })[0] == 0xDF);
+    CHECK(Written([](MsgPackWriter& w) { w.ArrayHeader(65535); })[0] == 0xDC);
+    CHECK(Written([](MsgPackWriter& w) { w.MapHeader(65535); })[0] == 0xDE);
+
+    nlohmann::json params = {{"text", std::string(70000, 'x')}, {"list", nlohmann::json::array()},
+                             {"map", nlohmann::json::object()}};
+    for (int i = 0; i < 70000; i++) {
+        params["list"].push_back(i - 35000);
+        if (i % 2 == 0) params["map"]["k" + std::to_string(i)] = i;
+    }
+    CHECK(RoundTrip(params) == params);
+}
+
+TEST(IPCCodec, TruncatedInputIsRejected) {
+    IPCRequest request;
+    request.action = "search";
+    request.requestId = 12;
+    request.params = {{"query", std::string(300, 'q')}, {"ids", {1, -2, 3}}};
+    std::vector<uint8_t> bytes;
+    EncodeRequest(request, IPCCodec::MsgPack, bytes);
+
+    for (size_t size = 0; size < bytes.size(); size++) {
+        IPCRequest decoded;
+        CHECK(!DecodeRequest(bytes.data(), size, IPCCodec::MsgPack, decoded));
+    }
+
+    // A failed read leaves the position where it was
+    auto string32 = Written([](MsgPackWriter& w) { w.String(std::string(65536, 's')); });
+    MsgPackReader reader(string32.data(), string32.size() - 1);
+    std::string value;
+    CHECK(!reader.ReadString(value));
+    CHECK(reader.Position() == 0);
+}
+
+TEST(IPCCodec, MagicSelectsTheCodec) {
+    CHECK(MagicForCodec(IPCCodec::Json) == IPC_MAGIC);
+    CHECK(MagicForCodec(IPCCodec::MsgPack) == IPC_MAGIC_MSGPACK);
+
+    IPCCodec codec = IPCCodec::MsgPack;
+    CHECK(CodecForMagic(IPC_MAGIC, codec));
+    CHECK(codec == IPCCodec::Json);
+    CHECK(CodecForMagic(IPC_MAGIC_MSGPACK, codec));
+    CHECK(codec == IPCCodec::MsgPack);
+    for (uint32_t magic : {0u, 0x58494C43u, 0x434C4943u, IPC_MAGIC ^ 0x01000000u}) {
+        codec = IPCCodec::MsgPack;
+        CHECK(!CodecForMagic(magic, codec));
+    }
+
+    IPCCodec named;
+    CHECK(CodecFromName("json", named) && named == IPCCodec::Json);
+    CHECK(CodecFromName("msgpack", named) && named == IPCCodec::MsgPack);
+    CHECK(!CodecFromName("MessagePack", named));
+    CHECK(std::string(CodecName(IPCCodec::MsgPack)) == "msgpack");
+}
+
+TEST(IPCCodec, FramesCarryTheirCodec) {
+    IPCRequest request;
+    request.action = "get_history";
+    request.requestId = 5;
+    request.params = {{"limit", 10}};
+
+    // Each frame is read back in the codec its header names, whatever the
+    // previous frame used
+    LoopbackConnection connection;
+    for (IPCCodec codec : {IPCCodec::MsgPack, IPCCodec::Json, IPCCodec::MsgPack}) {
+        std::vector<uint8_t> payload;
+        EncodeRequest(request, codec, payload);
+        REQUIRE(connection.WriteMessage(payload, codec));
+    }
+
+    IPCHeader header;
+    std::memcpy(&header, connection.bytes.data(), sizeof(header));
+    CHECK(header.magic == IPC_MAGIC_MSGPACK);
+
+    std::vector<uint8_t> payload;
+    IPCCodec codec = IPCCodec::Json;
+    REQUIRE(connection.ReadMessage(payload, codec));
+    CHECK(codec == IPCCodec::MsgPack);
+    REQUIRE(connection.ReadMessage(payload, codec));
+    CHECK(codec == IPCCodec::Json);
+    CHECK(payload.front() == '{');
+
+    std::vector<uint8_t> frame;
+    size_t filled = 0;
+    CHECK(connection.ReadAvailable(frame, filled, codec) == IPCReadResult::Message);
+    CHECK(codec == IPCCodec::MsgPack);
+    IPCRequest decoded;
+    REQUIRE(DecodeRequest(frame.data() + IPC_FRAME_HEADER_SIZE, frame.size() - IPC_FRAME_HEADER_SIZE, codec, decoded));
+    CHECK(decoded.action == "get_history");
+    CHECK(decoded.GetHistoryParams().limit == 10);
+
+    // An unknown magic fails the read instead of being guessed at
+    LoopbackConnection bad;
+    IPCHeader badHeader{0x58494C43u, 2};
+    bad.bytes.assign(reinterpret_cast<uint8_t*>(&badHeader), reinterpret_cast<uint8_t*>(&badHeader) + sizeof(badHeader));
+    bad.bytes.push_back('{');
+    bad.bytes.push_back('}');
+    CHECK(!bad.ReadMessage(payload, codec));
+}
@@ -0,0 +1,117 @@
+#include "test.h"
+#include "ipc_server.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace clipx;
+
+namespace {
+
+std::vector<uint8_t> RequestFrame(const std::string& action, int32_t requestId) {
+    IPCRequest request;
+    request.action = action;
+    request.requestId = requestId;
+    std::vector<uint8_t> frame(IPC_FRAME_HEADER_SIZE);
+    EncodeRequest(request, IPCCodec::Json, frame);
+
+    IPCHeader header{IPC_MAGIC, static_cast<uint32_t>(frame.size() - IPC_FRAME_HEADER_SIZE)};
+    std::memcpy(frame.data(), &header, sizeof(header));
+    return frame;
+}
+
+// A server counting the requests it dispatches, each answered at once
+struct CountingServer {
+    std::string path = "/tmp/clipx-test-" + std::to_string(::getpid()) + "-server.sock";
+    IPCServer server;
+    std::atomic<int> dispatched{0};
+
+    explicit CountingServer(size_t workers) {
+        server.SetRequestHandler([this](const IPCRequest& request, const std::shared_ptr<IPCSession>&) {
+            dispatched++;
+            return IPCResponse::Success(request.requestId, {{"action", request.action}});
+        });
+        IPCServerOptions options;
+        options.workerCount = workers;
+        REQUIRE(server.Start(path, options));
+    }
+    ~CountingServer() {
+        server.Stop();
+        ::unlink(path.c_str());
+    }
+
+    // A raw client socket, so frames can be sent in pieces
+    int Connect() const {
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+        int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        REQUIRE(fd >= 0);
+        REQUIRE(::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+        return fd;
+    }
+};
+
+IPCResponse ReadResponse(IPCConnection& connection, int timeoutMs) {
+    std::vector<uint8_t> payload;
+    IPCCodec codec;
+    REQUIRE(connection.ReadMessage(payload, codec, timeoutMs));
+    IPCServerMessage message;
+    REQUIRE(DecodeServerMessage(payload.data(), payload.size(), codec, message));
+    REQUIRE(!message.isNotification);
+    return message.response;
+}
+
+} // namespace
+
+TEST(IPCServer, FrameSentByteByByteIsDispatchedOnce) {
+    CountingServer server(2);
+    int fd = server.Connect();
+    auto client = AdoptIPCSocket(fd);
+
+    std::vector<uint8_t> frame = RequestFrame("get_history", 42);
+    for (uint8_t byte : frame) {
+        REQUIRE(::send(fd, &byte, 1, 0) == 1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    IPCResponse response = ReadResponse(*client, 2000);
+    CHECK(response.requestId == 42);
+    CHECK(response.data["action"] == "get_history");
+
+    // Nothing else is dispatched or answered
+    CHECK(!client->WaitReadable(100));
+    CHECK(server.dispatched == 1);
+}
+
+TEST(IPCServer, StalledClientDoesNotHoldAWorker) {
+    CountingServer server(1);
+
+    // Half a frame, then silence
+    int stalled = server.Connect();
+    auto stalledClient = AdoptIPCSocket(stalled);
+    std::vector<uint8_t> slow = RequestFrame("search", 1);
+    size_t half = slow.size() / 2;
+    REQUIRE(::send(stalled, slow.data(), half, 0) == static_cast<ssize_t>(half));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    // The only worker still answers another client right away
+    auto other = ConnectIPC(server.path, 1000);
+    REQUIRE(other != nullptr);
+    std::vector<uint8_t> ping = RequestFrame("ping", 2);
+    REQUIRE(other->WriteMessage(std::vector<uint8_t>(ping.begin() + IPC_FRAME_HEADER_SIZE, ping.end()), IPCCodec::Json));
+    auto start = std::chrono::steady_clock::now();
+    CHECK(ReadResponse(*other, 1000).requestId == 2);
+    CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(500));
+
+    // The stalled frame completes where it left off
+    REQUIRE(::send(stalled, slow.data() + half, slow.size() - half, 0) == static_cast<ssize_t>(slow.size() - half));
+    CHECK(ReadResponse(*stalledClient, 2000).requestId == 1);
+    CHECK(server.dispatched == 2);
+}
@@ -0,0 +1,166 @@
+#include "test.h"
+#include "common/ipc_codec.h"
+#include "common/ipc_transport.h"
+#include <cstring>
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace clipx;
+
+namespace {
+
+std::vector<uint8_t> RequestFrame(const std::string& action, int32_t requestId) {
+    IPCRequest request;
+    request.action = action;
+    request.requestId = requestId;
+    request.params = {{"limit", 20}};
+    std::vector<uint8_t> frame(IPC_FRAME_HEADER_SIZE);
+    EncodeRequest(request, IPCCodec::Json, frame);
+
+    IPCHeader header{IPC_MAGIC, static_cast<uint32_t>(frame.size() - IPC_FRAME_HEADER_SIZE)};
+    std::memcpy(frame.data(), &header, sizeof(header));
+    return frame;
+}
+
+std::string SocketPath(const char* name) {
+    return "/tmp/clipx-test-" + std::to_string(::getpid()) + "-" + name + ".sock";
+}
+
+bool PathExists(const std::string& path) {
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0;
+}
+
+} // namespace
+
+TEST(IPCTransport, FrameSentByteByByteIsReadOnce) {
+    int fds[2];
+    REQUIRE(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) == 0);
+    auto server = AdoptIPCSocket(fds[0]);
+    int client = fds[1];
+
+    std::vector<uint8_t> frame = RequestFrame("get_history", 9);
+    std::vector<uint8_t> buffer;
+    size_t filled = 0;
+    IPCCodec codec = IPCCodec::MsgPack;
+    int messages = 0;
+
+    CHECK(server->ReadAvailable(buffer, filled, codec) == IPCReadResult::Pending);
+    for (size_t i = 0; i < frame.size(); i++) {
+        REQUIRE(::send(client, &frame[i], 1, 0) == 1);
+        IPCReadResult result = server->ReadAvailable(buffer, filled, codec);
+        if (i + 1 < frame.size()) {
+            CHECK(result == IPCReadResult::Pending);
+            CHECK(filled == i + 1);
+        } else {
+            CHECK(result == IPCReadResult::Message);
+            messages += result == IPCReadResult::Message;
+        }
+    }
+    CHECK(messages == 1);
+    CHECK(codec == IPCCodec::Json);
+    CHECK(buffer == frame);
+
+    IPCRequest request;
+    REQUIRE(DecodeRequest(buffer.data() + IPC_FRAME_HEADER_SIZE, buffer.size() - IPC_FRAME_HEADER_SIZE, codec, request));
+    CHECK(request.action == "get_history");
+    CHECK(request.requestId == 9);
+
+    // Nothing more is made of the same bytes
+    filled = 0;
+    CHECK(server->ReadAvailable(buffer, filled, codec) == IPCReadResult::Pending);
+    CHECK(filled == 0);
+
+    // Two whole frames and part of a third, sent at once
+    std::vector<uint8_t> burst;
+    for (int32_t id : {10, 11, 12}) {
+        std::vector<uint8_t> next = RequestFrame("ping", id);
+        burst.insert(burst.end(), next.begin(), next.end());
+    }
+    size_t partial = burst.size() - 5;
+    REQUIRE(::send(client, burst.data(), partial, 0) == static_cast<ssize_t>(partial));
+    for (int32_t id : {10, 11}) {
+        filled = 0;
+        REQUIRE(server->ReadAvailable(buffer, filled, codec) == IPCReadResult::Message);
+        REQUIRE(DecodeRequest(buffer.data() + IPC_FRAME_HEADER_SIZE, buffer.size() - IPC_FRAME_HEADER_SIZE, codec,
+                              request));
+        CHECK(request.requestId == id);
+    }
+    filled = 0;
+    CHECK(server->ReadAvailable(buffer, filled, codec) == IPCReadResult::Pending);
+    REQUIRE(::send(client, burst.data() + partial, 5, 0) == 5);
+    CHECK(server->ReadAvailable(buffer, filled, codec) == IPCReadResult::Message);
+
+    // A hang-up mid-frame fails the read
+    REQUIRE(::send(client, frame.data(), 3, 0) == 3);
+    ::close(client);
+    filled = 0;
+    CHECK(server->ReadAvailable(buffer, filled, codec) == IPCReadResult::Failed);
+}
+
+TEST(IPCTransport, BadHeaderFailsWithoutWaitingForPayload) {
+    int fds[2];
+    REQUIRE(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) == 0);
+    auto server = AdoptIPCSocket(fds[0]);
+    auto client = AdoptIPCSocket(fds[1]);
+
+    IPCHeader header{IPC_MAGIC, IPC_MAX_PAYLOAD_SIZE + 1};
+    REQUIRE(::send(fds[1], &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)));
+    std::vector<uint8_t> buffer;
+    size_t filled = 0;
+    IPCCodec codec;
+    CHECK(server->ReadAvailable(buffer, filled, codec) == IPCReadResult::Failed);
+    CHECK(buffer.size() <= IPC_FRAME_HEADER_SIZE);
+}
+
+TEST(IPCTransport, StaleSocketFileIsReplaced) {
+    const std::string path = SocketPath("stale");
+    ::unlink(path.c_str());
+
+    // Left behind by a server that exited without removing it
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    REQUIRE(::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+    ::close(fd);
+    REQUIRE(PathExists(path));
+
+    auto listener = CreateIPCListener();
+    REQUIRE(listener->Listen(path, 4));
+    auto client = ConnectIPC(path, 1000);
+    CHECK(client != nullptr);
+    listener->Close();
+    ::unlink(path.c_str());
+}
+
+TEST(IPCTransport, LiveServerKeepsItsAddress) {
+    const std::string path = SocketPath("live");
+    ::unlink(path.c_str());
+
+    auto first = CreateIPCListener();
+    REQUIRE(first->Listen(path, 4));
+
+    // The probe connects to the live server, so the second one backs off
+    auto second = CreateIPCListener();
+    CHECK(!second->Listen(path, 4));
+    CHECK(PathExists(path));
+
+    // And the first still takes new clients
+    auto client = ConnectIPC(path, 1000);
+    REQUIRE(client != nullptr);
+    std::vector<std::shared_ptr<IPCConnection>> accepted;
+    std::vector<std::shared_ptr<IPCConnection>> readable;
+    for (int i = 0; i < 20 && accepted.size() < 2; i++) {
+        REQUIRE(first->Wait(50, accepted, readable));
+    }
+    CHECK(accepted.size() == 2);  // The probe and the client
+
+    first->Close();
+    second->Close();
+    ::unlink(path.c_str());
+}
@@ -0,0 +1,257 @@
+#include "test.h"
+#include "list_model.h"
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <vector>
+
+using namespace clipx;
+
+namespace {
+
+// A history of `size` rows, newest first; row i has id size - i
+class FakeHistory {
+public:
+    explicit FakeHistory(size_t size) : m_size(size) {}
+
+    void Attach(VirtualListModel& model) {
+        model.SetFetchCallback([this](const ListPageRequest& request) { m_requests.push_back(request); });
+    }
+
+    std::vector<UIEntry> Page(size_t offset, size_t limit) const {
+        std::vector<UIEntry> rows;
+        for (size_t i = offset; i < m_size && i < offset + limit; i++) {
+            rows.push_back(Row(i));
+        }
+        return rows;
+    }
+
+    UIEntry Row(size_t index) const {
+        UIEntry entry{};
+        entry.id = static_cast<int64_t>(m_size - index);
+        entry.preview = "row " + std::to_string(index);
+        entry.type = ClipboardDataType::Text;
+        return entry;
+    }
+
+    // Answers every queued request, including those the answers cause
+    void Serve(VirtualListModel& model, int64_t version = 0) {
+        while (!m_requests.empty()) {
+            ListPageRequest request = m_requests.front();
+            m_requests.pop_front();
+            model.PageLoaded(request, Page(request.offset, request.limit), version);
+        }
+    }
+
+    std::deque<ListPageRequest>& Requests() { return m_requests; }
+
+private:
+    size_t m_size;
+    std::deque<ListPageRequest> m_requests;
+};
+
+bool ViewportLoaded(const VirtualListModel& model, const FakeHistory& history) {
+    for (size_t i = model.First(); i < model.First() + model.Visible() && i < model.Count(); i++) {
+        const UIEntry* row = model.Row(i);
+        if (!row || row->id != history.Row(i).id) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+TEST(ListModel, WindowStaysBoundedAcross100kRows) {
+    const size_t total = 100000;
+    FakeHistory history(total);
+    VirtualListModel model;
+    history.Attach(model);
+    model.Reset(history.Page(0, 50), false);
+    model.SetViewport(0, 12);
+    history.Serve(model);
+
+    size_t maxLoaded = 0;
+    while (model.First() + model.Visible() < model.Count() || !model.IsComplete()) {
+        model.ScrollBy(37);
+        history.Serve(model);
+        maxLoaded = std::max(maxLoaded, model.LoadedRows());
+        REQUIRE(ViewportLoaded(model, history));
+    }
+    CHECK(model.IsComplete());
+    CHECK(model.Count() == total);
+    CHECK(model.Row(total - 1) && model.Row(total - 1)->id == 1);
+    CHECK(maxLoaded <= 300);
+    CHECK(maxLoaded > 100);
+
+    // And back up again
+    while (model.First() > 0) {
+        model.ScrollBy(-41);
+        history.Serve(model);
+        REQUIRE(model.LoadedRows() <= 300);
+        REQUIRE(ViewportLoaded(model, history));
+    }
+}
+
+TEST(ListModel, EvictsRowsBehindTheViewport) {
+    FakeHistory history(5000);
+    VirtualListModel model;
+    history.Attach(model);
+    model.Reset(history.Page(0, 50), false);
+    model.SetViewport(0, 10);
+    history.Serve(model);
+    CHECK(model.Row(0) != nullptr);
+
+    for (int i = 0; i < 60; i++) {
+        model.ScrollBy(20);
+        history.Serve(model);
+    }
+    CHECK(model.First() == 1200);
+    CHECK(model.Row(0) == nullptr);
+    CHECK(model.Row(500) == nullptr);
+    CHECK(model.LoadedRows() <= 300);
+    CHECK(ViewportLoaded(model, history));
+
+    // A jump back to the top fetches it again
+    model.SetViewport(0, 10);
+    CHECK(model.Row(0) == nullptr || model.Row(0)->id == 5000);
+    history.Serve(model);
+    CHECK(ViewportLoaded(model, history));
+    CHECK(model.Row(0) && model.Row(0)->id == 5000);
+}
+
+TEST(ListModel, ShortPageCompletesTheList) {
+    FakeHistory history(120);
+    VirtualListModel model;
+    history.Attach(model);
+    model.Reset(history.Page(0, 50), false);
+    model.SetViewport(0, 10);
+    history.Serve(model);
+    CHECK(!model.IsComplete());
+
+    model.SetViewport(100, 10);
+    history.Serve(model);
+    CHECK(model.IsComplete());
+    CHECK(model.Count() == 120);
+    CHECK(ViewportLoaded(model, history));
+}
+
+TEST(ListModel, ReportedTotalSizesTheScrollRange) {
+    FakeHistory history(5000);
+    VirtualListModel model;
+    history.Attach(model);
+    model.Reset(history.Page(0, 50), false);
+    model.SetTotal(5000);
+    CHECK(model.IsComplete());
+    CHECK(model.Count() == 5000);
+
+    // A jump to the end is fetched right away, not grown into page by page
+    model.SetViewport(4990, 10);
+    CHECK(model.First() == 4990);
+    history.Serve(model);
+    CHECK(ViewportLoaded(model, history));
+
+    // A total below the loaded rows drops those past it
+    model.SetTotal(4995);
+    CHECK(model.Count() == 4995);
+    CHECK(model.Row(4996) == nullptr);
+    CHECK(model.First() == 4985);
+}
+
+TEST(ListModel, DropsPagesOfAnEarlierList) {
+    FakeHistory history(1000);
+    VirtualListModel model;
+    history.Attach(model);
+    model.Reset(history.Page(0, 50), false);
+    model.SetViewport(0, 10);
+    REQUIRE(!history.Requests().empty());
+    ListPageRequest stale = history.Requests().front();
+    history.Requests().clear();
+
+    // A new list (another search) arrives before the page
+    FakeHistory other(10);
+    model.Reset(other.Page(0, 10), true);
+    CHECK(!model.PageLoaded(stale, history.Page(stale.offset, stale.limit), 0));
+    CHECK(model.Count() == 10);
+    CHECK(model.Row(0)->id == 10);
+}
+
+TEST(ListModel, DropsPagesThatWereNotAskedFor) {
+    FakeHistory history(1000);
+    VirtualListModel model;
+    history.Attach(model);
+    model.Reset(history.Page(0, 50), false);
+    model.SetViewport(0, 10);
+    REQUIRE(!history.Requests().empty());
+    ListPageRequest request = history.Requests().front();
+    history.Serve(model);
+
+    // Answered twice: the second copy is ignored
+    CHECK(!model.PageLoaded(request, history.Page(request.offset, request.limit), 0));
+}
+
+TEST(ListModel, RefetchesPagesReadAtAnotherVersion) {
+    FakeHistory history(1000);
+    VirtualListModel model;
+    history.Attach(model);
+    model.Reset(history.Page(0, 50), false, 10);
+    model.SetViewport(0, 10);
+    REQUIRE(history.Requests().size() == 1);
+
+    // Read before an edit the model already has: asked again right away
+    ListPageRequest request = history.Requests().front();
+    history.Requests().clear();
+    CHECK(!model.PageLoaded(request, history.Page(request.offset, request.limit), 9));
+    REQUIRE(history.Requests().size() == 1);
+    CHECK(model.LoadedRows() == 50);
+
+    // Read after an edit the model has yet to see: asked again once it has
+    request = history.Requests().front();
+    history.Requests().clear();
+    CHECK(!model.PageLoaded(request, history.Page(request.offset, request.limit), 11));
+    CHECK(history.Requests().empty());
+    model.SetVersion(11);
+    REQUIRE(history.Requests().size() == 1);
+
+    history.Serve(model, 11);
+    CHECK(model.LoadedRows() > 50);
+    CHECK(ViewportLoaded(model, history));
+}
+
+TEST(ListModel, FailedPageIsRequestedOnTheNextMove) {
+    FakeHistory history(1000);
+    VirtualListModel model;
+    history.Attach(model);
+    model.Reset(history.Page(0, 50), false);
+    model.SetViewport(0, 10);
+    REQUIRE(history.Requests().size() == 1);
+    ListPageRequest request = history.Requests().front();
+    history.Requests().clear();
+
+    model.PageFailed(request);
+    CHECK(history.Requests().empty());
+    model.ScrollBy(1);
+    CHECK(history.Requests().size() == 1);
+}
+
+TEST(ListModel, SelectionFollowsItsEntryAcrossEdits) {
+    FakeHistory history(100);
+    VirtualListModel model;
+    model.Reset(history.Page(0, 100), true);
+    model.SetViewport(0, 10);
+    model.Select(5);
+    const int64_t selectedId = model.SelectedRow()->id;
+
+    UIEntry fresh = history.Row(0);
+    fresh.id = 1000;
+    model.Upsert(fresh);
+    CHECK(model.Count() == 101);
+    CHECK(model.Row(0)->id == 1000);
+    CHECK(model.SelectedRow()->id == selectedId);
+    CHECK(model.Selected() == 6);
+
+    model.Remove([](const UIEntry& entry) { return entry.id == 1000; });
+    CHECK(model.Count() == 100);
+    CHECK(model.SelectedRow()->id == selectedId);
+    CHECK(model.Selected() == 5);
+}
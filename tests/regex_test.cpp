@@ -0,0 +1,138 @@
+#include "test.h"
+#include "common/regex.h"
+#include "common/utils.h"
+#include <string>
+#include <vector>
+
+using namespace clipx;
+
+namespace {
+
+bool Matches(const std::string& pattern, const std::string& text, bool ignoreCase = false) {
+    auto regex = Regex::Compile(pattern, ignoreCase);
+    REQUIRE(regex != nullptr);
+    return regex->Search(text);
+}
+
+bool HasLiteral(const std::string& pattern, const std::string& literal) {
+    auto regex = Regex::Compile(pattern);
+    REQUIRE(regex != nullptr);
+    for (const auto& required : regex->RequiredLiterals()) {
+        if (required == literal) return true;
+    }
+    return false;
+}
+
+} // namespace
+
+TEST(Regex, AnchorsMatchAtLineBoundaries) {
+    CHECK(Matches("^abc", "abc def"));
+    CHECK(!Matches("^abc", "xabc"));
+    CHECK(Matches("def$", "abc def"));
+    CHECK(!Matches("def$", "abc defx"));
+    CHECK(Matches("^def$", "abc\ndef\nghi"));
+    CHECK(Matches("^$", ""));
+    CHECK(Matches("\\bcat\\b", "a cat sat"));
+    CHECK(!Matches("\\bcat\\b", "concatenate"));
+    CHECK(Matches("\\Bcat\\B", "concatenate"));
+}
+
+TEST(Regex, ClassesAndEscapes) {
+    CHECK(Matches("[a-c]x", "bx"));
+    CHECK(!Matches("[a-c]x", "dx"));
+    CHECK(Matches("[^a-c]x", "dx"));
+    CHECK(!Matches("^[^a-c]x", "ax"));
+    CHECK(Matches("^\\d{3}-\\d{4}$", "555-1234"));
+    CHECK(!Matches("^\\d{3}-\\d{4}$", "555-123"));
+    CHECK(Matches("^\\w+\\s\\W$", "word_1 !"));
+    CHECK(Matches("a.c", "abc"));
+    CHECK(!Matches("a.c", "a\nc"));
+    CHECK(Matches("^caf.$", u8"caf\u00e9"));  // . is one code point, not one byte
+}
+
+TEST(Regex, AlternationAndRepetition) {
+    CHECK(Matches("^(cat|dog)s?$", "dogs"));
+    CHECK(Matches("^(cat|dog)s?$", "cat"));
+    CHECK(!Matches("^(cat|dog)s?$", "cow"));
+    CHECK(Matches("^(?:ab){2,3}$", "ababab"));
+    CHECK(!Matches("^(?:ab){2,3}$", "ab"));
+    CHECK(!Matches("^(?:ab){2,3}$", "abababab"));
+    CHECK(Matches("^a*?b+?$", "aabb"));
+    CHECK(Matches("x|^$", ""));
+}
+
+TEST(Regex, CaseInsensitiveMode) {
+    CHECK(!Matches("error", "ERROR: disk full"));
+    CHECK(Matches("error", "ERROR: disk full", true));
+    CHECK(Matches("(?i)error", "ERROR: disk full"));
+    CHECK(Matches("(?i)[a-c]+$", "xABC"));
+    CHECK(Matches("[A-C]+$", "xabc", true));
+}
+
+TEST(Regex, InvalidPatternsReportAnError) {
+    for (const char* pattern : {"(abc", "abc)", "[abc", "*a", "a{3,2}"}) {
+        std::string error;
+        CHECK(Regex::Compile(pattern, false, &error) == nullptr);
+        CHECK(!error.empty());
+    }
+}
+
+TEST(Regex, NestedQuantifiersRunInLinearTime) {
+    // A backtracking engine takes 2^n steps on "aaa...ab" with (a+)+$
+    auto regex = Regex::Compile("(a+)+$");
+    REQUIRE(regex != nullptr);
+
+    std::string text(100000, 'a');
+    text += 'b';
+    auto start = Regex::Clock::now();
+    CHECK(regex->Search(text.data(), text.size(), start + std::chrono::seconds(10)) == Regex::Result::NoMatch);
+
+    // Four times the input, not much more than four times the work
+    auto shortStart = Regex::Clock::now();
+    CHECK(regex->Search(text.data() + 75000, text.size() - 75000) == Regex::Result::NoMatch);
+    auto shortTime = Regex::Clock::now() - shortStart;
+    auto longStart = Regex::Clock::now();
+    CHECK(regex->Search(text.data(), text.size()) == Regex::Result::NoMatch);
+    auto longTime = Regex::Clock::now() - longStart;
+    CHECK(longTime < shortTime * 16 + std::chrono::milliseconds(50));
+}
+
+TEST(Regex, DeadlineStopsTheSearch) {
+    auto regex = Regex::Compile("(a|aa)*c");
+    REQUIRE(regex != nullptr);
+    std::string text(1000000, 'a');
+    CHECK(regex->Search(text.data(), text.size(), Regex::Clock::now()) == Regex::Result::Timeout);
+}
+
+TEST(Regex, RequiredLiteralsOccurInEveryMatch) {
+    CHECK(HasLiteral("hello\\d+world", "hello"));
+    CHECK(HasLiteral("hello\\d+world", "world"));
+    CHECK(HasLiteral("(?i)Error: \\w+", "error: "));
+    CHECK(HasLiteral("(abc|abd)", "ab"));
+
+    // Parts only some matches contain are never required
+    CHECK(!HasLiteral("(cat|dog)food", "cat"));
+    CHECK(!HasLiteral("colou?r", "colour"));
+    CHECK(!HasLiteral("ab*c", "abc"));
+    CHECK(Regex::Compile("(x|y)")->RequiredLiterals().empty());
+
+    // Every text that matches holds every literal, case-insensitively
+    const char* const patterns[] = {"hello\\d+world", "(cat|dog)food", "colou?r", "ab*c", "(?i)Error: \\w+",
+                                    "x{3}y", "[Hh]ello there", "foo(bar)+", "(abc|abd)", "(?:ab){2,}", "a?b?c?"};
+    const char* const texts[] = {"hello42world", "HELLO1WORLD", "catfood", "dogfood", "color", "colour", "ac",
+                                 "abbbc", "error: disk", "ERROR: x", "xxxy", "Hello there", "hello there",
+                                 "foobarbar", "abd", "abab", "", "zzz"};
+    for (const char* pattern : patterns) {
+        for (bool ignoreCase : {false, true}) {
+            auto regex = Regex::Compile(pattern, ignoreCase);
+            REQUIRE(regex != nullptr);
+            for (const char* text : texts) {
+                if (!regex->Search(text)) continue;
+                std::string lower = utils::ToLower(text);
+                for (const auto& literal : regex->RequiredLiterals()) {
+                    CHECK(lower.find(literal) != std::string::npos);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,159 @@
+#include "test.h"
+#include "render_cache.h"
+#include <string>
+#include <vector>
+
+using namespace clipx;
+
+namespace {
+
+// Stable widths without a window system: every character is 7 pixels (8
+// in bold, 5 small); counts the calls
+class FakeTextMeasurer : public TextMeasurer {
+public:
+    int Measure(TextStyle style, const std::wstring& text) override {
+        calls++;
+        int perChar = style == TextStyle::Bold ? 8 : style == TextStyle::Small ? 5 : 7;
+        return static_cast<int>(text.size()) * perChar;
+    }
+
+    int calls = 0;
+};
+
+UIEntry MakeEntry(int64_t id, std::vector<std::string> tags) {
+    UIEntry entry{};
+    entry.id = id;
+    entry.preview = "entry " + std::to_string(id);
+    entry.sourceApp = "code.exe";
+    entry.timestamp = 1700000000000;
+    entry.type = ClipboardDataType::Text;
+    entry.copyCount = 1;
+    entry.tags = std::move(tags);
+    return entry;
+}
+
+} // namespace
+
+TEST(RenderCache, LaysOutRowText) {
+    FakeTextMeasurer measurer;
+    RenderCache cache(measurer);
+
+    const EntryLayout& layout = cache.Entry(MakeEntry(1, {"a", "bb", "ccc", "dddd", "eeeee"}));
+    CHECK(layout.preview == L"entry 1");
+    CHECK(layout.secondary.rfind(L"code.exe \u00b7 ", 0) == 0);
+
+    // Last tags first, at most ROW_TAGS, the rest counted in "+N"
+    REQUIRE(layout.tags.size() == RenderCache::ROW_TAGS);
+    CHECK(layout.tags[0].text == L"eeeee");
+    CHECK(layout.tags[0].width == 5 * 5 + 2 * RenderCache::ROW_TAG_PADDING);
+    CHECK(layout.tags[2].text == L"ccc");
+    CHECK(layout.more.text == L"+2");
+    CHECK(layout.more.width == 2 * 5 + 2 * RenderCache::ROW_TAG_PADDING);
+
+    const EntryLayout& plain = cache.Entry(MakeEntry(2, {}));
+    CHECK(plain.tags.empty());
+    CHECK(plain.more.width == 0);
+}
+
+TEST(RenderCache, HitsDoNoMeasuring) {
+    FakeTextMeasurer measurer;
+    RenderCache cache(measurer);
+    std::vector<UIEntry> rows;
+    for (int64_t id = 1; id <= 20; id++) {
+        rows.push_back(MakeEntry(id, {"work", "tag" + std::to_string(id)}));
+    }
+
+    for (const auto& row : rows) {
+        cache.Entry(row);
+    }
+    const int firstPaint = measurer.calls;
+    CHECK(firstPaint == 40);
+
+    // Repaints, and copies of the rows as the list model hands them out
+    for (int repaint = 0; repaint < 5; repaint++) {
+        for (UIEntry row : rows) {
+            cache.Entry(row);
+        }
+    }
+    CHECK(measurer.calls == firstPaint);
+    CHECK(cache.Size() == rows.size());
+}
+
+TEST(RenderCache, ChangedRowIsLaidOutAlone) {
+    FakeTextMeasurer measurer;
+    RenderCache cache(measurer);
+    UIEntry a = MakeEntry(1, {"x"});
+    UIEntry b = MakeEntry(2, {"y"});
+    UIEntry c = MakeEntry(3, {"z"});
+    cache.Entry(a);
+    cache.Entry(b);
+    cache.Entry(c);
+    int before = measurer.calls;
+
+    b.tags.push_back("new");
+    CHECK(cache.Entry(b).tags.size() == 2);
+    CHECK(cache.Entry(a).tags[0].text == L"x");
+    CHECK(cache.Entry(c).tags[0].text == L"z");
+    CHECK(measurer.calls == before + 2);
+
+    // Fields the row doesn't show don't change its fingerprint
+    before = measurer.calls;
+    a.copyCount = 9;
+    a.isFavorited = true;
+    cache.Entry(a);
+    CHECK(measurer.calls == before);
+
+    // A new preview is converted again
+    b.preview = "edited";
+    CHECK(cache.Entry(b).preview == L"edited");
+}
+
+TEST(RenderCache, EvictsBeyondMaxEntries) {
+    FakeTextMeasurer measurer;
+    RenderCache cache(measurer);
+    for (int64_t id = 1; id <= static_cast<int64_t>(RenderCache::MAX_ENTRIES); id++) {
+        cache.Entry(MakeEntry(id, {"t"}));
+    }
+    CHECK(cache.Size() == RenderCache::MAX_ENTRIES);
+
+    cache.Entry(MakeEntry(100000, {"t"}));
+    CHECK(cache.Size() < RenderCache::MAX_ENTRIES);
+
+    // An evicted row is measured again
+    int before = measurer.calls;
+    cache.Entry(MakeEntry(1, {"t"}));
+    CHECK(measurer.calls == before + 1);
+}
+
+TEST(RenderCache, InvalidateDropsEverything) {
+    FakeTextMeasurer measurer;
+    RenderCache cache(measurer);
+    UIEntry row = MakeEntry(1, {"t"});
+    cache.Entry(row);
+    cache.Invalidate();
+    CHECK(cache.Size() == 0);
+
+    int before = measurer.calls;
+    cache.Entry(row);
+    CHECK(measurer.calls == before + 1);
+}
+
+TEST(RenderCache, TagPanelIsMeasuredOncePerTagList) {
+    FakeTextMeasurer measurer;
+    RenderCache cache(measurer);
+    std::vector<std::pair<std::string, int>> tags = {{"work", 3}, {u8"\u4e2a\u4eba", 12}};
+
+    const TagPanelLayout& panel = cache.TagPanel(tags);
+    REQUIRE(panel.tags.size() == 2);
+    CHECK(panel.all.text == L"All");
+    CHECK(panel.tags[0].text == L"work (3)");
+    CHECK(panel.tags[1].text == L"\u4e2a\u4eba (12)");
+    int measured = measurer.calls;
+
+    cache.TagPanel(tags);
+    CHECK(measurer.calls == measured);
+
+    tags[0].second = 4;
+    CHECK(cache.TagPanel(tags).tags[0].text == L"work (4)");
+    CHECK(measurer.calls > measured);
+}
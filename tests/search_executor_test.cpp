@@ -0,0 +1,162 @@
+#include "test.h"
+#include "search_executor.h"
+#include <string>
+#include <vector>
+
+using namespace clipx;
+
+namespace {
+
+// An executor on a clock the test moves by hand; started queries are
+// recorded instead of sent anywhere
+struct Harness {
+    int64_t now = 1000;
+    std::vector<SearchExecutor::Query> started;
+    SearchExecutor executor{[this](const SearchExecutor::Query& query) { started.push_back(query); },
+                            [this] { return now; }};
+
+    void Advance(int64_t ms) {
+        now += ms;
+        executor.Poll();
+    }
+};
+
+} // namespace
+
+TEST(SearchExecutor, TypedQueryWaitsForTheDebounce) {
+    Harness h;
+    h.executor.Submit("abc");
+    CHECK(h.executor.HasPending());
+    CHECK(h.executor.NextDeadline() == 1000 + SearchExecutor::DEBOUNCE_MS);
+
+    h.Advance(SearchExecutor::DEBOUNCE_MS - 1);
+    CHECK(h.started.empty());
+
+    h.Advance(1);
+    REQUIRE(h.started.size() == 1);
+    CHECK(h.started[0].text == "abc");
+    CHECK(h.executor.IsRunning());
+    CHECK(!h.executor.HasPending());
+    CHECK(h.executor.NextDeadline() == -1);
+}
+
+TEST(SearchExecutor, KeystrokesRestartTheDebounce) {
+    Harness h;
+    const char* typed[] = {"h", "he", "hel", "hell", "hello"};
+    for (const char* text : typed) {
+        h.executor.Submit(text);
+        h.Advance(100);
+    }
+    CHECK(h.started.empty());
+
+    // Only the last edit is searched, a full debounce after it
+    h.Advance(SearchExecutor::DEBOUNCE_MS - 100 - 1);
+    CHECK(h.started.empty());
+    h.Advance(1);
+    REQUIRE(h.started.size() == 1);
+    CHECK(h.started[0].text == "hello");
+}
+
+TEST(SearchExecutor, SubmitNowSkipsTheDebounce) {
+    Harness h;
+    h.executor.Submit("typed");
+    h.executor.SubmitNow("tag:work");
+    REQUIRE(h.started.size() == 1);
+    CHECK(h.started[0].text == "tag:work");
+    h.Advance(SearchExecutor::DEBOUNCE_MS);
+    CHECK(h.started.size() == 1);
+}
+
+TEST(SearchExecutor, QueriesBehindARunningOneCoalesce) {
+    Harness h;
+    h.executor.SubmitNow("a");
+    REQUIRE(h.started.size() == 1);
+    const uint64_t first = h.started[0].generation;
+
+    // Three more while "a" runs: none starts, the deadline is not armed
+    h.executor.Submit("ab");
+    h.Advance(SearchExecutor::DEBOUNCE_MS);
+    h.executor.Submit("abc");
+    h.executor.SubmitNow("abcd");
+    h.Advance(SearchExecutor::DEBOUNCE_MS);
+    CHECK(h.started.size() == 1);
+    CHECK(h.executor.HasPending());
+    CHECK(h.executor.NextDeadline() == -1);
+
+    // Latest wins: "a" finishing starts only "abcd"
+    h.executor.Finished(first);
+    REQUIRE(h.started.size() == 2);
+    CHECK(h.started[1].text == "abcd");
+    CHECK(!h.executor.HasPending());
+}
+
+TEST(SearchExecutor, QueuedQueryStillWaitsItsDebounce) {
+    Harness h;
+    h.executor.SubmitNow("a");
+    h.executor.Submit("ab");
+    h.executor.Finished(h.started[0].generation);
+    CHECK(h.started.size() == 1);
+    CHECK(h.executor.NextDeadline() == 1000 + SearchExecutor::DEBOUNCE_MS);
+
+    h.Advance(SearchExecutor::DEBOUNCE_MS);
+    REQUIRE(h.started.size() == 2);
+    CHECK(h.started[1].text == "ab");
+}
+
+TEST(SearchExecutor, SupersededResultsAreNotCurrent) {
+    Harness h;
+    h.executor.SubmitNow("old");
+    const uint64_t old = h.started[0].generation;
+    CHECK(h.executor.IsCurrent(old));
+
+    h.executor.Submit("new");
+    CHECK(!h.executor.IsCurrent(old));  // Its results are dropped when they come
+    h.executor.Finished(old);
+    h.Advance(SearchExecutor::DEBOUNCE_MS);
+    REQUIRE(h.started.size() == 2);
+    const uint64_t fresh = h.started[1].generation;
+    CHECK(fresh > old);
+    CHECK(h.executor.IsCurrent(fresh));
+
+    // A late or duplicate completion of the old one frees nothing
+    h.executor.Submit("newer");
+    h.executor.Finished(old);
+    CHECK(h.executor.IsRunning());
+    h.Advance(SearchExecutor::DEBOUNCE_MS);
+    CHECK(h.started.size() == 2);
+    h.executor.Finished(fresh);
+    CHECK(h.started.size() == 3);
+}
+
+TEST(SearchExecutor, CancelDropsPendingAndRunningResults) {
+    Harness h;
+    h.executor.SubmitNow("running");
+    const uint64_t running = h.started[0].generation;
+    h.executor.Submit("pending");
+    h.executor.Cancel();
+
+    CHECK(!h.executor.HasPending());
+    CHECK(!h.executor.IsCurrent(running));
+    h.executor.Finished(running);
+    h.Advance(SearchExecutor::DEBOUNCE_MS);
+    CHECK(h.started.size() == 1);
+    CHECK(!h.executor.IsRunning());
+}
+
+TEST(SearchExecutor, SynchronousCompletionStartsTheNext) {
+    int64_t now = 0;
+    std::vector<std::string> started;
+    SearchExecutor* self = nullptr;
+    SearchExecutor executor(
+        [&](const SearchExecutor::Query& query) {
+            started.push_back(query.text);
+            self->Finished(query.generation);
+        },
+        [&] { return now; });
+    self = &executor;
+
+    executor.SubmitNow("a");
+    executor.SubmitNow("b");
+    CHECK((started == std::vector<std::string>{"a", "b"}));
+    CHECK(!executor.IsRunning());
+}
@@ -0,0 +1,33 @@
+#include "test.h"
+#include "common/search_query.h"
+#include <string>
+#include <vector>
+
+using namespace clipx;
+
+TEST(SearchQuery, QuotedValuesTakeEscapes) {
+    auto query = ParseSearchQuery(R"(tag:"work notes" app:"say \"hi\"" "C:\dir\\" plain\"x)");
+    CHECK((query.tags == std::vector<std::string>{"work notes"}));
+    CHECK((query.apps == std::vector<std::string>{"say \"hi\""}));
+    // Backslashes outside quotes, or not before a quote or backslash, are literal
+    CHECK((query.terms == std::vector<std::string>{"C:\\dir\\", "plain\\x"}));
+
+    // An unterminated quote runs to the end of the input
+    CHECK((ParseSearchQuery("tag:\"open \\\"end").tags == std::vector<std::string>{"open \"end"}));
+}
+
+TEST(SearchQuery, FormattedFiltersParseBack) {
+    const std::string values[] = {"work", "work notes", "", "a:b", "say \"hi\"", "\"", "back\\slash x", "end\\"};
+    for (const auto& value : values) {
+        auto query = ParseSearchQuery(FormatQueryFilter("tag", value));
+        if (value.empty()) {
+            CHECK(query.tags.empty());  // An empty tag is not a filter
+            continue;
+        }
+        REQUIRE(query.tags.size() == 1);
+        CHECK(query.tags[0] == value);
+        CHECK(query.terms.empty());
+    }
+    CHECK(FormatQueryFilter("tag", "work") == "tag:work");
+    CHECK(FormatQueryFilter("tag", "say \"hi\"") == R"(tag:"say \"hi\"")");
+}
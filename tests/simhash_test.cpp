@@ -0,0 +1,64 @@
+#include "test.h"
+#include "common/simhash.h"
+#include <string>
+
+using namespace clipx;
+
+namespace {
+
+uint64_t Fingerprint(const std::string& text) {
+    return simhash::Compute(text.data(), text.size());
+}
+
+const std::string LOG_LINE = "2024-05-01 12:00:01 ERROR [worker-3] request timed out after 30000 ms id=48213";
+
+} // namespace
+
+TEST(SimHash, WhitespaceAndDigitsAreIgnored) {
+    std::string otherTime = LOG_LINE;
+    otherTime[18] = '2';
+    const std::string copies[] = {LOG_LINE + "\n", "  " + LOG_LINE + "\t", "2024-05-01  12:00:01 ERROR\n[worker-3]"
+                                  " request timed out after 30000 ms id=48213", otherTime,
+                                  "2025-11-30 23:59:59 ERROR [worker-9] request timed out after 15000 ms id=70000"};
+    for (const auto& copy : copies) {
+        CHECK(Fingerprint(copy) == Fingerprint(LOG_LINE));
+    }
+}
+
+TEST(SimHash, WordsAndCaseAreKept) {
+    std::string otherCase = LOG_LINE;
+    otherCase[20] = 'e';
+    std::string otherWord = LOG_LINE;
+    otherWord.replace(otherWord.find("request"), 7, "reply");
+
+    // Nearly equal, so the distance decides whether they collapse
+    for (const auto& edit : {otherCase, otherWord, LOG_LINE + " again"}) {
+        int distance = simhash::Distance(Fingerprint(edit), Fingerprint(LOG_LINE));
+        CHECK(distance > 0);
+        CHECK(distance < 16);
+    }
+
+    const std::string unrelated = "Traceback (most recent call last): File \"/srv/app/main.py\", line 12";
+    CHECK(simhash::Distance(Fingerprint(unrelated), Fingerprint(LOG_LINE)) > 16);
+}
+
+TEST(SimHash, ShortTextsHaveNoFingerprint) {
+    CHECK(Fingerprint(std::string(simhash::MIN_TEXT_LENGTH - 1, 'x')) == 0);
+    CHECK(Fingerprint("   " + std::string(simhash::MIN_TEXT_LENGTH - 1, 'x') + "   ") == 0);
+    CHECK(Fingerprint(std::string(simhash::MIN_TEXT_LENGTH, 'x')) != 0);
+}
+
+TEST(SimHash, IndexFindsNearestWithinDistance) {
+    SimHashIndex index;
+    const uint64_t base = 0x0123456789ABCDEFULL;
+    index.Add(1, base);
+    index.Add(2, base ^ 0x7);         // 3 bits away
+    index.Add(3, ~base);
+
+    CHECK(index.FindNearest(base, 3) == std::optional<int64_t>(1));
+    CHECK(index.FindNearest(base, 3, 1) == std::optional<int64_t>(2));
+    CHECK(!index.FindNearest(base ^ 0xF0F0, 3, 1).has_value());
+    index.Remove(1);
+    CHECK(index.FindNearest(base ^ 0x1, 3) == std::optional<int64_t>(2));
+    CHECK(index.Size() == 2);
+}
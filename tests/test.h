@@ -0,0 +1,61 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// A minimal test registry, so the tests build with nothing but the
+// compiler on every platform.
+//
+//   TEST(Suite, Name) {
+//       CHECK(a == b);    // Records a failure and carries on
+//       REQUIRE(ok);      // Records a failure and ends the test
+//   }
+//
+// `tests [Suite]` runs every test, or those of one suite; ctest runs each
+// suite as its own test.
+
+namespace clipx {
+namespace test {
+
+struct TestCase {
+    const char* suite;
+    const char* name;
+    void (*run)();
+};
+
+std::vector<TestCase>& Registry();
+
+struct Registrar {
+    Registrar(const char* suite, const char* name, void (*run)()) {
+        Registry().push_back({suite, name, run});
+    }
+};
+
+// Thrown by REQUIRE to leave the test
+struct Abort {};
+
+void Fail(const char* file, int line, const std::string& message);
+
+} // namespace test
+} // namespace clipx
+
+#define CLIPX_TEST_NAME(suite, name) suite##_##name##_Test
+
+#define TEST(suite, name)                                                              \
+    static void CLIPX_TEST_NAME(suite, name)();                                        \
+    static clipx::test::Registrar CLIPX_TEST_NAME(suite, name##_registrar)(            \
+        #suite, #name, CLIPX_TEST_NAME(suite, name));                                  \
+    static void CLIPX_TEST_NAME(suite, name)()
+
+#define CHECK(expr)                                                                    \
+    do {                                                                               \
+        if (!(expr)) clipx::test::Fail(__FILE__, __LINE__, "CHECK(" #expr ")");        \
+    } while (0)
+
+#define REQUIRE(expr)                                                                  \
+    do {                                                                               \
+        if (!(expr)) {                                                                 \
+            clipx::test::Fail(__FILE__, __LINE__, "REQUIRE(" #expr ")");               \
+            throw clipx::test::Abort{};                                                \
+        }                                                                              \
+    } while (0)
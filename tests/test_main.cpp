@@ -0,0 +1,55 @@
+#include "test.h"
+#include <cstdio>
+#include <cstring>
+#include <exception>
+
+namespace clipx {
+namespace test {
+
+namespace {
+int g_failures = 0;
+}
+
+std::vector<TestCase>& Registry() {
+    static std::vector<TestCase> registry;
+    return registry;
+}
+
+void Fail(const char* file, int line, const std::string& message) {
+    std::printf("  %s:%d: %s failed\n", file, line, message.c_str());
+    g_failures++;
+}
+
+} // namespace test
+} // namespace clipx
+
+int main(int argc, char** argv) {
+    using namespace clipx::test;
+    const char* suite = argc > 1 ? argv[1] : nullptr;
+
+    int run = 0;
+    int failed = 0;
+    for (const auto& test : Registry()) {
+        if (suite && std::strcmp(test.suite, suite) != 0) {
+            continue;
+        }
+        run++;
+        int before = g_failures;
+        try {
+            test.run();
+        } catch (const Abort&) {
+        } catch (const std::exception& e) {
+            Fail(test.suite, 0, std::string("unexpected exception: ") + e.what());
+        }
+        bool passed = g_failures == before;
+        failed += passed ? 0 : 1;
+        std::printf("[%s] %s.%s\n", passed ? "  OK  " : " FAIL ", test.suite, test.name);
+    }
+
+    if (run == 0) {
+        std::printf("No tests%s%s\n", suite ? " in suite " : "", suite ? suite : "");
+        return 1;
+    }
+    std::printf("%d of %d tests passed\n", run - failed, run);
+    return failed == 0 ? 0 : 1;
+}
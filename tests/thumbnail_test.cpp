@@ -0,0 +1,311 @@
+#include "test.h"
+#include "common/thumbnail.h"
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace clipx;
+using namespace clipx::image;
+
+namespace {
+
+constexpr size_t HEADER_SIZE = 40;
+
+// BGRA pixels, top row first
+struct Image {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> pixels;
+
+    const uint8_t* At(int x, int y) const { return pixels.data() + (static_cast<size_t>(y) * width + x) * 4; }
+};
+
+// A deterministic pattern with detail in every channel, so that a row or
+// channel mixed up anywhere shows
+Image MakeImage(int width, int height, bool alpha = false) {
+    Image image;
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(static_cast<size_t>(width) * height * 4);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            uint8_t* p = image.pixels.data() + (static_cast<size_t>(y) * width + x) * 4;
+            p[0] = static_cast<uint8_t>(x * 7 + y * 3);
+            p[1] = static_cast<uint8_t>(x * y + 11);
+            p[2] = static_cast<uint8_t>(255 - y * 5 + x);
+            p[3] = alpha ? static_cast<uint8_t>((x + y) * 9) : 255;
+        }
+    }
+    return image;
+}
+
+void PutU32(std::vector<uint8_t>& buffer, size_t offset, uint32_t value) {
+    std::memcpy(buffer.data() + offset, &value, sizeof(value));
+}
+
+void PutU16(std::vector<uint8_t>& buffer, size_t offset, uint16_t value) {
+    std::memcpy(buffer.data() + offset, &value, sizeof(value));
+}
+
+enum class Layout {
+    Rgb,        // BI_RGB
+    Bitfields,  // BI_BITFIELDS, BGRX masks after the header
+    Rgba        // BI_BITFIELDS in a V4-sized header, RGBA byte order with alpha
+};
+
+// Packed DIB of `image` at 24 or 32 bpp
+std::vector<uint8_t> MakeDib(const Image& image, int bitCount, Layout layout, bool topDown) {
+    const size_t headerSize = layout == Layout::Rgba ? 108 : HEADER_SIZE;
+    const size_t masksSize = layout == Layout::Bitfields ? 12 : 0;
+    const size_t stride = ((static_cast<size_t>(image.width) * bitCount + 31) / 32) * 4;
+    std::vector<uint8_t> dib(headerSize + masksSize + stride * image.height, 0);
+    PutU32(dib, 0, static_cast<uint32_t>(headerSize));
+    PutU32(dib, 4, static_cast<uint32_t>(image.width));
+    PutU32(dib, 8, static_cast<uint32_t>(topDown ? -image.height : image.height));
+    PutU16(dib, 12, 1);
+    PutU16(dib, 14, static_cast<uint16_t>(bitCount));
+    PutU32(dib, 16, layout == Layout::Rgb ? 0 : 3);
+    if (layout == Layout::Bitfields) {
+        PutU32(dib, HEADER_SIZE, 0x00FF0000);
+        PutU32(dib, HEADER_SIZE + 4, 0x0000FF00);
+        PutU32(dib, HEADER_SIZE + 8, 0x000000FF);
+    } else if (layout == Layout::Rgba) {
+        PutU32(dib, HEADER_SIZE, 0x000000FF);
+        PutU32(dib, HEADER_SIZE + 4, 0x0000FF00);
+        PutU32(dib, HEADER_SIZE + 8, 0x00FF0000);
+        PutU32(dib, HEADER_SIZE + 12, 0xFF000000);
+    }
+
+    uint8_t* bits = dib.data() + headerSize + masksSize;
+    for (int y = 0; y < image.height; y++) {
+        uint8_t* row = bits + static_cast<size_t>(topDown ? y : image.height - 1 - y) * stride;
+        for (int x = 0; x < image.width; x++) {
+            const uint8_t* p = image.At(x, y);
+            if (bitCount == 24) {
+                std::memcpy(row + x * 3, p, 3);
+            } else if (layout == Layout::Rgba) {
+                uint8_t* q = row + x * 4;
+                q[0] = p[2];
+                q[1] = p[1];
+                q[2] = p[0];
+                q[3] = p[3];
+            } else {
+                std::memcpy(row + x * 4, p, 4);
+            }
+        }
+    }
+    return dib;
+}
+
+// The box filter spelled out: the rounded mean of every source pixel whose
+// box [i * src / dst, (i + 1) * src / dst) covers, per channel
+Image ReferenceScale(const Image& src, int width, int height, bool keepAlpha) {
+    Image out;
+    out.width = width;
+    out.height = height;
+    out.pixels.resize(static_cast<size_t>(width) * height * 4);
+    for (int ty = 0; ty < height; ty++) {
+        const int y0 = ty * src.height / height;
+        const int y1 = (ty + 1) * src.height / height;
+        for (int tx = 0; tx < width; tx++) {
+            const int x0 = tx * src.width / width;
+            const int x1 = (tx + 1) * src.width / width;
+            double sum[4] = {};
+            for (int y = y0; y < y1; y++) {
+                for (int x = x0; x < x1; x++) {
+                    for (int c = 0; c < 4; c++) {
+                        sum[c] += src.At(x, y)[c];
+                    }
+                }
+            }
+            const double area = static_cast<double>((x1 - x0) * (y1 - y0));
+            uint8_t* p = out.pixels.data() + (static_cast<size_t>(ty) * width + tx) * 4;
+            for (int c = 0; c < 4; c++) {
+                p[c] = static_cast<uint8_t>(std::floor(sum[c] / area + 0.5));
+            }
+            if (!keepAlpha) {
+                p[3] = 255;
+            }
+        }
+    }
+    return out;
+}
+
+int32_t ReadI32(const std::vector<uint8_t>& buffer, size_t offset) {
+    int32_t value;
+    std::memcpy(&value, buffer.data() + offset, sizeof(value));
+    return value;
+}
+
+bool Parses(const std::vector<uint8_t>& dib) {
+    DibInfo info;
+    return ParseDib(dib.data(), dib.size(), info);
+}
+
+} // namespace
+
+TEST(Thumbnail, ParsesHeaderVariants) {
+    const Image image = MakeImage(13, 7, true);
+    struct Variant {
+        int bitCount;
+        Layout layout;
+    } variants[] = {{24, Layout::Rgb}, {32, Layout::Rgb}, {32, Layout::Bitfields}, {32, Layout::Rgba}};
+
+    for (const auto& variant : variants) {
+        for (bool topDown : {false, true}) {
+            std::vector<uint8_t> dib = MakeDib(image, variant.bitCount, variant.layout, topDown);
+            DibInfo info;
+            REQUIRE(ParseDib(dib.data(), dib.size(), info));
+            CHECK(info.width == 13);
+            CHECK(info.height == 7);
+            CHECK(info.topDown == topDown);
+            CHECK(info.bitCount == variant.bitCount);
+            CHECK(info.stride == (variant.bitCount == 24 ? 40u : 52u));
+            CHECK(info.bits + info.stride * 7 == dib.data() + dib.size());
+            CHECK(info.masks[3] == (variant.layout == Layout::Rgba ? 0xFF000000u : 0u));
+
+            // Same size: converted, not scaled
+            std::vector<uint8_t> pixels = ScaleDib(info, 13, 7);
+            REQUIRE(pixels.size() == image.pixels.size());
+            bool same = true;
+            for (size_t i = 0; i < pixels.size(); i++) {
+                uint8_t expected = i % 4 == 3 && variant.layout != Layout::Rgba ? 255 : image.pixels[i];
+                same = same && pixels[i] == expected;
+            }
+            CHECK(same);
+        }
+    }
+}
+
+TEST(Thumbnail, ScalerMatchesReferenceBoxFilter) {
+    struct Case {
+        int srcWidth, srcHeight, width, height;
+    } cases[] = {{64, 64, 48, 48}, {100, 37, 48, 18}, {7, 300, 1, 48}, {49, 49, 48, 48},
+                 {33, 17, 5, 3},   {48, 48, 48, 48}, {250, 1, 48, 1},  {5, 5, 1, 1}};
+
+    for (const auto& c : cases) {
+        for (int bitCount : {24, 32}) {
+            const bool alpha = bitCount == 32;
+            const Image image = MakeImage(c.srcWidth, c.srcHeight, alpha);
+            std::vector<uint8_t> dib = MakeDib(image, bitCount, alpha ? Layout::Rgba : Layout::Rgb, false);
+            DibInfo info;
+            REQUIRE(ParseDib(dib.data(), dib.size(), info));
+
+            std::vector<uint8_t> scaled = ScaleDib(info, c.width, c.height);
+            const Image expected = ReferenceScale(image, c.width, c.height, alpha);
+            CHECK(scaled == expected.pixels);
+        }
+    }
+
+    DibInfo info;
+    std::vector<uint8_t> dib = MakeDib(MakeImage(10, 10), 32, Layout::Rgb, true);
+    REQUIRE(ParseDib(dib.data(), dib.size(), info));
+    CHECK(ScaleDib(info, 0, 5).empty());
+    CHECK(ScaleDib(info, 11, 5).empty());  // Never upscales
+    CHECK(ScaleDib(info, 5, 11).empty());
+}
+
+TEST(Thumbnail, MakeThumbnailFitsTheLongestSide) {
+    const Image image = MakeImage(200, 50);
+    std::vector<uint8_t> dib = MakeDib(image, 24, Layout::Rgb, false);
+    std::vector<uint8_t> thumbnail = MakeThumbnail(dib.data(), dib.size());
+
+    // A 32 bpp top-down DIB that parses back
+    DibInfo info;
+    REQUIRE(ParseDib(thumbnail.data(), thumbnail.size(), info));
+    CHECK(info.width == THUMBNAIL_MAX_SIDE);
+    CHECK(info.height == 12);
+    CHECK(info.topDown);
+    CHECK(info.bitCount == 32);
+    CHECK(ReadI32(thumbnail, 8) == -12);
+    CHECK(thumbnail.size() == HEADER_SIZE + 48 * 12 * 4);
+
+    const Image expected = ReferenceScale(image, 48, 12, false);
+    CHECK(std::equal(expected.pixels.begin(), expected.pixels.end(), thumbnail.begin() + HEADER_SIZE));
+
+    // Small images keep their size; a sliver keeps at least a pixel
+    std::vector<uint8_t> small = MakeDib(MakeImage(20, 30), 32, Layout::Rgb, true);
+    thumbnail = MakeThumbnail(small.data(), small.size());
+    REQUIRE(ParseDib(thumbnail.data(), thumbnail.size(), info));
+    CHECK(info.width == 20 && info.height == 30);
+
+    std::vector<uint8_t> sliver = MakeDib(MakeImage(1000, 3), 32, Layout::Rgb, true);
+    thumbnail = MakeThumbnail(sliver.data(), sliver.size());
+    REQUIRE(ParseDib(thumbnail.data(), thumbnail.size(), info));
+    CHECK(info.width == 48 && info.height == 1);
+}
+
+TEST(Thumbnail, RejectsMalformedHeaders) {
+    const std::vector<uint8_t> good = MakeDib(MakeImage(16, 8), 32, Layout::Rgb, false);
+    REQUIRE(Parses(good));
+
+    auto corrupt = [&](size_t offset, uint32_t value, bool u16 = false) {
+        std::vector<uint8_t> dib = good;
+        if (u16) {
+            PutU16(dib, offset, static_cast<uint16_t>(value));
+        } else {
+            PutU32(dib, offset, value);
+        }
+        return dib;
+    };
+
+    CHECK(!Parses(corrupt(0, 12)));           // BITMAPCOREHEADER size
+    CHECK(!Parses(corrupt(0, 0x10000)));      // Header larger than the buffer
+    CHECK(!Parses(corrupt(4, 0)));            // Zero width
+    CHECK(!Parses(corrupt(4, 0xFFFFFFF0)));   // Negative width
+    CHECK(!Parses(corrupt(4, 70000)));        // Too wide
+    CHECK(!Parses(corrupt(8, 0)));            // Zero height
+    CHECK(!Parses(corrupt(8, 0x80000000)));   // INT32_MIN height
+    CHECK(!Parses(corrupt(8, static_cast<uint32_t>(-70000))));
+    CHECK(!Parses(corrupt(12, 2, true)));     // Planes
+    CHECK(!Parses(corrupt(14, 0, true)));     // Bit counts
+    CHECK(!Parses(corrupt(14, 7, true)));
+    CHECK(!Parses(corrupt(14, 64, true)));
+    CHECK(!Parses(corrupt(16, 1)));           // RLE8
+    CHECK(!Parses(corrupt(16, 4)));           // JPEG
+    CHECK(!Parses(corrupt(16, 5)));           // PNG
+    CHECK(!Parses(corrupt(32, 0x40000000)));  // Color table past the end
+
+    // Bitfields need 16 or 32 bpp, and room for their masks
+    std::vector<uint8_t> dib24 = MakeDib(MakeImage(4, 4), 24, Layout::Rgb, false);
+    PutU32(dib24, 16, 3);
+    CHECK(!Parses(dib24));
+    std::vector<uint8_t> masks = MakeDib(MakeImage(1, 1), 32, Layout::Bitfields, false);
+    REQUIRE(Parses(masks));
+    masks.resize(HEADER_SIZE + 8);
+    CHECK(!Parses(masks));
+
+    // Palette images need their color table
+    std::vector<uint8_t> indexed(HEADER_SIZE + 4 * 4, 0);
+    PutU32(indexed, 0, HEADER_SIZE);
+    PutU32(indexed, 4, 4);
+    PutU32(indexed, 8, 4);
+    PutU16(indexed, 12, 1);
+    PutU16(indexed, 14, 8);
+    CHECK(!Parses(indexed));
+    PutU32(indexed, 32, 2);  // Two colors, still no room for the pixels
+    CHECK(!Parses(indexed));
+    indexed.resize(HEADER_SIZE + 2 * 4 + 4 * 4);
+    CHECK(Parses(indexed));
+
+    CHECK(MakeThumbnail(nullptr, 0).empty());
+    CHECK(MakeThumbnail(good.data(), good.size(), 0).empty());
+    std::vector<uint8_t> bad = corrupt(16, 1);
+    CHECK(MakeThumbnail(bad.data(), bad.size()).empty());
+}
+
+TEST(Thumbnail, RejectsTruncatedPixels) {
+    for (int bitCount : {24, 32}) {
+        for (bool topDown : {false, true}) {
+            const std::vector<uint8_t> dib = MakeDib(MakeImage(9, 5), bitCount, Layout::Rgb, topDown);
+            REQUIRE(Parses(dib));
+            for (size_t size = 0; size < dib.size(); size++) {
+                // Copies of exactly `size` bytes, so sanitizers see overreads
+                std::vector<uint8_t> prefix(dib.begin(), dib.begin() + static_cast<ptrdiff_t>(size));
+                DibInfo info;
+                CHECK(!ParseDib(prefix.data(), prefix.size(), info));
+                CHECK(MakeThumbnail(prefix.data(), prefix.size()).empty());
+            }
+        }
+    }
+}
@@ -0,0 +1,285 @@
+#include "test.h"
+#include "common/utf.h"
+#include "common/utils.h"
+#include <string>
+#include <vector>
+
+using namespace clipx;
+
+namespace {
+
+constexpr char32_t REPLACEMENT = 0xFFFD;
+
+// Byte-at-a-time decoder following the Unicode "maximal subpart" rule: a
+// U+FFFD for every prefix of a well-formed sequence cut short, and for
+// every byte that can't start one
+std::u32string ReferenceDecode(const std::string& text) {
+    std::u32string out;
+    const size_t n = text.size();
+    size_t i = 0;
+    while (i < n) {
+        unsigned char b = static_cast<unsigned char>(text[i]);
+        if (b < 0x80) {
+            out += b;
+            i++;
+            continue;
+        }
+
+        int need;
+        char32_t cp;
+        unsigned char lo = 0x80, hi = 0xBF;
+        if (b >= 0xC2 && b <= 0xDF) {
+            need = 1;
+            cp = b & 0x1F;
+        } else if (b >= 0xE0 && b <= 0xEF) {
+            need = 2;
+            cp = b & 0x0F;
+            if (b == 0xE0) lo = 0xA0;  // Overlong
+            if (b == 0xED) hi = 0x9F;  // Surrogates
+        } else if (b >= 0xF0 && b <= 0xF4) {
+            need = 3;
+            cp = b & 0x07;
+            if (b == 0xF0) lo = 0x90;  // Overlong
+            if (b == 0xF4) hi = 0x8F;  // Past U+10FFFF
+        } else {
+            out += REPLACEMENT;
+            i++;
+            continue;
+        }
+
+        size_t j = i + 1;
+        int got = 0;
+        while (got < need && j < n) {
+            unsigned char c = static_cast<unsigned char>(text[j]);
+            if (c < lo || c > hi) break;
+            cp = (cp << 6) | (c & 0x3F);
+            lo = 0x80;
+            hi = 0xBF;
+            j++;
+            got++;
+        }
+        out += got == need ? cp : REPLACEMENT;
+        i = j;
+    }
+    return out;
+}
+
+std::string ReferenceEncode(const std::u32string& text) {
+    std::string out;
+    for (char32_t cp : text) {
+        if (cp < 0x80) {
+            out += static_cast<char>(cp);
+        } else if (cp < 0x800) {
+            out += static_cast<char>(0xC0 | (cp >> 6));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            out += static_cast<char>(0xE0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (cp >> 18));
+            out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+    return out;
+}
+
+std::u16string ToUtf16(const std::u32string& text) {
+    std::u16string out;
+    for (char32_t cp : text) {
+        if (cp < 0x10000) {
+            out += static_cast<char16_t>(cp);
+        } else {
+            out += static_cast<char16_t>(0xD800 + ((cp - 0x10000) >> 10));
+            out += static_cast<char16_t>(0xDC00 + ((cp - 0x10000) & 0x3FF));
+        }
+    }
+    return out;
+}
+
+std::u32string DecodeUtf32(const std::string& text, bool* valid = nullptr) {
+    std::u32string out(utf::MaxUtf32ForUtf8(text.size()), U'\0');
+    out.resize(utf::Utf8ToUtf32(text.data(), text.size(), &out[0], valid));
+    return out;
+}
+
+std::u16string DecodeUtf16(const std::string& text, bool* valid = nullptr) {
+    std::u16string out(utf::MaxUtf16ForUtf8(text.size()), u'\0');
+    out.resize(utf::Utf8ToUtf16(text.data(), text.size(), &out[0], valid));
+    return out;
+}
+
+std::string EncodeUtf16(const std::u16string& text, bool* valid = nullptr) {
+    std::string out(utf::MaxUtf8ForUtf16(text.size()), '\0');
+    out.resize(utf::Utf16ToUtf8(text.data(), text.size(), &out[0], valid));
+    return out;
+}
+
+std::string EncodeUtf32(const std::u32string& text, bool* valid = nullptr) {
+    std::string out(utf::MaxUtf8ForUtf32(text.size()), '\0');
+    out.resize(utf::Utf32ToUtf8(text.data(), text.size(), &out[0], valid));
+    return out;
+}
+
+// Decodes `text` every way and checks each against the reference
+void CheckDecodes(const std::string& text) {
+    std::u32string expected = ReferenceDecode(text);
+    bool expectValid = expected.find(REPLACEMENT) == std::u32string::npos;
+
+    bool valid = !expectValid;
+    CHECK(DecodeUtf32(text, &valid) == expected);
+    CHECK(valid == expectValid);
+    valid = !expectValid;
+    CHECK(DecodeUtf16(text, &valid) == ToUtf16(expected));
+    CHECK(valid == expectValid);
+    CHECK(utf::ValidateUtf8(text.data(), text.size()) == expectValid);
+
+    std::wstring wide = utils::Utf8ToWide(text);
+    if (sizeof(wchar_t) == 2) {
+        std::u16string utf16 = ToUtf16(expected);
+        CHECK(wide == std::wstring(utf16.begin(), utf16.end()));
+    } else {
+        CHECK(wide == std::wstring(expected.begin(), expected.end()));
+    }
+}
+
+const std::string EURO = "\xE2\x82\xAC";           // U+20AC
+const std::string EMOJI = "\xF0\x9F\x98\x80";      // U+1F600
+const std::string ACCENTED = "\xC3\xA9";           // U+00E9
+
+} // namespace
+
+TEST(Utf, OverlongSequencesAreReplaced) {
+    CHECK(DecodeUtf32("\xC0\xAF") == std::u32string(2, REPLACEMENT));
+    CHECK(DecodeUtf32("\xC1\xBF") == std::u32string(2, REPLACEMENT));
+    CHECK(DecodeUtf32("\xE0\x80\xAF") == std::u32string(3, REPLACEMENT));
+    CHECK(DecodeUtf32("\xE0\x9F\xBF") == std::u32string(3, REPLACEMENT));
+    CHECK(DecodeUtf32("\xF0\x80\x80\xAF") == std::u32string(4, REPLACEMENT));
+    CHECK(DecodeUtf32("\xF0\x8F\xBF\xBF") == std::u32string(4, REPLACEMENT));
+
+    // The shortest forms right above them are fine
+    CHECK(DecodeUtf32("\xC2\x80") == std::u32string(1, 0x80));
+    CHECK(DecodeUtf32("\xE0\xA0\x80") == std::u32string(1, 0x800));
+    CHECK(DecodeUtf32("\xF0\x90\x80\x80") == std::u32string(1, 0x10000));
+
+    for (const char* text : {"\xC0\xAF", "\xE0\x80\xAF", "\xF0\x80\x80\xAF", "a\xC1\x81z"}) {
+        CheckDecodes(text);
+    }
+}
+
+TEST(Utf, SurrogatesAndOutOfRangeAreReplaced) {
+    // UTF-8 encoded surrogates (CESU-8) are not UTF-8
+    CHECK(DecodeUtf32("\xED\xA0\x80") == std::u32string(3, REPLACEMENT));
+    CHECK(DecodeUtf32("\xED\xBF\xBF") == std::u32string(3, REPLACEMENT));
+    CHECK(DecodeUtf32("\xED\xA0\xBD\xED\xB8\x80") == std::u32string(6, REPLACEMENT));
+    CHECK(DecodeUtf32("\xED\x9F\xBF") == std::u32string(1, 0xD7FF));
+    CHECK(DecodeUtf32("\xEE\x80\x80") == std::u32string(1, 0xE000));
+
+    CHECK(DecodeUtf32("\xF4\x8F\xBF\xBF") == std::u32string(1, 0x10FFFF));
+    CHECK(DecodeUtf32("\xF4\x90\x80\x80") == std::u32string(4, REPLACEMENT));
+    CHECK(DecodeUtf32("\xF5\x80\x80\x80") == std::u32string(4, REPLACEMENT));
+    CHECK(DecodeUtf32("\xFF\xFE") == std::u32string(2, REPLACEMENT));
+
+    // Nor can UTF-32 carry them
+    bool valid = true;
+    CHECK(EncodeUtf32(std::u32string{U'a', 0xD800, U'b'}, &valid) == "a\xEF\xBF\xBD" "b");
+    CHECK(!valid);
+    valid = true;
+    CHECK(EncodeUtf32(std::u32string{0x110000}, &valid) == "\xEF\xBF\xBD");
+    CHECK(!valid);
+    valid = false;
+    CHECK(EncodeUtf32(std::u32string{0x10FFFF, 0x1F600}, &valid) == "\xF4\x8F\xBF\xBF" + EMOJI);
+    CHECK(valid);
+}
+
+TEST(Utf, TruncatedSequencesAreReplacedOnce) {
+    // A cut-short sequence is one replacement, and the next character survives
+    CHECK(DecodeUtf32("\xE2\x82") == std::u32string(1, REPLACEMENT));
+    CHECK(DecodeUtf32("\xF0\x9F\x98") == std::u32string(1, REPLACEMENT));
+    CHECK(DecodeUtf32("\xF0\x9F\x98" "a") == (std::u32string{REPLACEMENT, U'a'}));
+    CHECK(DecodeUtf32("\xE2\x82" + EURO) == (std::u32string{REPLACEMENT, 0x20AC}));
+    CHECK(DecodeUtf32("\xC3") == std::u32string(1, REPLACEMENT));
+
+    // A lone continuation byte is one replacement each
+    CHECK(DecodeUtf32("\x80\xBF" "a") == (std::u32string{REPLACEMENT, REPLACEMENT, U'a'}));
+
+    // Every prefix of a valid text, cut anywhere
+    std::string text = "a" + ACCENTED + EURO + EMOJI + "z";
+    for (size_t size = 0; size <= text.size(); size++) {
+        CheckDecodes(text.substr(0, size));
+    }
+}
+
+TEST(Utf, LoneUtf16SurrogatesAreReplaced) {
+    const std::string replacement = "\xEF\xBF\xBD";
+    const std::u16string cases[] = {
+        {0xD800}, {0xDC00}, {u'a', 0xD83D}, {0xD83D, u'a'}, {0xDE00, 0xD83D}, {0xD83D, 0xD83D, 0xDE00},
+    };
+    const std::string expected[] = {
+        replacement, replacement, "a" + replacement, replacement + "a", replacement + replacement,
+        replacement + EMOJI,
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        bool valid = true;
+        CHECK(EncodeUtf16(cases[i], &valid) == expected[i]);
+        CHECK(!valid);
+    }
+
+    bool valid = false;
+    CHECK(EncodeUtf16(std::u16string{0xD83D, 0xDE00, 0x20AC}, &valid) == EMOJI + EURO);
+    CHECK(valid);
+
+    // Also in long inputs, where the vector path runs, at every position
+    for (size_t at : {size_t(0), size_t(31), size_t(32), size_t(63), size_t(64), size_t(127), size_t(199)}) {
+        std::u16string text(200, u'x');
+        text[at] = 0xDC00;
+        std::string out = EncodeUtf16(text, &valid);
+        CHECK(!valid);
+        CHECK(out == std::string(at, 'x') + replacement + std::string(199 - at, 'x'));
+    }
+}
+
+TEST(Utf, LengthsAroundTheVectorThresholds) {
+    // 64 units is where the vector loops start, 128 where utils stops using
+    // a stack buffer; each length gets ASCII, mixed and broken inputs
+    const std::string units[] = {"a", ACCENTED, EURO, EMOJI};
+    for (size_t length = 0; length <= 260; length++) {
+        if (length > 140 && length % 31 != 0) continue;
+
+        std::string ascii(length, 'q');
+        std::string mixed;
+        for (size_t i = 0; mixed.size() < length; i++) {
+            mixed += units[(i * 7) % 4];
+        }
+        mixed.resize(length);  // May cut the last character
+        for (const std::string& text : {ascii, mixed}) {
+            CheckDecodes(text);
+
+            std::string broken = text;
+            if (!broken.empty()) {
+                broken[length / 2] = '\xFF';
+                CheckDecodes(broken);
+                broken[length - 1] = '\xC3';
+                CheckDecodes(broken);
+            }
+        }
+
+        // Valid text round-trips through every encoding
+        std::string valid = ReferenceEncode(ReferenceDecode(mixed));
+        std::u32string decoded = ReferenceDecode(valid);
+        CHECK(EncodeUtf32(decoded) == valid);
+        CHECK(EncodeUtf16(ToUtf16(decoded)) == valid);
+        CHECK(utils::WideToUtf8(utils::Utf8ToWide(valid)) == valid);
+    }
+
+    // Wide strings just under the short-conversion size that expand the most
+    for (size_t length : {size_t(127), size_t(128), size_t(129)}) {
+        std::string text;
+        for (size_t i = 0; i < length; i++) text += sizeof(wchar_t) == 2 ? EURO : EMOJI;
+        std::wstring wide = utils::Utf8ToWide(text);
+        CHECK(wide.size() == length);
+        CHECK(utils::WideToUtf8(wide) == text);
+    }
+}